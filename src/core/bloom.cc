@@ -10,8 +10,10 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstring>
 
 #include "base/logging.h"
+#include "core/sse_port.h"
 
 namespace dfly {
 
@@ -34,6 +36,38 @@ inline uint64_t BitIndex(uint64_t low, uint64_t hi, unsigned i, uint64_t mask) {
 constexpr double kDenom = M_LN2 * M_LN2;
 constexpr double kSBFErrorFactor = 0.5;
 
+constexpr unsigned kBlockBits = Bloom::kBlockBytes * 8;
+constexpr unsigned kBlockWords = Bloom::kBlockBytes / sizeof(uint64_t);
+
+// Checks whether all the bits of `mask` are set in `block` and sets them if `set` is true.
+// Returns true if all of them were set before.
+bool TestBlock(uint8_t* block, const uint64_t* mask, bool set) {
+#ifndef __s390x__
+  __m128i missing = _mm_setzero_si128();
+  for (unsigned i = 0; i < Bloom::kBlockBytes / sizeof(__m128i); ++i) {
+    __m128i* ptr = reinterpret_cast<__m128i*>(block) + i;
+    __m128i data = _mm_load_si128(ptr);
+    __m128i bits = mm_loadu_si128(reinterpret_cast<const __m128i*>(mask) + i);
+    missing = _mm_or_si128(missing, _mm_andnot_si128(data, bits));
+    if (set)
+      _mm_store_si128(ptr, _mm_or_si128(data, bits));
+  }
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(missing, _mm_setzero_si128())) == 0xFFFF;
+#else
+  uint64_t missing = 0;
+  for (unsigned i = 0; i < kBlockWords; ++i) {
+    uint64_t word;
+    memcpy(&word, block + i * sizeof(word), sizeof(word));
+    missing |= mask[i] & ~word;
+    if (set) {
+      word |= mask[i];
+      memcpy(block + i * sizeof(word), &word, sizeof(word));
+    }
+  }
+  return missing == 0;
+#endif
+}
+
 inline double BPE(double fp_prob) {
   return -log(fp_prob) / kDenom;
 }
@@ -44,11 +78,12 @@ Bloom::~Bloom() {
   CHECK(bf_ == nullptr);
 }
 
-Bloom::Bloom(Bloom&& o) : hash_cnt_(o.hash_cnt_), bit_log_(o.bit_log_), bf_(o.bf_) {
+Bloom::Bloom(Bloom&& o)
+    : hash_cnt_(o.hash_cnt_), bit_log_(o.bit_log_), blocked_(o.blocked_), bf_(o.bf_) {
   o.bf_ = nullptr;
 }
 
-void Bloom::Init(uint64_t entries, double fp_prob, PMR_NS::memory_resource* heap) {
+void Bloom::Init(uint64_t entries, double fp_prob, PMR_NS::memory_resource* heap, bool blocked) {
   CHECK(bf_ == nullptr);
   CHECK(fp_prob > 0 && fp_prob < 1);
 
@@ -65,21 +100,24 @@ void Bloom::Init(uint64_t entries, double fp_prob, PMR_NS::memory_resource* heap
   bits = absl::bit_ceil(bits);  // make it power of 2.
 
   uint64_t length = bits / 8;
-  bf_ = (uint8_t*)heap->allocate(length);
+  bf_ = (uint8_t*)heap->allocate(length, kBlockBytes);
   memset(bf_, 0, length);
   bit_log_ = absl::countr_zero(bits);
+  blocked_ = blocked;
 }
 
-void Bloom::Init(uint8_t* blob, size_t len, unsigned hash_cnt) {
+void Bloom::Init(uint8_t* blob, size_t len, unsigned hash_cnt, bool blocked) {
   DCHECK_EQ(len * 8, absl::bit_ceil(len * 8));  // must be power of two.
+  DCHECK_EQ(reinterpret_cast<uintptr_t>(blob) % kBlockBytes, 0u);
   CHECK(bf_ == nullptr);
   hash_cnt_ = hash_cnt;
   bf_ = blob;
   bit_log_ = absl::countr_zero(len * 8);
+  blocked_ = blocked;
 }
 
 void Bloom::Destroy(PMR_NS::memory_resource* resource) {
-  resource->deallocate(CHECK_NOTNULL(bf_), bitlen() / 8);
+  resource->deallocate(CHECK_NOTNULL(bf_), bitlen() / 8, kBlockBytes);
   bf_ = nullptr;
 }
 
@@ -91,6 +129,12 @@ bool Bloom::Exists(std::string_view str) const {
 }
 
 bool Bloom::Exists(const uint64_t fp[2]) const {
+  if (blocked_) {
+    uint64_t bits[kBlockWords];
+    BlockMask(fp, bits);
+    return TestBlock(Block(fp), bits, false);
+  }
+
   uint64_t mask = GetMask(bit_log_);
   for (unsigned i = 0; i < hash_cnt_; ++i) {
     uint64_t index = BitIndex(fp[0], fp[1], i, mask);
@@ -107,6 +151,12 @@ bool Bloom::Add(std::string_view str) {
 }
 
 bool Bloom::Add(const uint64_t fp[2]) {
+  if (blocked_) {
+    uint64_t bits[kBlockWords];
+    BlockMask(fp, bits);
+    return !TestBlock(Block(fp), bits, true);
+  }
+
   uint64_t mask = GetMask(bit_log_);
 
   unsigned changes = 0;
@@ -118,6 +168,18 @@ bool Bloom::Add(const uint64_t fp[2]) {
   return changes != 0;
 }
 
+void Bloom::Prefetch(const uint64_t fp[2]) const {
+  if (blocked_) {
+    __builtin_prefetch(Block(fp));
+    return;
+  }
+
+  uint64_t mask = GetMask(bit_log_);
+  for (unsigned i = 0; i < hash_cnt_; ++i) {
+    __builtin_prefetch(bf_ + BitIndex(fp[0], fp[1], i, mask) / 8);
+  }
+}
+
 size_t Bloom::Capacity(double fp_prob) const {
   if (fp_prob > 0.5)
     fp_prob = 0.5;
@@ -132,6 +194,24 @@ inline bool Bloom::IsSet(size_t bit_idx) const {
   return (b & (1 << bit_idx)) != 0;
 }
 
+uint8_t* Bloom::Block(const uint64_t fp[2]) const {
+  uint64_t block_idx = fp[0] & GetMask(bit_log_ - absl::countr_zero(kBlockBits));
+  return bf_ + block_idx * kBlockBytes;
+}
+
+void Bloom::BlockMask(const uint64_t fp[2], uint64_t* mask) const {
+  // Each bit is taken from the top bits of a multiplicative hash sequence. Unlike double hashing
+  // modulo kBlockBits, it does not limit the number of distinct bit patterns, which would
+  // otherwise dominate the false positive rate.
+  memset(mask, 0, kBlockBytes);
+  uint64_t h = fp[1];
+  for (unsigned i = 0; i < hash_cnt_; ++i) {
+    h *= 0x9E3779B97F4A7C15ULL;
+    unsigned bit = h >> (64 - absl::countr_zero(kBlockBits));
+    mask[bit / 64] |= 1ULL << (bit % 64);
+  }
+}
+
 inline bool Bloom::Set(size_t bit_idx) {
   uint64_t byte_idx = bit_idx / 8;
   bit_idx %= 8;
@@ -144,20 +224,25 @@ inline bool Bloom::Set(size_t bit_idx) {
 ///////////////////////////////////////////////////////////////////////////////
 // SBF implementation
 ///////////////////////////////////////////////////////////////////////////////
-SBF::SBF(uint64_t initial_capacity, double fp_prob, double grow_factor, PMR_NS::memory_resource* mr)
-    : filters_(1, mr), grow_factor_(grow_factor), fp_prob_(fp_prob * kSBFErrorFactor) {
-  filters_.front().Init(initial_capacity, fp_prob_, mr);
+SBF::SBF(uint64_t initial_capacity, double fp_prob, double grow_factor, PMR_NS::memory_resource* mr,
+         bool blocked)
+    : filters_(1, mr),
+      grow_factor_(grow_factor),
+      fp_prob_(fp_prob * kSBFErrorFactor),
+      blocked_(blocked) {
+  filters_.front().Init(initial_capacity, fp_prob_, mr, blocked_);
   max_capacity_ = filters_.front().Capacity(fp_prob_);
 }
 
 SBF::SBF(double grow_factor, double fp_prob, size_t max_capacity, size_t prev_size,
-         size_t current_size, PMR_NS::memory_resource* mr)
+         size_t current_size, PMR_NS::memory_resource* mr, bool blocked)
     : filters_(mr),
       grow_factor_(grow_factor),
       fp_prob_(fp_prob),
       prev_size_(prev_size),
       current_size_(current_size),
-      max_capacity_(max_capacity) {
+      max_capacity_(max_capacity),
+      blocked_(blocked) {
 }
 
 SBF::~SBF() {
@@ -171,24 +256,50 @@ SBF& SBF::operator=(SBF&& src) {
   filters_.swap(src.filters_);
   grow_factor_ = src.grow_factor_;
   fp_prob_ = src.fp_prob_;
+  prev_size_ = src.prev_size_;
   current_size_ = src.current_size_;
   max_capacity_ = src.max_capacity_;
+  blocked_ = src.blocked_;
 
   return *this;
 }
 
 void SBF::AddFilter(const std::string& blob, unsigned hash_cnt) {
   PMR_NS::memory_resource* mr = filters_.get_allocator().resource();
-  uint8_t* ptr = (uint8_t*)mr->allocate(blob.size(), 1);
+  uint8_t* ptr = (uint8_t*)mr->allocate(blob.size(), Bloom::kBlockBytes);
   memcpy(ptr, blob.data(), blob.size());
-  filters_.emplace_back().Init(ptr, blob.size(), hash_cnt);
+  filters_.emplace_back().Init(ptr, blob.size(), hash_cnt, blocked_);
 }
 
 bool SBF::Add(std::string_view str) {
-  DCHECK_LT(current_size_, max_capacity_);
-
   XXH128_hash_t hash = Hash(str);
   uint64_t fp[2] = {hash.low64, hash.high64};
+  return Add(fp);
+}
+
+void SBF::Add(absl::Span<const std::string_view> items, bool* res) {
+  uint64_t fps[kBatchSize][2];
+  for (size_t start = 0; start < items.size(); start += kBatchSize) {
+    size_t len = min<size_t>(kBatchSize, items.size() - start);
+    for (size_t i = 0; i < len; ++i) {
+      XXH128_hash_t hash = Hash(items[start + i]);
+      fps[i][0] = hash.low64;
+      fps[i][1] = hash.high64;
+
+      // New items are checked against all the filters.
+      for (const Bloom& b : filters_)
+        b.Prefetch(fps[i]);
+    }
+
+    // Items are added one by one, as each of them may trigger a new filter.
+    for (size_t i = 0; i < len; ++i) {
+      res[start + i] = Add(fps[i]);
+    }
+  }
+}
+
+bool SBF::Add(const uint64_t fp[2]) {
+  DCHECK_LT(current_size_, max_capacity_);
 
   auto exists = [fp](const Bloom& b) { return b.Exists(fp); };
 
@@ -207,7 +318,7 @@ bool SBF::Add(std::string_view str) {
   if (current_size_ >= max_capacity_) {
     fp_prob_ *= kSBFErrorFactor;
     filters_.emplace_back().Init(max_capacity_ * grow_factor_, fp_prob_,
-                                 filters_.get_allocator().resource());
+                                 filters_.get_allocator().resource(), blocked_);
     current_size_ = 0;
     max_capacity_ = filters_.back().Capacity(fp_prob_);
   }
@@ -224,6 +335,31 @@ bool SBF::Exists(std::string_view str) const {
   return any_of(filters_.crbegin(), filters_.crend(), exists);
 }
 
+void SBF::Exists(absl::Span<const std::string_view> items, bool* res) const {
+  uint64_t fps[kBatchSize][2];
+  for (size_t start = 0; start < items.size(); start += kBatchSize) {
+    size_t len = min<size_t>(kBatchSize, items.size() - start);
+    for (size_t i = 0; i < len; ++i) {
+      XXH128_hash_t hash = Hash(items[start + i]);
+      fps[i][0] = hash.low64;
+      fps[i][1] = hash.high64;
+      res[start + i] = false;
+    }
+
+    // Probe the filters one at a time, from the largest one, skipping the items already found.
+    for (auto it = filters_.crbegin(); it != filters_.crend(); ++it) {
+      for (size_t i = 0; i < len; ++i) {
+        if (!res[start + i])
+          it->Prefetch(fps[i]);
+      }
+      for (size_t i = 0; i < len; ++i) {
+        if (!res[start + i])
+          res[start + i] = it->Exists(fps[i]);
+      }
+    }
+  }
+}
+
 size_t SBF::MallocUsed() const {
   size_t res = filters_.capacity() * sizeof(Bloom);
   for (const auto& b : filters_) {
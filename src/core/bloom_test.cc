@@ -3,6 +3,7 @@
 //
 
 #include "core/bloom.h"
+#include "core/cuckoo_filter.h"
 
 #include <absl/strings/str_cat.h>
 #include <gmock/gmock.h>
@@ -88,6 +89,106 @@ TEST_F(BloomTest, SBF) {
   EXPECT_LE(collisions, kNumElems * 0.008);
 }
 
+TEST_F(BloomTest, Blocked) {
+  Bloom b2;
+  b2.Init(1000, 0.001, PMR_NS::get_default_resource(), true);
+  EXPECT_TRUE(b2.blocked());
+
+  size_t max_capacity = b2.Capacity(0.001);
+  unsigned collisions = 0;
+  for (unsigned i = 0; i < max_capacity; ++i) {
+    if (!b2.Add(absl::StrCat("item", i))) {
+      ++collisions;
+    }
+  }
+  for (unsigned i = 0; i < max_capacity; ++i) {
+    ASSERT_TRUE(b2.Exists(absl::StrCat("item", i)));
+  }
+
+  // The blocked layout trades some accuracy for a single cache miss per probe.
+  EXPECT_LE(collisions, max_capacity * 0.005);
+  b2.Destroy(PMR_NS::get_default_resource());
+}
+
+TEST_F(BloomTest, SBFBatched) {
+  for (bool blocked : {false, true}) {
+    SBF sequential(10, 0.01, 2, PMR_NS::get_default_resource(), blocked);
+    SBF batched(10, 0.01, 2, PMR_NS::get_default_resource(), blocked);
+
+    constexpr unsigned kNumElems = 10000;
+    vector<string> items;
+    for (unsigned i = 0; i < kNumElems; ++i) {
+      items.push_back(absl::StrCat("item", i % (kNumElems / 2)));
+    }
+    vector<string_view> views(items.begin(), items.end());
+
+    // The batched versions must yield the same results as the sequential ones.
+    unique_ptr<bool[]> res(new bool[kNumElems]);
+    batched.Add(views, res.get());
+    for (unsigned i = 0; i < kNumElems; ++i) {
+      ASSERT_EQ(sequential.Add(views[i]), res[i]) << i;
+    }
+    EXPECT_EQ(sequential.num_filters(), batched.num_filters());
+
+    for (unsigned i = 0; i < kNumElems; ++i) {
+      items[i] = absl::StrCat(i % 2 ? "item" : "other", i);
+    }
+    views.assign(items.begin(), items.end());
+    batched.Exists(views, res.get());
+    for (unsigned i = 0; i < kNumElems; ++i) {
+      ASSERT_EQ(sequential.Exists(views[i]), res[i]) << i;
+    }
+  }
+}
+
+TEST_F(BloomTest, CuckooFilter) {
+  CuckooFilter cf(10, 20, 2, PMR_NS::get_default_resource());
+
+  constexpr unsigned kNumElems = 100000;
+  for (unsigned i = 0; i < kNumElems; ++i) {
+    ASSERT_TRUE(cf.Add(absl::StrCat("item", i)));
+  }
+  EXPECT_GT(cf.num_tables(), 1u);
+  EXPECT_EQ(kNumElems, cf.num_items());
+
+  unsigned false_positives = 0;
+  for (unsigned i = 0; i < kNumElems; ++i) {
+    ASSERT_TRUE(cf.Exists(absl::StrCat("item", i)));
+    false_positives += cf.Exists(absl::StrCat("other", i));
+  }
+  EXPECT_LE(false_positives, kNumElems * 0.003);
+
+  for (unsigned i = 0; i < kNumElems; i += 2) {
+    ASSERT_TRUE(cf.Delete(absl::StrCat("item", i)));
+  }
+  for (unsigned i = 1; i < kNumElems; i += 2) {
+    ASSERT_TRUE(cf.Exists(absl::StrCat("item", i)));
+  }
+  EXPECT_EQ(kNumElems / 2, cf.num_deletes());
+
+  EXPECT_TRUE(cf.Add("dup"));
+  EXPECT_TRUE(cf.Add("dup"));
+  EXPECT_EQ(2, cf.Count("dup"));
+  EXPECT_TRUE(cf.Delete("dup"));
+  EXPECT_EQ(1, cf.Count("dup"));
+}
+
+TEST_F(BloomTest, CuckooFilterFull) {
+  CuckooFilter cf(64, 20, 0, PMR_NS::get_default_resource());
+
+  unsigned added = 0;
+  while (cf.Add(absl::StrCat("item", added))) {
+    ++added;
+  }
+
+  // A failed insertion must not evict any of the previously added items.
+  EXPECT_GE(added, 56u);
+  EXPECT_EQ(1, cf.num_tables());
+  for (unsigned i = 0; i < added; ++i) {
+    ASSERT_TRUE(cf.Exists(absl::StrCat("item", i))) << i;
+  }
+}
+
 static void BM_BloomExist(benchmark::State& state) {
   constexpr size_t kCapacity = 1U << 22;
   Bloom bloom;
@@ -107,4 +208,44 @@ static void BM_BloomExist(benchmark::State& state) {
 }
 BENCHMARK(BM_BloomExist);
 
+static void BM_SBFExistsBatched(benchmark::State& state) {
+  constexpr size_t kCapacity = 1U << 22;
+  SBF sbf(kCapacity, 0.001, 2, PMR_NS::get_default_resource(), state.range(0));
+  for (size_t i = 0; i < kCapacity * 0.8; ++i) {
+    sbf.Add(absl::StrCat("val", i));
+  }
+
+  size_t batch = state.range(1);
+  vector<string> items(batch);
+  vector<string_view> views(batch);
+  unique_ptr<bool[]> res(new bool[batch]);
+  unsigned i = 0;
+  while (state.KeepRunning()) {
+    for (size_t j = 0; j < batch; ++j) {
+      items[j] = absl::StrCat("item", i++);
+      views[j] = items[j];
+    }
+    sbf.Exists(views, res.get());
+  }
+  state.SetItemsProcessed(state.iterations() * batch);
+}
+BENCHMARK(BM_SBFExistsBatched)->Args({0, 1})->Args({0, 64})->Args({1, 1})->Args({1, 64});
+
+static void BM_CuckooExist(benchmark::State& state) {
+  constexpr size_t kCapacity = 1U << 22;
+  CuckooFilter cf(kCapacity, 20, 0, PMR_NS::get_default_resource());
+  for (size_t i = 0; i < kCapacity * 0.8; ++i) {
+    cf.Add(absl::StrCat("val", i));
+  }
+  unsigned i = 0;
+  char buf[32];
+  memset(buf, 'x', sizeof(buf));
+  string_view sv{buf, sizeof(buf)};
+  while (state.KeepRunning()) {
+    absl::numbers_internal::FastIntToBuffer(i, buf);
+    cf.Exists(sv);
+  }
+}
+BENCHMARK(BM_CuckooExist);
+
 }  // namespace dfly
@@ -26,11 +26,15 @@ extern "C" {
 #include "base/logging.h"
 #include "base/pod_array.h"
 #include "core/bloom.h"
+#include "core/count_min_sketch.h"
+#include "core/cuckoo_filter.h"
 #include "core/detail/bitpacking.h"
 #include "core/qlist.h"
 #include "core/sorted_map.h"
 #include "core/string_map.h"
 #include "core/string_set.h"
+#include "core/t_digest.h"
+#include "core/top_k.h"
 
 ABSL_FLAG(bool, experimental_flat_json, false, "If true uses flat json implementation.");
 
@@ -681,6 +685,18 @@ size_t CompactObj::Size() const {
       case SBF_TAG:
         raw_size = u_.sbf->current_size();
         break;
+      case CMS_TAG:
+        raw_size = u_.cms->count();
+        break;
+      case TOPK_TAG:
+        raw_size = u_.topk->heap().size();
+        break;
+      case CF_TAG:
+        raw_size = u_.cf->num_items();
+        break;
+      case TDIGEST_TAG:
+        raw_size = u_.tdigest->num_merged() + u_.tdigest->num_unmerged();
+        break;
       default:
         LOG(DFATAL) << "Should not reach " << int(taglen_);
     }
@@ -743,6 +759,22 @@ CompactObjType CompactObj::ObjType() const {
     return OBJ_SBF;
   }
 
+  if (taglen_ == CMS_TAG) {
+    return OBJ_CMS;
+  }
+
+  if (taglen_ == TOPK_TAG) {
+    return OBJ_TOPK;
+  }
+
+  if (taglen_ == CF_TAG) {
+    return OBJ_CF;
+  }
+
+  if (taglen_ == TDIGEST_TAG) {
+    return OBJ_TDIGEST;
+  }
+
   LOG(FATAL) << "TBD " << int(taglen_);
   return kInvalidCompactObjType;
 }
@@ -787,6 +819,14 @@ auto CompactObj::GetJson() const -> JsonType* {
   return nullptr;
 }
 
+std::pair<uint8_t*, size_t> CompactObj::GetJsonFlat() const {
+  if (ObjType() == OBJ_JSON) {
+    DCHECK_EQ(JsonEnconding(), kEncodingJsonFlat);
+    return {u_.json_obj.flat.flat_ptr, u_.json_obj.flat.json_len};
+  }
+  return {nullptr, 0};
+}
+
 void CompactObj::SetJson(JsonType&& j) {
   if (taglen_ == JSON_TAG && JsonEnconding() == kEncodingJsonCons) {
     DCHECK(u_.json_obj.cons.json_ptr != nullptr);  // must be allocated
@@ -833,12 +873,13 @@ void CompactObj::SetJson(const uint8_t* buf, size_t len) {
   u_.json_obj.flat.json_len = len;
 }
 
-void CompactObj::SetSBF(uint64_t initial_capacity, double fp_prob, double grow_factor) {
+void CompactObj::SetSBF(uint64_t initial_capacity, double fp_prob, double grow_factor,
+                        bool blocked) {
   if (taglen_ == SBF_TAG) {  // already json
-    *u_.sbf = SBF(initial_capacity, fp_prob, grow_factor, tl.local_mr);
+    *u_.sbf = SBF(initial_capacity, fp_prob, grow_factor, tl.local_mr, blocked);
   } else {
     SetMeta(SBF_TAG);
-    u_.sbf = AllocateMR<SBF>(initial_capacity, fp_prob, grow_factor, tl.local_mr);
+    u_.sbf = AllocateMR<SBF>(initial_capacity, fp_prob, grow_factor, tl.local_mr, blocked);
   }
 }
 
@@ -847,6 +888,26 @@ SBF* CompactObj::GetSBF() const {
   return u_.sbf;
 }
 
+CMS* CompactObj::GetCMS() const {
+  DCHECK_EQ(CMS_TAG, taglen_);
+  return u_.cms;
+}
+
+TopK* CompactObj::GetTopK() const {
+  DCHECK_EQ(TOPK_TAG, taglen_);
+  return u_.topk;
+}
+
+CuckooFilter* CompactObj::GetCF() const {
+  DCHECK_EQ(CF_TAG, taglen_);
+  return u_.cf;
+}
+
+TDigest* CompactObj::GetTDigest() const {
+  DCHECK_EQ(TDIGEST_TAG, taglen_);
+  return u_.tdigest;
+}
+
 void CompactObj::SetString(std::string_view str) {
   uint8_t mask = mask_ & ~kEncMask;
   CHECK(!IsExternal());
@@ -971,14 +1032,17 @@ bool CompactObj::HasAllocated() const {
       (taglen_ == ROBJ_TAG && u_.r_obj.inner_obj() == nullptr))
     return false;
 
-  DCHECK(taglen_ == ROBJ_TAG || taglen_ == SMALL_TAG || taglen_ == JSON_TAG || taglen_ == SBF_TAG);
+  DCHECK(taglen_ == ROBJ_TAG || taglen_ == SMALL_TAG || taglen_ == JSON_TAG || taglen_ == SBF_TAG ||
+         taglen_ == CMS_TAG || taglen_ == TOPK_TAG || taglen_ == CF_TAG ||
+         taglen_ == TDIGEST_TAG);
   return true;
 }
 
 bool CompactObj::TagAllowsEmptyValue() const {
   const auto type = ObjType();
   return type == OBJ_JSON || type == OBJ_STREAM || type == OBJ_STRING || type == OBJ_SBF ||
-         type == OBJ_SET;
+         type == OBJ_SET || type == OBJ_CMS || type == OBJ_TOPK || type == OBJ_CF ||
+         type == OBJ_TDIGEST;
 }
 
 void __attribute__((noinline)) CompactObj::GetString(string* res) const {
@@ -1146,6 +1210,14 @@ void CompactObj::Free() {
     }
   } else if (taglen_ == SBF_TAG) {
     DeleteMR<SBF>(u_.sbf);
+  } else if (taglen_ == CMS_TAG) {
+    DeleteMR<CMS>(u_.cms);
+  } else if (taglen_ == TOPK_TAG) {
+    DeleteMR<TopK>(u_.topk);
+  } else if (taglen_ == CF_TAG) {
+    DeleteMR<CuckooFilter>(u_.cf);
+  } else if (taglen_ == TDIGEST_TAG) {
+    DeleteMR<TDigest>(u_.tdigest);
   } else {
     LOG(FATAL) << "Unsupported tag " << int(taglen_);
   }
@@ -1162,11 +1234,9 @@ size_t CompactObj::MallocUsed(bool slow) const {
   }
 
   if (taglen_ == JSON_TAG) {
-    // TODO fix this once we fully support flat json
-    // This is here because accessing a union field that is not active
-    // is UB.
+    // Accessing a union field that is not active is UB.
     if (JsonEnconding() == kEncodingJsonFlat) {
-      return 0;
+      return u_.json_obj.flat.json_len;
     }
     return u_.json_obj.cons.bytes_used;
   }
@@ -1178,6 +1248,22 @@ size_t CompactObj::MallocUsed(bool slow) const {
   if (taglen_ == SBF_TAG) {
     return u_.sbf->MallocUsed();
   }
+
+  if (taglen_ == CMS_TAG) {
+    return u_.cms->MallocUsed();
+  }
+
+  if (taglen_ == TOPK_TAG) {
+    return u_.topk->MallocUsed();
+  }
+
+  if (taglen_ == CF_TAG) {
+    return u_.cf->MallocUsed();
+  }
+
+  if (taglen_ == TDIGEST_TAG) {
+    return u_.tdigest->MallocUsed();
+  }
   LOG(DFATAL) << "should not reach";
   return 0;
 }
@@ -1376,10 +1462,11 @@ MemoryResource* CompactObj::memory_resource() {
   return tl.local_mr;
 }
 
-constexpr std::pair<CompactObjType, std::string_view> kObjTypeToString[8] = {
-    {OBJ_STRING, "string"sv},  {OBJ_LIST, "list"sv},    {OBJ_SET, "set"sv},
-    {OBJ_ZSET, "zset"sv},      {OBJ_HASH, "hash"sv},    {OBJ_STREAM, "stream"sv},
-    {OBJ_JSON, "ReJSON-RL"sv}, {OBJ_SBF, "MBbloom--"sv}};
+constexpr std::pair<CompactObjType, std::string_view> kObjTypeToString[12] = {
+    {OBJ_STRING, "string"sv},  {OBJ_LIST, "list"sv},      {OBJ_SET, "set"sv},
+    {OBJ_ZSET, "zset"sv},      {OBJ_HASH, "hash"sv},      {OBJ_STREAM, "stream"sv},
+    {OBJ_JSON, "ReJSON-RL"sv}, {OBJ_SBF, "MBbloom--"sv},  {OBJ_CMS, "CMSk-TYPE"sv},
+    {OBJ_TOPK, "TopK-TYPE"sv}, {OBJ_CF, "MBbloomCF"sv},  {OBJ_TDIGEST, "TDIS-TYPE"sv}};
 
 std::string_view ObjTypeToString(CompactObjType type) {
   for (auto& p : kObjTypeToString) {
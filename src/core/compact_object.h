@@ -9,6 +9,7 @@
 #include <boost/intrusive/list_hook.hpp>
 #include <optional>
 #include <type_traits>
+#include <utility>
 
 #include "base/pmr/memory_resource.h"
 #include "core/json/json_object.h"
@@ -26,6 +27,10 @@ constexpr unsigned kEncodingJsonCons = 0;
 constexpr unsigned kEncodingJsonFlat = 1;
 
 class SBF;
+class CMS;
+class TopK;
+class CuckooFilter;
+class TDigest;
 
 namespace detail {
 
@@ -121,6 +126,10 @@ class CompactObj {
     EXTERNAL_TAG = 20,
     JSON_TAG = 21,
     SBF_TAG = 22,
+    CMS_TAG = 23,
+    TOPK_TAG = 24,
+    CF_TAG = 25,
+    TDIGEST_TAG = 26,
   };
 
   enum MaskBit {
@@ -323,14 +332,51 @@ class CompactObj {
   // pre condition - the type here is OBJ_JSON and was set with SetJson
   JsonType* GetJson() const;
 
+  // Same as above for the flat encoding. The buffer is owned by the object and may be patched
+  // in place as long as its size does not change.
+  std::pair<uint8_t*, size_t> GetJsonFlat() const;
+
   void SetSBF(SBF* sbf) {
     SetMeta(SBF_TAG);
     u_.sbf = sbf;
   }
 
-  void SetSBF(uint64_t initial_capacity, double fp_prob, double grow_factor);
+  void SetSBF(uint64_t initial_capacity, double fp_prob, double grow_factor,
+              bool blocked = false);
   SBF* GetSBF() const;
 
+  // Takes ownership of `cms`, which must be allocated with AllocateMR.
+  void SetCMS(CMS* cms) {
+    SetMeta(CMS_TAG);
+    u_.cms = cms;
+  }
+
+  CMS* GetCMS() const;
+
+  // Takes ownership of `topk`, which must be allocated with AllocateMR.
+  void SetTopK(TopK* topk) {
+    SetMeta(TOPK_TAG);
+    u_.topk = topk;
+  }
+
+  TopK* GetTopK() const;
+
+  // Takes ownership of `cf`, which must be allocated with AllocateMR.
+  void SetCF(CuckooFilter* cf) {
+    SetMeta(CF_TAG);
+    u_.cf = cf;
+  }
+
+  CuckooFilter* GetCF() const;
+
+  // Takes ownership of `td`, which must be allocated with AllocateMR.
+  void SetTDigest(TDigest* td) {
+    SetMeta(TDIGEST_TAG);
+    u_.tdigest = td;
+  }
+
+  TDigest* GetTDigest() const;
+
   // dest must have at least Size() bytes available
   void GetString(char* dest) const;
 
@@ -485,6 +531,10 @@ class CompactObj {
     // using 'packed' to reduce alignement of U to 1.
     JsonWrapper json_obj __attribute__((packed));
     SBF* sbf __attribute__((packed));
+    CMS* cms __attribute__((packed));
+    TopK* topk __attribute__((packed));
+    CuckooFilter* cf __attribute__((packed));
+    TDigest* tdigest __attribute__((packed));
     int64_t ival __attribute__((packed));
     ExternalPtr ext_ptr;
 
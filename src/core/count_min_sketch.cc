@@ -0,0 +1,155 @@
+// Copyright 2024, DragonflyDB authors.  All rights reserved.
+// See LICENSE for licensing terms.
+//
+
+#include "core/count_min_sketch.h"
+
+#include <xxhash.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#include "base/logging.h"
+
+namespace dfly {
+
+using namespace std;
+
+namespace {
+
+constexpr uint32_t kMaxCounter = numeric_limits<uint32_t>::max();
+
+inline uint32_t SaturatingAdd(uint32_t counter, uint32_t incr) {
+  uint32_t res;
+  return __builtin_add_overflow(counter, incr, &res) ? kMaxCounter : res;
+}
+
+}  // namespace
+
+CMS::CMS(uint32_t width, uint32_t depth, PMR_NS::memory_resource* mr)
+    : width_(width), depth_(depth), mr_(mr) {
+  DCHECK(width > 0 && depth > 0);
+
+  size_t bytes = data().size();
+  counters_ = static_cast<uint32_t*>(mr_->allocate(bytes));
+  memset(counters_, 0, bytes);
+}
+
+CMS::~CMS() {
+  mr_->deallocate(counters_, data().size());
+}
+
+pair<uint32_t, uint32_t> CMS::DimsFromError(double error, double prob) {
+  DCHECK(error > 0 && error < 1);
+  DCHECK(prob > 0 && prob < 1);
+
+  return {uint32_t(ceil(M_E / error)), uint32_t(max(1.0, ceil(-log(prob))))};
+}
+
+uint32_t CMS::IncrBy(string_view item, uint32_t incr) {
+  HashPair hash;
+  Prefetch({&item, 1}, &hash);
+  return IncrBy(hash, incr);
+}
+
+void CMS::IncrBy(absl::Span<const string_view> items, absl::Span<const uint32_t> incrs,
+                 uint32_t* res) {
+  DCHECK_EQ(items.size(), incrs.size());
+
+  HashPair hashes[kBatchSize];
+  for (size_t start = 0; start < items.size(); start += kBatchSize) {
+    size_t len = min<size_t>(kBatchSize, items.size() - start);
+    Prefetch(items.subspan(start, len), hashes);
+    for (size_t i = 0; i < len; ++i) {
+      res[start + i] = IncrBy(hashes[i], incrs[start + i]);
+    }
+  }
+}
+
+uint32_t CMS::Query(string_view item) const {
+  HashPair hash;
+  Prefetch({&item, 1}, &hash);
+  return Query(hash);
+}
+
+void CMS::Query(absl::Span<const string_view> items, uint32_t* res) const {
+  HashPair hashes[kBatchSize];
+  for (size_t start = 0; start < items.size(); start += kBatchSize) {
+    size_t len = min<size_t>(kBatchSize, items.size() - start);
+    Prefetch(items.subspan(start, len), hashes);
+    for (size_t i = 0; i < len; ++i) {
+      res[start + i] = Query(hashes[i]);
+    }
+  }
+}
+
+void CMS::Merge(absl::Span<const MergeSource> srcs) {
+  size_t len = size_t(width_) * depth_;
+
+  // Doubles represent all the counters exactly and can not overflow. Precision is lost only for
+  // sums that are far above kMaxCounter anyway.
+  vector<double> sums(len, 0);
+  double count = 0;
+  for (const MergeSource& src : srcs) {
+    DCHECK_EQ(src.counters.size(), len * sizeof(uint32_t));
+
+    const uint32_t* counters = reinterpret_cast<const uint32_t*>(src.counters.data());
+    double weight = src.weight;
+    for (size_t i = 0; i < len; ++i) {
+      sums[i] += counters[i] * weight;
+    }
+    count += src.count * weight;
+  }
+
+  for (size_t i = 0; i < len; ++i) {
+    counters_[i] = uint32_t(clamp(sums[i], 0.0, double(kMaxCounter)));
+  }
+  count_ = uint64_t(clamp(count, 0.0, double(numeric_limits<uint64_t>::max())));
+}
+
+void CMS::Load(string_view counters, uint64_t count) {
+  CHECK_EQ(counters.size(), data().size());
+
+  memcpy(counters_, counters.data(), counters.size());
+  count_ = count;
+}
+
+size_t CMS::MallocUsed() const {
+  return sizeof(CMS) + data().size();
+}
+
+void CMS::Prefetch(absl::Span<const string_view> items, HashPair* hashes) const {
+  for (size_t i = 0; i < items.size(); ++i) {
+    XXH128_hash_t hash = XXH3_128bits(items[i].data(), items[i].size());
+    hashes[i] = {hash.low64, hash.high64};
+    for (unsigned row = 0; row < depth_; ++row) {
+      __builtin_prefetch(Counter(hashes[i], row));
+    }
+  }
+}
+
+uint32_t CMS::IncrBy(const HashPair& hash, uint32_t incr) {
+  uint32_t res = kMaxCounter;
+  for (unsigned row = 0; row < depth_; ++row) {
+    uint32_t* counter = Counter(hash, row);
+    *counter = SaturatingAdd(*counter, incr);
+    res = min(res, *counter);
+  }
+
+  uint64_t count;
+  count_ = __builtin_add_overflow(count_, incr, &count) ? numeric_limits<uint64_t>::max() : count;
+  return res;
+}
+
+uint32_t CMS::Query(const HashPair& hash) const {
+  uint32_t res = kMaxCounter;
+  for (unsigned row = 0; row < depth_; ++row) {
+    res = min(res, *Counter(hash, row));
+  }
+  return res;
+}
+
+}  // namespace dfly
@@ -0,0 +1,105 @@
+// Copyright 2024, DragonflyDB authors.  All rights reserved.
+// See LICENSE for licensing terms.
+//
+
+#pragma once
+
+#include <absl/types/span.h>
+
+#include <cstdint>
+#include <string_view>
+#include <utility>
+
+#include "base/pmr/memory_resource.h"
+
+namespace dfly {
+
+/// Count-Min sketch, see https://en.wikipedia.org/wiki/Count%E2%80%93min_sketch
+/// Counters of all rows are stored in a single contiguous array of uint32_t, row after row.
+/// This way merging sketches boils down to a weighted sum of flat arrays, which the compiler
+/// vectorizes. Counters saturate at UINT32_MAX instead of wrapping around.
+class CMS {
+  CMS(const CMS&) = delete;
+  CMS& operator=(const CMS&) = delete;
+
+ public:
+  struct MergeSource {
+    std::string_view counters;  // see data()
+    uint64_t count;
+    int64_t weight;
+  };
+
+  // width - number of counters per row, depth - number of rows. Both must be positive.
+  CMS(uint32_t width, uint32_t depth, PMR_NS::memory_resource* mr);
+  ~CMS();
+
+  // Returns {width, depth} of a sketch that overestimates counts by at most error * count()
+  // with probability of at least 1 - prob. Both arguments must be in (0, 1) range.
+  static std::pair<uint32_t, uint32_t> DimsFromError(double error, double prob);
+
+  // Increases the count of `item` by `incr`. Returns the updated estimation of the item.
+  uint32_t IncrBy(std::string_view item, uint32_t incr);
+
+  // Batched version of the above. The items are hashed and their counters prefetched before
+  // any of them is updated. res[i] is set to the estimation of items[i] right after its update,
+  // i.e. the result is identical to calling IncrBy for each item in order.
+  void IncrBy(absl::Span<const std::string_view> items, absl::Span<const uint32_t> incrs,
+              uint32_t* res);
+
+  // Returns the estimated count of `item`.
+  uint32_t Query(std::string_view item) const;
+
+  // Batched version of Query, with prefetching similar to the batched IncrBy.
+  void Query(absl::Span<const std::string_view> items, uint32_t* res) const;
+
+  // Overwrites the sketch with the weighted sum of `srcs`. All sources must have the same
+  // dimensions as this sketch. Negative sums are clamped to 0.
+  void Merge(absl::Span<const MergeSource> srcs);
+
+  // Loads counters previously returned by data() of a sketch with the same dimensions.
+  void Load(std::string_view counters, uint64_t count);
+
+  uint32_t width() const {
+    return width_;
+  }
+
+  uint32_t depth() const {
+    return depth_;
+  }
+
+  // Total of all increments.
+  uint64_t count() const {
+    return count_;
+  }
+
+  std::string_view data() const {
+    return {reinterpret_cast<const char*>(counters_), size_t(width_) * depth_ * sizeof(uint32_t)};
+  }
+
+  size_t MallocUsed() const;
+
+ private:
+  static constexpr unsigned kBatchSize = 16;
+
+  struct HashPair {
+    uint64_t low, hi;
+  };
+
+  uint32_t* Counter(const HashPair& hash, unsigned row) const {
+    return counters_ + size_t(row) * width_ + (hash.low + hash.hi * row) % width_;
+  }
+
+  // Hashes `items` into `hashes` and prefetches their counters.
+  void Prefetch(absl::Span<const std::string_view> items, HashPair* hashes) const;
+
+  uint32_t IncrBy(const HashPair& hash, uint32_t incr);
+  uint32_t Query(const HashPair& hash) const;
+
+  uint32_t width_;
+  uint32_t depth_;
+  uint64_t count_ = 0;
+  uint32_t* counters_;
+  PMR_NS::memory_resource* mr_;
+};
+
+}  // namespace dfly
@@ -0,0 +1,255 @@
+// Copyright 2024, DragonflyDB authors.  All rights reserved.
+// See LICENSE for licensing terms.
+//
+
+#include "core/cuckoo_filter.h"
+
+#include <absl/container/inlined_vector.h>
+#include <absl/numeric/bits.h>
+#include <xxhash.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include "base/logging.h"
+#include "core/sse_port.h"
+
+namespace dfly {
+
+using namespace std;
+
+namespace {
+
+constexpr uint64_t kHashSeed = 0xc6a4a7935bd1e995ULL;
+constexpr uint64_t kAltIndexMul = 0x5bd1e995;
+constexpr size_t kBucketBytes = CuckooTable::kBucketSize * sizeof(uint16_t);
+
+static_assert(kBucketBytes == sizeof(uint64_t));
+
+// Returns the slot of the lowest match in a single bucket mask, see CuckooTable::Match.
+inline unsigned FirstSlot(uint32_t mask) {
+  return (absl::countr_zero(mask) % 8) / 2;
+}
+
+}  // namespace
+
+CuckooTable::~CuckooTable() {
+  CHECK(fps_ == nullptr);
+}
+
+CuckooTable::CuckooTable(CuckooTable&& o) : bucket_log_(o.bucket_log_), fps_(o.fps_) {
+  o.fps_ = nullptr;
+}
+
+void CuckooTable::Init(uint64_t capacity, PMR_NS::memory_resource* resource) {
+  CHECK(fps_ == nullptr);
+
+  uint64_t buckets = absl::bit_ceil(max<uint64_t>(1, (capacity + kBucketSize - 1) / kBucketSize));
+  bucket_log_ = absl::countr_zero(buckets);
+
+  size_t length = data().size();
+  fps_ = static_cast<uint16_t*>(resource->allocate(length, kBucketBytes));
+  memset(fps_, 0, length);
+}
+
+void CuckooTable::Init(uint8_t* blob, size_t len) {
+  DCHECK_EQ(len, absl::bit_ceil(len));
+  DCHECK_EQ(len % kBucketBytes, 0u);
+  CHECK(fps_ == nullptr);
+
+  fps_ = reinterpret_cast<uint16_t*>(blob);
+  bucket_log_ = absl::countr_zero(len / kBucketBytes);
+}
+
+void CuckooTable::Destroy(PMR_NS::memory_resource* resource) {
+  resource->deallocate(CHECK_NOTNULL(fps_), data().size(), kBucketBytes);
+  fps_ = nullptr;
+}
+
+auto CuckooTable::HashItem(string_view item) -> Hash {
+  uint64_t hash = XXH3_64bits_withSeed(item.data(), item.size(), kHashSeed);
+
+  // 0 marks an empty slot.
+  uint16_t fp = hash >> 48;
+  return {fp ? fp : uint16_t(1), hash};
+}
+
+uint64_t CuckooTable::AltIndex(uint64_t index, uint16_t fp) const {
+  // Since the table size is a power of 2, AltIndex(AltIndex(i, fp), fp) == i.
+  return BucketIndex(index ^ (fp * kAltIndexMul));
+}
+
+#ifndef __s390x__
+uint32_t CuckooTable::Match(uint64_t i1, uint64_t i2, uint16_t fp) const {
+  uint64_t b1, b2;
+  memcpy(&b1, Slot(i1, 0), kBucketBytes);
+  memcpy(&b2, Slot(i2, 0), kBucketBytes);
+
+  // Loads both buckets into a single register, i1 in the lower half.
+  __m128i buckets = _mm_set_epi64x(b2, b1);
+  __m128i eq = _mm_cmpeq_epi16(buckets, _mm_set1_epi16(fp));
+  return _mm_movemask_epi8(eq);
+}
+#else
+uint32_t CuckooTable::Match(uint64_t i1, uint64_t i2, uint16_t fp) const {
+  uint32_t mask = 0;
+  for (unsigned i = 0; i < kBucketSize; ++i) {
+    if (*Slot(i1, i) == fp)
+      mask |= 3u << (i * 2);
+    if (*Slot(i2, i) == fp)
+      mask |= 3u << (8 + i * 2);
+  }
+  return mask;
+}
+#endif
+
+bool CuckooTable::Insert(const Hash& hash, unsigned max_kicks) {
+  uint64_t index = BucketIndex(hash.index);
+  uint64_t alt = AltIndex(index, hash.fp);
+
+  if (uint32_t empty = Match(index, alt, 0); empty) {
+    *Slot(empty & 0xFF ? index : alt, FirstSlot(empty)) = hash.fp;
+    return true;
+  }
+
+  // Both buckets are full, relocate fingerprints to their alternate buckets.
+  // The victims are chosen deterministically so that replicas end up with the same layout.
+  // The path is recorded to restore the table if no empty slot is found.
+  absl::InlinedVector<uint16_t*, 32> path;
+  uint16_t fp = hash.fp;
+  index = (hash.index >> 32) & 1 ? alt : index;
+  for (unsigned kick = 0; kick < max_kicks; ++kick) {
+    uint16_t* victim = Slot(index, (fp + kick) % kBucketSize);
+    swap(fp, *victim);
+    path.push_back(victim);
+
+    index = AltIndex(index, fp);
+    if (uint32_t empty = Match(index, index, 0) & 0xFF; empty) {
+      *Slot(index, FirstSlot(empty)) = fp;
+      return true;
+    }
+  }
+
+  for (auto it = path.rbegin(); it != path.rend(); ++it) {
+    swap(fp, **it);
+  }
+  DCHECK_EQ(fp, hash.fp);
+  return false;
+}
+
+bool CuckooTable::Contains(const Hash& hash) const {
+  uint64_t index = BucketIndex(hash.index);
+  return Match(index, AltIndex(index, hash.fp), hash.fp) != 0;
+}
+
+bool CuckooTable::Delete(const Hash& hash) {
+  uint64_t index = BucketIndex(hash.index);
+  uint64_t alt = AltIndex(index, hash.fp);
+  uint32_t mask = Match(index, alt, hash.fp);
+  if (!mask)
+    return false;
+
+  *Slot(mask & 0xFF ? index : alt, FirstSlot(mask)) = 0;
+  return true;
+}
+
+unsigned CuckooTable::Count(const Hash& hash) const {
+  uint64_t index = BucketIndex(hash.index);
+  uint64_t alt = AltIndex(index, hash.fp);
+  uint32_t mask = Match(index, alt, hash.fp);
+
+  // Do not count the same bucket twice.
+  if (index == alt)
+    mask &= 0xFF;
+  return absl::popcount(mask) / 2;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// CuckooFilter implementation
+///////////////////////////////////////////////////////////////////////////////
+CuckooFilter::CuckooFilter(uint64_t capacity, uint32_t max_iterations, uint32_t expansion,
+                           PMR_NS::memory_resource* mr)
+    : tables_(1, mr), capacity_(capacity), max_iterations_(max_iterations), expansion_(expansion) {
+  tables_.front().Init(capacity, mr);
+}
+
+CuckooFilter::CuckooFilter(uint64_t capacity, uint32_t max_iterations, uint32_t expansion,
+                           uint64_t num_items, uint64_t num_deletes, PMR_NS::memory_resource* mr)
+    : tables_(mr),
+      capacity_(capacity),
+      num_items_(num_items),
+      num_deletes_(num_deletes),
+      max_iterations_(max_iterations),
+      expansion_(expansion) {
+}
+
+CuckooFilter::~CuckooFilter() {
+  PMR_NS::memory_resource* mr = tables_.get_allocator().resource();
+  for (auto& t : tables_)
+    t.Destroy(mr);
+}
+
+void CuckooFilter::AddTable(const std::string& blob) {
+  PMR_NS::memory_resource* mr = tables_.get_allocator().resource();
+  uint8_t* ptr = (uint8_t*)mr->allocate(blob.size(), kBucketBytes);
+  memcpy(ptr, blob.data(), blob.size());
+  tables_.emplace_back().Init(ptr, blob.size());
+}
+
+bool CuckooFilter::Add(string_view item) {
+  CuckooTable::Hash hash = CuckooTable::HashItem(item);
+
+  if (!tables_.back().Insert(hash, max_iterations_)) {
+    if (expansion_ == 0)
+      return false;
+
+    uint64_t capacity = tables_.back().num_buckets() * CuckooTable::kBucketSize * expansion_;
+    tables_.emplace_back().Init(capacity, tables_.get_allocator().resource());
+    CHECK(tables_.back().Insert(hash, 0));
+  }
+
+  ++num_items_;
+  return true;
+}
+
+bool CuckooFilter::Exists(string_view item) const {
+  CuckooTable::Hash hash = CuckooTable::HashItem(item);
+  auto contains = [&hash](const CuckooTable& t) { return t.Contains(hash); };
+
+  return any_of(tables_.crbegin(), tables_.crend(), contains);
+}
+
+bool CuckooFilter::Delete(string_view item) {
+  CuckooTable::Hash hash = CuckooTable::HashItem(item);
+
+  // Start from the latest table, which is where recently added copies are.
+  for (auto it = tables_.rbegin(); it != tables_.rend(); ++it) {
+    if (it->Delete(hash)) {
+      --num_items_;
+      ++num_deletes_;
+      return true;
+    }
+  }
+  return false;
+}
+
+unsigned CuckooFilter::Count(string_view item) const {
+  CuckooTable::Hash hash = CuckooTable::HashItem(item);
+
+  unsigned res = 0;
+  for (const auto& t : tables_)
+    res += t.Count(hash);
+  return res;
+}
+
+size_t CuckooFilter::MallocUsed() const {
+  size_t res = tables_.capacity() * sizeof(CuckooTable);
+  for (const auto& t : tables_) {
+    res += t.data().size();
+  }
+  res += sizeof(CuckooFilter);
+
+  return res;
+}
+
+}  // namespace dfly
@@ -0,0 +1,168 @@
+// Copyright 2024, DragonflyDB authors.  All rights reserved.
+// See LICENSE for licensing terms.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "base/pmr/memory_resource.h"
+
+namespace dfly {
+
+/// Single cuckoo hash table of fingerprints, based on
+/// "Cuckoo Filter: Practically Better Than Bloom" by Fan et al.
+/// Every bucket holds 4 16-bit fingerprints, i.e. takes exactly 8 bytes. Both candidate buckets
+/// of an item are compared against its fingerprint with a single 128-bit SSE comparison.
+/// The number of buckets is always a power of 2, so that the alternate bucket can be computed
+/// with a xor, without knowing the item itself.
+class CuckooTable {
+  CuckooTable(const CuckooTable&) = delete;
+  CuckooTable& operator=(const CuckooTable&) = delete;
+
+ public:
+  static constexpr unsigned kBucketSize = 4;
+
+  // Hash of an item, split into its fingerprint and the index of its primary bucket.
+  // The index is not masked, so that the same hash can be used with tables of any size.
+  struct Hash {
+    uint16_t fp;
+    uint64_t index;
+  };
+
+  CuckooTable() = default;
+
+  // Note, that Destroy() must be called before calling the d'tor
+  ~CuckooTable();
+
+  CuckooTable(CuckooTable&& o);
+
+  // Initializes a table with enough buckets for `capacity` items.
+  void Init(uint64_t capacity, PMR_NS::memory_resource* resource);
+
+  // Direct initializer. len must be a power of 2 and a multiple of the bucket length.
+  void Init(uint8_t* blob, size_t len);
+
+  // Destroys the object, must be called before destructing the object.
+  // resource - resource with which the object was initialized.
+  void Destroy(PMR_NS::memory_resource* resource);
+
+  static Hash HashItem(std::string_view item);
+
+  // Inserts the fingerprint, relocating at most `max_kicks` other fingerprints.
+  // Returns false if the table is too full. The table is left unchanged in that case.
+  bool Insert(const Hash& hash, unsigned max_kicks);
+
+  bool Contains(const Hash& hash) const;
+
+  // Removes a single copy of the fingerprint. Returns false if it was not found.
+  bool Delete(const Hash& hash);
+
+  // Returns how many copies of the fingerprint are stored in the table.
+  unsigned Count(const Hash& hash) const;
+
+  size_t num_buckets() const {
+    return 1ULL << bucket_log_;
+  }
+
+  std::string_view data() const {
+    return {reinterpret_cast<const char*>(fps_), num_buckets() * kBucketSize * sizeof(uint16_t)};
+  }
+
+ private:
+  uint64_t BucketIndex(uint64_t index) const {
+    return index & (num_buckets() - 1);
+  }
+
+  uint64_t AltIndex(uint64_t index, uint16_t fp) const;
+
+  // Returns a mask with 2 bits per slot for both buckets, the slots of `i1` in the low half.
+  uint32_t Match(uint64_t i1, uint64_t i2, uint16_t fp) const;
+
+  uint16_t* Slot(uint64_t bucket, unsigned slot) const {
+    return fps_ + bucket * kBucketSize + slot;
+  }
+
+  uint8_t bucket_log_ = 0;
+  uint16_t* fps_ = nullptr;
+};
+
+/**
+ * @brief Scalable cuckoo filter.
+ * Similarly to SBF, when the current table fills up a new one, `expansion` times larger, is added.
+ * Lookups and deletions check all the tables, insertions only go to the last one.
+ * Unlike SBF, items can be deleted and added multiple times.
+ */
+class CuckooFilter {
+  CuckooFilter(const CuckooFilter&) = delete;
+  CuckooFilter& operator=(const CuckooFilter&) = delete;
+
+ public:
+  // capacity - number of items the first table can hold.
+  // max_iterations - maximal number of relocations per insertion before the table is deemed full.
+  // expansion - growth factor of the tables, 0 disables the growth.
+  CuckooFilter(uint64_t capacity, uint32_t max_iterations, uint32_t expansion,
+               PMR_NS::memory_resource* mr);
+
+  // C'tor used for loading persisted filters. Should be followed by AddTable.
+  CuckooFilter(uint64_t capacity, uint32_t max_iterations, uint32_t expansion, uint64_t num_items,
+               uint64_t num_deletes, PMR_NS::memory_resource* mr);
+  ~CuckooFilter();
+
+  void AddTable(const std::string& blob);
+
+  // Returns false if the filter is full and expansion is disabled.
+  bool Add(std::string_view item);
+
+  bool Exists(std::string_view item) const;
+
+  // Removes a single copy of the item. Returns false if it was not found.
+  bool Delete(std::string_view item);
+
+  // Estimated number of copies of the item in the filter. Fingerprint collisions may inflate it.
+  unsigned Count(std::string_view item) const;
+
+  uint64_t capacity() const {
+    return capacity_;
+  }
+
+  uint32_t max_iterations() const {
+    return max_iterations_;
+  }
+
+  uint32_t expansion() const {
+    return expansion_;
+  }
+
+  uint64_t num_items() const {
+    return num_items_;
+  }
+
+  uint64_t num_deletes() const {
+    return num_deletes_;
+  }
+
+  uint32_t num_tables() const {
+    return tables_.size();
+  }
+
+  std::string_view data(size_t idx) const {
+    return tables_[idx].data();
+  }
+
+  size_t MallocUsed() const;
+
+ private:
+  // from the smallest to the largest.
+  std::vector<CuckooTable, PMR_NS::polymorphic_allocator<CuckooTable>> tables_;
+  uint64_t capacity_;
+  uint64_t num_items_ = 0;
+  uint64_t num_deletes_ = 0;
+  uint32_t max_iterations_;
+  uint32_t expansion_;
+};
+
+}  // namespace dfly
@@ -575,4 +575,122 @@ TYPED_TEST(JsonPathTest, SubRange) {
   arr.clear();
 }
 
+TYPED_TEST(JsonPathTest, DirectPath) {
+  TypeParam json = ValidJson<TypeParam>(R"({"a": {"b": [1, 2, {"c": 3}]}, "d": 4})");
+
+  vector<int> arr;
+  vector<string> keys;
+  auto cb = [&](optional<string_view> key, const TypeParam& val) {
+    keys.emplace_back(key.value_or("-"));
+    arr.push_back(is_int(val) ? to_int(val) : -1);
+  };
+
+  for (auto [expr, expected] : vector<pair<string, int>>{{"$.d", 4},
+                                                         {"$.a.b[1]", 2},
+                                                         {"$.a.b[-1].c", 3},
+                                                         {"$.a.b[-3]", 1},
+                                                         {"$.a.b", -1}}) {
+    ASSERT_EQ(0, this->Parse(expr));
+    Path path = this->driver_.TakePath();
+    EXPECT_TRUE(IsDirectPath(path)) << expr;
+    EvaluatePath(path, json, cb);
+    ASSERT_THAT(arr, ElementsAre(expected)) << expr;
+    arr.clear();
+  }
+  EXPECT_THAT(keys, ElementsAre("d", "-", "c", "-", "b"));
+
+  // Missing fields, out of range indices and type mismatches do not match.
+  for (string_view expr : {"$.x", "$.a.b[3]", "$.a.b[-4]", "$.d.e", "$.d[0]"}) {
+    ASSERT_EQ(0, this->Parse(string(expr)));
+    Path path = this->driver_.TakePath();
+    EXPECT_TRUE(IsDirectPath(path)) << expr;
+    EvaluatePath(path, json, cb);
+    EXPECT_THAT(arr, ElementsAre()) << expr;
+  }
+
+  for (string_view expr : {"$.a.*", "$..c", "$.a.b[0:2]", "$.a.b[*]"}) {
+    ASSERT_EQ(0, this->Parse(string(expr)));
+    EXPECT_FALSE(IsDirectPath(this->driver_.TakePath())) << expr;
+  }
+
+  // Deleting through a direct path removes the entry from its parent.
+  ASSERT_EQ(0, this->Parse("$.a.b[1]"));
+  Path path = this->driver_.TakePath();
+  MutateCallback cb_del = [](optional<string_view>, JsonType*) { return true; };
+  auto expected = ValidJson<JsonType>(R"({"a": {"b": [1, {"c": 3}]}, "d": 4})");
+  if constexpr (std::is_same_v<TypeParam, JsonType>) {
+    ASSERT_EQ(1u, MutatePath(path, cb_del, &json));
+    ASSERT_EQ(expected, json);
+  } else {
+    flexbuffers::Builder fbb;
+    ASSERT_EQ(1u, MutatePath(path, cb_del, json, &fbb));
+    ASSERT_EQ(expected, FromFlat(flexbuffers::GetRoot(fbb.GetBuffer())));
+  }
+}
+
+using FlatJsonPathTest = JsonPathTest<FlatJson>;
+
+TEST_F(FlatJsonPathTest, MutateInPlace) {
+  FlatJson json = ValidJson<FlatJson>(
+      R"({"a": {"n": 1, "f": 1.5, "b": true, "s": "abc"}, "arr": [1, 2, 3]})");
+
+  auto mutate = [&](string expr, MutateCallback cb, flexbuffers::Builder* fbb) {
+    CHECK_EQ(0, this->Parse(expr));
+    return MutatePath(this->driver_.TakePath(), cb, json, fbb);
+  };
+
+  // Scalars that keep their type and width are overwritten inside the buffer.
+  flexbuffers::Builder fbb;
+  EXPECT_EQ(1u, mutate(
+                    "$.a.n",
+                    [](auto, JsonType* val) {
+                      *val = val->as<int64_t>() + 1;
+                      return false;
+                    },
+                    &fbb));
+  EXPECT_EQ(1u, mutate(
+                    "$.a.b",
+                    [](auto, JsonType* val) {
+                      *val = !val->as_bool();
+                      return false;
+                    },
+                    &fbb));
+  EXPECT_EQ(1u, mutate(
+                    "$.a.s",
+                    [](auto, JsonType* val) {
+                      *val = "xyz";
+                      return false;
+                    },
+                    &fbb));
+  EXPECT_EQ(1u, mutate(
+                    "$.a.f",
+                    [](auto, JsonType* val) {
+                      *val = 2.5;
+                      return false;
+                    },
+                    &fbb));
+  EXPECT_EQ(0u, fbb.GetSize());
+  EXPECT_EQ(ValidJson<JsonType>(
+                R"({"a": {"n": 2, "f": 2.5, "b": false, "s": "xyz"}, "arr": [1, 2, 3]})"),
+            FromFlat(json));
+
+  // Values that do not fit and deletions rebuild the buffer.
+  EXPECT_EQ(1u, mutate(
+                    "$.arr[1]",
+                    [](auto, JsonType* val) {
+                      *val = 100000;
+                      return false;
+                    },
+                    &fbb));
+  ASSERT_GT(fbb.GetSize(), 0u);
+  EXPECT_EQ(ValidJson<JsonType>(
+                R"({"a": {"n": 2, "f": 2.5, "b": false, "s": "xyz"}, "arr": [1, 100000, 3]})"),
+            FromFlat(flexbuffers::GetRoot(fbb.GetBuffer())));
+
+  flexbuffers::Builder fbb2;
+  EXPECT_EQ(1u, mutate("$.a.s", [](auto, JsonType*) { return true; }, &fbb2));
+  EXPECT_EQ(ValidJson<JsonType>(R"({"a": {"n": 2, "f": 2.5, "b": false}, "arr": [1, 2, 3]})"),
+            FromFlat(flexbuffers::GetRoot(fbb2.GetBuffer())));
+}
+
 }  // namespace dfly::json
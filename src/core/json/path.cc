@@ -4,6 +4,8 @@
 
 #include "src/core/json/path.h"
 
+#include <algorithm>
+
 #include <absl/strings/str_cat.h>
 #include <absl/types/span.h>
 
@@ -32,6 +34,109 @@ class JsonPathDriver : public json::Driver {
   }
 };
 
+// Returns the child of `node` addressed by a direct path segment, or null if there is none.
+// Sets `key` to the field name for object fields.
+template <typename Json>
+Json* DirectChild(const PathSegment& segment, Json* node, optional<string_view>* key) {
+  if (segment.type() == SegmentType::IDENTIFIER) {
+    if (!node->is_object())
+      return nullptr;
+    auto it = node->find(segment.identifier());
+    if (it == node->object_range().end())
+      return nullptr;
+    *key = it->key();
+    return &it->value();
+  }
+
+  if (!node->is_array())
+    return nullptr;
+  IndexExpr index = segment.index().Normalize(node->size());
+  if (index.Empty())
+    return nullptr;
+  *key = nullopt;
+  return &(*node)[index.first];
+}
+
+// Same as above for flat json. Null values are treated as missing, like in FlatDfs.
+FlatJson DirectChild(const PathSegment& segment, FlatJson node, optional<string_view>* key) {
+  if (segment.type() == SegmentType::IDENTIFIER) {
+    if (!node.IsMap())
+      return FlatJson{};
+    *key = segment.identifier();
+    return node.AsMap()[segment.identifier().c_str()];
+  }
+
+  if (!node.IsUntypedVector())
+    return FlatJson{};
+  auto vec = node.AsVector();
+  IndexExpr index = segment.index().Normalize(vec.size());
+  if (index.Empty())
+    return FlatJson{};
+  *key = nullopt;
+  return vec[index.first];
+}
+
+// Overwrites the scalar `dest` with `src` if they have the same type and `src` fits into the
+// storage of `dest`. Returns false and leaves `dest` intact otherwise.
+bool PatchScalar(const JsonType& src, FlatJson dest) {
+  if (src.is_bool())
+    return dest.IsBool() && dest.MutateBool(src.as_bool());
+
+  if (src.is_int64())
+    return dest.IsInt() && dest.MutateInt(src.as<int64_t>());
+
+  if (src.is_double())
+    return dest.IsFloat() && dest.MutateFloat(src.as_double());
+
+  if (src.is_string()) {
+    string_view sv = src.as_string_view();
+    return dest.IsString() && dest.MutateString(sv.data(), sv.size());
+  }
+  return false;
+}
+
+void EvaluateDirectPath(const Path& path, const JsonType& json, PathCallback callback) {
+  const JsonType* node = &json;
+  optional<string_view> key;
+  for (const PathSegment& segment : path) {
+    node = DirectChild(segment, node, &key);
+    if (!node)
+      return;
+  }
+  callback(key, *node);
+}
+
+void EvaluateDirectPath(const Path& path, FlatJson json, PathFlatCallback callback) {
+  optional<string_view> key;
+  for (const PathSegment& segment : path) {
+    json = DirectChild(segment, json, &key);
+    if (json.IsNull())
+      return;
+  }
+  callback(key, json);
+}
+
+unsigned MutateDirectPath(const Path& path, MutateCallback callback, JsonType* json) {
+  JsonType* parent = nullptr;
+  optional<string_view> key;
+  for (const PathSegment& segment : path) {
+    parent = json;
+    json = DirectChild(segment, json, &key);
+    if (!json)
+      return 0;
+  }
+
+  if (callback(key, json)) {
+    if (parent->is_object()) {
+      parent->erase(parent->find(path.back().identifier()));
+    } else {
+      auto it = parent->array_range().begin() + (json - &*parent->array_range().begin());
+      parent->erase(it);
+    }
+  }
+  return 1;
+}
+
 }  // namespace
 
 const char* SegmentName(SegmentType type) {
@@ -94,12 +199,25 @@ AggFunction::Result PathSegment::GetResult() const {
   return func->GetResult();
 }
 
+bool IsDirectPath(const Path& path) {
+  return all_of(path.begin(), path.end(), [](const PathSegment& segment) {
+    if (segment.type() == SegmentType::INDEX)
+      return segment.index().first == segment.index().second;
+    return segment.type() == SegmentType::IDENTIFIER;
+  });
+}
+
 void EvaluatePath(const Path& path, const JsonType& json, PathCallback callback) {
   if (path.empty()) {  // root node
     callback(nullopt, json);
     return;
   }
 
+  if (IsDirectPath(path)) {
+    EvaluateDirectPath(path, json, std::move(callback));
+    return;
+  }
+
   if (path.front().type() != SegmentType::FUNCTION) {
     Dfs::Traverse(path, json, std::move(callback));
     return;
@@ -154,6 +272,10 @@ unsigned MutatePath(const Path& path, MutateCallback callback, JsonType* json) {
     return 1;
   }
 
+  if (IsDirectPath(path)) {
+    return MutateDirectPath(path, std::move(callback), json);
+  }
+
   Dfs dfs = Dfs::Mutate(path, callback, json);
   return dfs.matches();
 }
@@ -165,6 +287,11 @@ void EvaluatePath(const Path& path, FlatJson json, PathFlatCallback callback) {
     return;
   }
 
+  if (IsDirectPath(path)) {
+    EvaluateDirectPath(path, json, std::move(callback));
+    return;
+  }
+
   if (path.front().type() != SegmentType::FUNCTION) {
     FlatDfs::Traverse(path, json, std::move(callback));
     return;
@@ -286,6 +413,39 @@ void FromJsonType(const JsonType& src, flexbuffers::Builder* fbb) {
 
 unsigned MutatePath(const Path& path, MutateCallback callback, FlatJson json,
                     flexbuffers::Builder* fbb) {
+  // A direct path addresses a single value. If it is a scalar, the callback runs on a copy and
+  // the result is written over the old value when it fits, e.g. JSON.NUMINCRBY or JSON.TOGGLE.
+  // Null values are skipped by flat lookups, so they take the generic route below.
+  if (!path.empty() && IsDirectPath(path)) {
+    optional<string_view> key;
+    FlatJson target = json;
+    for (const PathSegment& segment : path) {
+      target = DirectChild(segment, target, &key);
+      if (target.IsNull())
+        break;
+    }
+
+    if (!target.IsNull() && !target.IsUntypedVector()) {
+      JsonType value = FromFlat(target);
+      bool erase = callback(key, &value);
+      if (!erase && PatchScalar(value, target))
+        return 1;
+
+      // Does not fit, rebuild the buffer with the computed value.
+      JsonType mut_json = FromFlat(json);
+      MutateDirectPath(
+          path,
+          [&](optional<string_view>, JsonType* val) {
+            *val = std::move(value);
+            return erase;
+          },
+          &mut_json);
+      FromJsonType(mut_json, fbb);
+      fbb->Finish();
+      return 1;
+    }
+  }
+
   JsonType mut_json = FromFlat(json);
   unsigned res = MutatePath(path, std::move(callback), &mut_json);
   if (res) {
@@ -128,6 +128,11 @@ using PathFlatCallback = absl::FunctionRef<void(std::optional<std::string_view>,
 // Returns true if the entry should be deleted, false otherwise.
 using MutateCallback = absl::FunctionRef<bool(std::optional<std::string_view>, JsonType*)>;
 
+// Returns true if the path addresses at most one value, i.e. it consists only of identifiers and
+// single indices, like $.a.b[3]. EvaluatePath and MutatePath follow such paths by direct lookups
+// instead of the generic DFS traversal.
+bool IsDirectPath(const Path& path);
+
 void EvaluatePath(const Path& path, const JsonType& json, PathCallback callback);
 
 // Same as above but for flatbuffers.
@@ -135,6 +140,10 @@ void EvaluatePath(const Path& path, FlatJson json, PathFlatCallback callback);
 
 // returns number of matches found with the given path.
 unsigned MutatePath(const Path& path, MutateCallback callback, JsonType* json);
+
+// Same as above for flat json. The mutated json is written into `fbb`. A direct path that
+// addresses a scalar is patched in place when the new value fits into the old one, in that
+// case `fbb` is left untouched. Therefore the buffer of `json` must be writable.
 unsigned MutatePath(const Path& path, MutateCallback callback, FlatJson json,
                     flexbuffers::Builder* fbb);
 
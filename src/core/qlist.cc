@@ -12,8 +12,13 @@ extern "C" {
 
 #include <absl/base/macros.h>
 #include <absl/base/optimization.h>
+#include <absl/container/flat_hash_map.h>
+#include <absl/container/inlined_vector.h>
+#include <absl/numeric/bits.h>
 #include <absl/strings/str_cat.h>
 
+#include <vector>
+
 #include "base/logging.h"
 
 using namespace std;
@@ -60,18 +65,24 @@ namespace dfly {
 
 namespace {
 
-static_assert(sizeof(QList) == 24);
+static_assert(sizeof(QList) == 32);
 
 enum IterDir : uint8_t { FWD = 1, REV = 0 };
 
 /* This is for test suite development purposes only, 0 means disabled. */
 size_t packed_threshold = 0;
 
+// Minimal number of nodes for building a node index, 0 means disabled.
+unsigned index_threshold = 32;
+
 /* Optimization levels for size-based filling.
  * Note that the largest possible limit is 64k, so even if each record takes
  * just one byte, it still won't overflow the 16 bit count field. */
 const size_t kOptLevel[] = {4096, 8192, 16384, 32768, 65536};
 
+// Size of an empty listpack: its header and the EOF byte.
+constexpr size_t kEmptyListpackSize = 7;
+
 /* Calculate the size limit of the quicklist node based on negative 'fill'. */
 size_t NodeNegFillLimit(int fill) {
   DCHECK_LT(fill, 0);
@@ -293,10 +304,136 @@ quicklistNode* SplitNode(quicklistNode* node, int offset, bool after) {
 
 }  // namespace
 
+// Fenwick tree over the element counts of the list nodes, ordered from head to tail.
+// Live nodes occupy slots [begin_, end_), the free slots on both sides absorb new head and tail
+// nodes. Count changes of any node are point updates; only insertion or removal of inner nodes
+// makes QList drop the index, which is then rebuilt on the next positional lookup.
+class QList::NodeIndex {
+ public:
+  NodeIndex(quicklistNode* head, uint32_t len);
+
+  // Return false if there is no free slot left.
+  bool PushFront(quicklistNode* node);
+  bool PushBack(quicklistNode* node);
+
+  void PopFront() {
+    DCHECK_LT(begin_, end_);
+    Add(begin_, -long(counts_[begin_]));
+    slots_.erase(nodes_[begin_]);
+    nodes_[begin_++] = nullptr;
+  }
+
+  void PopBack() {
+    DCHECK_LT(begin_, end_);
+    --end_;
+    Add(end_, -long(counts_[end_]));
+    slots_.erase(nodes_[end_]);
+    nodes_[end_] = nullptr;
+  }
+
+  // Updates the count of an indexed node. Returns false if the node is not indexed.
+  bool Add(const quicklistNode* node, long delta) {
+    auto it = slots_.find(node);
+    if (it == slots_.end())
+      return false;
+    Add(it->second, delta);
+    return true;
+  }
+
+  // Returns the node holding the element at position 'index' counting from head,
+  // and the number of elements preceding that node.
+  pair<quicklistNode*, uint64_t> Find(uint64_t index) const;
+
+  size_t MallocUsed() const {
+    return sizeof(*this) + nodes_.capacity() * sizeof(quicklistNode*) +
+           (counts_.capacity() + tree_.capacity()) * sizeof(uint32_t) +
+           slots_.capacity() * (sizeof(decltype(slots_)::value_type) + 1);
+  }
+
+ private:
+  void Add(unsigned slot, long delta);
+
+  vector<quicklistNode*> nodes_;
+  vector<uint32_t> counts_;
+  vector<uint32_t> tree_;  // 1-based, tree_[0] is unused.
+  absl::flat_hash_map<const quicklistNode*, unsigned> slots_;
+  unsigned begin_ = 0, end_ = 0;
+};
+
+QList::NodeIndex::NodeIndex(quicklistNode* head, uint32_t len) {
+  // Capacity is a power of 2 so that Find() can descend the tree bit by bit.
+  size_t capacity = absl::bit_ceil(max<size_t>(16, size_t(len) * 2));
+  nodes_.resize(capacity, nullptr);
+  counts_.resize(capacity, 0);
+  tree_.resize(capacity + 1, 0);
+
+  slots_.reserve(len);
+  begin_ = end_ = (capacity - len) / 2;
+  for (quicklistNode* node = head; node; node = node->next) {
+    slots_[node] = end_;
+    nodes_[end_] = node;
+    counts_[end_] = node->count;
+    tree_[end_ + 1] = node->count;
+    ++end_;
+  }
+  DCHECK_EQ(end_ - begin_, len);
+
+  // Linear time construction: propagate each partial sum to its parent.
+  for (size_t i = 1; i <= capacity; ++i) {
+    size_t parent = i + (i & -i);
+    if (parent <= capacity)
+      tree_[parent] += tree_[i];
+  }
+}
+
+bool QList::NodeIndex::PushFront(quicklistNode* node) {
+  if (begin_ == 0)
+    return false;
+  nodes_[--begin_] = node;
+  slots_[node] = begin_;
+  Add(begin_, node->count);
+  return true;
+}
+
+bool QList::NodeIndex::PushBack(quicklistNode* node) {
+  if (end_ == nodes_.size())
+    return false;
+  nodes_[end_] = node;
+  slots_[node] = end_;
+  Add(end_++, node->count);
+  return true;
+}
+
+void QList::NodeIndex::Add(unsigned slot, long delta) {
+  DCHECK_LT(slot, nodes_.size());
+  counts_[slot] += delta;
+  for (size_t i = slot + 1; i < tree_.size(); i += (i & -i)) {
+    tree_[i] += delta;
+  }
+}
+
+auto QList::NodeIndex::Find(uint64_t index) const -> pair<quicklistNode*, uint64_t> {
+  // Finds the first slot whose prefix sum exceeds 'index'.
+  size_t pos = 0;
+  uint64_t rem = index;
+  for (size_t step = nodes_.size(); step; step >>= 1) {
+    if (pos + step < tree_.size() && tree_[pos + step] <= rem) {
+      pos += step;
+      rem -= tree_[pos];
+    }
+  }
+  DCHECK_LT(pos, nodes_.size());
+  return {nodes_[pos], index - rem};
+}
+
 void QList::SetPackedThreshold(unsigned threshold) {
   packed_threshold = threshold;
 }
 
+void QList::SetIndexThreshold(unsigned min_nodes) {
+  index_threshold = min_nodes;
+}
+
 QList::QList() : fill_(-2), compress_(0), bookmark_count_(0) {
 }
 
@@ -305,12 +442,14 @@ QList::QList(int fill, int compress) : fill_(fill), compress_(compress), bookmar
 
 QList::QList(QList&& other)
     : head_(other.head_),
+      index_(other.index_),
       count_(other.count_),
       len_(other.len_),
       fill_(other.fill_),
       compress_(other.compress_),
       bookmark_count_(other.bookmark_count_) {
   other.head_ = nullptr;
+  other.index_ = nullptr;
   other.len_ = other.count_ = 0;
 }
 
@@ -322,6 +461,7 @@ QList& QList::operator=(QList&& other) {
   if (this != &other) {
     Clear();
     head_ = other.head_;
+    index_ = other.index_;
     len_ = other.len_;
     count_ = other.count_;
     fill_ = other.fill_;
@@ -329,12 +469,14 @@ QList& QList::operator=(QList&& other) {
     bookmark_count_ = other.bookmark_count_;
 
     other.head_ = nullptr;
+    other.index_ = nullptr;
     other.len_ = other.count_ = 0;
   }
   return *this;
 }
 
 void QList::Clear() {
+  DropIndex();
   quicklistNode* current = head_;
 
   while (len_) {
@@ -390,6 +532,125 @@ string QList::Pop(Where where) {
   return res;
 }
 
+void QList::PushBatch(absl::Span<const string_view> vals, Where where) {
+  /* The head and tail should never be compressed (we don't attempt to decompress them) */
+  if (head_) {
+    DCHECK(head_->encoding != QUICKLIST_NODE_ENCODING_LZF);
+    DCHECK(head_->prev->encoding != QUICKLIST_NODE_ENCODING_LZF);
+  }
+
+  while (!vals.empty()) {
+    if (ABSL_PREDICT_FALSE(IsLargeElement(vals.front().size(), fill_))) {
+      PushSentinel(vals.front(), where);
+      vals.remove_prefix(1);
+      continue;
+    }
+
+    size_t pushed = PushPacked(where == HEAD ? head_ : _Tail(), vals, where);
+    if (pushed == 0)  // the sentinel is full or plain.
+      pushed = PushPacked(nullptr, vals, where);
+    vals.remove_prefix(pushed);
+  }
+}
+
+size_t QList::PushPacked(quicklistNode* node, absl::Span<const string_view> vals, Where where) {
+  if (node && QL_NODE_IS_PLAIN(node))
+    return 0;
+
+  // Apply the same limits as NodeAllowInsert() does for each element pushed one by one.
+  size_t sz = node ? node->sz : kEmptyListpackSize;
+  unsigned count = node ? node->count : 0;
+  size_t num = 0;
+  for (; num < vals.size(); ++num) {
+    size_t elem_sz = vals[num].size();
+    if (IsLargeElement(elem_sz, fill_))
+      break;
+
+    size_t new_sz = sz + elem_sz + SIZE_ESTIMATE_OVERHEAD;
+
+    // A new node always accepts its first element.
+    if ((node || num > 0) && quicklistNodeExceedsLimit(fill_, new_sz, count + 1))
+      break;
+    sz = new_sz;
+    ++count;
+  }
+
+  if (num == 0)
+    return 0;
+
+  // Pushing to the head reverses the order of the values.
+  absl::InlinedVector<listpackEntry, 16> entries(num);
+  for (size_t i = 0; i < num; ++i) {
+    string_view val = vals[where == HEAD ? num - 1 - i : i];
+    entries[i].sval = const_cast<uint8_t*>(uint_ptr(val));
+    entries[i].slen = val.size();
+  }
+
+  if (node) {
+    auto func = (where == HEAD) ? lpBatchPrepend : lpBatchAppend;
+    node->entry = func(node->entry, entries.data(), num);
+    node->count += num;
+    NodeUpdateSz(node);
+    OnNodeCountChange(node, num);
+  } else {
+    node = CreateNode();
+    node->entry = lpBatchAppend(lpNew(0), entries.data(), num);
+    node->count = num;
+    NodeUpdateSz(node);
+    InsertNode(where == HEAD ? head_ : _Tail(), node, where == HEAD ? BEFORE : AFTER);
+  }
+  count_ += num;
+
+  return num;
+}
+
+void QList::PopBatch(unsigned count, Where where, vector<string>* dest) {
+  DCHECK_LE(count, count_);
+
+  while (count) {
+    quicklistNode* node = where == HEAD ? head_ : _Tail();
+
+    /* The head and tail should never be compressed */
+    DCHECK(node->encoding != QUICKLIST_NODE_ENCODING_LZF);
+
+    if (ABSL_PREDICT_FALSE(QL_NODE_IS_PLAIN(node))) {
+      if (dest)
+        dest->emplace_back(reinterpret_cast<char*>(node->entry), node->sz);
+      DelNode(node);
+      --count;
+      continue;
+    }
+
+    unsigned num = std::min<unsigned>(count, node->count);
+    if (dest) {
+      uint8_t* pos = where == HEAD ? lpFirst(node->entry) : lpLast(node->entry);
+      for (unsigned i = 0; i < num; ++i) {
+        unsigned int vlen;
+        long long vlong;
+        uint8_t* vstr = lpGetValue(pos, &vlen, &vlong);
+        if (vstr) {
+          dest->emplace_back(reinterpret_cast<char*>(vstr), vlen);
+        } else {
+          dest->push_back(absl::StrCat(vlong));
+        }
+        pos = where == HEAD ? lpNext(node->entry, pos) : lpPrev(node->entry, pos);
+      }
+    }
+
+    // Remove the whole run with a single listpack shrink.
+    if (num == node->count) {
+      DelNode(node);
+    } else {
+      node->entry = lpDeleteRange(node->entry, where == HEAD ? 0 : -long(num), num);
+      node->count -= num;
+      NodeUpdateSz(node);
+      count_ -= num;
+      OnNodeCountChange(node, -long(num));
+    }
+    count -= num;
+  }
+}
+
 void QList::AppendListpack(unsigned char* zl) {
   quicklistNode* node = CreateNode();
   node->entry = zl;
@@ -437,6 +698,8 @@ bool QList::Replace(long index, std::string_view elem) {
 size_t QList::MallocUsed(bool slow) const {
   // Approximation since does not account for listpacks.
   size_t node_size = len_ * sizeof(quicklistNode) + znallocx(sizeof(quicklist));
+  if (index_)
+    node_size += index_->MallocUsed();
   if (slow) {
     for (quicklistNode* node = head_; node; node = node->next) {
       node_size += zmalloc_usable_size(node->entry);
@@ -483,6 +746,7 @@ bool QList::PushSentinel(string_view value, Where where) {
     orig->entry = func(orig->entry, value);
     NodeUpdateSz(orig);
     orig->count++;
+    OnNodeCountChange(orig, 1);
     return false;
   }
 
@@ -528,6 +792,16 @@ void QList::InsertNode(quicklistNode* old_node, quicklistNode* new_node, InsertO
     head_->prev = new_node;
   }
 
+  if (index_) {
+    bool indexed = false;
+    if (new_node == head_)
+      indexed = index_->PushFront(new_node);
+    else if (new_node == head_->prev)
+      indexed = index_->PushBack(new_node);
+    if (!indexed)
+      DropIndex();
+  }
+
   /* Update len first, so in Compress we know exactly len */
   len_++;
 
@@ -570,6 +844,7 @@ void QList::Insert(Iterator it, std::string_view elem, InsertOpt insert_opt) {
     if (QL_NODE_IS_PLAIN(node) || (at_tail && after) || (at_head && !after)) {
       InsertPlainNode(node, elem, insert_opt);
     } else {
+      DropIndex();
       DecompressNodeIfNeeded(true, node);
       new_node = SplitNode(node, it.offset_, after);
       quicklistNode* entry_node = CreateNode(QUICKLIST_NODE_CONTAINER_PLAIN, elem);
@@ -585,11 +860,13 @@ void QList::Insert(Iterator it, std::string_view elem, InsertOpt insert_opt) {
     DecompressNodeIfNeeded(true, node);
     node->entry = LP_Insert(node->entry, elem, it.zi_, LP_AFTER);
     NodeOnAddItem(node);
+    OnNodeCountChange(node, 1);
     RecompressOnly(node);
   } else if (!full && !after) {
     DecompressNodeIfNeeded(true, node);
     node->entry = LP_Insert(node->entry, elem, it.zi_, LP_BEFORE);
     NodeOnAddItem(node);
+    OnNodeCountChange(node, 1);
     RecompressOnly(node);
   } else if (full && at_tail && avail_next && after) {
     /* If we are: at tail, next has free space, and inserting after:
@@ -598,6 +875,7 @@ void QList::Insert(Iterator it, std::string_view elem, InsertOpt insert_opt) {
     DecompressNodeIfNeeded(true, new_node);
     new_node->entry = LP_Prepend(new_node->entry, elem);
     NodeOnAddItem(new_node);
+    OnNodeCountChange(new_node, 1);
     RecompressOnly(new_node);
     RecompressOnly(node);
   } else if (full && at_head && avail_prev && !after) {
@@ -607,6 +885,7 @@ void QList::Insert(Iterator it, std::string_view elem, InsertOpt insert_opt) {
     DecompressNodeIfNeeded(true, new_node);
     new_node->entry = LP_Append(new_node->entry, elem);
     NodeOnAddItem(new_node);
+    OnNodeCountChange(new_node, 1);
     RecompressOnly(new_node);
     RecompressOnly(node);
   } else if (full && ((at_tail && !avail_next && after) || (at_head && !avail_prev && !after))) {
@@ -617,6 +896,7 @@ void QList::Insert(Iterator it, std::string_view elem, InsertOpt insert_opt) {
   } else if (full) {
     /* else, node is full we need to split it. */
     /* covers both after and !after cases */
+    DropIndex();
     DecompressNodeIfNeeded(true, node);
     new_node = SplitNode(node, it.offset_, after);
     if (after)
@@ -658,8 +938,10 @@ void QList::Replace(Iterator it, std::string_view elem) {
     node->dont_compress = 1; /* Prevent compression in InsertNode() */
 
     /* If the entry is not at the tail, split the node at the entry's offset. */
-    if (it.offset_ != node->count - 1 && it.offset_ != -1)
+    if (it.offset_ != node->count - 1 && it.offset_ != -1) {
+      DropIndex();
       split_node = SplitNode(node, it.offset_, 1);
+    }
 
     /* Create a new node and insert it after the original node.
      * If the original node was split, insert the split node after the new node. */
@@ -809,6 +1091,8 @@ quicklistNode* QList::ListpackMerge(quicklistNode* a, quicklistNode* b) {
   DecompressNodeIfNeeded(false, a);
   DecompressNodeIfNeeded(false, b);
   if ((lpMerge(&a->entry, &b->entry))) {
+    DropIndex();
+
     /* We merged listpacks! Now remove the unused quicklistNode. */
     quicklistNode *keep = NULL, *nokeep = NULL;
     if (!a->entry) {
@@ -834,15 +1118,25 @@ quicklistNode* QList::ListpackMerge(quicklistNode* a, quicklistNode* b) {
 }
 
 void QList::DelNode(quicklistNode* node) {
+  if (index_) {
+    if (node == head_)
+      index_->PopFront();
+    else if (node == head_->prev)
+      index_->PopBack();
+    else
+      DropIndex();
+  }
+
   if (node->next)
     node->next->prev = node->prev;
-  if (node->prev)
-    node->prev->next = node->next;
 
   if (node == head_) {
+    // head_->prev is the tail, its next pointer must stay NULL.
     head_ = node->next;
-  } else if (node == head_->prev) {  // tail
-    head_->prev = node->prev;
+  } else {
+    node->prev->next = node->next;
+    if (node == head_->prev)  // tail
+      head_->prev = node->prev;
   }
 
   /* Update len first, so in Compress we know exactly len */
@@ -871,6 +1165,7 @@ bool QList::DelPackedIndex(quicklistNode* node, uint8_t** p) {
   bool gone = false;
   node->entry = lpDelete(node->entry, *p, p);
   node->count--;
+  OnNodeCountChange(node, -1);
   if (node->count == 0) {
     gone = true;
     DelNode(node);
@@ -883,6 +1178,16 @@ bool QList::DelPackedIndex(quicklistNode* node, uint8_t** p) {
   return gone;
 }
 
+void QList::OnNodeCountChange(const quicklistNode* node, long delta) {
+  if (index_ && !index_->Add(node, delta))
+    DropIndex();
+}
+
+void QList::DropIndex() const {
+  delete index_;
+  index_ = nullptr;
+}
+
 auto QList::GetIterator(Where where) const -> Iterator {
   Iterator it;
   it.owner_ = this;
@@ -910,30 +1215,41 @@ auto QList::GetIterator(long idx) const -> Iterator {
 
   DCHECK(head_);
 
-  /* Seek in the other direction if that way is shorter. */
-  int seek_forward = forward;
-  unsigned long long seek_index = index;
-  if (index > (count_ - 1) / 2) {
-    seek_forward = !forward;
-    seek_index = count_ - 1 - index;
-  }
+  if (!index_ && index_threshold && len_ >= index_threshold)
+    index_ = new NodeIndex(head_, len_);
 
-  n = seek_forward ? head_ : head_->prev;
-  while (ABSL_PREDICT_TRUE(n)) {
-    if ((accum + n->count) > seek_index) {
-      break;
-    } else {
-      accum += n->count;
-      n = seek_forward ? n->next : n->prev;
+  if (index_) {
+    /* The index counts from head, accum is relative to the direction of the seek. */
+    tie(n, accum) = index_->Find(forward ? index : count_ - 1 - index);
+    DCHECK(n);
+    if (!forward)
+      accum = count_ - n->count - accum;
+  } else {
+    /* Seek in the other direction if that way is shorter. */
+    int seek_forward = forward;
+    unsigned long long seek_index = index;
+    if (index > (count_ - 1) / 2) {
+      seek_forward = !forward;
+      seek_index = count_ - 1 - index;
     }
-  }
 
-  if (!n)
-    return {};
+    n = seek_forward ? head_ : head_->prev;
+    while (ABSL_PREDICT_TRUE(n)) {
+      if ((accum + n->count) > seek_index) {
+        break;
+      } else {
+        accum += n->count;
+        n = seek_forward ? n->next : n->prev;
+      }
+    }
 
-  /* Fix accum so it looks like we seeked in the other direction. */
-  if (seek_forward != forward)
-    accum = count_ - n->count - accum;
+    if (!n)
+      return {};
+
+    /* Fix accum so it looks like we seeked in the other direction. */
+    if (seek_forward != forward)
+      accum = count_ - n->count - accum;
+  }
 
   Iterator iter;
   iter.owner_ = this;
@@ -1006,6 +1322,26 @@ bool QList::Erase(const long start, unsigned count) {
     extent = -start; /* c.f. LREM -29 29; just delete until end. */
   }
 
+  /* Trimming the tail: delete from the tail backwards, so that every removed node is the tail
+   * at the time it goes away. This keeps the node index valid (see OnNodeCountChange). */
+  if (extent == (start < 0 ? -start : count_ - start)) {
+    while (extent) {
+      quicklistNode* node = head_->prev;
+      if (QL_NODE_IS_PLAIN(node) || extent >= node->count) {
+        extent -= node->count;
+        DelNode(node);
+      } else {
+        node->entry = lpDeleteRange(node->entry, -long(extent), extent);
+        NodeUpdateSz(node);
+        node->count -= extent;
+        count_ -= extent;
+        OnNodeCountChange(node, -long(extent));
+        extent = 0;
+      }
+    }
+    return true;
+  }
+
   Iterator it = GetIterator(start);
   quicklistNode* node = it.current_;
   long offset = it.offset_;
@@ -1052,6 +1388,7 @@ bool QList::Erase(const long start, unsigned count) {
       NodeUpdateSz(node);
       node->count -= del;
       count_ -= del;
+      OnNodeCountChange(node, -long(del));
       if (node->count == 0) {
         DelNode(node);
       } else {
@@ -9,10 +9,12 @@ extern "C" {
 }
 
 #include <absl/functional/function_ref.h>
+#include <absl/types/span.h>
 
 #include <optional>
 #include <string>
 #include <variant>
+#include <vector>
 
 namespace dfly {
 
@@ -98,6 +100,14 @@ class QList {
   // Returns the popped value. Precondition: list is not empty.
   std::string Pop(Where where);
 
+  // Equivalent to calling Push for each of 'vals' in order, but fills the head/tail node
+  // with a single listpack resize and builds new nodes directly.
+  void PushBatch(absl::Span<const std::string_view> vals, Where where);
+
+  // Equivalent to calling Pop 'count' times. Popped values are appended to 'dest' in pop order,
+  // unless it is null. Precondition: count <= Size().
+  void PopBatch(unsigned count, Where where, std::vector<std::string>* dest);
+
   void AppendListpack(unsigned char* zl);
   void AppendPlain(unsigned char* zl, size_t sz);
 
@@ -153,7 +163,17 @@ class QList {
 
   static void SetPackedThreshold(unsigned threshold);
 
+  // Lists with at least 'min_nodes' nodes build a node index on the first positional lookup,
+  // making GetIterator(long) logarithmic in the number of nodes. 0 disables the index.
+  static void SetIndexThreshold(unsigned min_nodes);
+
+  bool HasIndex() const {
+    return index_ != nullptr;
+  }
+
  private:
+  class NodeIndex;
+
   bool AllowCompression() const {
     return compress_ != 0;
   }
@@ -167,6 +187,10 @@ class QList {
 
   // Returns false if used existing head, true if new head created.
   bool PushTail(std::string_view value);
+
+  // Pushes a run of packed elements into 'node' (or into a new node if 'node' is null)
+  // and returns how many of them fit.
+  size_t PushPacked(quicklistNode* node, absl::Span<const std::string_view> vals, Where where);
   void InsertPlainNode(quicklistNode* old_node, std::string_view, InsertOpt insert_opt);
   void InsertNode(quicklistNode* old_node, quicklistNode* new_node, InsertOpt insert_opt);
   void Replace(Iterator it, std::string_view elem);
@@ -179,7 +203,12 @@ class QList {
   void DelNode(quicklistNode* node);
   bool DelPackedIndex(quicklistNode* node, uint8_t** p);
 
+  // Updates the index after the element count of 'node' changed by 'delta'.
+  void OnNodeCountChange(const quicklistNode* node, long delta);
+  void DropIndex() const;
+
   quicklistNode* head_ = nullptr;
+  mutable NodeIndex* index_ = nullptr;  // built lazily by GetIterator(long).
 
   uint32_t count_ = 0;                   /* total count of all entries in all listpacks */
   uint32_t len_ = 0;                     /* number of quicklistNodes */
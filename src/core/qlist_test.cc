@@ -9,6 +9,9 @@
 #include <absl/strings/str_format.h>
 #include <gmock/gmock.h>
 
+#include <deque>
+#include <random>
+
 #include "base/gtest.h"
 #include "base/logging.h"
 #include "core/mi_memory_resource.h"
@@ -255,6 +258,86 @@ TEST_F(QListTest, GetNum) {
   EXPECT_EQ(1251977, it.Get().ival());
 }
 
+TEST_F(QListTest, NodeIndex) {
+  ql_ = QList(4, 0);  // small nodes to get many of them.
+  deque<string> expected;
+  mt19937 gen(0);
+
+  auto verify = [&] {
+    ASSERT_EQ(expected.size(), ql_.Size());
+    for (unsigned j = 0; j < 64; ++j) {
+      long idx = gen() % expected.size();
+      auto it = ql_.GetIterator(idx);
+      ASSERT_TRUE(it.Next());
+      ASSERT_EQ(expected[idx], it.Get()) << idx;
+      it = ql_.GetIterator(-idx - 1);
+      ASSERT_TRUE(it.Next());
+      ASSERT_EQ(expected[expected.size() - idx - 1], it.Get()) << idx;
+    }
+  };
+
+  for (unsigned i = 0; i < 2000; ++i) {
+    string val = StrCat("v", i);
+    if (i % 3 == 0) {
+      ql_.Push(val, QList::HEAD);
+      expected.push_front(val);
+    } else {
+      ql_.Push(val, QList::TAIL);
+      expected.push_back(val);
+    }
+  }
+  verify();
+  EXPECT_TRUE(ql_.HasIndex());
+
+  // Head and tail operations are absorbed by the index.
+  for (unsigned i = 0; i < 500; ++i) {
+    if (i % 2) {
+      ASSERT_EQ(expected.front(), ql_.Pop(QList::HEAD));
+      expected.pop_front();
+    } else {
+      ASSERT_EQ(expected.back(), ql_.Pop(QList::TAIL));
+      expected.pop_back();
+    }
+    ql_.Push(StrCat("p", i), QList::HEAD);
+    expected.push_front(StrCat("p", i));
+  }
+  EXPECT_TRUE(ql_.HasIndex());
+  verify();
+
+  // Trimming from both ends.
+  ASSERT_TRUE(ql_.Erase(0, 100));
+  expected.erase(expected.begin(), expected.begin() + 100);
+  ASSERT_TRUE(ql_.Erase(-50, 50));
+  expected.erase(expected.end() - 50, expected.end());
+  EXPECT_TRUE(ql_.HasIndex());
+  verify();
+
+  // Count changes of inner nodes are point updates of the index.
+  ASSERT_TRUE(ql_.Erase(1000, 1));
+  expected.erase(expected.begin() + 1000);
+  ASSERT_TRUE(ql_.Insert(expected[999], "inner", QList::AFTER));
+  expected.insert(expected.begin() + 1000, "inner");
+  ASSERT_TRUE(ql_.Erase(600, 1));
+  expected.erase(expected.begin() + 600);
+  EXPECT_TRUE(ql_.HasIndex());
+  verify();
+
+  // Splitting or removing inner nodes drops the index, it is rebuilt lazily.
+  ASSERT_TRUE(ql_.Replace(700, string(9000, 'x')));
+  expected[700] = string(9000, 'x');
+  ASSERT_TRUE(ql_.Erase(300, 77));
+  expected.erase(expected.begin() + 300, expected.begin() + 377);
+  ASSERT_TRUE(ql_.Insert(expected[1000], "ins", QList::AFTER));
+  expected.insert(expected.begin() + 1001, "ins");
+  verify();
+  EXPECT_TRUE(ql_.HasIndex());
+
+  vector<string> items = ToItems();
+  EXPECT_TRUE(equal(items.begin(), items.end(), expected.begin(), expected.end()));
+  ASSERT_EQ(0, ql_verify(ql_, ql_.node_count(), expected.size(), ql_.Head()->count,
+                         ql_.Tail()->count));
+}
+
 TEST_F(QListTest, CompressionPlain) {
   char buf[256];
   QList::SetPackedThreshold(1);
@@ -340,6 +423,57 @@ TEST_P(OptionsTest, NumbersIndex) {
   ASSERT_EQ(760, i);
 }
 
+TEST_P(OptionsTest, Batch) {
+  auto [fill, compress] = GetParam();
+  ql_ = QList(fill, compress);
+  QList expected(fill, compress);
+
+  vector<string> vals;
+  for (unsigned i = 0; i < 500; ++i) {
+    vals.push_back(i % 97 == 0 ? string(9000, 'a' + i % 26) : StrCat("val", i * 31));
+  }
+  vector<string_view> views(vals.begin(), vals.end());
+
+  for (unsigned i = 0; i < 6; ++i) {
+    QList::Where where = i % 2 ? QList::HEAD : QList::TAIL;
+    absl::Span<const string_view> batch = absl::MakeSpan(views).subspan(i * 50, 50 + i * 20);
+    ql_.PushBatch(batch, where);
+    for (string_view v : batch)
+      expected.Push(v, where);
+    ASSERT_EQ(expected.Size(), ql_.Size());
+  }
+
+  auto exp_items = [&] {
+    vector<string> res;
+    expected.Iterate(
+        [&](const QList::Entry& e) {
+          res.push_back(e.to_string());
+          return true;
+        },
+        0, expected.Size());
+    return res;
+  };
+  ASSERT_EQ(exp_items(), ToItems());
+  ASSERT_EQ(0, ql_verify(ql_, ql_.node_count(), ql_.Size(), ql_.Head()->count, ql_.Tail()->count));
+
+  vector<string> popped;
+  for (unsigned count : {1u, 33u, 120u}) {
+    for (QList::Where where : {QList::HEAD, QList::TAIL}) {
+      popped.clear();
+      ql_.PopBatch(count, where, &popped);
+      ASSERT_EQ(count, popped.size());
+      for (unsigned j = 0; j < count; ++j) {
+        ASSERT_EQ(expected.Pop(where), popped[j]);
+      }
+      ASSERT_EQ(exp_items(), ToItems());
+    }
+  }
+
+  ql_.PopBatch(ql_.Size(), QList::TAIL, nullptr);
+  EXPECT_EQ(0, ql_.Size());
+  EXPECT_EQ(0, ql_.node_count());
+}
+
 TEST_P(OptionsTest, DelRangeA) {
   auto [fill, compress] = GetParam();
   ql_ = QList(fill, compress);
@@ -824,4 +958,52 @@ TEST_P(OptionsTest, IndexFrom500) {
   ASSERT_FALSE(it.Next());
 }
 
+static void BM_QListGetIterator(benchmark::State& state) {
+  init_zmalloc_threadlocal(mi_heap_get_backing());
+  QList::SetIndexThreshold(state.range(1));
+
+  QList ql;
+  const unsigned kLen = state.range(0);
+  for (unsigned i = 0; i < kLen; ++i) {
+    ql.Push(StrCat("timeline_entry", i), QList::TAIL);
+  }
+
+  mt19937 gen(0);
+  while (state.KeepRunning()) {
+    auto it = ql.GetIterator(long(gen() % kLen));
+    benchmark::DoNotOptimize(it.Next());
+  }
+  QList::SetIndexThreshold(32);
+}
+BENCHMARK(BM_QListGetIterator)
+    ->Args({1 << 16, 0})
+    ->Args({1 << 16, 32})
+    ->Args({10'000'000, 0})
+    ->Args({10'000'000, 32});
+
+static void BM_QListPush(benchmark::State& state) {
+  init_zmalloc_threadlocal(mi_heap_get_backing());
+
+  vector<string> vals(state.range(0));
+  for (size_t i = 0; i < vals.size(); ++i) {
+    vals[i] = StrCat("message_payload_", i);
+  }
+  vector<string_view> views(vals.begin(), vals.end());
+
+  const bool batch = state.range(1);
+  while (state.KeepRunning()) {
+    QList ql;
+    for (unsigned i = 0; i < 20; ++i) {
+      if (batch) {
+        ql.PushBatch(views, QList::HEAD);
+      } else {
+        for (string_view v : views)
+          ql.Push(v, QList::HEAD);
+      }
+    }
+    benchmark::DoNotOptimize(ql.Size());
+  }
+}
+BENCHMARK(BM_QListPush)->Args({500, 0})->Args({500, 1});
+
 }  // namespace dfly
@@ -27,6 +27,14 @@ AstRangeNode::AstRangeNode(double lo, bool lo_excl, double hi, bool hi_excl)
     : lo{lo_excl ? nextafter(lo, hi) : lo}, hi{hi_excl ? nextafter(hi, lo) : hi} {
 }
 
+AstGeoNode AstGeoNode::Radius(double lon, double lat, double radius) {
+  return AstGeoNode{lon, lat, false, radius};
+}
+
+AstGeoNode AstGeoNode::Box(double lon, double lat, double width, double height) {
+  return AstGeoNode{lon, lat, true, 0, width, height};
+}
+
 AstNegateNode::AstNegateNode(AstNode&& node) : node{make_unique<AstNode>(std::move(node))} {
 }
 
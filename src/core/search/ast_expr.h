@@ -42,6 +42,17 @@ struct AstRangeNode {
   double lo, hi;
 };
 
+// Matches geo points within a circle or a box around (lon, lat). Distances are in meters.
+struct AstGeoNode {
+  static AstGeoNode Radius(double lon, double lat, double radius);
+  static AstGeoNode Box(double lon, double lat, double width, double height);
+
+  double lon, lat;
+  bool box = false;
+  double radius = 0;             // if !box
+  double width = 0, height = 0;  // if box
+};
+
 // Negates subtree
 struct AstNegateNode {
   AstNegateNode(AstNode&& node);
@@ -109,14 +120,15 @@ struct AstKnnNode {
 };
 
 struct AstSortNode {
-  std::unique_ptr<AstNode> filter;
+  std::shared_ptr<const AstNode> filter;
   std::string field;
   bool descending = false;
 };
 
 using NodeVariants =
     std::variant<std::monostate, AstStarNode, AstTermNode, AstPrefixNode, AstRangeNode,
-                 AstNegateNode, AstLogicalNode, AstFieldNode, AstTagsNode, AstKnnNode, AstSortNode>;
+                 AstGeoNode, AstNegateNode, AstLogicalNode, AstFieldNode, AstTagsNode,
+                 AstKnnNode, AstSortNode>;
 
 struct AstNode : public NodeVariants {
   using variant::variant;
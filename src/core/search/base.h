@@ -22,8 +22,26 @@ using DocId = uint32_t;
 
 enum class VectorSimilarity { L2, COSINE };
 
+// Storage format of vectors in flat vector indices.
+enum class VectorQuantization { NONE, INT8 };
+
 using OwnedFtVector = std::pair<std::unique_ptr<float[]>, size_t /* dimension (size) */>;
 
+// Transparent hash and equality for maps with PMR_NS::string keys, allow lookups by string_view.
+struct StringViewHash {
+  using is_transparent = void;
+  size_t operator()(std::string_view str) const {
+    return absl::Hash<std::string_view>{}(str);
+  }
+};
+
+struct StringViewEq {
+  using is_transparent = void;
+  bool operator()(std::string_view l, std::string_view r) const {
+    return l == r;
+  }
+};
+
 // Query params represent named parameters for queries supplied via PARAMS.
 struct QueryParams {
   std::string_view operator[](std::string_view name) const;
@@ -33,6 +51,14 @@ struct QueryParams {
     return params.size();
   }
 
+  auto begin() const {
+    return params.begin();
+  }
+
+  auto end() const {
+    return params.end();
+  }
+
  private:
   absl::flat_hash_map<std::string, std::string> params;
 };
@@ -76,19 +76,48 @@ template <typename C> void BlockList<C>::TrySplit(BlockIt block) {
 template <typename C>
 typename BlockList<C>::BlockListIterator& BlockList<C>::BlockListIterator::operator++() {
   ++*block_it;
-  if (block_it == block_end) {
-    ++it;
-    if (it != it_end) {
-      block_it = it->begin();
-      block_end = it->end();
-    } else {
-      block_it = std::nullopt;
-      block_end = std::nullopt;
-    }
-  }
+  if (block_it == block_end)
+    NextBlock();
   return *this;
 }
 
+template <typename C> void BlockList<C>::BlockListIterator::SeekGE(DocId t) {
+  if (it == it_end || **block_it >= t)
+    return;
+
+  // Jump to the last block that starts not after t, all preceding blocks hold only smaller values
+  auto last = std::upper_bound(it + 1, it_end, t,
+                               [](DocId t, const C& block) { return t < *block.begin(); });
+  if (--last != it) {
+    it = last;
+    block_it = it->begin();
+    block_end = it->end();
+  }
+
+  using BlockIterCategory = typename std::iterator_traits<typename C::iterator>::iterator_category;
+  if constexpr (std::is_base_of_v<std::random_access_iterator_tag, BlockIterCategory>) {
+    block_it = std::lower_bound(*block_it, *block_end, t);
+  } else {
+    while (block_it != block_end && **block_it < t)
+      ++*block_it;
+  }
+
+  // All values of the block are less than t, so the next block starts after it
+  if (block_it == block_end)
+    NextBlock();
+}
+
+template <typename C> void BlockList<C>::BlockListIterator::NextBlock() {
+  ++it;
+  if (it != it_end) {
+    block_it = it->begin();
+    block_end = it->end();
+  } else {
+    block_it = std::nullopt;
+    block_end = std::nullopt;
+  }
+}
+
 template class BlockList<CompressedSortedSet>;
 template class BlockList<SortedVector>;
 
@@ -55,6 +55,10 @@ template <typename Container /* underlying container */> class BlockList {
 
     BlockListIterator& operator++();
 
+    // Advance to the first element not less than t. Blocks that end before t are skipped by
+    // comparing their first elements, so they are never traversed.
+    void SeekGE(DocId t);
+
     friend class BlockList;
 
     bool operator==(const BlockListIterator& other) const {
@@ -73,6 +77,8 @@ template <typename Container /* underlying container */> class BlockList {
       }
     }
 
+    void NextBlock();  // Move to the beginning of the next block
+
     ConstBlockIt it, it_end;
     std::optional<typename Container::iterator> block_it, block_end;
   };
@@ -103,6 +103,32 @@ TYPED_TEST(BlockListTest, RandomNumbers) {
   }
 }
 
+TYPED_TEST(BlockListTest, SeekGE) {
+  auto list = this->Make();
+  std::set<DocId> list_copy;
+  for (size_t i = 0; i < 500; i++) {
+    DocId t = rand() % 5'000;
+    list.Insert(t);
+    list_copy.insert(t);
+  }
+
+  auto it = list.begin();
+  for (DocId t = 0; t < 5'100; t += rand() % 100) {
+    it.SeekGE(t);
+    auto expected = list_copy.lower_bound(t);
+    if (expected == list_copy.end()) {
+      ASSERT_TRUE(it == list.end());
+      break;
+    }
+    ASSERT_TRUE(it != list.end());
+    ASSERT_EQ(*it, *expected);
+
+    // Seeking a smaller or equal value doesn't move the iterator
+    it.SeekGE(t);
+    ASSERT_EQ(*it, *expected);
+  }
+}
+
 static void BM_Erase90PctTail(benchmark::State& state) {
   BlockList<CompressedSortedSet> bl{PMR_NS::get_default_resource()};
 
@@ -21,8 +21,17 @@
 
 #include <algorithm>
 #include <cctype>
+#include <cmath>
+#include <limits>
 
 #include "base/logging.h"
+#include "core/search/vector_utils.h"
+
+extern "C" {
+#include "redis/geo.h"
+#include "redis/geohash.h"
+#include "redis/geohash_helper.h"
+}
 
 namespace dfly::search {
 
@@ -49,6 +58,19 @@ absl::flat_hash_set<std::string> TokenizeWords(std::string_view text,
   return words;
 }
 
+// Same as TokenizeWords, but counts occurrences of each word
+void CountTokens(std::string_view text, const TextIndex::StopWords& stopwords,
+                 absl::flat_hash_map<std::string, uint32_t>* counts) {
+  for (std::string_view word : una::views::word_only::utf8(text)) {
+    if (std::string word_lc = una::cases::to_lowercase_utf8(word); !stopwords.contains(word_lc))
+      (*counts)[std::move(word_lc)]++;
+  }
+}
+
+// BM25 parameters as used by Lucene and RediSearch
+constexpr double kBM25K1 = 1.2;
+constexpr double kBM25B = 0.75;
+
 // Split taglist, remove duplicates and convert all to lowercase
 // TODO: introduce unicode support if needed
 absl::flat_hash_set<string> NormalizeTags(string_view taglist, bool case_sensitive,
@@ -66,9 +88,91 @@ absl::flat_hash_set<string> NormalizeTags(string_view taglist, bool case_sensiti
   return tags;
 }
 
+// Union of sorted runs, merged pairwise in rounds to keep the complexity at O(n log k)
+vector<DocId> UnionSorted(vector<vector<DocId>>&& runs) {
+  if (runs.empty())
+    return {};
+
+  while (runs.size() > 1) {
+    vector<vector<DocId>> merged;
+    merged.reserve((runs.size() + 1) / 2);
+    for (size_t i = 0; i + 1 < runs.size(); i += 2) {
+      vector<DocId>& out = merged.emplace_back();
+      out.reserve(runs[i].size() + runs[i + 1].size());
+      set_union(runs[i].begin(), runs[i].end(), runs[i + 1].begin(), runs[i + 1].end(),
+                back_inserter(out));
+    }
+    if (runs.size() % 2 == 1)
+      merged.push_back(std::move(runs.back()));
+    runs = std::move(merged);
+  }
+  return std::move(runs.front());
+}
+
+// Parse "lon,lat" into its 52 bit geohash, nullopt if the point is not valid
+optional<uint64_t> ParseGeoPoint(string_view value) {
+  pair<string_view, string_view> parts = absl::StrSplit(value, ',');
+  double lon, lat;
+  if (!absl::SimpleAtod(parts.first, &lon) || !absl::SimpleAtod(parts.second, &lat))
+    return nullopt;
+
+  if (lon < GEO_LONG_MIN || lon > GEO_LONG_MAX || lat < GEO_LAT_MIN || lat > GEO_LAT_MAX)
+    return nullopt;
+
+  GeoHashBits hash;
+  geohashEncodeWGS84(lon, lat, GEO_STEP_MAX, &hash);
+  return geohashAlign52Bits(hash);
+}
+
+// Collect ids of all entries within shape. The area is covered by the geohash box of the center
+// and its eight neighbours, each of which is a contiguous range of hashes.
+template <typename Entries> vector<DocId> CollectInShape(const Entries& entries, GeoShape* shape) {
+  GeoHashRadius area = geohashCalculateAreasByShapeWGS84(shape);
+  const GeoHashNeighbors& n = area.neighbors;
+  GeoHashBits boxes[] = {area.hash,     n.north,      n.south,      n.east,      n.west,
+                         n.north_east, n.north_west, n.south_east, n.south_west};
+
+  vector<DocId> out;
+  const GeoHashBits* last = nullptr;
+  for (const GeoHashBits& box : boxes) {
+    // Adjacent boxes can be the same for huge areas
+    if (HASHISZERO(box) || (last && last->bits == box.bits && last->step == box.step))
+      continue;
+    last = &box;
+
+    GeoHashFix52Bits min, max;
+    scoresOfGeoHashBox(box, &min, &max);
+
+    auto it_end = entries.lower_bound({max, 0});
+    for (auto it = entries.lower_bound({min, 0}); it != it_end; ++it) {
+      double xy[2], distance;
+      GeoHashBits hash{it->first, GEO_STEP_MAX};
+      if (!geohashDecodeToLongLatWGS84(hash, xy))
+        continue;
+
+      bool within = shape->type == CIRCULAR_TYPE
+                        ? geohashGetDistanceIfInRadiusWGS84(shape->xy[0], shape->xy[1], xy[0],
+                                                            xy[1], shape->t.radius, &distance)
+                        : geohashGetDistanceIfInRectangle(shape->t.r.width, shape->t.r.height,
+                                                          shape->xy[0], shape->xy[1], xy[0],
+                                                          xy[1], &distance);
+      if (within)
+        out.push_back(it->second);
+    }
+  }
+
+  sort(out.begin(), out.end());
+  out.erase(unique(out.begin(), out.end()), out.end());
+  return out;
+}
+
 };  // namespace
 
-NumericIndex::NumericIndex(PMR_NS::memory_resource* mr) : entries_{mr} {
+NumericIndex::NumericIndex(PMR_NS::memory_resource* mr, size_t max_bucket_size)
+    : entries_{mr}, mr_{mr}, max_bucket_size_{max_bucket_size}, buckets_{mr} {
+  // The first bucket covers all values, it's never removed
+  buckets_.emplace(piecewise_construct, forward_as_tuple(-numeric_limits<double>::infinity()),
+                   forward_as_tuple(mr_, max_bucket_size_));
 }
 
 bool NumericIndex::Add(DocId id, const DocumentAccessor& doc, string_view field) {
@@ -77,16 +181,37 @@ bool NumericIndex::Add(DocId id, const DocumentAccessor& doc, string_view field)
     return false;
   }
 
+  absl::InlinedVector<BucketMap::iterator, 1> touched;
   for (auto num : numbers.value()) {
-    entries_.emplace(num, id);
+    if (!entries_.emplace(num, id).second)
+      continue;
+
+    auto bucket = FindBucket(num);
+    bucket->second.entries++;
+    bucket->second.ids.Insert(id);
+    if (find(touched.begin(), touched.end(), bucket) == touched.end())
+      touched.push_back(bucket);
   }
+
+  for (auto bucket : touched)
+    TrySplit(bucket);
   return true;
 }
 
 void NumericIndex::Remove(DocId id, const DocumentAccessor& doc, string_view field) {
   auto numbers = doc.GetNumbers(field).value();
   for (auto num : numbers) {
-    entries_.erase({num, id});
+    if (entries_.erase({num, id}) == 0)
+      continue;
+
+    // All values of the document are removed, so it can be dropped from the posting list
+    auto bucket = FindBucket(num);
+    bucket->second.entries--;
+    bucket->second.ids.Remove(id);
+
+    // Empty buckets are merged into their predecessor by removing their lower bound
+    if (bucket->second.entries == 0 && bucket != buckets_.begin())
+      buckets_.erase(bucket);
   }
 }
 
@@ -94,17 +219,158 @@ vector<DocId> NumericIndex::Range(double l, double r) const {
   if (r < l)
     return {};
 
-  auto it_l = entries_.lower_bound({l, 0});
-  auto it_r = entries_.lower_bound({r, numeric_limits<DocId>::max()});
-  DCHECK_GE(it_r - it_l, 0);
+  vector<vector<DocId>> runs;
+  for (auto it = prev(buckets_.upper_bound(l)); it != buckets_.end() && it->first <= r; ++it) {
+    auto [bucket_begin, bucket_end] = BucketEntries(it);
+    auto first = l > it->first ? entries_.lower_bound({l, 0}) : bucket_begin;
+    if (first == bucket_end)
+      continue;
 
-  vector<DocId> out;
-  for (auto it = it_l; it != it_r; ++it)
-    out.push_back(it->second);
+    // Fully covered buckets contribute their posting list as a whole
+    if (first == bucket_begin && prev(bucket_end)->first <= r) {
+      runs.emplace_back(it->second.ids.begin(), it->second.ids.end());
+      continue;
+    }
 
-  sort(out.begin(), out.end());
-  out.erase(unique(out.begin(), out.end()), out.end());
-  return out;
+    vector<DocId>& run = runs.emplace_back();
+    for (auto e = first; e != bucket_end && e->first <= r; ++e)
+      run.push_back(e->second);
+
+    sort(run.begin(), run.end());
+    run.erase(unique(run.begin(), run.end()), run.end());
+  }
+
+  return UnionSorted(std::move(runs));
+}
+
+NumericIndex::BucketMap::iterator NumericIndex::FindBucket(double value) {
+  DCHECK(!buckets_.empty());
+  return prev(buckets_.upper_bound(value));
+}
+
+pair<NumericIndex::EntrySet::const_iterator, NumericIndex::EntrySet::const_iterator>
+NumericIndex::BucketEntries(BucketMap::const_iterator bucket) const {
+  auto next = std::next(bucket);
+  auto end = next == buckets_.end() ? entries_.end() : entries_.lower_bound({next->first, 0});
+  return {entries_.lower_bound({bucket->first, 0}), end};
+}
+
+void NumericIndex::TrySplit(BucketMap::iterator bucket) {
+  if (bucket->second.entries <= bucket->second.split_at)
+    return;
+
+  auto [bucket_begin, bucket_end] = BucketEntries(bucket);
+
+  // Split at the median value. All equal values have to stay in one bucket, so if the median is
+  // the smallest value, split after it instead.
+  double median = std::next(bucket_begin, bucket->second.entries / 2)->first;
+  EntrySet::const_iterator mid =
+      median > bucket_begin->first
+          ? entries_.lower_bound({median, 0})
+          : entries_.upper_bound({median, numeric_limits<DocId>::max()});
+
+  if (mid == bucket_end) {  // all values are equal
+    bucket->second.split_at *= 2;
+    return;
+  }
+
+  auto collect = [](auto begin, auto end) {
+    vector<DocId> ids;
+    for (auto it = begin; it != end; ++it)
+      ids.push_back(it->second);
+    sort(ids.begin(), ids.end());
+    ids.erase(unique(ids.begin(), ids.end()), ids.end());
+    return ids;
+  };
+
+  auto refill = [this](double bound, const vector<DocId>& ids, size_t entries) {
+    auto it = buckets_.emplace_hint(buckets_.end(), piecewise_construct, forward_as_tuple(bound),
+                                    forward_as_tuple(mr_, max_bucket_size_));
+    for (DocId id : ids)
+      it->second.ids.Insert(id);
+    it->second.entries = entries;
+  };
+
+  size_t left_entries = distance(bucket_begin, mid);
+  size_t right_entries = bucket->second.entries - left_entries;
+  vector<DocId> left = collect(bucket_begin, mid), right = collect(mid, bucket_end);
+  double bucket_bound = bucket->first, split_value = mid->first;
+
+  buckets_.erase(bucket);
+  refill(bucket_bound, left, left_entries);
+  refill(split_value, right, right_entries);
+}
+
+GeoIndex::GeoIndex(PMR_NS::memory_resource* mr) : entries_{mr}, points_{mr} {
+}
+
+bool GeoIndex::Add(DocId id, const DocumentAccessor& doc, string_view field) {
+  auto strings = doc.GetStrings(field);
+  if (!strings)
+    return false;
+
+  Points points{points_.get_allocator()};
+  for (string_view value : *strings) {
+    auto point = ParseGeoPoint(value);
+    if (!point)
+      return false;
+    points.push_back(*point);
+  }
+
+  if (points.empty())
+    return true;
+
+  for (uint64_t point : points)
+    entries_.emplace(point, id);
+  points_[id] = std::move(points);
+  return true;
+}
+
+void GeoIndex::Remove(DocId id, const DocumentAccessor& doc, string_view field) {
+  auto it = points_.find(id);
+  if (it == points_.end())
+    return;
+
+  for (uint64_t point : it->second)
+    entries_.erase({point, id});
+  points_.erase(it);
+}
+
+vector<DocId> GeoIndex::Radius(double lon, double lat, double radius) const {
+  GeoShape shape{};
+  shape.type = CIRCULAR_TYPE;
+  shape.xy[0] = lon;
+  shape.xy[1] = lat;
+  shape.conversion = 1;
+  shape.t.radius = radius;
+  return CollectInShape(entries_, &shape);
+}
+
+vector<DocId> GeoIndex::Box(double lon, double lat, double width, double height) const {
+  GeoShape shape{};
+  shape.type = RECTANGLE_TYPE;
+  shape.xy[0] = lon;
+  shape.xy[1] = lat;
+  shape.conversion = 1;
+  shape.t.r.width = width;
+  shape.t.r.height = height;
+  return CollectInShape(entries_, &shape);
+}
+
+optional<double> GeoIndex::Distance(DocId id, double lon, double lat) const {
+  auto it = points_.find(id);
+  if (it == points_.end())
+    return nullopt;
+
+  optional<double> closest;
+  for (uint64_t point : it->second) {
+    double xy[2];
+    if (!geohashDecodeToLongLatWGS84(GeoHashBits{point, GEO_STEP_MAX}, xy))
+      continue;
+    double distance = geohashGetDistance(lon, lat, xy[0], xy[1]);
+    closest = min(closest.value_or(distance), distance);
+  }
+  return closest;
 }
 
 template <typename C>
@@ -188,10 +454,114 @@ template <typename C> vector<string> BaseStringIndex<C>::GetTerms() const {
 template struct BaseStringIndex<CompressedSortedSet>;
 template struct BaseStringIndex<SortedVector>;
 
+std::optional<absl::flat_hash_map<std::string, uint32_t>> TextIndex::CountWords(
+    const DocumentAccessor& doc, std::string_view field) const {
+  auto strings_list = doc.GetStrings(field);
+  if (!strings_list)
+    return std::nullopt;
+
+  absl::flat_hash_map<std::string, uint32_t> counts;
+  for (string_view str : strings_list.value())
+    CountTokens(str, *stopwords_, &counts);
+  return counts;
+}
+
+bool TextIndex::Add(DocId id, const DocumentAccessor& doc, string_view field) {
+  auto counts = CountWords(doc, field);
+  if (!counts)
+    return false;
+
+  uint32_t length = 0;
+  for (const auto& [word, count] : *counts) {
+    GetOrCreate(word)->Insert(id);
+    if (count > 1) {
+      auto it = frequencies_.find(word);
+      if (it == frequencies_.end()) {
+        auto* mr = frequencies_.get_allocator().resource();
+        it = frequencies_.try_emplace(PMR_NS::string{word, mr}).first;
+      }
+      it->second[id] = count;
+    }
+    length += count;
+  }
+
+  if (doc_lengths_.size() <= id)
+    doc_lengths_.resize(id + 1);
+  doc_lengths_[id] = length;
+  num_docs_++;
+  total_length_ += length;
+  return true;
+}
+
+void TextIndex::Remove(DocId id, const DocumentAccessor& doc, string_view field) {
+  auto counts = CountWords(doc, field);
+  if (!counts)
+    return;
+
+  for (const auto& [word, count] : *counts) {
+    if (auto it = entries_.find(word); it != entries_.end()) {
+      it->second.Remove(id);
+      if (it->second.Size() == 0)
+        entries_.erase(it);
+    }
+
+    if (count == 1)
+      continue;
+
+    if (auto it = frequencies_.find(word); it != frequencies_.end()) {
+      it->second.erase(id);
+      if (it->second.empty())
+        frequencies_.erase(it);
+    }
+  }
+
+  DCHECK_LT(id, doc_lengths_.size());
+  DCHECK_GT(num_docs_, 0u);
+  num_docs_--;
+  total_length_ -= doc_lengths_[id];
+  doc_lengths_[id] = 0;
+}
+
 absl::flat_hash_set<std::string> TextIndex::Tokenize(std::string_view value) const {
   return TokenizeWords(value, *stopwords_);
 }
 
+void TextIndex::ScoreBM25(string_view term, absl::Span<const DocId> ids,
+                          absl::Span<double> scores) const {
+  DCHECK_EQ(ids.size(), scores.size());
+  const Container* postings = Matching(term);
+  if (postings == nullptr || num_docs_ == 0)
+    return;
+
+  double matched = postings->Size();
+  double idf = log(1 + (num_docs_ - matched + 0.5) / (matched + 0.5));
+  double avg_length = double(total_length_) / num_docs_;
+
+  const DocFrequencies* frequencies = nullptr;
+  if (auto it = frequencies_.find(ToLower(absl::StripAsciiWhitespace(term)));
+      it != frequencies_.end())
+    frequencies = &it->second;
+
+  // Both postings and ids are sorted, so advance through ids while iterating postings.
+  auto id_it = ids.begin();
+  for (DocId id : *postings) {
+    id_it = lower_bound(id_it, ids.end(), id);
+    if (id_it == ids.end())
+      break;
+    if (*id_it != id)
+      continue;
+
+    double tf = 1;
+    if (frequencies) {
+      if (auto it = frequencies->find(id); it != frequencies->end())
+        tf = it->second;
+    }
+
+    double norm = 1 - kBM25B + kBM25B * doc_lengths_[id] / avg_length;
+    scores[id_it - ids.begin()] += idf * tf * (kBM25K1 + 1) / (tf + kBM25K1 * norm);
+  }
+}
+
 absl::flat_hash_set<std::string> TagIndex::Tokenize(std::string_view value) const {
   return NormalizeTags(value, case_sensitive_, separator_);
 }
@@ -213,18 +583,43 @@ bool BaseVectorIndex::Add(DocId id, const DocumentAccessor& doc, std::string_vie
     return false;
   }
 
+  // Cosine distance of normalized vectors is a single dot product.
+  if (ptr && sim_ == VectorSimilarity::COSINE)
+    NormalizeVector(ptr.get(), dim_);
+
   AddVector(id, ptr);
   return true;
 }
 
 FlatVectorIndex::FlatVectorIndex(const SchemaField::VectorParams& params,
                                  PMR_NS::memory_resource* mr)
-    : BaseVectorIndex{params.dim, params.sim}, entries_{mr} {
+    : BaseVectorIndex{params.dim, params.sim},
+      quantization_{params.quantization},
+      entries_{mr},
+      quantized_{mr},
+      scales_{mr} {
   DCHECK(!params.use_hnsw);
-  entries_.reserve(params.capacity * params.dim);
+  if (quantization_ == VectorQuantization::INT8) {
+    quantized_.reserve(params.capacity * params.dim);
+    scales_.reserve(params.capacity);
+  } else {
+    entries_.reserve(params.capacity * params.dim);
+  }
 }
 
 void FlatVectorIndex::AddVector(DocId id, const VectorPtr& vector) {
+  if (quantization_ == VectorQuantization::INT8) {
+    DCHECK_LE(id, scales_.size());
+    if (id == scales_.size()) {
+      quantized_.resize((id + 1) * dim_);
+      scales_.resize(id + 1);
+    }
+
+    if (vector)
+      scales_[id] = QuantizeVector(vector.get(), dim_, &quantized_[id * dim_]);
+    return;
+  }
+
   DCHECK_LE(id * dim_, entries_.size());
   if (id * dim_ == entries_.size())
     entries_.resize((id + 1) * dim_);
@@ -239,8 +634,10 @@ void FlatVectorIndex::Remove(DocId id, const DocumentAccessor& doc, string_view
   // noop
 }
 
-const float* FlatVectorIndex::Get(DocId doc) const {
-  return &entries_[doc * dim_];
+float FlatVectorIndex::Distance(const float* target, DocId doc) const {
+  if (quantization_ == VectorQuantization::INT8)
+    return QuantizedVectorDistance(target, &quantized_[doc * dim_], scales_[doc], dim_, sim_);
+  return NormalizedVectorDistance(target, &entries_[doc * dim_], dim_, sim_);
 }
 
 struct HnswlibAdapter {
@@ -285,6 +682,28 @@ struct HnswlibAdapter {
     return QueueToVec(world_.searchKnn(target, k, &filter));
   }
 
+  vector<pair<float, DocId>> KnnFlat(const float* target, size_t k, const vector<DocId>& allowed) {
+    vector<pair<float, DocId>> out;
+    out.reserve(allowed.size());
+    for (DocId id : allowed) {
+      auto it = world_.label_lookup_.find(id);
+      if (it == world_.label_lookup_.end() || world_.isMarkedDeleted(it->second))
+        continue;
+
+      const char* data = world_.getDataByInternalId(it->second);
+      out.emplace_back(world_.fstdistfunc_(target, data, world_.dist_func_param_), id);
+    }
+
+    size_t prefix_size = min(k, out.size());
+    partial_sort(out.begin(), out.begin() + prefix_size, out.end());
+    out.resize(prefix_size);
+    return out;
+  }
+
+  size_t Degree() const {
+    return world_.M_;
+  }
+
  private:
   using SpaceUnion = std::variant<hnswlib::L2Space, hnswlib::InnerProductSpace>;
 
@@ -338,6 +757,15 @@ std::vector<std::pair<float, DocId>> HnswVectorIndex::Knn(float* target, size_t
   return adapter_->Knn(target, k, ef, allowed);
 }
 
+std::vector<std::pair<float, DocId>> HnswVectorIndex::KnnFlat(
+    const float* target, size_t k, const std::vector<DocId>& allowed) const {
+  return adapter_->KnnFlat(target, k, allowed);
+}
+
+size_t HnswVectorIndex::Degree() const {
+  return adapter_->Degree();
+}
+
 void HnswVectorIndex::Remove(DocId id, const DocumentAccessor& doc, string_view field) {
   adapter_->Remove(id);
 }
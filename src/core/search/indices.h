@@ -5,6 +5,7 @@
 #include <absl/container/btree_set.h>
 #include <absl/container/flat_hash_map.h>
 #include <absl/container/flat_hash_set.h>
+#include <absl/types/span.h>
 
 #include <map>
 #include <memory>
@@ -23,19 +24,81 @@
 
 namespace dfly::search {
 
-// Index for integer fields.
-// Range bounds are queried in logarithmic time, iteration is constant.
+// Index for numeric fields.
+// Values are partitioned into adaptive range buckets, each keeping a posting list of its
+// documents. Wide ranges union the posting lists of fully covered buckets and only the two
+// boundary buckets are refined by value. Buckets are split at their median when they grow too big.
 struct NumericIndex : public BaseIndex {
-  explicit NumericIndex(PMR_NS::memory_resource* mr);
+  static constexpr size_t kMaxBucketSize = 1 << 16;
+
+  explicit NumericIndex(PMR_NS::memory_resource* mr, size_t max_bucket_size = kMaxBucketSize);
 
   bool Add(DocId id, const DocumentAccessor& doc, std::string_view field) override;
   void Remove(DocId id, const DocumentAccessor& doc, std::string_view field) override;
 
   std::vector<DocId> Range(double l, double r) const;
 
+  size_t BucketCount() const {
+    return buckets_.size();
+  }
+
  private:
+  struct Bucket {
+    Bucket(PMR_NS::memory_resource* mr, size_t split_at) : ids{mr}, split_at{split_at} {
+    }
+
+    BlockList<SortedVector> ids;  // documents with values in the bucket
+    size_t entries = 0;           // number of values in the bucket
+    size_t split_at;              // split if there are more entries, grows for unsplittable buckets
+  };
+
+  // Buckets by their lower bound, each bucket covers values up to the next bucket's bound
+  using BucketMap = std::map<double, Bucket, std::less<double>,
+                             PMR_NS::polymorphic_allocator<std::pair<const double, Bucket>>>;
+
   using Entry = std::pair<double, DocId>;
+  using EntrySet = absl::btree_set<Entry, std::less<Entry>, PMR_NS::polymorphic_allocator<Entry>>;
+
+  BucketMap::iterator FindBucket(double value);
+  void TrySplit(BucketMap::iterator bucket);
+
+  // Range of entries with values in the bucket
+  std::pair<EntrySet::const_iterator, EntrySet::const_iterator> BucketEntries(
+      BucketMap::const_iterator bucket) const;
+
+  EntrySet entries_;
+
+  PMR_NS::memory_resource* mr_;
+  size_t max_bucket_size_;
+  BucketMap buckets_;
+};
+
+// Index for geo fields with "lon,lat" values.
+// Points are ordered by their 52 bit geohash, so an area is covered by a few hash ranges that are
+// scanned in logarithmic time and filtered by exact distance.
+struct GeoIndex : public BaseIndex {
+  explicit GeoIndex(PMR_NS::memory_resource* mr);
+
+  bool Add(DocId id, const DocumentAccessor& doc, std::string_view field) override;
+  void Remove(DocId id, const DocumentAccessor& doc, std::string_view field) override;
+
+  // Documents with a point within radius meters from (lon, lat)
+  std::vector<DocId> Radius(double lon, double lat, double radius) const;
+
+  // Documents with a point within a width x height meters box centered on (lon, lat)
+  std::vector<DocId> Box(double lon, double lat, double width, double height) const;
+
+  // Distance in meters from (lon, lat) to the closest point of the document
+  std::optional<double> Distance(DocId id, double lon, double lat) const;
+
+ private:
+  using Entry = std::pair<uint64_t /* geohash */, DocId>;
+  using Points = absl::InlinedVector<uint64_t, 1, PMR_NS::polymorphic_allocator<uint64_t>>;
+
   absl::btree_set<Entry, std::less<Entry>, PMR_NS::polymorphic_allocator<Entry>> entries_;
+  absl::flat_hash_map<DocId, Points, absl::Hash<DocId>, std::equal_to<DocId>,
+                      PMR_NS::polymorphic_allocator<std::pair<const DocId, Points>>>
+      points_;
 };
 
 // Base index for string based indices.
@@ -67,18 +130,44 @@ template <typename C> struct BaseStringIndex : public BaseIndex {
 };
 
 // Index for text fields.
-// Hashmap based lookup per word.
+// Hashmap based lookup per word. Keeps term frequencies and document lengths for BM25 scoring.
 struct TextIndex : public BaseStringIndex<CompressedSortedSet> {
   using StopWords = absl::flat_hash_set<std::string>;
 
   TextIndex(PMR_NS::memory_resource* mr, const StopWords* stopwords)
-      : BaseStringIndex(mr, false), stopwords_{stopwords} {
+      : BaseStringIndex(mr, false), stopwords_{stopwords}, doc_lengths_{mr}, frequencies_{mr} {
   }
 
+  bool Add(DocId id, const DocumentAccessor& doc, std::string_view field) override;
+  void Remove(DocId id, const DocumentAccessor& doc, std::string_view field) override;
+
   absl::flat_hash_set<std::string> Tokenize(std::string_view value) const override;
 
+  // Add BM25 relevance of term to the scores of documents in ids, which must be sorted.
+  void ScoreBM25(std::string_view term, absl::Span<const DocId> ids,
+                 absl::Span<double> scores) const;
+
  private:
+  // Count occurrences of all words in the field, returns nullopt if the field is missing.
+  std::optional<absl::flat_hash_map<std::string, uint32_t>> CountWords(
+      const DocumentAccessor& doc, std::string_view field) const;
+
   const StopWords* stopwords_;
+
+  PMR_NS::vector<uint32_t> doc_lengths_;  // number of words per document
+  size_t num_docs_ = 0;
+  size_t total_length_ = 0;
+
+  using DocFrequencies =
+      absl::flat_hash_map<DocId, uint32_t, absl::Hash<DocId>, std::equal_to<DocId>,
+                          PMR_NS::polymorphic_allocator<std::pair<const DocId, uint32_t>>>;
+
+  using TermFrequencies = std::pair<const PMR_NS::string, DocFrequencies>;
+
+  // Frequencies of words that occur more than once in a document, most words occur only once.
+  absl::flat_hash_map<PMR_NS::string, DocFrequencies, StringViewHash, StringViewEq,
+                      PMR_NS::polymorphic_allocator<TermFrequencies>>
+      frequencies_;
 };
 
 // Index for text fields.
@@ -110,19 +199,23 @@ struct BaseVectorIndex : public BaseIndex {
 };
 
 // Index for vector fields.
-// Only supports lookup by id.
+// Only supports lookup by id. Vectors are stored normalized for COSINE similarity.
 struct FlatVectorIndex : public BaseVectorIndex {
   FlatVectorIndex(const SchemaField::VectorParams& params, PMR_NS::memory_resource* mr);
 
   void Remove(DocId id, const DocumentAccessor& doc, std::string_view field) override;
 
-  const float* Get(DocId doc) const;
+  // Distance from target to the vector of doc. For COSINE similarity target must be normalized.
+  float Distance(const float* target, DocId doc) const;
 
  protected:
   void AddVector(DocId id, const VectorPtr& vector) override;
 
  private:
-  PMR_NS::vector<float> entries_;
+  VectorQuantization quantization_;
+  PMR_NS::vector<float> entries_;     // dim_ floats per document, if not quantized
+  PMR_NS::vector<int8_t> quantized_;  // dim_ values per document, if quantized to int8
+  PMR_NS::vector<float> scales_;      // quantization scale per document
 };
 
 struct HnswlibAdapter;
@@ -137,6 +230,14 @@ struct HnswVectorIndex : public BaseVectorIndex {
   std::vector<std::pair<float, DocId>> Knn(float* target, size_t k, std::optional<size_t> ef,
                                            const std::vector<DocId>& allowed) const;
 
+  // Computes distances to all allowed documents directly instead of traversing the graph.
+  // Distances are the same as the ones returned by Knn.
+  std::vector<std::pair<float, DocId>> KnnFlat(const float* target, size_t k,
+                                               const std::vector<DocId>& allowed) const;
+
+  // Number of links per graph node (M)
+  size_t Degree() const;
+
  protected:
   void AddVector(DocId id, const VectorPtr& vector) override;
 
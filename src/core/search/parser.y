@@ -24,6 +24,8 @@
 
 // Added to cc file
 %code {
+#include <absl/strings/ascii.h>
+
 #include "core/search/query_driver.h"
 #include "core/search/vector_utils.h"
 
@@ -37,6 +39,7 @@ using namespace std;
 
 uint32_t toUint32(string_view src);
 double toDouble(string_view src);
+double toGeoUnit(const string& unit, const dfly::search::Parser::location_type& loc);
 
 }
 
@@ -146,6 +149,19 @@ field_cond:
 
 numeric_filter_expr:
 opt_lparen generic_number opt_lparen generic_number { $$ = AstRangeNode($2, $1, $4, $3); }
+  // geo radius: [lon lat radius unit]
+  | opt_lparen generic_number opt_lparen generic_number generic_number TERM
+    {
+      if ($1 || $3) throw syntax_error(@$, "unexpected ( in geo filter");
+      $$ = AstGeoNode::Radius($2, $4, $5 * toGeoUnit($6, @6));
+    }
+  // geo box: [lon lat width height unit]
+  | opt_lparen generic_number opt_lparen generic_number generic_number generic_number TERM
+    {
+      if ($1 || $3) throw syntax_error(@$, "unexpected ( in geo filter");
+      double unit = toGeoUnit($7, @7);
+      $$ = AstGeoNode::Box($2, $4, $5 * unit, $6 * unit);
+    }
 
 generic_number:
   DOUBLE { $$ = toDouble($1); }
@@ -205,3 +221,17 @@ double toDouble(string_view str) {
   absl::SimpleAtod(str, &val); // no need to check the result because str is parsed by regex
   return val;
 }
+
+// Returns the number of meters in the geo distance unit
+double toGeoUnit(const string& unit, const dfly::search::Parser::location_type& loc) {
+  string lower = absl::AsciiStrToLower(unit);
+  if (lower == "m")
+    return 1;
+  if (lower == "km")
+    return 1000;
+  if (lower == "mi")
+    return 1609.34;
+  if (lower == "ft")
+    return 0.3048;
+  throw dfly::search::Parser::syntax_error(loc, "unsupported geo unit: " + unit);
+}
@@ -10,6 +10,9 @@
 #include <absl/strings/str_join.h>
 
 #include <chrono>
+#include <cmath>
+#include <limits>
+#include <numeric>
 #include <type_traits>
 #include <variant>
 
@@ -114,8 +117,54 @@ struct IndexResult {
       value_;
 };
 
+// Intersections iterate the smaller set and seek in the larger one if it's at least this many times
+// larger, otherwise both sets are merged linearly.
+constexpr size_t kSeekIntersectionRatio = 8;
+
+// Advance iterator to the first element not less than t
+template <typename It> void SeekGE(It* it, const It& end, DocId t) {
+  using Category = typename iterator_traits<It>::iterator_category;
+  if constexpr (is_base_of_v<random_access_iterator_tag, Category>)
+    *it = lower_bound(*it, end, t);
+  else
+    it->SeekGE(t);
+}
+
+// Intersect by seeking every element of the small set in the large set. Block lists skip whole
+// blocks on seeks, so the large set is only partially traversed.
+template <typename S, typename L>
+void IntersectBySeeking(const S& small, const L& large, vector<DocId>* out) {
+  auto it = large.begin(), end = large.end();
+  for (DocId id : small) {
+    SeekGE(&it, end, id);
+    if (it == end)
+      break;
+    if (*it == id)
+      out->push_back(id);
+  }
+}
+
+// hnswlib default for the size of the dynamic candidate list
+constexpr size_t kDefaultHnswEf = 10;
+
+// Upper bound for the candidate list size chosen for filtered HNSW queries
+constexpr size_t kMaxAutoHnswEf = 1000;
+
+// Estimates whether brute force KNN over `allowed` of `total` documents is cheaper than filtered
+// HNSW traversal. The traversal evaluates about ef * M * log(n) candidates to collect ef results,
+// but only the allowed fraction of candidates is accepted. Brute force computes exactly one
+// distance per allowed document.
+bool PreferFlatKnn(size_t allowed, size_t total, size_t ef, size_t degree) {
+  if (allowed == 0 || total == 0)
+    return true;
+
+  double selectivity = double(allowed) / total;
+  double hnsw_cost = double(ef) * degree * log2(double(total) + 1) / selectivity;
+  return allowed <= hnsw_cost;
+}
+
 struct ProfileBuilder {
-  string GetNodeInfo(const AstNode& node) {
+  string GetNodeInfo(const AstNode& node, string_view knn_plan) {
     struct NodeFormatter {
       void operator()(std::string* out, const AstPrefixNode& node) const {
         out->append(node.prefix);
@@ -132,6 +181,7 @@ struct ProfileBuilder {
         [](const AstTermNode& n) { return absl::StrCat("Term{", n.term, "}"); },
         [](const AstPrefixNode& n) { return absl::StrCat("Prefix{", n.prefix, "}"); },
         [](const AstRangeNode& n) { return absl::StrCat("Range{", n.lo, "<>", n.hi, "}"); },
+        [](const AstGeoNode& n) { return absl::StrCat("Geo{", n.lon, ",", n.lat, "}"); },
         [](const AstLogicalNode& n) {
           auto op = n.op == AstLogicalNode::AND ? "and" : "or";
           return absl::StrCat("Logical{n=", n.nodes.size(), ",o=", op, "}");
@@ -140,7 +190,9 @@ struct ProfileBuilder {
           return absl::StrCat("Tags{", absl::StrJoin(n.tags, ",", NodeFormatter()), "}");
         },
         [](const AstFieldNode& n) { return absl::StrCat("Field{", n.field, "}"); },
-        [](const AstKnnNode& n) { return absl::StrCat("KNN{l=", n.limit, "}"); },
+        [knn_plan](const AstKnnNode& n) {
+          return absl::StrCat("KNN{l=", n.limit, knn_plan.empty() ? "" : ",", knn_plan, "}");
+        },
         [](const AstNegateNode& n) { return absl::StrCat("Negate{}"); },
         [](const AstStarNode& n) { return absl::StrCat("Star{}"); },
         [](const AstSortNode& n) { return absl::StrCat("Sort{f", n.field, "}"); },
@@ -155,11 +207,11 @@ struct ProfileBuilder {
     return chrono::steady_clock::now();
   }
 
-  void Finish(Tp start, const AstNode& node, const IndexResult& result) {
+  void Finish(Tp start, const AstNode& node, const IndexResult& result, string_view knn_plan) {
     DCHECK_GE(depth_, 1u);
     auto took = chrono::steady_clock::now() - start;
     size_t micros = chrono::duration_cast<chrono::microseconds>(took).count();
-    auto descr = GetNodeInfo(node);
+    auto descr = GetNodeInfo(node, knn_plan);
     profile_.events.push_back({std::move(descr), micros, depth_ - 1, result.Size()});
     depth_--;
   }
@@ -185,6 +237,10 @@ struct BasicSearch {
     profile_builder_ = ProfileBuilder{};
   }
 
+  void EnableScoring() {
+    scoring_ = true;
+  }
+
   // Get casted sub index by field
   template <typename T> T* GetIndex(string_view field) {
     static_assert(is_base_of_v<BaseIndex, T>);
@@ -228,9 +284,19 @@ struct BasicSearch {
     tmp_vec_.clear();
 
     if (op == LogicOp::AND) {
-      tmp_vec_.reserve(min(matched.Size(), current.Size()));
-      auto cb = [this](auto* s1, auto* s2) {
-        set_intersection(s1->begin(), s1->end(), s2->begin(), s2->end(), back_inserter(tmp_vec_));
+      size_t small = min(matched.Size(), current.Size());
+      size_t large = max(matched.Size(), current.Size());
+      tmp_vec_.reserve(small);
+
+      bool seek = large >= small * kSeekIntersectionRatio;
+      auto cb = [this, seek](auto* s1, auto* s2) {
+        if (!seek)
+          set_intersection(s1->begin(), s1->end(), s2->begin(), s2->end(),
+                           back_inserter(tmp_vec_));
+        else if (s1->size() <= s2->size())
+          IntersectBySeeking(*s1, *s2, &tmp_vec_);
+        else
+          IntersectBySeeking(*s2, *s1, &tmp_vec_);
       };
       visit(cb, matched.Borrowed(), current.Borrowed());
     } else {
@@ -281,12 +347,17 @@ struct BasicSearch {
   // "term": access field's text index or unify results from all text indices if no field is set
   IndexResult Search(const AstTermNode& node, string_view active_field) {
     if (!active_field.empty()) {
-      if (auto* index = GetIndex<TextIndex>(active_field); index)
+      if (auto* index = GetIndex<TextIndex>(active_field); index) {
+        scored_terms_.emplace_back(index, node.term);
         return index->Matching(node.term);
+      }
       return IndexResult{};
     }
 
     vector<TextIndex*> selected_indices = indices_->GetAllTextIndices();
+    for (TextIndex* index : selected_indices)
+      scored_terms_.emplace_back(index, node.term);
+
     auto mapping = [&node](TextIndex* index) { return index->Matching(node.term); };
 
     return UnifyResults(GetSubResults(selected_indices, mapping), LogicOp::OR);
@@ -317,9 +388,27 @@ struct BasicSearch {
     return IndexResult{};
   }
 
+  // [lon lat radius unit] or [lon lat width height unit]: access field's geo index
+  IndexResult Search(const AstGeoNode& node, string_view active_field) {
+    DCHECK(!active_field.empty());
+    auto* index = GetIndex<GeoIndex>(active_field);
+    if (!index)
+      return IndexResult{};
+
+    // Remember the center for sorting by distance
+    geo_centers_.emplace_back(index, make_pair(node.lon, node.lat));
+
+    if (node.box)
+      return index->Box(node.lon, node.lat, node.width, node.height);
+    return index->Radius(node.lon, node.lat, node.radius);
+  }
+
   // negate -(*subquery*): explicitly compute result complement. Needs further optimizations
   IndexResult Search(const AstNegateNode& node, string_view active_field) {
+    // Negated terms don't contribute to relevance
+    size_t scored_terms = scored_terms_.size();
     vector<DocId> matched = SearchGeneric(*node.node, active_field).Take();
+    scored_terms_.resize(scored_terms);
     vector<DocId> all = indices_->GetAllDocs();
 
     // To negate a result, we have to find the complement of matched to all documents,
@@ -372,6 +461,11 @@ struct BasicSearch {
 
     preagg_total_ = sub_results.Size();
 
+    // Geo fields are sorted by distance to the query's geo filter
+    auto* geo_index = dynamic_cast<const GeoIndex*>(indices_->GetIndex(node.field));
+    if (geo_index)
+      return SortByDistance(geo_index, std::move(sub_results), node.descending);
+
     if (auto* sort_index = GetSortIndex(node.field); sort_index) {
       auto ids_vec = sub_results.Take();
       scores_ = sort_index->Sort(&ids_vec, limit_, node.descending);
@@ -381,14 +475,44 @@ struct BasicSearch {
     return IndexResult{};
   }
 
-  void SearchKnnFlat(FlatVectorIndex* vec_index, const AstKnnNode& knn, IndexResult&& sub_results) {
+  // Sort by distance to the center of the geo filter on the same index
+  IndexResult SortByDistance(const GeoIndex* index, IndexResult&& sub_results, bool desc) {
+    auto center = find_if(geo_centers_.begin(), geo_centers_.end(),
+                          [index](const auto& entry) { return entry.first == index; });
+    if (center == geo_centers_.end()) {
+      error_ = "Sorting by a geo field requires a geo filter on it";
+      return IndexResult{};
+    }
+
+    auto [lon, lat] = center->second;
+    vector<pair<double, DocId>> distances;
+    distances.reserve(sub_results.Size());
+    for (DocId id : sub_results.Take()) {
+      double distance = index->Distance(id, lon, lat).value_or(numeric_limits<double>::infinity());
+      distances.emplace_back(desc ? -distance : distance, id);
+    }
+
+    size_t prefix_size = min(limit_, distances.size());
+    partial_sort(distances.begin(), distances.begin() + prefix_size, distances.end());
+    distances.resize(prefix_size);
+
+    vector<DocId> out;
+    out.reserve(prefix_size);
+    scores_.clear();
+    scores_.reserve(prefix_size);
+    for (auto [distance, id] : distances) {
+      out.push_back(id);
+      scores_.emplace_back(desc ? -distance : distance);
+    }
+    return out;
+  }
+
+  void SearchKnnFlat(FlatVectorIndex* vec_index, const AstKnnNode& knn, float* target,
+                     IndexResult&& sub_results) {
     knn_distances_.reserve(sub_results.Size());
     auto cb = [&](auto* set) {
-      auto [dim, sim] = vec_index->Info();
-      for (DocId matched_doc : *set) {
-        float dist = VectorDistance(knn.vec.first.get(), vec_index->Get(matched_doc), dim, sim);
-        knn_distances_.emplace_back(dist, matched_doc);
-      }
+      for (DocId matched_doc : *set)
+        knn_distances_.emplace_back(vec_index->Distance(target, matched_doc), matched_doc);
     };
     visit(cb, sub_results.Borrowed());
 
@@ -398,12 +522,31 @@ struct BasicSearch {
     knn_distances_.resize(prefix_size);
   }
 
-  void SearchKnnHnsw(HnswVectorIndex* vec_index, const AstKnnNode& knn, IndexResult&& sub_results) {
-    if (indices_->GetAllDocs().size() == sub_results.Size())
-      knn_distances_ = vec_index->Knn(knn.vec.first.get(), knn.limit, knn.ef_runtime);
-    else
-      knn_distances_ =
-          vec_index->Knn(knn.vec.first.get(), knn.limit, knn.ef_runtime, sub_results.Take());
+  void SearchKnnHnsw(HnswVectorIndex* vec_index, const AstKnnNode& knn, float* target,
+                     IndexResult&& sub_results) {
+    size_t total = indices_->GetAllDocs().size();
+    size_t allowed = sub_results.Size();
+    if (total == allowed) {
+      knn_plan_ = "hnsw";
+      knn_distances_ = vec_index->Knn(target, knn.limit, knn.ef_runtime);
+      return;
+    }
+
+    // Without an explicit EF_RUNTIME, grow the candidate list with the inverse selectivity of the
+    // filter, so that the traversal still collects enough allowed documents.
+    size_t ef = kMaxAutoHnswEf;
+    if (knn.ef_runtime)
+      ef = static_cast<size_t>(*knn.ef_runtime);
+    else if (allowed > 0)
+      ef = min<size_t>(max<size_t>(knn.limit, kDefaultHnswEf) * total / allowed, kMaxAutoHnswEf);
+
+    if (PreferFlatKnn(allowed, total, ef, vec_index->Degree())) {
+      knn_plan_ = "flat";
+      knn_distances_ = vec_index->KnnFlat(target, knn.limit, sub_results.Take());
+    } else {
+      knn_plan_ = absl::StrCat("hnsw,ef=", ef);
+      knn_distances_ = vec_index->Knn(target, knn.limit, ef, sub_results.Take());
+    }
   }
 
   // [KNN limit @field vec]: Compute distance from `vec` to all vectors keep closest `limit`
@@ -415,18 +558,25 @@ struct BasicSearch {
     if (!vec_index)
       return IndexResult{};
 
-    if (auto [dim, _] = vec_index->Info(); dim != knn.vec.second) {
+    auto [dim, sim] = vec_index->Info();
+    if (dim != knn.vec.second) {
       error_ =
           absl::StrCat("Wrong vector index dimensions, got: ", knn.vec.second, ", expected: ", dim);
       return IndexResult{};
     }
 
+    // Indices store normalized vectors for COSINE similarity, so normalize the target as well.
+    vector<float> target(knn.vec.first.get(), knn.vec.first.get() + dim);
+    if (sim == VectorSimilarity::COSINE)
+      NormalizeVector(target.data(), dim);
+
     preagg_total_ = sub_results.Size();
     scores_.clear();
     if (auto hnsw_index = dynamic_cast<HnswVectorIndex*>(vec_index); hnsw_index)
-      SearchKnnHnsw(hnsw_index, knn, std::move(sub_results));
+      SearchKnnHnsw(hnsw_index, knn, target.data(), std::move(sub_results));
     else
-      SearchKnnFlat(dynamic_cast<FlatVectorIndex*>(vec_index), knn, std::move(sub_results));
+      SearchKnnFlat(dynamic_cast<FlatVectorIndex*>(vec_index), knn, target.data(),
+                    std::move(sub_results));
 
     vector<DocId> out(knn_distances_.size());
     scores_.reserve(knn_distances_.size());
@@ -455,19 +605,49 @@ struct BasicSearch {
            visit([](auto* set) { return is_sorted(set->begin(), set->end()); }, result.Borrowed()));
 
     if (profile_builder_)
-      profile_builder_->Finish(start, node, result);
+      profile_builder_->Finish(start, node, result, knn_plan_);
 
     return result;
   }
 
+  // Rank results by BM25 relevance of the matched query terms and keep the best limit_ results.
+  vector<DocId> ScoreResults(IndexResult&& result) {
+    vector<DocId> ids = result.Take();
+    if (!is_sorted(ids.begin(), ids.end()))
+      sort(ids.begin(), ids.end());
+
+    vector<double> relevance(ids.size(), 0.0);
+    for (const auto& [index, term] : scored_terms_)
+      index->ScoreBM25(term, ids, absl::MakeSpan(relevance));
+
+    vector<size_t> order(ids.size());
+    iota(order.begin(), order.end(), 0);
+    size_t prefix_size = min(limit_, order.size());
+    partial_sort(order.begin(), order.begin() + prefix_size, order.end(),
+                 [&relevance](size_t l, size_t r) {
+                   return relevance[l] != relevance[r] ? relevance[l] > relevance[r] : l < r;
+                 });
+
+    vector<DocId> out(prefix_size);
+    scores_.reserve(prefix_size);
+    for (size_t i = 0; i < prefix_size; i++) {
+      out[i] = ids[order[i]];
+      scores_.emplace_back(relevance[order[i]]);
+    }
+    return out;
+  }
+
   SearchResult Search(const AstNode& query) {
     IndexResult result = SearchGeneric(query, "", true);
+    size_t total = result.Size();
+
+    if (scoring_ && error_.empty())
+      result = ScoreResults(std::move(result));
 
     // Extract profile if enabled
     optional<AlgorithmProfile> profile =
         profile_builder_ ? make_optional(profile_builder_->Take()) : nullopt;
 
-    size_t total = result.Size();
     return SearchResult{total,
                         max(total, preagg_total_),
                         result.Take(limit_),
@@ -487,6 +667,12 @@ struct BasicSearch {
 
   vector<DocId> tmp_vec_;
   vector<pair<float, DocId>> knn_distances_;
+  string knn_plan_;  // execution plan of the KNN node for profiling
+
+  bool scoring_ = false;
+  vector<pair<const TextIndex*, string_view /*term*/>> scored_terms_;
+
+  vector<pair<const GeoIndex*, pair<double, double> /*lon, lat*/>> geo_centers_;
 };
 
 #ifndef __clang__
@@ -535,6 +721,9 @@ void FieldIndices::CreateIndices(PMR_NS::memory_resource* mr) {
       case SchemaField::NUMERIC:
         indices_[field_ident] = make_unique<NumericIndex>(mr);
         break;
+      case SchemaField::GEO:
+        indices_[field_ident] = make_unique<GeoIndex>(mr);
+        break;
       case SchemaField::TAG: {
         const auto& tparams = std::get<SchemaField::TagParams>(field_info.special_params);
         indices_[field_ident] = make_unique<TagIndex>(mr, tparams);
@@ -571,6 +760,7 @@ void FieldIndices::CreateSortIndices(PMR_NS::memory_resource* mr) {
       case SchemaField::NUMERIC:
         sort_indices_[field_ident] = make_unique<NumericSortIndex>(mr);
         break;
+      case SchemaField::GEO:
       case SchemaField::VECTOR:
         break;
     }
@@ -662,29 +852,47 @@ SearchAlgorithm::SearchAlgorithm() = default;
 SearchAlgorithm::~SearchAlgorithm() = default;
 
 bool SearchAlgorithm::Init(string_view query, const QueryParams* params, const SortOption* sort) {
+  auto parsed = Parse(query, params);
+  if (!parsed)
+    return false;
+
+  Init(std::move(parsed), sort);
+  return true;
+}
+
+void SearchAlgorithm::Init(shared_ptr<const AstNode> query, const SortOption* sort) {
+  DCHECK(query);
+  query_ = std::move(query);
+  if (sort != nullptr)
+    query_ = make_shared<AstNode>(AstSortNode{std::move(query_), sort->field, sort->descending});
+}
+
+shared_ptr<const AstNode> SearchAlgorithm::Parse(string_view query, const QueryParams* params) {
+  shared_ptr<AstExpr> parsed;
   try {
-    query_ = make_unique<AstExpr>(ParseQuery(query, params));
+    parsed = make_shared<AstExpr>(ParseQuery(query, params));
   } catch (const Parser::syntax_error& se) {
     LOG(INFO) << "Failed to parse query \"" << query << "\":" << se.what();
-    return false;
+    return nullptr;
   } catch (...) {
     LOG(INFO) << "Unexpected query parser error";
-    return false;
+    return nullptr;
   }
 
-  if (holds_alternative<monostate>(*query_))
-    return false;
-
-  if (sort != nullptr)
-    query_ = make_unique<AstNode>(AstSortNode{std::move(query_), sort->field, sort->descending});
-
-  return true;
+  if (holds_alternative<monostate>(*parsed))
+    return nullptr;
+  return parsed;
 }
 
 SearchResult SearchAlgorithm::Search(const FieldIndices* index, size_t limit) const {
   auto bs = BasicSearch{index, limit};
   if (profiling_enabled_)
     bs.EnableProfiling();
+
+  // KNN and SORTBY queries define their own order
+  if (scoring_enabled_ && !get_if<AstKnnNode>(query_.get()) && !get_if<AstSortNode>(query_.get()))
+    bs.EnableScoring();
+
   return bs.Search(*query_);
 }
 
@@ -702,6 +910,9 @@ optional<AggregationInfo> SearchAlgorithm::HasAggregation() const {
     return AggregationInfo{nullopt, alias, sort->descending};
   }
 
+  if (scoring_enabled_)
+    return AggregationInfo{nullopt, "", true};
+
   return nullopt;
 }
 
@@ -709,4 +920,8 @@ void SearchAlgorithm::EnableProfiling() {
   profiling_enabled_ = true;
 }
 
+void SearchAlgorithm::EnableScoring() {
+  scoring_enabled_ = true;
+}
+
 }  // namespace dfly::search
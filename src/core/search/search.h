@@ -24,7 +24,7 @@ struct TextIndex;
 
 // Describes a specific index field
 struct SchemaField {
-  enum FieldType { TAG, TEXT, NUMERIC, VECTOR };
+  enum FieldType { TAG, TEXT, NUMERIC, VECTOR, GEO };
   enum FieldFlags : uint8_t { NOINDEX = 1 << 0, SORTABLE = 1 << 1 };
 
   struct VectorParams {
@@ -35,6 +35,7 @@ struct SchemaField {
     size_t capacity = 1000;                       // initial capacity
     size_t hnsw_ef_construction = 200;
     size_t hnsw_m = 16;
+    VectorQuantization quantization = VectorQuantization::NONE;  // only for flat indices
   };
 
   struct TagParams {
@@ -150,6 +151,12 @@ class SearchAlgorithm {
   // Init with query and return true if successful.
   bool Init(std::string_view query, const QueryParams* params, const SortOption* sort = nullptr);
 
+  // Init with an already parsed query. Parsed queries are immutable and can be shared.
+  void Init(std::shared_ptr<const AstNode> query, const SortOption* sort = nullptr);
+
+  // Parse query with bound params, returns nullptr if the query is not valid.
+  static std::shared_ptr<const AstNode> Parse(std::string_view query, const QueryParams* params);
+
   SearchResult Search(const FieldIndices* index,
                       size_t limit = std::numeric_limits<size_t>::max()) const;
 
@@ -158,9 +165,13 @@ class SearchAlgorithm {
 
   void EnableProfiling();
 
+  // Rank results by BM25 relevance of the query terms. KNN and SORTBY queries keep their order.
+  void EnableScoring();
+
  private:
   bool profiling_enabled_ = false;
-  std::unique_ptr<AstNode> query_;
+  bool scoring_enabled_ = false;
+  std::shared_ptr<const AstNode> query_;
 };
 
 }  // namespace dfly::search
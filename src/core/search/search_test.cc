@@ -7,6 +7,7 @@
 #include <absl/cleanup/cleanup.h>
 #include <absl/container/flat_hash_map.h>
 #include <absl/strings/escaping.h>
+#include <absl/strings/match.h>
 #include <absl/strings/numbers.h>
 #include <absl/strings/str_split.h>
 #include <gmock/gmock.h>
@@ -20,7 +21,9 @@
 #include "base/gtest.h"
 #include "base/logging.h"
 #include "core/search/base.h"
+#include "core/search/indices.h"
 #include "core/search/query_driver.h"
+#include "core/search/sort_indices.h"
 #include "core/search/vector_utils.h"
 
 extern "C" {
@@ -362,6 +365,100 @@ TEST_F(SearchTest, MatchDoubleRange) {
   }
 }
 
+TEST_F(SearchTest, NumericIndexBuckets) {
+  NumericIndex index{PMR_NS::get_default_resource(), 8};
+
+  // Every fourth document shares the same value to create an unsplittable bucket
+  default_random_engine rnd{};
+  vector<optional<double>> values(500);
+  for (DocId i = 0; i < values.size(); i++) {
+    values[i] = i % 4 == 0 ? 7 : rnd() % 300;
+    EXPECT_TRUE(index.Add(i, MockedDocument{Map{{"f", absl::StrCat(*values[i])}}}, "f"));
+  }
+
+  for (DocId i = 0; i < values.size(); i += 5) {
+    index.Remove(i, MockedDocument{Map{{"f", absl::StrCat(*values[i])}}}, "f");
+    values[i].reset();
+  }
+
+  EXPECT_GT(index.BucketCount(), 10u);
+
+  auto expected_range = [&values](double l, double r) {
+    vector<DocId> out;
+    for (DocId i = 0; i < values.size(); i++) {
+      if (values[i] && l <= *values[i] && *values[i] <= r)
+        out.push_back(i);
+    }
+    return out;
+  };
+
+  vector<pair<double, double>> ranges = {{0, 300},     {7, 7},  {6.5, 7.5},  {10, 20},
+                                          {150.5, 299}, {-1, 0}, {301, 400}, {20, 10}};
+  for (auto [l, r] : ranges)
+    EXPECT_EQ(index.Range(l, r), expected_range(l, r)) << l << " " << r;
+}
+
+TEST_F(SearchTest, MatchGeo) {
+  PrepareSchema({{"loc", SchemaField::GEO}, {"tag", SchemaField::TAG}});
+
+  // San Francisco city center
+  {
+    PrepareQuery("@loc:[-122.42 37.77 5 km]");
+
+    ExpectAll(Map{{"loc", "-122.4194,37.7749"}}, Map{{"loc", "-122.4313,37.7739"}});
+    ExpectNone(Map{{"loc", "-122.2711,37.8044"}}, Map{{"loc", "-118.2437,34.0522"}}, Map{});
+
+    EXPECT_TRUE(Check()) << GetError();
+  }
+
+  {
+    PrepareQuery("@loc:[-122.42 37.77 40 10 km] @tag:{open}");
+
+    ExpectAll(Map{{"loc", "-122.4194,37.7749"}, {"tag", "open"}},
+              Map{{"loc", "-122.2711,37.8044"}, {"tag", "open"}});
+    ExpectNone(Map{{"loc", "-122.4194,37.7749"}, {"tag", "closed"}},
+               Map{{"loc", "-122.4194,37.9"}, {"tag", "open"}},
+               Map{{"loc", "-118.2437,34.0522"}, {"tag", "open"}});
+
+    EXPECT_TRUE(Check()) << GetError();
+  }
+
+  {
+    PrepareQuery("@loc:[-122.42 37.77 1 parsec]");
+    EXPECT_FALSE(Check());
+  }
+}
+
+TEST_F(SearchTest, SortByGeoDistance) {
+  auto schema = MakeSimpleSchema({{"loc", SchemaField::GEO}});
+  FieldIndices indices{schema, kEmptyOptions, PMR_NS::get_default_resource()};
+
+  const string kPoints[] = {"-122.2711,37.8044", "-122.4194,37.7749", "-118.2437,34.0522",
+                            "-122.4313,37.7739"};
+  for (DocId i = 0; i < ABSL_ARRAYSIZE(kPoints); i++)
+    indices.Add(i, MockedDocument{Map{{"loc", kPoints[i]}}});
+
+  SearchAlgorithm algo{};
+  QueryParams params;
+  SortOption sort{"loc", false};
+
+  algo.Init("@loc:[-122.42 37.77 100 km]", &params, &sort);
+  auto res = algo.Search(&indices, 2);
+  EXPECT_EQ(res.total, 3u);
+  EXPECT_THAT(res.ids, testing::ElementsAre(1, 3));
+  EXPECT_LT(get<double>(res.scores[0]), 1000);
+
+  sort.descending = true;
+  algo.Init("@loc:[-122.42 37.77 1000 km]", &params, &sort);
+  res = algo.Search(&indices, 10);
+  EXPECT_THAT(res.ids, testing::ElementsAre(2, 0, 3, 1));
+
+  // A geo filter is needed for the distance reference point
+  algo.Init("*", &params, &sort);
+  res = algo.Search(&indices, 10);
+  EXPECT_FALSE(res.error.empty());
+}
+
 TEST_F(SearchTest, MatchStar) {
   PrepareQuery("*");
   ExpectAll("one", "two", "three", "and", "all", "documents");
@@ -496,6 +593,142 @@ TEST_F(SearchTest, Errors) {
   EXPECT_THAT(algo.Search(&indices).error, HasSubstr("Wrong vector index dimensions"));
 }
 
+TEST_F(SearchTest, BM25Scoring) {
+  auto schema = MakeSimpleSchema({{"title", SchemaField::TEXT}});
+  FieldIndices indices{schema, kEmptyOptions, PMR_NS::get_default_resource()};
+
+  const string kTitles[] = {"dragonfly dragonfly dragonfly fast", "dragonfly is a database",
+                            "redis database",
+                            "a long text about many things and one dragonfly mention here"};
+  for (size_t i = 0; i < ABSL_ARRAYSIZE(kTitles); i++) {
+    MockedDocument doc{Map{{"title", kTitles[i]}}};
+    indices.Add(i, doc);
+  }
+
+  SearchAlgorithm algo{};
+  QueryParams params;
+
+  // Higher term frequency and shorter documents rank first
+  algo.Init("dragonfly", &params);
+  algo.EnableScoring();
+  auto res = algo.Search(&indices);
+  EXPECT_THAT(res.ids, testing::ElementsAre(0, 1, 3));
+  ASSERT_EQ(res.scores.size(), 3u);
+  EXPECT_GT(get<double>(res.scores[0]), get<double>(res.scores[1]));
+
+  // Rare terms weigh more, documents matching both terms rank first
+  algo.Init("dragonfly | database", &params);
+  algo.EnableScoring();
+  EXPECT_THAT(algo.Search(&indices).ids, testing::ElementsAre(1, 2, 0, 3));
+
+  // Only the top results are returned, but all matches are counted
+  res = algo.Search(&indices, 2);
+  EXPECT_THAT(res.ids, testing::ElementsAre(1, 2));
+  EXPECT_EQ(res.total, 4u);
+
+  // Negated terms don't contribute
+  algo.Init("dragonfly -database", &params);
+  algo.EnableScoring();
+  EXPECT_THAT(algo.Search(&indices).ids, testing::ElementsAre(0, 3));
+
+  // Scores are updated when documents are removed
+  MockedDocument removed{Map{{"title", kTitles[0]}}};
+  indices.Remove(0, removed);
+  algo.Init("dragonfly", &params);
+  algo.EnableScoring();
+  EXPECT_THAT(algo.Search(&indices).ids, testing::ElementsAre(1, 3));
+}
+
+TEST_F(SearchTest, SkewedIntersection) {
+  auto schema = MakeSimpleSchema({{"title", SchemaField::TEXT}, {"tag", SchemaField::TAG}});
+  FieldIndices indices{schema, kEmptyOptions, PMR_NS::get_default_resource()};
+
+  // "common" is in every document, "rare" and the tag only in a few scattered ones
+  vector<DocId> expected;
+  for (DocId i = 0; i < 10'000; i++) {
+    bool rare = i % 997 == 0, tagged = i % 3 == 0;
+    MockedDocument doc{
+        Map{{"title", rare ? "common rare" : "common"}, {"tag", tagged ? "t" : "x"}}};
+    indices.Add(i, doc);
+    if (rare && tagged)
+      expected.push_back(i);
+  }
+
+  SearchAlgorithm algo{};
+  QueryParams params;
+
+  algo.Init("common rare @tag:{t}", &params);
+  EXPECT_EQ(algo.Search(&indices).ids, expected);
+
+  algo.Init("rare common", &params);
+  EXPECT_EQ(algo.Search(&indices).total, 11u);
+}
+
+TEST_F(SearchTest, SortByTag) {
+  auto schema = MakeSimpleSchema({{"color", SchemaField::TAG}});
+  schema.fields["color"].flags |= SchemaField::SORTABLE;
+  FieldIndices indices{schema, kEmptyOptions, PMR_NS::get_default_resource()};
+
+  const string kColors[] = {"red", "green", "blue", "yellow"};
+  for (DocId i = 0; i < 100; i++) {
+    MockedDocument doc{Map{{"color", kColors[i % 4]}}};
+    indices.Add(i, doc);
+  }
+
+  // Remove all red documents
+  for (DocId i = 0; i < 100; i += 4) {
+    MockedDocument doc{Map{{"color", "red"}}};
+    indices.Remove(i, doc);
+  }
+
+  SearchAlgorithm algo{};
+  QueryParams params;
+
+  SortOption sort{"color", false};
+  algo.Init("*", &params, &sort);
+  auto res = algo.Search(&indices, 3);
+  EXPECT_EQ(res.total, 75u);
+  ASSERT_EQ(res.ids.size(), 3u);
+  for (size_t i = 0; i < 3; i++) {
+    EXPECT_EQ(res.ids[i] % 4, 2u);
+    EXPECT_EQ(string_view(get<WrappedStrPtr>(res.scores[i])), "blue");
+  }
+
+  sort.descending = true;
+  algo.Init("*", &params, &sort);
+  res = algo.Search(&indices, 1);
+  EXPECT_EQ(res.ids[0] % 4, 3u);
+}
+
+TEST_F(SearchTest, StringSortIndex) {
+  StringSortIndex index{PMR_NS::get_default_resource()};
+
+  const string kValues[] = {"b", "", "a", "b", "c"};
+  for (DocId i = 0; i < ABSL_ARRAYSIZE(kValues); i++) {
+    MockedDocument doc{Map{{"f", kValues[i]}}};
+    index.Add(i, doc, "f");
+  }
+  EXPECT_EQ(index.DictionarySize(), 3u);
+  EXPECT_EQ(get<string>(index.Lookup(3)), "b");
+  EXPECT_EQ(get<string>(index.Lookup(1)), "");
+
+  // Fewer documents than distinct values are sorted by comparing strings, more by ranks
+  vector<DocId> ids = {4, 2};
+  index.Sort(&ids, 2, false);
+  EXPECT_THAT(ids, testing::ElementsAre(2, 4));
+
+  ids = {0, 1, 2, 3, 4};
+  index.Sort(&ids, 5, true);
+  EXPECT_EQ(ids[0], 4u);
+  EXPECT_EQ(ids[4], 1u);
+
+  // Values are dropped from the dictionary once no document references them
+  MockedDocument doc{Map{{"f", "c"}}};
+  index.Remove(4, doc, "f");
+  EXPECT_EQ(index.DictionarySize(), 2u);
+  EXPECT_EQ(get<string>(index.Lookup(4)), "");
+}
+
 class KnnTest : public SearchTest, public testing::WithParamInterface<bool /* hnsw */> {};
 
 TEST_P(KnnTest, Simple1D) {
@@ -725,6 +958,117 @@ TEST_P(KnnTest, AutoResize) {
 INSTANTIATE_TEST_SUITE_P(KnnFlat, KnnTest, testing::Values(false));
 INSTANTIATE_TEST_SUITE_P(KnnHnsw, KnnTest, testing::Values(true));
 
+TEST_F(SearchTest, KnnHnswFilterPlan) {
+  auto schema = MakeSimpleSchema({{"pos", SchemaField::VECTOR}, {"group", SchemaField::TAG}});
+  schema.fields["pos"].special_params = SchemaField::VectorParams{true, 1};
+  FieldIndices indices{schema, kEmptyOptions, PMR_NS::get_default_resource()};
+
+  for (size_t i = 0; i < 1000; i++) {
+    MockedDocument doc{Map{{"pos", ToBytes({float(i)})}, {"group", i % 100 ? "common" : "rare"}}};
+    indices.Add(i, doc);
+  }
+
+  auto knn_descr = [](const SearchResult& res) {
+    for (const auto& event : res.profile->events) {
+      if (absl::StartsWith(event.descr, "KNN"))
+        return event.descr;
+    }
+    return string{};
+  };
+
+  SearchAlgorithm algo{};
+  QueryParams params;
+  params["vec"] = ToBytes({260.0});
+
+  // Selective filter is served by brute force
+  algo.Init("@group:{rare} =>[KNN 3 @pos $vec]", &params);
+  algo.EnableProfiling();
+  auto res = algo.Search(&indices);
+  EXPECT_THAT(res.ids, testing::ElementsAre(300, 200, 400));
+  EXPECT_EQ(knn_descr(res), "KNN{l=3,flat}");
+
+  // Wide filter traverses the graph
+  params["vec"] = ToBytes({555.2});
+  algo.Init("@group:{common} =>[KNN 3 @pos $vec EF_RUNTIME 1]", &params);
+  algo.EnableProfiling();
+  res = algo.Search(&indices);
+  EXPECT_THAT(res.ids, testing::ElementsAre(555, 556, 554));
+  EXPECT_EQ(knn_descr(res), "KNN{l=3,hnsw,ef=1}");
+}
+
+TEST_F(SearchTest, VectorDistance) {
+  // Odd dimension to cover the scalar tail of the vectorized kernels
+  const size_t kDims = 37;
+
+  default_random_engine rnd{42};
+  uniform_real_distribution<float> dist{-1, 1};
+  vector<float> u(kDims), v(kDims);
+  for (size_t i = 0; i < kDims; i++) {
+    u[i] = dist(rnd);
+    v[i] = dist(rnd);
+  }
+
+  double l2 = 0, uv = 0, uu = 0, vv = 0;
+  for (size_t i = 0; i < kDims; i++) {
+    l2 += (u[i] - v[i]) * (u[i] - v[i]);
+    uv += u[i] * v[i];
+    uu += u[i] * u[i];
+    vv += v[i] * v[i];
+  }
+  double cosine = 1 - uv / sqrt(uu * vv);
+
+  EXPECT_NEAR(VectorDistance(u.data(), v.data(), kDims, VectorSimilarity::L2), sqrt(l2), 1e-4);
+  EXPECT_NEAR(VectorDistance(u.data(), v.data(), kDims, VectorSimilarity::COSINE), cosine, 1e-4);
+
+  NormalizeVector(u.data(), kDims);
+  NormalizeVector(v.data(), kDims);
+  EXPECT_NEAR(NormalizedVectorDistance(u.data(), v.data(), kDims, VectorSimilarity::COSINE),
+              cosine, 1e-4);
+
+  vector<int8_t> q(kDims);
+  float scale = QuantizeVector(v.data(), kDims, q.data());
+  EXPECT_NEAR(QuantizedVectorDistance(u.data(), q.data(), scale, kDims, VectorSimilarity::COSINE),
+              cosine, 2e-2);
+  EXPECT_NEAR(QuantizedVectorDistance(u.data(), q.data(), scale, kDims, VectorSimilarity::L2),
+              VectorDistance(u.data(), v.data(), kDims, VectorSimilarity::L2), 2e-2);
+
+  // Zero vectors are at distance 0 from any vector for COSINE similarity.
+  vector<float> zero(kDims, 0);
+  EXPECT_EQ(VectorDistance(zero.data(), v.data(), kDims, VectorSimilarity::COSINE), 0);
+  NormalizeVector(zero.data(), kDims);
+  EXPECT_EQ(NormalizedVectorDistance(zero.data(), v.data(), kDims, VectorSimilarity::COSINE), 0);
+  EXPECT_EQ(NormalizedVectorDistance(u.data(), zero.data(), kDims, VectorSimilarity::COSINE), 0);
+  EXPECT_EQ(QuantizedVectorDistance(zero.data(), q.data(), scale, kDims, VectorSimilarity::COSINE),
+            0);
+  scale = QuantizeVector(zero.data(), kDims, q.data());
+  EXPECT_EQ(QuantizedVectorDistance(u.data(), q.data(), scale, kDims, VectorSimilarity::COSINE),
+            0);
+}
+
+TEST_F(SearchTest, KnnQuantized) {
+  auto schema = MakeSimpleSchema({{"pos", SchemaField::VECTOR}});
+  SchemaField::VectorParams vparams{false, 2, VectorSimilarity::L2};
+  vparams.quantization = VectorQuantization::INT8;
+  schema.fields["pos"].special_params = vparams;
+  FieldIndices indices{schema, kEmptyOptions, PMR_NS::get_default_resource()};
+
+  for (size_t i = 0; i < 10; i++) {
+    MockedDocument doc{Map{{"pos", ToBytes({float(i), float(i) / 2})}}};
+    indices.Add(i, doc);
+  }
+
+  SearchAlgorithm algo{};
+  QueryParams params;
+
+  params["vec"] = ToBytes({5.2, 2.6});
+  algo.Init("* => [KNN 3 @pos $vec]", &params);
+  EXPECT_THAT(algo.Search(&indices).ids, testing::ElementsAre(5, 6, 4));
+
+  params["vec"] = ToBytes({-1, 0});
+  algo.Init("* => [KNN 3 @pos $vec]", &params);
+  EXPECT_THAT(algo.Search(&indices).ids, testing::ElementsAre(0, 1, 2));
+}
+
 static void BM_VectorSearch(benchmark::State& state) {
   unsigned ndims = state.range(0);
   unsigned nvecs = state.range(1);
@@ -759,7 +1103,55 @@ static void BM_VectorSearch(benchmark::State& state) {
   }
 }
 
-BENCHMARK(BM_VectorSearch)->Args({120, 10'000});
+BENCHMARK(BM_VectorSearch)->Args({120, 10'000})->Args({768, 10'000});
+
+static void BM_SearchIntersection(benchmark::State& state) {
+  unsigned ndocs = state.range(0);
+  unsigned rare_step = state.range(1);
+
+  auto schema = MakeSimpleSchema({{"title", SchemaField::TEXT}});
+  FieldIndices indices{schema, kEmptyOptions, PMR_NS::get_default_resource()};
+
+  for (size_t i = 0; i < ndocs; i++) {
+    MockedDocument doc{Map{{"title", i % rare_step == 0 ? "common rare" : "common"}}};
+    indices.Add(i, doc);
+  }
+
+  SearchAlgorithm algo{};
+  QueryParams params;
+  algo.Init("common rare", &params);
+
+  while (state.KeepRunning())
+    benchmark::DoNotOptimize(algo.Search(&indices));
+}
+
+BENCHMARK(BM_SearchIntersection)->Args({100'000, 2})->Args({100'000, 1'000});
+
+static void BM_SearchNumericRange(benchmark::State& state) {
+  unsigned ndocs = state.range(0);
+  unsigned percent = state.range(1);
+
+  auto schema = MakeSimpleSchema({{"price", SchemaField::NUMERIC}});
+  FieldIndices indices{schema, kEmptyOptions, PMR_NS::get_default_resource()};
+
+  default_random_engine rnd{};
+  for (size_t i = 0; i < ndocs; i++) {
+    MockedDocument doc{Map{{"price", absl::StrCat(rnd() % 10'000)}}};
+    indices.Add(i, doc);
+  }
+
+  SearchAlgorithm algo{};
+  QueryParams params;
+  algo.Init(absl::StrCat("@price:[0 ", percent * 100, "]"), &params);
+
+  while (state.KeepRunning())
+    benchmark::DoNotOptimize(algo.Search(&indices));
+}
+
+BENCHMARK(BM_SearchNumericRange)
+    ->Args({1'000'000, 1})
+    ->Args({1'000'000, 80})
+    ->Args({10'000'000, 80});
 
 }  // namespace search
 
@@ -24,11 +24,7 @@ SimpleValueSortIndex<T>::SimpleValueSortIndex(PMR_NS::memory_resource* mr) : val
 
 template <typename T> SortableValue SimpleValueSortIndex<T>::Lookup(DocId doc) const {
   DCHECK_LT(doc, values_.size());
-  if constexpr (is_same_v<T, PMR_NS::string>) {
-    return std::string(values_[doc]);
-  } else {
-    return values_[doc];
-  }
+  return values_[doc];
 }
 
 template <typename T>
@@ -67,12 +63,7 @@ void SimpleValueSortIndex<T>::Remove(DocId id, const DocumentAccessor& doc,
   values_[id] = T{};
 }
 
-template <typename T> PMR_NS::memory_resource* SimpleValueSortIndex<T>::GetMemRes() const {
-  return values_.get_allocator().resource();
-}
-
 template struct SimpleValueSortIndex<double>;
-template struct SimpleValueSortIndex<PMR_NS::string>;
 
 std::optional<double> NumericSortIndex::Get(const DocumentAccessor& doc, std::string_view field) {
   auto numbers_list = doc.GetNumbers(field);
@@ -82,14 +73,112 @@ std::optional<double> NumericSortIndex::Get(const DocumentAccessor& doc, std::st
   return !numbers_list->empty() ? numbers_list->front() : 0.0;
 }
 
-std::optional<PMR_NS::string> StringSortIndex::Get(const DocumentAccessor& doc,
-                                                   std::string_view field) {
+StringSortIndex::StringSortIndex(PMR_NS::memory_resource* mr)
+    : codes_{mr}, values_{mr}, free_codes_{mr}, dict_{mr} {
+  values_.push_back(nullptr);  // reserved for the empty string
+}
+
+SortableValue StringSortIndex::Lookup(DocId doc) const {
+  DCHECK_LT(doc, codes_.size());
+  return std::string{Decode(codes_[doc])};
+}
+
+std::vector<ResultScore> StringSortIndex::Sort(std::vector<DocId>* ids, size_t limit,
+                                               bool desc) const {
+  auto sort_by = [ids, limit, desc](auto key) {
+    auto cb = [&key, desc](DocId lhs, DocId rhs) {
+      return desc ? (key(lhs) > key(rhs)) : (key(lhs) < key(rhs));
+    };
+    std::partial_sort(ids->begin(), ids->begin() + std::min(ids->size(), limit), ids->end(), cb);
+  };
+
+  if (ids->size() > dict_.size()) {
+    // Rank all values once, so documents are compared by integers
+    vector<Code> by_value;
+    by_value.reserve(dict_.size() + 1);
+    for (Code code = 0; code < values_.size(); code++) {
+      if (code == 0 || values_[code] != nullptr)
+        by_value.push_back(code);
+    }
+    std::sort(by_value.begin(), by_value.end(),
+              [this](Code l, Code r) { return Decode(l) < Decode(r); });
+
+    vector<uint32_t> ranks(values_.size());
+    for (size_t i = 0; i < by_value.size(); i++)
+      ranks[by_value[i]] = i;
+
+    sort_by([this, &ranks](DocId id) { return ranks[codes_[id]]; });
+  } else {
+    sort_by([this](DocId id) { return Decode(codes_[id]); });
+  }
+
+  vector<ResultScore> out(min(ids->size(), limit));
+  for (size_t i = 0; i < out.size(); i++)
+    out[i] = std::string{Decode(codes_[(*ids)[i]])};
+  return out;
+}
+
+bool StringSortIndex::Add(DocId id, const DocumentAccessor& doc, std::string_view field) {
   auto strings_list = doc.GetStrings(field);
   if (!strings_list) {
-    return std::nullopt;
+    return false;
   }
-  return !strings_list->empty() ? PMR_NS::string{strings_list->front(), GetMemRes()}
-                                : PMR_NS::string{GetMemRes()};
+
+  DCHECK_LE(id, codes_.size());  // Doc ids grow at most by one
+  if (id >= codes_.size())
+    codes_.resize(id + 1);
+
+  Release(codes_[id]);
+  codes_[id] = Encode(!strings_list->empty() ? strings_list->front() : string_view{});
+  return true;
+}
+
+void StringSortIndex::Remove(DocId id, const DocumentAccessor& doc, std::string_view field) {
+  DCHECK_LT(id, codes_.size());
+  Release(codes_[id]);
+  codes_[id] = 0;
+}
+
+StringSortIndex::Code StringSortIndex::Encode(string_view value) {
+  if (value.empty())
+    return 0;
+
+  auto it = dict_.find(value);
+  if (it == dict_.end()) {
+    Code code;
+    if (!free_codes_.empty()) {
+      code = free_codes_.back();
+      free_codes_.pop_back();
+    } else {
+      code = values_.size();
+      values_.push_back(nullptr);
+    }
+
+    auto* mr = dict_.get_allocator().resource();
+    it = dict_.emplace(PMR_NS::string{value, mr}, DictEntry{code, 0}).first;
+    values_[code] = &it->first;
+  }
+
+  it->second.refs++;
+  return it->second.code;
+}
+
+void StringSortIndex::Release(Code code) {
+  if (code == 0)
+    return;
+
+  auto it = dict_.find(*values_[code]);
+  DCHECK(it != dict_.end());
+  if (--it->second.refs > 0)
+    return;
+
+  values_[code] = nullptr;
+  free_codes_.push_back(code);
+  dict_.erase(it);
+}
+
+std::string_view StringSortIndex::Decode(Code code) const {
+  return code == 0 ? std::string_view{} : std::string_view{*values_[code]};
 }
 
 }  // namespace dfly::search
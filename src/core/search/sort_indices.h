@@ -2,9 +2,12 @@
 // See LICENSE for licensing terms.
 //
 
+#pragma once
+
 #include <absl/container/btree_set.h>
 #include <absl/container/flat_hash_map.h>
 #include <absl/container/flat_hash_set.h>
+#include <absl/container/node_hash_map.h>
 
 #include <map>
 #include <memory>
@@ -30,8 +33,6 @@ template <typename T> struct SimpleValueSortIndex : BaseSortIndex {
  protected:
   virtual std::optional<T> Get(const DocumentAccessor& doc, std::string_view field_value) = 0;
 
-  PMR_NS::memory_resource* GetMemRes() const;
-
  private:
   PMR_NS::vector<T> values_;
 };
@@ -42,11 +43,42 @@ struct NumericSortIndex : public SimpleValueSortIndex<double> {
   std::optional<double> Get(const DocumentAccessor& doc, std::string_view field) override;
 };
 
-// TODO: Map tags to integers for fast sort
-struct StringSortIndex : public SimpleValueSortIndex<PMR_NS::string> {
-  StringSortIndex(PMR_NS::memory_resource* mr) : SimpleValueSortIndex{mr} {};
+// Sort index for strings. Values are dictionary encoded: documents store codes of distinct values,
+// which saves memory for low cardinality fields like tags and allows sorting large result sets by
+// comparing integer ranks of the codes instead of strings.
+struct StringSortIndex : public BaseSortIndex {
+  StringSortIndex(PMR_NS::memory_resource* mr);
+
+  SortableValue Lookup(DocId doc) const override;
+  std::vector<ResultScore> Sort(std::vector<DocId>* ids, size_t limit, bool desc) const override;
+
+  bool Add(DocId id, const DocumentAccessor& doc, std::string_view field) override;
+  void Remove(DocId id, const DocumentAccessor& doc, std::string_view field) override;
+
+  // Number of distinct non empty values
+  size_t DictionarySize() const {
+    return dict_.size();
+  }
+
+ private:
+  using Code = uint32_t;  // Code 0 is reserved for the empty string
+
+  struct DictEntry {
+    Code code;
+    uint32_t refs;  // number of documents with this value
+  };
+
+  Code Encode(std::string_view value);  // Get code of value and add a reference to it
+  void Release(Code code);              // Remove reference, free code if it was the last one
+
+  std::string_view Decode(Code code) const;
 
-  std::optional<PMR_NS::string> Get(const DocumentAccessor& doc, std::string_view field) override;
+  PMR_NS::vector<Code> codes_;                    // code of every document
+  PMR_NS::vector<const PMR_NS::string*> values_;  // value of every code, points into dict_
+  PMR_NS::vector<Code> free_codes_;
+  absl::node_hash_map<PMR_NS::string, DictEntry, StringViewHash, StringViewEq,
+                      PMR_NS::polymorphic_allocator<std::pair<const PMR_NS::string, DictEntry>>>
+      dict_;
 };
 
 }  // namespace dfly::search
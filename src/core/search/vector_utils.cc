@@ -4,7 +4,15 @@
 
 #include "core/search/vector_utils.h"
 
+#if defined(__x86_64__)
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+#include <algorithm>
 #include <cmath>
+#include <cstring>
 #include <memory>
 
 #include "base/logging.h"
@@ -15,28 +23,232 @@ using namespace std;
 
 namespace {
 
-// Euclidean vector distance: sqrt( sum: (u[i] - v[i])^2  )
-__attribute__((optimize("fast-math"))) float L2Distance(const float* u, const float* v,
-                                                        size_t dims) {
+// Scalar kernels, used when no vector extension is available. Fast-math lets the compiler
+// vectorize them for the baseline target.
+
+__attribute__((optimize("fast-math"))) float L2SqrScalar(const float* u, const float* v,
+                                                         size_t dims) {
   float sum = 0;
   for (size_t i = 0; i < dims; i++)
     sum += (u[i] - v[i]) * (u[i] - v[i]);
-  return sqrt(sum);
+  return sum;
+}
+
+__attribute__((optimize("fast-math"))) float DotScalar(const float* u, const float* v,
+                                                       size_t dims) {
+  float sum = 0;
+  for (size_t i = 0; i < dims; i++)
+    sum += u[i] * v[i];
+  return sum;
 }
 
-// TODO: Normalize vectors ahead if cosine distance is used
-__attribute__((optimize("fast-math"))) float CosineDistance(const float* u, const float* v,
-                                                            size_t dims) {
-  float sum_uv = 0, sum_uu = 0, sum_vv = 0;
+__attribute__((optimize("fast-math"))) float L2SqrI8Scalar(const float* u, const int8_t* q,
+                                                           float scale, size_t dims) {
+  float sum = 0;
   for (size_t i = 0; i < dims; i++) {
-    sum_uv += u[i] * v[i];
-    sum_uu += u[i] * u[i];
-    sum_vv += v[i] * v[i];
+    float d = u[i] - q[i] * scale;
+    sum += d * d;
   }
+  return sum;
+}
 
-  if (float denom = sum_uu * sum_vv; denom != 0.0f)
-    return 1 - sum_uv / sqrt(denom);
-  return 0.0f;
+__attribute__((optimize("fast-math"))) float DotI8Scalar(const float* u, const int8_t* q,
+                                                         size_t dims) {
+  float sum = 0;
+  for (size_t i = 0; i < dims; i++)
+    sum += u[i] * q[i];
+  return sum;
+}
+
+#if defined(__x86_64__)
+
+__attribute__((target("avx2,fma"))) inline float HorizontalSum(__m256 acc) {
+  __m128 sum = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+  sum = _mm_hadd_ps(sum, sum);
+  sum = _mm_hadd_ps(sum, sum);
+  return _mm_cvtss_f32(sum);
+}
+
+__attribute__((target("avx2,fma"))) inline __m256 LoadI8x8(const int8_t* q) {
+  __m128i bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(q));
+  return _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(bytes));
+}
+
+__attribute__((target("avx2,fma"))) float L2SqrAvx2(const float* u, const float* v, size_t dims) {
+  __m256 acc = _mm256_setzero_ps();
+  size_t i = 0;
+  for (; i + 8 <= dims; i += 8) {
+    __m256 d = _mm256_sub_ps(_mm256_loadu_ps(u + i), _mm256_loadu_ps(v + i));
+    acc = _mm256_fmadd_ps(d, d, acc);
+  }
+  return HorizontalSum(acc) + L2SqrScalar(u + i, v + i, dims - i);
+}
+
+__attribute__((target("avx2,fma"))) float DotAvx2(const float* u, const float* v, size_t dims) {
+  __m256 acc = _mm256_setzero_ps();
+  size_t i = 0;
+  for (; i + 8 <= dims; i += 8)
+    acc = _mm256_fmadd_ps(_mm256_loadu_ps(u + i), _mm256_loadu_ps(v + i), acc);
+  return HorizontalSum(acc) + DotScalar(u + i, v + i, dims - i);
+}
+
+__attribute__((target("avx2,fma"))) float L2SqrI8Avx2(const float* u, const int8_t* q,
+                                                      float scale, size_t dims) {
+  __m256 acc = _mm256_setzero_ps();
+  __m256 vscale = _mm256_set1_ps(scale);
+  size_t i = 0;
+  for (; i + 8 <= dims; i += 8) {
+    __m256 d = _mm256_fnmadd_ps(LoadI8x8(q + i), vscale, _mm256_loadu_ps(u + i));
+    acc = _mm256_fmadd_ps(d, d, acc);
+  }
+  return HorizontalSum(acc) + L2SqrI8Scalar(u + i, q + i, scale, dims - i);
+}
+
+__attribute__((target("avx2,fma"))) float DotI8Avx2(const float* u, const int8_t* q,
+                                                    size_t dims) {
+  __m256 acc = _mm256_setzero_ps();
+  size_t i = 0;
+  for (; i + 8 <= dims; i += 8)
+    acc = _mm256_fmadd_ps(_mm256_loadu_ps(u + i), LoadI8x8(q + i), acc);
+  return HorizontalSum(acc) + DotI8Scalar(u + i, q + i, dims - i);
+}
+
+// gcc 12 reports false positives for the intentionally undefined vectors inside avx512 intrinsics.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+
+__attribute__((target("avx512f"))) inline __m512 LoadI8x16(const int8_t* q) {
+  __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(q));
+  return _mm512_cvtepi32_ps(_mm512_cvtepi8_epi32(bytes));
+}
+
+__attribute__((target("avx512f"))) float L2SqrAvx512(const float* u, const float* v,
+                                                     size_t dims) {
+  __m512 acc = _mm512_setzero_ps();
+  size_t i = 0;
+  for (; i + 16 <= dims; i += 16) {
+    __m512 d = _mm512_sub_ps(_mm512_loadu_ps(u + i), _mm512_loadu_ps(v + i));
+    acc = _mm512_fmadd_ps(d, d, acc);
+  }
+  return _mm512_reduce_add_ps(acc) + L2SqrScalar(u + i, v + i, dims - i);
+}
+
+__attribute__((target("avx512f"))) float DotAvx512(const float* u, const float* v, size_t dims) {
+  __m512 acc = _mm512_setzero_ps();
+  size_t i = 0;
+  for (; i + 16 <= dims; i += 16)
+    acc = _mm512_fmadd_ps(_mm512_loadu_ps(u + i), _mm512_loadu_ps(v + i), acc);
+  return _mm512_reduce_add_ps(acc) + DotScalar(u + i, v + i, dims - i);
+}
+
+__attribute__((target("avx512f"))) float L2SqrI8Avx512(const float* u, const int8_t* q,
+                                                       float scale, size_t dims) {
+  __m512 acc = _mm512_setzero_ps();
+  __m512 vscale = _mm512_set1_ps(scale);
+  size_t i = 0;
+  for (; i + 16 <= dims; i += 16) {
+    __m512 d = _mm512_fnmadd_ps(LoadI8x16(q + i), vscale, _mm512_loadu_ps(u + i));
+    acc = _mm512_fmadd_ps(d, d, acc);
+  }
+  return _mm512_reduce_add_ps(acc) + L2SqrI8Scalar(u + i, q + i, scale, dims - i);
+}
+
+__attribute__((target("avx512f"))) float DotI8Avx512(const float* u, const int8_t* q,
+                                                     size_t dims) {
+  __m512 acc = _mm512_setzero_ps();
+  size_t i = 0;
+  for (; i + 16 <= dims; i += 16)
+    acc = _mm512_fmadd_ps(_mm512_loadu_ps(u + i), LoadI8x16(q + i), acc);
+  return _mm512_reduce_add_ps(acc) + DotI8Scalar(u + i, q + i, dims - i);
+}
+
+#pragma GCC diagnostic pop
+
+#elif defined(__aarch64__)
+
+inline float32x4_t LoadI8x4(const int8_t* q) {
+  int32_t word;
+  memcpy(&word, q, sizeof(word));
+  int16x8_t wide = vmovl_s8(vreinterpret_s8_s32(vdup_n_s32(word)));
+  return vcvtq_f32_s32(vmovl_s16(vget_low_s16(wide)));
+}
+
+float L2SqrNeon(const float* u, const float* v, size_t dims) {
+  float32x4_t acc = vdupq_n_f32(0);
+  size_t i = 0;
+  for (; i + 4 <= dims; i += 4) {
+    float32x4_t d = vsubq_f32(vld1q_f32(u + i), vld1q_f32(v + i));
+    acc = vfmaq_f32(acc, d, d);
+  }
+  return vaddvq_f32(acc) + L2SqrScalar(u + i, v + i, dims - i);
+}
+
+float DotNeon(const float* u, const float* v, size_t dims) {
+  float32x4_t acc = vdupq_n_f32(0);
+  size_t i = 0;
+  for (; i + 4 <= dims; i += 4)
+    acc = vfmaq_f32(acc, vld1q_f32(u + i), vld1q_f32(v + i));
+  return vaddvq_f32(acc) + DotScalar(u + i, v + i, dims - i);
+}
+
+float L2SqrI8Neon(const float* u, const int8_t* q, float scale, size_t dims) {
+  float32x4_t acc = vdupq_n_f32(0);
+  float32x4_t vscale = vdupq_n_f32(scale);
+  size_t i = 0;
+  for (; i + 4 <= dims; i += 4) {
+    float32x4_t d = vfmsq_f32(vld1q_f32(u + i), LoadI8x4(q + i), vscale);
+    acc = vfmaq_f32(acc, d, d);
+  }
+  return vaddvq_f32(acc) + L2SqrI8Scalar(u + i, q + i, scale, dims - i);
+}
+
+float DotI8Neon(const float* u, const int8_t* q, size_t dims) {
+  float32x4_t acc = vdupq_n_f32(0);
+  size_t i = 0;
+  for (; i + 4 <= dims; i += 4)
+    acc = vfmaq_f32(acc, vld1q_f32(u + i), LoadI8x4(q + i));
+  return vaddvq_f32(acc) + DotI8Scalar(u + i, q + i, dims - i);
+}
+
+#endif
+
+// Kernels for the current cpu, selected once on first use.
+struct Kernels {
+  float (*l2sqr)(const float*, const float*, size_t) = L2SqrScalar;
+  float (*dot)(const float*, const float*, size_t) = DotScalar;
+  float (*l2sqr_i8)(const float*, const int8_t*, float, size_t) = L2SqrI8Scalar;
+  float (*dot_i8)(const float*, const int8_t*, size_t) = DotI8Scalar;
+
+  Kernels() {
+#if defined(__x86_64__)
+    if (__builtin_cpu_supports("avx512f")) {
+      l2sqr = L2SqrAvx512;
+      dot = DotAvx512;
+      l2sqr_i8 = L2SqrI8Avx512;
+      dot_i8 = DotI8Avx512;
+    } else if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+      l2sqr = L2SqrAvx2;
+      dot = DotAvx2;
+      l2sqr_i8 = L2SqrI8Avx2;
+      dot_i8 = DotI8Avx2;
+    }
+#elif defined(__aarch64__)
+    l2sqr = L2SqrNeon;
+    dot = DotNeon;
+    l2sqr_i8 = L2SqrI8Neon;
+    dot_i8 = DotI8Neon;
+#endif
+  }
+};
+
+const Kernels& GetKernels() {
+  static const Kernels kernels;
+  return kernels;
+}
+
+bool IsZeroVector(const float* vec, size_t dims) {
+  return all_of(vec, vec + dims, [](float x) { return x == 0.0f; });
 }
 
 OwnedFtVector ConvertToFtVector(string_view value) {
@@ -63,12 +275,70 @@ std::optional<OwnedFtVector> BytesToFtVectorSafe(string_view value) {
   return ConvertToFtVector(value);
 }
 
+void NormalizeVector(float* vec, size_t dims) {
+  float norm = sqrt(GetKernels().dot(vec, vec, dims));
+  if (norm == 0.0f)
+    return;
+
+  for (size_t i = 0; i < dims; i++)
+    vec[i] /= norm;
+}
+
 float VectorDistance(const float* u, const float* v, size_t dims, VectorSimilarity sim) {
+  const Kernels& kernels = GetKernels();
+  switch (sim) {
+    case VectorSimilarity::L2:
+      return sqrt(kernels.l2sqr(u, v, dims));
+    case VectorSimilarity::COSINE: {
+      float sum_uv = kernels.dot(u, v, dims);
+      float denom = kernels.dot(u, u, dims) * kernels.dot(v, v, dims);
+      return denom != 0.0f ? 1 - sum_uv / sqrt(denom) : 0.0f;
+    }
+  };
+  return 0.0f;
+}
+
+float NormalizedVectorDistance(const float* u, const float* v, size_t dims,
+                               VectorSimilarity sim) {
+  if (sim == VectorSimilarity::COSINE) {
+    // Zero vectors stay zero after normalization. Like VectorDistance, treat them as distance 0.
+    float dot = GetKernels().dot(u, v, dims);
+    if (dot == 0.0f && (IsZeroVector(u, dims) || IsZeroVector(v, dims)))
+      return 0.0f;
+    return 1 - dot;
+  }
+  return VectorDistance(u, v, dims, sim);
+}
+
+float QuantizeVector(const float* vec, size_t dims, int8_t* out) {
+  float max_abs = 0;
+  for (size_t i = 0; i < dims; i++)
+    max_abs = max(max_abs, fabs(vec[i]));
+
+  if (max_abs == 0.0f) {
+    memset(out, 0, dims);
+    return 0.0f;
+  }
+
+  float scale = max_abs / 127;
+  for (size_t i = 0; i < dims; i++)
+    out[i] = static_cast<int8_t>(lrintf(vec[i] / scale));
+  return scale;
+}
+
+float QuantizedVectorDistance(const float* u, const int8_t* q, float scale, size_t dims,
+                              VectorSimilarity sim) {
+  const Kernels& kernels = GetKernels();
   switch (sim) {
     case VectorSimilarity::L2:
-      return L2Distance(u, v, dims);
-    case VectorSimilarity::COSINE:
-      return CosineDistance(u, v, dims);
+      return sqrt(kernels.l2sqr_i8(u, q, scale, dims));
+    case VectorSimilarity::COSINE: {
+      // Zero vectors are quantized with scale 0, see NormalizedVectorDistance.
+      float dot = kernels.dot_i8(u, q, dims) * scale;
+      if (dot == 0.0f && (scale == 0.0f || IsZeroVector(u, dims)))
+        return 0.0f;
+      return 1 - dot;
+    }
   };
   return 0.0f;
 }
@@ -14,6 +14,22 @@ OwnedFtVector BytesToFtVector(std::string_view value);
 // TODO: Remove unsafe version
 std::optional<OwnedFtVector> BytesToFtVectorSafe(std::string_view value);
 
+// Scales vec to unit length. Zero vectors are left as is.
+void NormalizeVector(float* vec, size_t dims);
+
 float VectorDistance(const float* u, const float* v, size_t dims, VectorSimilarity sim);
 
+// Same as VectorDistance, but expects both vectors to be normalized for COSINE similarity,
+// which reduces it to a single dot product. The distance from a zero vector is 0 in both.
+float NormalizedVectorDistance(const float* u, const float* v, size_t dims, VectorSimilarity sim);
+
+// Symmetric int8 scalar quantization: writes dims values to out, so that vec[i] ~ out[i] * scale.
+// Returns the scale.
+float QuantizeVector(const float* vec, size_t dims, int8_t* out);
+
+// Distance between a float vector u and a vector quantized with QuantizeVector. Like
+// NormalizedVectorDistance, expects both to be normalized for COSINE similarity.
+float QuantizedVectorDistance(const float* u, const int8_t* q, float scale, size_t dims,
+                              VectorSimilarity sim);
+
 }  // namespace dfly::search
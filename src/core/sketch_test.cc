@@ -0,0 +1,305 @@
+// Copyright 2024, DragonflyDB authors.  All rights reserved.
+// See LICENSE for licensing terms.
+//
+
+#include <absl/container/flat_hash_map.h>
+#include <absl/strings/str_cat.h>
+#include <gmock/gmock.h>
+
+#include <limits>
+#include <random>
+
+#include "base/gtest.h"
+#include "core/count_min_sketch.h"
+#include "core/t_digest.h"
+#include "core/top_k.h"
+
+namespace dfly {
+
+using namespace std;
+
+class SketchTest : public ::testing::Test {
+ protected:
+  SketchTest() {
+    mt19937 gen(1);
+    geometric_distribution<unsigned> dist(0.01);
+    for (unsigned i = 0; i < 100000; ++i) {
+      unsigned id = min(dist(gen), 9999u);
+      stream_.push_back(absl::StrCat("item", id));
+      ++truth_[stream_.back()];
+    }
+  }
+
+  PMR_NS::memory_resource* mr_ = PMR_NS::get_default_resource();
+  vector<string> stream_;
+  absl::flat_hash_map<string, uint32_t> truth_;
+};
+
+TEST_F(SketchTest, CMS) {
+  auto [width, depth] = CMS::DimsFromError(0.001, 0.01);
+  EXPECT_EQ(2719, width);
+  EXPECT_EQ(5, depth);
+
+  CMS cms(width, depth, mr_);
+  EXPECT_EQ(0, cms.Query("foo"));
+  EXPECT_EQ(3, cms.IncrBy("foo", 3));
+  EXPECT_EQ(3, cms.Query("foo"));
+  EXPECT_EQ(UINT32_MAX, cms.IncrBy("foo", UINT32_MAX));
+
+  CMS batched(width, depth, mr_);
+  vector<string_view> items(stream_.begin(), stream_.end());
+  vector<uint32_t> incrs(items.size(), 1), res(items.size());
+  batched.IncrBy(items, incrs, res.data());
+  EXPECT_EQ(stream_.size(), batched.count());
+
+  // The batched update must yield the same results as the sequential one.
+  CMS sequential(width, depth, mr_);
+  for (size_t i = 0; i < items.size(); ++i) {
+    ASSERT_EQ(res[i], sequential.IncrBy(items[i], 1)) << i;
+  }
+  EXPECT_EQ(sequential.data(), batched.data());
+
+  for (const auto& [item, count] : truth_) {
+    uint32_t estimation = batched.Query(item);
+    EXPECT_GE(estimation, count);
+    EXPECT_LE(estimation, count + 0.001 * stream_.size()) << item;
+  }
+}
+
+TEST_F(SketchTest, CMSMerge) {
+  CMS a(100, 4, mr_), b(100, 4, mr_), merged(100, 4, mr_);
+  a.IncrBy("x", 10);
+  a.IncrBy("y", 1);
+  b.IncrBy("x", 3);
+
+  CMS::MergeSource srcs[] = {{a.data(), a.count(), 2}, {b.data(), b.count(), -1}};
+  merged.Merge(srcs);
+  EXPECT_EQ(17, merged.Query("x"));
+  EXPECT_EQ(2, merged.Query("y"));
+  EXPECT_EQ(19, merged.count());
+
+  // Negative sums are clamped.
+  CMS::MergeSource negative[] = {{b.data(), b.count(), -1}};
+  merged.Merge(negative);
+  EXPECT_EQ(0, merged.Query("x"));
+  EXPECT_EQ(0, merged.count());
+
+  CMS loaded(100, 4, mr_);
+  loaded.Load(a.data(), a.count());
+  EXPECT_EQ(10, loaded.Query("x"));
+  EXPECT_EQ(11, loaded.count());
+}
+
+TEST_F(SketchTest, TopK) {
+  TopK topk(10, 1000, 5, 0.9, mr_);
+  for (const string& item : stream_) {
+    topk.IncrBy(item, 1);
+  }
+
+  auto list = topk.List();
+  ASSERT_EQ(10, list.size());
+  for (size_t i = 0; i < list.size(); ++i) {
+    // HeavyKeeper does not overestimate and the heavy hitters are hardly ever decayed.
+    uint32_t count = truth_[list[i].first];
+    EXPECT_LE(list[i].second, count);
+    EXPECT_GE(list[i].second, count * 0.95);
+    EXPECT_TRUE(topk.Query(list[i].first));
+    if (i > 0) {
+      EXPECT_GE(list[i - 1].second, list[i].second);
+    }
+  }
+  EXPECT_TRUE(topk.Query("item0"));
+  EXPECT_FALSE(topk.Query("item5000"));
+  EXPECT_EQ(topk.List()[0].second, topk.Count(topk.List()[0].first));
+}
+
+TEST_F(SketchTest, TopKExpel) {
+  TopK topk(2, 8, 7, 0.9, mr_);
+  EXPECT_EQ(nullopt, topk.IncrBy("a", 5));
+  EXPECT_EQ(nullopt, topk.IncrBy("b", 10));
+  EXPECT_EQ("a", topk.IncrBy("c", 1000000000));
+  EXPECT_EQ(nullopt, topk.IncrBy("d", 1));
+
+  auto list = topk.List();
+  ASSERT_EQ(2, list.size());
+  EXPECT_EQ("c", list[0].first);
+  EXPECT_EQ("b", list[1].first);
+
+  // A loaded copy must behave exactly as the original one.
+  TopK loaded(2, 8, 7, 0.9, mr_);
+  loaded.Load(topk.buckets(), topk.rng_state());
+  for (const auto& entry : topk.heap()) {
+    loaded.LoadHeapEntry(entry.item, entry.count);
+  }
+  for (unsigned i = 0; i < 1000; ++i) {
+    string item = absl::StrCat("item", i % 7);
+    ASSERT_EQ(topk.IncrBy(item, i + 1), loaded.IncrBy(item, i + 1));
+  }
+  EXPECT_EQ(topk.buckets(), loaded.buckets());
+}
+
+TEST_F(SketchTest, TDigest) {
+  TDigest td(100, mr_);
+  double qs[] = {0, 0.5, 1};
+  double res[3];
+  td.Quantile(qs, res);
+  EXPECT_TRUE(isnan(res[1]));
+
+  // Small digests keep every value in its own centroid. The points are interpolated through
+  // the middle of every centroid, hence CDF of the maximum is below 1.
+  vector<double> values = {5, 1, 4, 2, 3, 6, 8, 7, 10, 9};
+  td.Add(values);
+  td.Quantile(qs, res);
+  EXPECT_THAT(res, testing::ElementsAre(1, 5.5, 10));
+  double points[] = {0, 1, 5.5, 10, 11};
+  double cdf[5];
+  td.CDF(points, cdf);
+  EXPECT_THAT(cdf, testing::ElementsAre(0, 0.05, 0.5, 0.95, 1));
+
+  mt19937 gen(1);
+  exponential_distribution<double> dist(1);
+  vector<double> sample(1000000);
+  for (double& val : sample)
+    val = dist(gen);
+
+  TDigest large(100, mr_);
+  for (size_t i = 0; i < sample.size(); i += 100) {
+    large.Add(absl::MakeConstSpan(sample).subspan(i, 100));
+  }
+  EXPECT_EQ(sample.size(), large.count());
+  EXPECT_LE(large.num_merged() + large.num_unmerged(), large.capacity());
+  EXPECT_LT(large.num_merged(), 2 * large.compression());
+
+  sort(sample.begin(), sample.end());
+  double percentiles[] = {0.001, 0.01, 0.5, 0.9, 0.99, 0.999, 0.9999};
+  double estimations[7], ranks[7];
+  large.Quantile(percentiles, estimations);
+  large.CDF(estimations, ranks);
+  for (size_t i = 0; i < 7; ++i) {
+    // The error in rank is proportional to the distance from the closer tail.
+    double q = percentiles[i];
+    auto it = lower_bound(sample.begin(), sample.end(), estimations[i]);
+    double exact_q = double(it - sample.begin()) / sample.size();
+    EXPECT_NEAR(exact_q, q, 0.1 * min(q, 1 - q)) << q;
+    EXPECT_NEAR(ranks[i], q, 1e-9);
+  }
+
+  // Compressing does not change the number of observations.
+  large.Compress();
+  EXPECT_EQ(0, large.num_unmerged());
+  EXPECT_EQ(sample.size(), large.count());
+}
+
+TEST_F(SketchTest, TDigestMerge) {
+  TDigest a(100, mr_), b(50, mr_), merged(100, mr_);
+  for (unsigned i = 0; i < 10000; ++i) {
+    double val = i;
+    (i % 2 ? a : b).Add({&val, 1});
+  }
+  b.Compress();
+
+  merged.Merge(a.centroids(), a.min(), a.max());
+  merged.Merge(b.centroids(), b.min(), b.max());
+  EXPECT_EQ(10000, merged.count());
+  EXPECT_EQ(0, merged.min());
+  EXPECT_EQ(9999, merged.max());
+
+  double qs[] = {0.01, 0.5, 0.99};
+  double res[3];
+  merged.Quantile(qs, res);
+  EXPECT_NEAR(res[0], 100, 5);
+  EXPECT_NEAR(res[1], 5000, 100);
+  EXPECT_NEAR(res[2], 9900, 5);
+
+  // Unmerged centroids are loaded as is, hence the copy answers identically.
+  TDigest loaded(100, mr_);
+  ASSERT_TRUE(loaded.Load(merged.data(), merged.num_merged(), merged.min(), merged.max()));
+  EXPECT_EQ(merged.num_unmerged(), loaded.num_unmerged());
+  double loaded_res[3];
+  loaded.Quantile(qs, loaded_res);
+  EXPECT_THAT(loaded_res, testing::ElementsAreArray(res));
+
+  TDigest small(1, mr_);
+  EXPECT_FALSE(small.Load(merged.data(), merged.num_merged(), merged.min(), merged.max()));
+
+  // Corrupted centroids are rejected.
+  vector<TDigest::Centroid> cs(merged.centroids().begin(), merged.centroids().end());
+  auto load_into = [&](TDigest& td, size_t len, size_t num_merged) {
+    string_view data{reinterpret_cast<const char*>(cs.data()), len * sizeof(cs[0])};
+    return td.Load(data, num_merged, 1, 1);
+  };
+  auto load = [&] {
+    string_view data{reinterpret_cast<const char*>(cs.data()), cs.size() * sizeof(cs[0])};
+    return loaded.Load(data, merged.num_merged(), merged.min(), merged.max());
+  };
+  ASSERT_GT(merged.num_merged(), 1u);
+  swap(cs[0], cs[1]);
+  EXPECT_FALSE(load());
+  swap(cs[0], cs[1]);
+  cs.back().weight = 0;
+  EXPECT_FALSE(load());
+  cs.back().weight = numeric_limits<double>::quiet_NaN();
+  EXPECT_FALSE(load());
+  cs.back().weight = 1;
+  cs.back().mean = numeric_limits<double>::infinity();
+  EXPECT_FALSE(load());
+  cs.back().mean = merged.max();
+  EXPECT_TRUE(load());
+  EXPECT_FALSE(loaded.Load(merged.data(), merged.num_merged(), merged.max(), merged.min()));
+  EXPECT_FALSE(loaded.Load(merged.data(), merged.num_merged(), merged.min(),
+                           numeric_limits<double>::infinity()));
+
+  // A full digest is rejected, as Add could not make space for a new value.
+  TDigest tiny(1, mr_);
+  cs.assign(tiny.capacity(), {1, 1});
+  EXPECT_FALSE(load_into(tiny, cs.size(), 0));
+  EXPECT_FALSE(load_into(tiny, cs.size(), cs.size()));
+  cs.pop_back();
+  EXPECT_FALSE(load_into(tiny, cs.size(), cs.size()));
+  ASSERT_TRUE(load_into(tiny, cs.size(), 0));
+  double val = 2;
+  tiny.Add({&val, 1});
+  EXPECT_EQ(cs.size() + 1, tiny.count());
+  EXPECT_LT(tiny.num_merged() + tiny.num_unmerged(), tiny.capacity());
+}
+
+static void BM_CMSIncrBy(benchmark::State& state) {
+  CMS cms(1 << 20, 5, PMR_NS::get_default_resource());
+  vector<string> keys(1 << 16);
+  for (size_t i = 0; i < keys.size(); ++i) {
+    keys[i] = absl::StrCat("key", i);
+  }
+
+  size_t batch = state.range(0);
+  vector<string_view> items(batch);
+  vector<uint32_t> incrs(batch, 1), res(batch);
+  size_t i = 0;
+  while (state.KeepRunning()) {
+    for (auto& item : items) {
+      item = keys[i++ % keys.size()];
+    }
+    cms.IncrBy(items, incrs, res.data());
+  }
+  state.SetItemsProcessed(state.iterations() * batch);
+}
+BENCHMARK(BM_CMSIncrBy)->Arg(1)->Arg(16)->Arg(256);
+
+static void BM_TDigestAdd(benchmark::State& state) {
+  TDigest td(100, PMR_NS::get_default_resource());
+  mt19937 gen(1);
+  lognormal_distribution<double> dist(0, 1);
+  vector<double> values(1 << 16);
+  for (double& val : values)
+    val = dist(gen);
+
+  size_t batch = state.range(0);
+  size_t i = 0;
+  while (state.KeepRunning()) {
+    td.Add(absl::MakeConstSpan(values).subspan(i, batch));
+    i = (i + batch) % values.size();
+  }
+  state.SetItemsProcessed(state.iterations() * batch);
+}
+BENCHMARK(BM_TDigestAdd)->Arg(1)->Arg(64);
+
+}  // namespace dfly
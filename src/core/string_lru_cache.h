@@ -0,0 +1,71 @@
+// Copyright 2024, DragonflyDB authors.  All rights reserved.
+// See LICENSE for licensing terms.
+//
+
+#pragma once
+
+#include <absl/container/flat_hash_map.h>
+#include <absl/flags/flag.h>
+
+#include <list>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace dfly {
+
+// LRU cache of values keyed by strings, e.g. of parsed command arguments. Not thread safe, meant
+// to be used as a thread local. Its capacity is read from a flag, so that it can be changed at
+// runtime, and 0 disables the cache.
+template <typename V> class StringLruCache {
+ public:
+  explicit StringLruCache(const absl::Flag<uint32_t>* capacity_flag)
+      : capacity_flag_(capacity_flag) {
+  }
+
+  size_t capacity() const {
+    return absl::GetFlag(*capacity_flag_);
+  }
+
+  size_t size() const {
+    return lru_.size();
+  }
+
+  // Returns a default constructed value if the key is not cached. Counts the lookup either in
+  // `hits` or in `misses`.
+  V Get(std::string_view key, uint64_t* hits, uint64_t* misses) {
+    auto it = index_.find(key);
+    if (it == index_.end()) {
+      ++*misses;
+      return V{};
+    }
+
+    ++*hits;
+    lru_.splice(lru_.begin(), lru_, it->second);
+    return it->second->second;
+  }
+
+  // Inserts a key that is not cached, evicting the least recently used entries if the cache
+  // is full.
+  void Put(std::string key, V value) {
+    const size_t capacity = this->capacity();
+    if (capacity == 0)
+      return;
+
+    while (lru_.size() >= capacity) {
+      index_.erase(lru_.back().first);
+      lru_.pop_back();
+    }
+    lru_.emplace_front(std::move(key), std::move(value));
+    index_.emplace(lru_.front().first, lru_.begin());
+  }
+
+ private:
+  using Entry = std::pair<std::string, V>;
+
+  const absl::Flag<uint32_t>* capacity_flag_;
+  std::list<Entry> lru_;  // most recently used first.
+  absl::flat_hash_map<std::string_view, typename std::list<Entry>::iterator> index_;
+};
+
+}  // namespace dfly
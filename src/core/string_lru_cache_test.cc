@@ -0,0 +1,60 @@
+// Copyright 2024, DragonflyDB authors.  All rights reserved.
+// See LICENSE for licensing terms.
+//
+
+#include "core/string_lru_cache.h"
+
+#include "base/flags.h"
+#include "base/gtest.h"
+
+ABSL_FLAG(uint32_t, test_lru_cache_size, 2, "");
+
+using namespace std;
+
+namespace dfly {
+
+class StringLruCacheTest : public ::testing::Test {
+ protected:
+  void TearDown() override {
+    absl::SetFlag(&FLAGS_test_lru_cache_size, 2);
+  }
+
+  StringLruCache<shared_ptr<int>> cache_{&FLAGS_test_lru_cache_size};
+  uint64_t hits_ = 0, misses_ = 0;
+};
+
+TEST_F(StringLruCacheTest, GetAndPut) {
+  EXPECT_EQ(nullptr, cache_.Get("a", &hits_, &misses_));
+  cache_.Put("a", make_shared<int>(1));
+  cache_.Put("b", make_shared<int>(2));
+
+  // "a" becomes the most recently used, so "b" is evicted.
+  auto a = cache_.Get("a", &hits_, &misses_);
+  ASSERT_NE(nullptr, a);
+  EXPECT_EQ(1, *a);
+  cache_.Put("c", make_shared<int>(3));
+
+  EXPECT_EQ(2u, cache_.size());
+  EXPECT_EQ(nullptr, cache_.Get("b", &hits_, &misses_));
+  EXPECT_NE(nullptr, cache_.Get("a", &hits_, &misses_));
+  EXPECT_NE(nullptr, cache_.Get("c", &hits_, &misses_));
+  EXPECT_EQ(3u, hits_);
+  EXPECT_EQ(2u, misses_);
+}
+
+TEST_F(StringLruCacheTest, Capacity) {
+  cache_.Put("a", make_shared<int>(1));
+  cache_.Put("b", make_shared<int>(2));
+
+  absl::SetFlag(&FLAGS_test_lru_cache_size, 1);
+  cache_.Put("c", make_shared<int>(3));
+  EXPECT_EQ(1u, cache_.size());
+  EXPECT_NE(nullptr, cache_.Get("c", &hits_, &misses_));
+
+  absl::SetFlag(&FLAGS_test_lru_cache_size, 0);
+  EXPECT_EQ(0u, cache_.capacity());
+  cache_.Put("d", make_shared<int>(4));
+  EXPECT_EQ(nullptr, cache_.Get("d", &hits_, &misses_));
+}
+
+}  // namespace dfly
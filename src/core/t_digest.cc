@@ -0,0 +1,236 @@
+// Copyright 2024, DragonflyDB authors.  All rights reserved.
+// See LICENSE for licensing terms.
+//
+
+#include "core/t_digest.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include "base/logging.h"
+
+namespace dfly {
+
+using namespace std;
+
+namespace {
+
+// Bound on the number of merged centroids, see MergeCentroids.
+constexpr uint32_t kMergedFactor = 2;
+constexpr uint32_t kMergedSlack = 4;
+
+// The buffer holds at least this many centroids per unit of compression. Larger buffers amortize
+// the merge better, see the MergingDigest of the reference implementation.
+constexpr uint32_t kBufferFactor = 4;
+
+bool MeanLess(const TDigest::Centroid& a, const TDigest::Centroid& b) {
+  return a.mean < b.mean;
+}
+
+// Linear interpolation of y(t) between points (x0, y0) and (x1, y1).
+double Interpolate(double x0, double y0, double x1, double y1, double t) {
+  if (x1 <= x0)
+    return y1;
+  return y0 + (y1 - y0) * (t - x0) / (x1 - x0);
+}
+
+}  // namespace
+
+TDigest::TDigest(uint32_t compression, PMR_NS::memory_resource* mr)
+    : compression_(compression),
+      capacity_(compression * (kMergedFactor + kBufferFactor) + kMergedSlack),
+      min_(numeric_limits<double>::infinity()),
+      max_(-numeric_limits<double>::infinity()),
+      mr_(mr) {
+  DCHECK_GT(compression, 0u);
+
+  centroids_ = static_cast<Centroid*>(
+      mr_->allocate(capacity_ * sizeof(Centroid), alignof(Centroid)));
+}
+
+TDigest::~TDigest() {
+  mr_->deallocate(centroids_, capacity_ * sizeof(Centroid), alignof(Centroid));
+}
+
+void TDigest::Add(absl::Span<const double> values) {
+  for (double val : values) {
+    DCHECK(isfinite(val));
+    Append({val, 1});
+    min_ = std::min(min_, val);
+    max_ = std::max(max_, val);
+  }
+}
+
+void TDigest::Merge(absl::Span<const Centroid> centroids, double min, double max) {
+  for (const Centroid& c : centroids) {
+    Append(c);
+  }
+  if (!centroids.empty()) {
+    min_ = std::min(min_, min);
+    max_ = std::max(max_, max);
+  }
+}
+
+bool TDigest::Load(string_view centroids, size_t num_merged, double min, double max) {
+  // A full buffer or too many merged centroids would leave Append without space after Compress.
+  size_t len = centroids.size() / sizeof(Centroid);
+  if (centroids.size() % sizeof(Centroid) != 0 || len >= capacity_ || num_merged > len ||
+      num_merged >= kMergedFactor * compression_ + kMergedSlack) {
+    return false;
+  }
+  if (len > 0 && !(isfinite(min) && isfinite(max) && min <= max))
+    return false;
+
+  memcpy(centroids_, centroids.data(), centroids.size());
+  for (size_t i = 0; i < len; ++i) {
+    const Centroid& c = centroids_[i];
+    if (!isfinite(c.mean) || !isfinite(c.weight) || c.weight <= 0)
+      return false;
+    if (i > 0 && i < num_merged && MeanLess(c, centroids_[i - 1]))
+      return false;
+  }
+
+  num_merged_ = num_merged;
+  num_unmerged_ = len - num_merged;
+  count_ = 0;
+  for (size_t i = 0; i < len; ++i) {
+    count_ += centroids_[i].weight;
+  }
+  if (len > 0) {  // an empty digest keeps the infinite bounds of the constructor
+    min_ = min;
+    max_ = max;
+  }
+  return true;
+}
+
+void TDigest::Compress() {
+  if (num_unmerged_ == 0)
+    return;
+
+  num_merged_ = MergeCentroids(centroids_, num_merged_, num_merged_ + num_unmerged_);
+  num_unmerged_ = 0;
+}
+
+void TDigest::Quantile(absl::Span<const double> qs, double* res) const {
+  vector<Centroid> tmp;
+  absl::Span<const Centroid> cs = MergedView(&tmp);
+
+  for (size_t i = 0; i < qs.size(); ++i) {
+    DCHECK(qs[i] >= 0 && qs[i] <= 1);
+    res[i] = cs.empty() ? numeric_limits<double>::quiet_NaN() : ValueAt(cs, qs[i] * count_);
+  }
+}
+
+void TDigest::CDF(absl::Span<const double> values, double* res) const {
+  vector<Centroid> tmp;
+  absl::Span<const Centroid> cs = MergedView(&tmp);
+
+  for (size_t i = 0; i < values.size(); ++i) {
+    if (cs.empty())
+      res[i] = numeric_limits<double>::quiet_NaN();
+    else if (values[i] < min_)
+      res[i] = 0;
+    else if (values[i] > max_)
+      res[i] = 1;
+    else
+      res[i] = RankOf(cs, values[i]) / count_;
+  }
+}
+
+size_t TDigest::MallocUsed() const {
+  return sizeof(TDigest) + capacity_ * sizeof(Centroid);
+}
+
+void TDigest::Append(const Centroid& c) {
+  DCHECK_LT(num_merged_ + num_unmerged_, capacity_);
+  centroids_[num_merged_ + num_unmerged_++] = c;
+  count_ += c.weight;
+
+  // Compress eagerly, so that the buffer is never left full, also not in a saved digest.
+  if (num_merged_ + num_unmerged_ == capacity_)
+    Compress();
+}
+
+double TDigest::ValueAt(absl::Span<const Centroid> cs, double rank) const {
+  double prev_rank = 0, prev_val = min_, weight = 0;
+  for (const Centroid& c : cs) {
+    double mid = weight + c.weight / 2;
+    if (rank <= mid)
+      return Interpolate(prev_rank, prev_val, mid, c.mean, rank);
+    prev_rank = mid;
+    prev_val = c.mean;
+    weight += c.weight;
+  }
+  return Interpolate(prev_rank, prev_val, count_, max_, rank);
+}
+
+double TDigest::RankOf(absl::Span<const Centroid> cs, double val) const {
+  double prev_rank = 0, prev_val = min_, weight = 0;
+  for (const Centroid& c : cs) {
+    double mid = weight + c.weight / 2;
+    if (val <= c.mean)
+      return Interpolate(prev_val, prev_rank, c.mean, mid, val);
+    prev_rank = mid;
+    prev_val = c.mean;
+    weight += c.weight;
+  }
+  return Interpolate(prev_val, prev_rank, max_, count_, val);
+}
+
+absl::Span<const TDigest::Centroid> TDigest::MergedView(vector<Centroid>* tmp) const {
+  if (num_unmerged_ == 0)
+    return centroids();
+
+  tmp->assign(centroids().begin(), centroids().end());
+  size_t len = MergeCentroids(tmp->data(), num_merged_, tmp->size());
+  return {tmp->data(), len};
+}
+
+size_t TDigest::MergeCentroids(Centroid* cs, size_t num_sorted, size_t len) const {
+  sort(cs + num_sorted, cs + len, MeanLess);
+  inplace_merge(cs, cs + num_sorted, cs + len, MeanLess);
+
+  double total = 0;
+  for (size_t i = 0; i < len; ++i) {
+    total += cs[i].weight;
+  }
+
+  // k2 scale function: k(q) = norm * log(q / (1 - q)). Neighbouring centroids are merged as long
+  // as the result spans at most 1 in k, so centroids are tiny near the tails, which keeps high
+  // percentiles accurate, and large around the median. Every pair of consecutive centroids spans
+  // more than 1 and, for compression below 2^16, the whole range spans less than compression,
+  // hence there are less than 2 * compression + 4 of them.
+  double norm = compression_ / (4 * log(std::max(total / compression_, 1.0)) + 24);
+  auto weight_limit = [&](double weight_so_far) {
+    double q = weight_so_far / total;
+    if (q <= 0 || q >= 1)
+      return q * total;
+    double k = norm * log(q / (1 - q)) + 1;
+    return total / (1 + exp(-k / norm));
+  };
+
+  // Centroids are written in place, behind the read position.
+  size_t out = 0;
+  double weight_so_far = 0;
+  double limit = weight_limit(0);
+  Centroid cur = cs[0];
+  for (size_t i = 1; i < len; ++i) {
+    if (weight_so_far + cur.weight + cs[i].weight <= limit) {
+      cur.weight += cs[i].weight;
+      cur.mean += (cs[i].mean - cur.mean) * cs[i].weight / cur.weight;
+    } else {
+      weight_so_far += cur.weight;
+      cs[out++] = cur;
+      limit = weight_limit(weight_so_far);
+      cur = cs[i];
+    }
+  }
+  cs[out++] = cur;
+
+  DCHECK_LT(out, kMergedFactor * compression_ + kMergedSlack);
+  return out;
+}
+
+}  // namespace dfly
@@ -0,0 +1,128 @@
+// Copyright 2024, DragonflyDB authors.  All rights reserved.
+// See LICENSE for licensing terms.
+//
+
+#pragma once
+
+#include <absl/types/span.h>
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "base/pmr/memory_resource.h"
+
+namespace dfly {
+
+/// Merging t-digest, see "Computing Extremely Accurate Quantiles Using t-Digests" by Dunning
+/// and Ertl. Centroids are kept in a single array that is allocated once: sorted, merged
+/// centroids at its start, followed by a buffer of unmerged ones. New values are appended to the
+/// buffer and only when it fills up, the buffer is sorted and merged with the rest in one pass.
+/// Queries use the merged view of the digest without modifying it. Quantile and CDF interpolate
+/// the same points, so they are inverse of each other.
+class TDigest {
+  TDigest(const TDigest&) = delete;
+  TDigest& operator=(const TDigest&) = delete;
+
+ public:
+  static constexpr uint32_t kMaxCompression = 1U << 16;
+
+  struct Centroid {
+    double mean;
+    double weight;
+  };
+
+  // compression - controls the accuracy and the size of the digest, must be in
+  // [1, kMaxCompression] range.
+  // The number of merged centroids stays below 2 * compression + 4.
+  TDigest(uint32_t compression, PMR_NS::memory_resource* mr);
+  ~TDigest();
+
+  // Adds values, which must be finite.
+  void Add(absl::Span<const double> values);
+
+  // Adds centroids of another digest with the given minimum and maximum.
+  void Merge(absl::Span<const Centroid> centroids, double min, double max);
+
+  // Loads centroids previously returned by data(), the first `num_merged` of them merged.
+  // Returns false if they do not fit into the digest or are not valid: means and weights must be
+  // finite, weights positive and the merged centroids sorted by mean, min and max of a non-empty
+  // digest finite. The digest should be discarded after a failed load.
+  bool Load(std::string_view centroids, size_t num_merged, double min, double max);
+
+  // Merges the buffer into the merged centroids.
+  void Compress();
+
+  // Batched estimation of quantiles in [0, 1] range and of the CDF at given points.
+  // Both return NaN for an empty digest.
+  void Quantile(absl::Span<const double> qs, double* res) const;
+  void CDF(absl::Span<const double> values, double* res) const;
+
+  uint32_t compression() const {
+    return compression_;
+  }
+
+  // Maximal number of centroids, merged and unmerged ones.
+  size_t capacity() const {
+    return capacity_;
+  }
+
+  size_t num_merged() const {
+    return num_merged_;
+  }
+
+  size_t num_unmerged() const {
+    return num_unmerged_;
+  }
+
+  // Total weight of all centroids, i.e. the number of added values.
+  double count() const {
+    return count_;
+  }
+
+  double min() const {
+    return min_;
+  }
+
+  double max() const {
+    return max_;
+  }
+
+  absl::Span<const Centroid> centroids() const {
+    return {centroids_, num_merged_ + num_unmerged_};
+  }
+
+  std::string_view data() const {
+    return {reinterpret_cast<const char*>(centroids_), centroids().size() * sizeof(Centroid)};
+  }
+
+  size_t MallocUsed() const;
+
+ private:
+  // Appends a centroid to the buffer, compressing if it becomes full.
+  void Append(const Centroid& c);
+
+  // Returns all the centroids merged, using `tmp` as storage if the buffer is not empty.
+  absl::Span<const Centroid> MergedView(std::vector<Centroid>* tmp) const;
+
+  // The points (0, min), (cumulative weight up to the middle of every centroid, its mean) and
+  // (count, max) are interpolated linearly. ValueAt maps a rank to a value, RankOf the opposite.
+  double ValueAt(absl::Span<const Centroid> cs, double rank) const;
+  double RankOf(absl::Span<const Centroid> cs, double val) const;
+
+  // Sorts [0, len) range of `cs` whose prefix of `num_sorted` items is already sorted and
+  // merges neighbouring centroids in place. Returns the number of resulting centroids.
+  size_t MergeCentroids(Centroid* cs, size_t num_sorted, size_t len) const;
+
+  uint32_t compression_;
+  uint32_t capacity_;
+  uint32_t num_merged_ = 0;
+  uint32_t num_unmerged_ = 0;
+  double count_ = 0;
+  double min_;
+  double max_;
+  Centroid* centroids_;
+  PMR_NS::memory_resource* mr_;
+};
+
+}  // namespace dfly
@@ -0,0 +1,198 @@
+// Copyright 2024, DragonflyDB authors.  All rights reserved.
+// See LICENSE for licensing terms.
+//
+
+#include "core/top_k.h"
+
+#include <xxhash.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include "base/logging.h"
+
+namespace dfly {
+
+using namespace std;
+
+TopK::TopK(uint32_t k, uint32_t width, uint32_t depth, double decay,
+           PMR_NS::memory_resource* mr)
+    : k_(k),
+      width_(width),
+      depth_(depth),
+      decay_(decay),
+      buckets_(size_t(width) * depth, Bucket{0, 0}, mr),
+      heap_(mr) {
+  DCHECK(k > 0 && width > 0 && depth > 0);
+  DCHECK(decay > 0 && decay <= 1);
+  heap_.reserve(k);
+}
+
+optional<string> TopK::IncrBy(string_view item, uint32_t incr) {
+  HashPair hash = Hash(item);
+  uint32_t fp = Fingerprint(hash);
+  uint32_t max_count = 0;
+
+  for (unsigned row = 0; row < depth_; ++row) {
+    Bucket& bucket = buckets_[BucketIndex(hash, row)];
+    if (bucket.count == 0) {
+      bucket = {fp, incr};
+    } else if (bucket.fp == fp) {
+      uint32_t count;
+      bucket.count = __builtin_add_overflow(bucket.count, incr, &count)
+                         ? numeric_limits<uint32_t>::max()
+                         : count;
+    } else {
+      // Every unit of `incr` decays the count of the resident item with probability
+      // decay^count. Instead of flipping a coin per unit, we sample the number of units until the
+      // next decay from the geometric distribution, so large increments stay cheap.
+      // Once the count drops to zero, the bucket is taken over with the remaining units.
+      uint32_t left = incr;
+      while (left > 0) {
+        double prob = pow(decay_, bucket.count);
+        if (prob <= 0)
+          break;
+
+        double trials = prob >= 1 ? 1 : floor(log(NextRandom()) / log1p(-prob)) + 1;
+        if (trials > left)
+          break;
+
+        left -= uint32_t(trials) - 1;
+        if (--bucket.count == 0) {
+          bucket = {fp, left};
+          break;
+        }
+        --left;
+      }
+    }
+
+    if (bucket.fp == fp)
+      max_count = max(max_count, bucket.count);
+  }
+
+  // Long tail items do not reach the heap, so skip the lookup for them.
+  if (max_count == 0 || (heap_.size() == k_ && max_count < heap_.front().count))
+    return nullopt;
+
+  if (size_t pos = FindInHeap(item, fp); pos < heap_.size()) {
+    heap_[pos].count = max_count;
+    FixHeap(pos);
+    return nullopt;
+  }
+
+  if (heap_.size() < k_) {
+    heap_.push_back({PMR_NS::string{item, heap_.get_allocator()}, fp, max_count});
+    FixHeap(heap_.size() - 1);
+    return nullopt;
+  }
+
+  if (max_count == heap_.front().count)
+    return nullopt;
+
+  HeapEntry& min_entry = heap_.front();
+  optional<string> expelled{string{string_view{min_entry.item}}};
+  min_entry.item.assign(item);
+  min_entry.fp = fp;
+  min_entry.count = max_count;
+  FixHeap(0);
+
+  return expelled;
+}
+
+bool TopK::Query(string_view item) const {
+  return FindInHeap(item, Fingerprint(Hash(item))) < heap_.size();
+}
+
+uint32_t TopK::Count(string_view item) const {
+  HashPair hash = Hash(item);
+  uint32_t fp = Fingerprint(hash);
+
+  uint32_t res = 0;
+  for (unsigned row = 0; row < depth_; ++row) {
+    const Bucket& bucket = buckets_[BucketIndex(hash, row)];
+    if (bucket.fp == fp)
+      res = max(res, bucket.count);
+  }
+  return res;
+}
+
+vector<pair<string_view, uint32_t>> TopK::List() const {
+  vector<pair<string_view, uint32_t>> res;
+  res.reserve(heap_.size());
+  for (const HeapEntry& entry : heap_) {
+    res.emplace_back(entry.item, entry.count);
+  }
+
+  sort(res.begin(), res.end(), [](const auto& l, const auto& r) { return l.second > r.second; });
+  return res;
+}
+
+void TopK::Load(string_view buckets, uint64_t rng_state) {
+  CHECK_EQ(buckets.size(), this->buckets().size());
+
+  memcpy(buckets_.data(), buckets.data(), buckets.size());
+  rng_state_ = rng_state;
+}
+
+void TopK::LoadHeapEntry(string_view item, uint32_t count) {
+  DCHECK_LT(heap_.size(), k_);
+
+  heap_.push_back({PMR_NS::string{item, heap_.get_allocator()}, Fingerprint(Hash(item)), count});
+  FixHeap(heap_.size() - 1);
+}
+
+size_t TopK::MallocUsed() const {
+  size_t res = sizeof(TopK) + buckets_.capacity() * sizeof(Bucket);
+  res += heap_.capacity() * sizeof(HeapEntry);
+  for (const HeapEntry& entry : heap_) {
+    res += entry.item.capacity();
+  }
+  return res;
+}
+
+TopK::HashPair TopK::Hash(string_view item) {
+  XXH128_hash_t hash = XXH3_128bits(item.data(), item.size());
+  return {hash.low64, hash.high64};
+}
+
+double TopK::NextRandom() {
+  // splitmix64
+  uint64_t z = (rng_state_ += 0x9e3779b97f4a7c15ULL);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  z ^= z >> 31;
+  return (z >> 11) * 0x1.0p-53;
+}
+
+size_t TopK::FindInHeap(string_view item, uint32_t fp) const {
+  for (size_t i = 0; i < heap_.size(); ++i) {
+    if (heap_[i].fp == fp && heap_[i].item == item)
+      return i;
+  }
+  return heap_.size();
+}
+
+void TopK::FixHeap(size_t index) {
+  auto less = [this](size_t l, size_t r) { return heap_[l].count < heap_[r].count; };
+
+  while (index > 0 && less(index, (index - 1) / 2)) {
+    swap(heap_[index], heap_[(index - 1) / 2]);
+    index = (index - 1) / 2;
+  }
+
+  while (true) {
+    size_t smallest = index;
+    for (size_t child = 2 * index + 1; child <= 2 * index + 2 && child < heap_.size(); ++child) {
+      if (less(child, smallest))
+        smallest = child;
+    }
+    if (smallest == index)
+      break;
+    swap(heap_[index], heap_[smallest]);
+    index = smallest;
+  }
+}
+
+}  // namespace dfly
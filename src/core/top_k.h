@@ -0,0 +1,125 @@
+// Copyright 2024, DragonflyDB authors.  All rights reserved.
+// See LICENSE for licensing terms.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "base/pmr/memory_resource.h"
+
+namespace dfly {
+
+/// Top-K heavy hitters based on HeavyKeeper, see
+/// https://www.usenix.org/conference/atc18/presentation/gong
+/// Similarly to TopKeys in server/top_keys.h, a `depth` x `width` table of (fingerprint, count)
+/// buckets tracks the counts, while the k items with the largest counts are kept in a min-heap.
+/// The random decisions of HeavyKeeper are taken from a generator whose state is part of the
+/// object, so replaying the same updates on a loaded copy yields the same result.
+class TopK {
+  TopK(const TopK&) = delete;
+  TopK& operator=(const TopK&) = delete;
+
+ public:
+  struct Bucket {
+    uint32_t fp;
+    uint32_t count;
+  };
+
+  struct HeapEntry {
+    PMR_NS::string item;
+    uint32_t fp;
+    uint32_t count;
+  };
+
+  // k, width and depth must be positive, decay must be in (0, 1] range.
+  TopK(uint32_t k, uint32_t width, uint32_t depth, double decay, PMR_NS::memory_resource* mr);
+
+  // Increases the count of `item` by `incr`. Returns the item that was expelled from the top-k
+  // list as a result, if any.
+  std::optional<std::string> IncrBy(std::string_view item, uint32_t incr);
+
+  // Returns true if `item` is in the top-k list.
+  bool Query(std::string_view item) const;
+
+  // Returns the estimated count of `item`.
+  uint32_t Count(std::string_view item) const;
+
+  // Returns the top-k list ordered by descending count.
+  std::vector<std::pair<std::string_view, uint32_t>> List() const;
+
+  // Loading interface. Buckets are expected in the format returned by buckets(),
+  // heap entries in any order.
+  void Load(std::string_view buckets, uint64_t rng_state);
+  void LoadHeapEntry(std::string_view item, uint32_t count);
+
+  uint32_t k() const {
+    return k_;
+  }
+
+  uint32_t width() const {
+    return width_;
+  }
+
+  uint32_t depth() const {
+    return depth_;
+  }
+
+  double decay() const {
+    return decay_;
+  }
+
+  uint64_t rng_state() const {
+    return rng_state_;
+  }
+
+  std::string_view buckets() const {
+    return {reinterpret_cast<const char*>(buckets_.data()), buckets_.size() * sizeof(Bucket)};
+  }
+
+  const auto& heap() const {
+    return heap_;
+  }
+
+  size_t MallocUsed() const;
+
+ private:
+  struct HashPair {
+    uint64_t low, hi;
+  };
+
+  static HashPair Hash(std::string_view item);
+
+  static uint32_t Fingerprint(const HashPair& hash) {
+    return hash.hi >> 32;
+  }
+
+  size_t BucketIndex(const HashPair& hash, unsigned row) const {
+    return size_t(row) * width_ + (hash.low + hash.hi * row) % width_;
+  }
+
+  // Returns a uniformly distributed number in [0, 1) range.
+  double NextRandom();
+
+  // Returns the heap index of the item with fingerprint `fp`, or heap_.size() if not found.
+  size_t FindInHeap(std::string_view item, uint32_t fp) const;
+
+  // Restores the heap property after the count of heap_[index] changed.
+  void FixHeap(size_t index);
+
+  uint32_t k_;
+  uint32_t width_;
+  uint32_t depth_;
+  double decay_;
+  uint64_t rng_state_ = 0;
+
+  std::vector<Bucket, PMR_NS::polymorphic_allocator<Bucket>> buckets_;
+  std::vector<HeapEntry, PMR_NS::polymorphic_allocator<HeapEntry>> heap_;
+};
+
+}  // namespace dfly
@@ -1018,6 +1018,95 @@ unsigned char *lpAppendInteger(unsigned char *lp, long long lval) {
     return lpInsertInteger(lp, lval, eofptr, LP_BEFORE, NULL);
 }
 
+/* Insert the 'len' elements of 'entries' before or after ('where' is LP_BEFORE
+ * or LP_AFTER) the element pointed by 'p', keeping their order. Unlike calling
+ * lpInsert() for each element, the listpack is reallocated and its tail is
+ * moved only once.
+ *
+ * If 'newp' is not NULL, it is set to the first inserted element.
+ * Returns NULL on out of memory or when the listpack would exceed its maximum size. */
+unsigned char *lpBatchInsert(unsigned char *lp, unsigned char *p, int where,
+                             listpackEntry *entries, unsigned int len, unsigned char **newp)
+{
+    unsigned char intenc[LP_MAX_INT_ENCODING_LEN];
+    unsigned char backlen[LP_MAX_BACKLEN_SIZE];
+    uint64_t enclen;
+
+    assert(where == LP_BEFORE || where == LP_AFTER);
+    assert(entries != NULL && len > 0);
+
+    if (where == LP_AFTER) {
+        p = lpSkip(p);
+        ASSERT_INTEGRITY(lp, p);
+    }
+
+    /* First pass: compute how many bytes the new elements need. */
+    uint64_t addedlen = 0;
+    for (unsigned int i = 0; i < len; i++) {
+        if (entries[i].sval)
+            lpEncodeGetType(entries[i].sval, entries[i].slen, intenc, &enclen);
+        else
+            lpEncodeIntegerGetType(entries[i].lval, intenc, &enclen);
+        addedlen += enclen + lpEncodeBacklen(NULL, enclen);
+    }
+
+    unsigned long poff = p-lp;
+    uint64_t old_listpack_bytes = lpGetTotalBytes(lp);
+    uint64_t new_listpack_bytes = old_listpack_bytes + addedlen;
+    if (new_listpack_bytes > UINT32_MAX) return NULL;
+
+    if (new_listpack_bytes > zmalloc_size(lp)) {
+        if ((lp = zrealloc(lp, new_listpack_bytes)) == NULL) return NULL;
+    }
+
+    unsigned char *dst = lp + poff;
+    memmove(dst + addedlen, dst, old_listpack_bytes - poff);
+
+    /* Second pass: encode the elements into the gap. */
+    for (unsigned int i = 0; i < len; i++) {
+        int enctype = LP_ENCODING_INT;
+        if (entries[i].sval)
+            enctype = lpEncodeGetType(entries[i].sval, entries[i].slen, intenc, &enclen);
+        else
+            lpEncodeIntegerGetType(entries[i].lval, intenc, &enclen);
+
+        if (enctype == LP_ENCODING_INT)
+            memcpy(dst, intenc, enclen);
+        else
+            lpEncodeString(dst, entries[i].sval, entries[i].slen);
+        dst += enclen;
+        unsigned long backlen_size = lpEncodeBacklen(backlen, enclen);
+        memcpy(dst, backlen, backlen_size);
+        dst += backlen_size;
+    }
+
+    uint32_t num_elements = lpGetNumElements(lp);
+    if (num_elements != LP_HDR_NUMELE_UNKNOWN) {
+        if ((uint64_t)num_elements + len < LP_HDR_NUMELE_UNKNOWN)
+            lpSetNumElements(lp, num_elements + len);
+        else
+            lpSetNumElements(lp, LP_HDR_NUMELE_UNKNOWN);
+    }
+    lpSetTotalBytes(lp, new_listpack_bytes);
+
+    if (newp) *newp = lp + poff;
+    return lp;
+}
+
+/* Append the 'len' elements of 'entries' at the end of the listpack. */
+unsigned char *lpBatchAppend(unsigned char *lp, listpackEntry *entries, unsigned long len) {
+    unsigned char *eofptr = lp + lpGetTotalBytes(lp) - 1;
+    return lpBatchInsert(lp, eofptr, LP_BEFORE, entries, len, NULL);
+}
+
+/* Insert the 'len' elements of 'entries' at the head of the listpack, so that
+ * entries[0] becomes the first element. */
+unsigned char *lpBatchPrepend(unsigned char *lp, listpackEntry *entries, unsigned long len) {
+    unsigned char *p = lpFirst(lp);
+    if (!p) return lpBatchAppend(lp, entries, len);
+    return lpBatchInsert(lp, p, LP_BEFORE, entries, len, NULL);
+}
+
 /* This is just a wrapper for lpInsert() to directly use a string to replace
  * the current element. The function returns the new listpack as return
  * value, and also updates the current cursor by updating '*p'. */
@@ -63,6 +63,10 @@ unsigned char *lpPrepend(unsigned char *lp, const unsigned char *s, uint32_t sle
 unsigned char *lpPrependInteger(unsigned char *lp, long long lval);
 unsigned char *lpAppend(unsigned char *lp, const unsigned char *s, uint32_t slen);
 unsigned char *lpAppendInteger(unsigned char *lp, long long lval);
+unsigned char *lpBatchInsert(unsigned char *lp, unsigned char *p, int where,
+                             listpackEntry *entries, unsigned int len, unsigned char **newp);
+unsigned char *lpBatchAppend(unsigned char *lp, listpackEntry *entries, unsigned long len);
+unsigned char *lpBatchPrepend(unsigned char *lp, listpackEntry *entries, unsigned long len);
 unsigned char *lpInsertInteger(unsigned char *lp, long long lval, unsigned char *p, int where,
                                unsigned char **newp);
 unsigned char *lpReplace(unsigned char *lp, unsigned char **p, const unsigned char *s, uint32_t slen);
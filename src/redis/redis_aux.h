@@ -8,9 +8,13 @@
  * this will add enough place for Redis types to grow */
 #define OBJ_JSON 15U
 #define OBJ_SBF  16U
+#define OBJ_CMS  17U
+#define OBJ_TOPK 18U
+#define OBJ_CF   19U
+#define OBJ_TDIGEST 20U
 
 /* How many types of objects exist */
-#define OBJ_TYPE_MAX 17U
+#define OBJ_TYPE_MAX 21U
 
 #define CONFIG_RUN_ID_SIZE 40U
 
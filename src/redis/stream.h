@@ -75,6 +75,11 @@ typedef struct streamCG {
     rax *consumers;         /* A radix tree representing the consumers by name
                                and their associated representation in the form
                                of streamConsumer structures. */
+    rax *pel_by_time;       /* Secondary index of the PEL ordered by delivery time,
+                               so idle entries can be found without scanning the
+                               whole PEL. Keys are the delivery time followed by
+                               the entry ID (see streamEncodePelTimeKey), values
+                               are the streamNACK structures shared with 'pel'. */
 } streamCG;
 
 /* A specific consumer in a consumer group.  */
@@ -133,6 +138,9 @@ typedef struct {
 #define SCC_NO_NOTIFY     (1<<0) /* Do not notify key space if consumer created */
 #define SCC_NO_DIRTIFY    (1<<1) /* Do not dirty++ if consumer created */
 
+/* Length of the keys of streamCG.pel_by_time: delivery time + entry ID. */
+#define STREAM_PEL_TIME_KEY_LEN (sizeof(uint64_t) + sizeof(streamID))
+
 #define SCG_INVALID_ENTRIES_READ -1
 #define SCG_INVALID_LAG -1
 
@@ -158,6 +166,11 @@ void streamDecodeID(void *buf, streamID *id);
 int streamCompareID(streamID *a, streamID *b);
 int streamEntryExists(stream *s, streamID *id);
 void streamFreeNACK(streamNACK *na);
+void streamEncodePelTimeKey(void *buf, mstime_t delivery_time, const unsigned char *rawid);
+void streamPelIndexAdd(streamCG *cg, const unsigned char *rawid, streamNACK *nack);
+void streamPelIndexRemove(streamCG *cg, const unsigned char *rawid, streamNACK *nack);
+void streamNACKSetDeliveryTime(streamCG *cg, const unsigned char *rawid, streamNACK *nack,
+                               mstime_t delivery_time);
 int streamIncrID(streamID *id);
 int streamDecrID(streamID *id);
 
@@ -1047,6 +1047,42 @@ void streamFreeNACK(streamNACK *na) {
     zfree(na);
 }
 
+/* Encode the 'pel_by_time' key of a pending entry: the delivery time as a big
+ * endian number with its sign bit flipped, so that keys sort by time even for
+ * negative times, followed by the raw 128 bit entry ID. 'buf' must hold
+ * STREAM_PEL_TIME_KEY_LEN bytes. */
+void streamEncodePelTimeKey(void *buf, mstime_t delivery_time, const unsigned char *rawid) {
+    uint64_t t = htonu64((uint64_t)delivery_time ^ (1ULL << 63));
+    memcpy(buf,&t,sizeof(t));
+    memcpy((unsigned char*)buf+sizeof(t),rawid,sizeof(streamID));
+}
+
+/* Add the pending entry 'rawid' to the delivery time index of the group. Must
+ * be called whenever a NACK is added to the group PEL. */
+void streamPelIndexAdd(streamCG *cg, const unsigned char *rawid, streamNACK *nack) {
+    unsigned char key[STREAM_PEL_TIME_KEY_LEN];
+    streamEncodePelTimeKey(key,nack->delivery_time,rawid);
+    raxInsert(cg->pel_by_time,key,sizeof(key),nack,NULL);
+}
+
+/* Remove the pending entry 'rawid' from the delivery time index of the group.
+ * Must be called whenever a NACK leaves the group PEL, before it is freed. */
+void streamPelIndexRemove(streamCG *cg, const unsigned char *rawid, streamNACK *nack) {
+    unsigned char key[STREAM_PEL_TIME_KEY_LEN];
+    streamEncodePelTimeKey(key,nack->delivery_time,rawid);
+    raxRemove(cg->pel_by_time,key,sizeof(key),NULL);
+}
+
+/* Update the delivery time of a NACK that is in the group PEL, keeping the
+ * delivery time index in sync. */
+void streamNACKSetDeliveryTime(streamCG *cg, const unsigned char *rawid, streamNACK *nack,
+                               mstime_t delivery_time) {
+    if (nack->delivery_time == delivery_time) return;
+    streamPelIndexRemove(cg,rawid,nack);
+    nack->delivery_time = delivery_time;
+    streamPelIndexAdd(cg,rawid,nack);
+}
+
 /* Free a consumer and associated data structures. Note that this function
  * will not reassign the pending messages associated with this consumer
  * nor will delete them from the stream, so when this function is called
@@ -1071,6 +1107,7 @@ streamCG *streamCreateCG(stream *s, const char *name, size_t namelen, streamID *
     streamCG *cg = zmalloc(sizeof(*cg));
     cg->pel = raxNew();
     cg->consumers = raxNew();
+    cg->pel_by_time = raxNew();
     cg->last_id = *id;
     cg->entries_read = entries_read;
     raxInsert(s->cgroups,(unsigned char*)name,namelen,cg,NULL);
@@ -1081,6 +1118,7 @@ streamCG *streamCreateCG(stream *s, const char *name, size_t namelen, streamID *
 void streamFreeCG(streamCG *cg) {
     raxFreeWithCallback(cg->pel,(void(*)(void*))streamFreeNACK);
     raxFreeWithCallback(cg->consumers,(void(*)(void*))streamFreeConsumer);
+    raxFree(cg->pel_by_time); /* Values are owned by 'pel'. */
     zfree(cg);
 }
 
@@ -1135,6 +1173,7 @@ void streamDelConsumer(streamCG *cg, streamConsumer *consumer) {
     while(raxNext(&ri)) {
         streamNACK *nack = ri.data;
         raxRemove(cg->pel,ri.key,ri.key_len,NULL);
+        streamPelIndexRemove(cg,ri.key,nack);
         streamFreeNACK(nack);
     }
     raxStop(&ri);
@@ -20,12 +20,14 @@ using namespace std;
 struct WatchItem {
   Transaction* trans;
   KeyReadyChecker key_ready_checker;
+  BlockingHandOff* handoff;
 
   Transaction* get() const {
     return trans;
   }
 
-  WatchItem(Transaction* t, KeyReadyChecker krc) : trans(t), key_ready_checker(std::move(krc)) {
+  WatchItem(Transaction* t, KeyReadyChecker krc, BlockingHandOff* ho)
+      : trans(t), key_ready_checker(std::move(krc)), handoff(ho) {
   }
 };
 
@@ -199,7 +201,8 @@ void BlockingController::NotifyPending() {
   awakened_indices_.clear();
 }
 
-void BlockingController::AddWatched(Keys watch_keys, KeyReadyChecker krc, Transaction* trans) {
+void BlockingController::AddWatched(Keys watch_keys, KeyReadyChecker krc, Transaction* trans,
+                                    BlockingHandOff* handoff) {
   auto [dbit, added] = watched_dbs_.emplace(trans->GetDbIndex(), nullptr);
   if (added) {
     dbit->second.reset(new DbWatchTable);
@@ -222,7 +225,7 @@ void BlockingController::AddWatched(Keys watch_keys, KeyReadyChecker krc, Transa
         continue;
     }
     DVLOG(2) << "Emplace " << trans->DebugId() << " to watch " << key;
-    res->second->items.emplace_back(trans, krc);
+    res->second->items.emplace_back(trans, krc, handoff);
   }
 }
 
@@ -242,6 +245,42 @@ void BlockingController::AwakeWatched(DbIndex db_index, string_view db_key) {
   }
 }
 
+BlockingHandOff* BlockingController::AwakeForHandOff(DbIndex db_index, string_view db_key) {
+  auto it = watched_dbs_.find(db_index);
+  if (it == watched_dbs_.end())
+    return nullptr;
+
+  DbWatchTable& wt = *it->second;
+  auto w_it = wt.queue_map.find(db_key);
+  if (w_it == wt.queue_map.end())
+    return nullptr;
+
+  // Only the head of the queue may be served directly, otherwise we would overtake transactions
+  // that started waiting earlier. Queues that are already active have a pending waiter.
+  WatchQueue* wq = w_it->second.get();
+  if (wq->state != WatchQueue::SUSPENDED || wq->items.empty())
+    return nullptr;
+
+  WatchItem& wi = wq->items.front();
+  if (wi.handoff == nullptr)
+    return nullptr;
+
+  // Fails if the transaction is timing out or being cancelled at the same time.
+  Transaction* head = wi.get();
+  if (!head->NotifySuspended(owner_->committed_txid(), owner_->shard_id(), db_key))
+    return nullptr;
+
+  DVLOG(2) << "WQ-HandOff " << head->DebugId() << " from key " << db_key;
+
+  // Same state as after NotifyWatchQueue: the head stays in the queue until it finalizes.
+  wq->state = WatchQueue::ACTIVE;
+  wq->notify_txid = owner_->committed_txid();
+  wt.awakened_keys.erase(w_it->first);
+  awakened_transactions_.insert(head);
+
+  return wi.handoff;
+}
+
 // Marks the queue as active and notifies the first transaction in the queue.
 void BlockingController::NotifyWatchQueue(std::string_view key, WatchQueue* wq,
                                           const DbContext& context) {
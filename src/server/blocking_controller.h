@@ -41,11 +41,17 @@ class BlockingController {
   // TODO: consider moving all watched functions to
   // EngineShard with separate per db map.
   //! AddWatched adds a transaction to the blocking queue.
-  void AddWatched(Keys watch_keys, KeyReadyChecker krc, Transaction* me);
+  void AddWatched(Keys watch_keys, KeyReadyChecker krc, Transaction* me,
+                  BlockingHandOff* handoff = nullptr);
 
   // Called from operations that create keys like lpush, rename etc.
   void AwakeWatched(DbIndex db_index, std::string_view db_key);
 
+  // Called from single hop pushes that create db_key. If the first transaction in the key's
+  // watch queue accepts hand-offs, wakes it and returns its slot, which the caller must fill
+  // with the value it would have pushed. Returns nullptr if the regular wake path must be used.
+  BlockingHandOff* AwakeForHandOff(DbIndex db_index, std::string_view db_key);
+
   // Used in tests and debugging functions.
   size_t NumWatched(DbIndex db_indx) const;
   std::vector<std::string> GetWatchedKeys(DbIndex db_indx) const;
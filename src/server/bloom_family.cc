@@ -5,6 +5,7 @@
 #include "server/bloom_family.h"
 
 #include "core/bloom.h"
+#include "core/cuckoo_filter.h"
 #include "facade/cmd_arg_parser.h"
 #include "facade/error.h"
 #include "server/command_registry.h"
@@ -25,12 +26,26 @@ struct SbfParams {
   uint32_t init_capacity;
   double error;
   double grow_factor = kDefaultGrowFactor;
+  bool blocked = false;
 
   bool ok() const {
     return error > 0 and error < 0.5;
   }
 };
 
+struct CfParams {
+  uint64_t capacity;
+  uint32_t max_iterations = 20;
+  uint32_t expansion = 1;
+
+  bool ok() const {
+    return capacity > 0 && capacity <= (1ULL << 32) && max_iterations > 0 &&
+           max_iterations <= 65535 && expansion <= 32768;
+  }
+};
+
+constexpr uint64_t kDefaultCfCapacity = 1024;
+
 using AddResult = absl::InlinedVector<OpResult<bool>, 4>;
 using ExistsResult = absl::InlinedVector<bool, 4>;
 
@@ -43,7 +58,7 @@ OpStatus OpReserve(const SbfParams& params, const OpArgs& op_args, string_view k
     return OpStatus::KEY_EXISTS;
 
   PrimeValue& pv = op_res->it->second;
-  pv.SetSBF(params.init_capacity, params.error, params.grow_factor);
+  pv.SetSBF(params.init_capacity, params.error, params.grow_factor, params.blocked);
 
   return OpStatus::OK;
 }
@@ -64,12 +79,9 @@ OpResult<AddResult> OpAdd(const OpArgs& op_args, string_view key, CmdArgList ite
       return OpStatus::WRONG_TYPE;
   }
 
-  SBF* sbf = pv.GetSBF();
-  AddResult result(items.size());
-  for (size_t i = 0; i < items.size(); ++i) {
-    result[i] = sbf->Add(ToSV(items[i]));
-  }
-  return result;
+  ExistsResult added(items.size());
+  pv.GetSBF()->Add(items, added.data());
+  return AddResult(added.begin(), added.end());
 }
 
 OpResult<ExistsResult> OpExists(const OpArgs& op_args, string_view key, CmdArgList items) {
@@ -79,16 +91,116 @@ OpResult<ExistsResult> OpExists(const OpArgs& op_args, string_view key, CmdArgLi
     return op_res.status();
   auto it = (*op_res);
 
-  const SBF* sbf = it->second.GetSBF();
   ExistsResult result(items.size());
+  it->second.GetSBF()->Exists(items, result.data());
+  return result;
+}
 
-  for (size_t i = 0; i < items.size(); ++i) {
-    result[i] = sbf->Exists(ToSV(items[i]));
+OpStatus OpCfReserve(const CfParams& params, const OpArgs& op_args, string_view key) {
+  auto& db_slice = op_args.GetDbSlice();
+  OpResult op_res = db_slice.AddOrFind(op_args.db_cntx, key);
+  if (!op_res)
+    return op_res.status();
+  if (!op_res->is_new)
+    return OpStatus::KEY_EXISTS;
+
+  op_res->it->second.SetCF(CompactObj::AllocateMR<CuckooFilter>(
+      params.capacity, params.max_iterations, params.expansion, CompactObj::memory_resource()));
+  return OpStatus::OK;
+}
+
+// Returns true if the item was added, false if `nx` is set and the item was already "present".
+// OUT_OF_RANGE status means that the filter is full.
+OpResult<bool> OpCfAdd(const OpArgs& op_args, string_view key, string_view item, bool nx) {
+  auto& db_slice = op_args.GetDbSlice();
+
+  OpResult op_res = db_slice.AddOrFind(op_args.db_cntx, key);
+  if (!op_res)
+    return op_res.status();
+  PrimeValue& pv = op_res->it->second;
+
+  if (op_res->is_new) {
+    CfParams params{kDefaultCfCapacity};
+    pv.SetCF(CompactObj::AllocateMR<CuckooFilter>(
+        params.capacity, params.max_iterations, params.expansion, CompactObj::memory_resource()));
+  } else if (pv.ObjType() != OBJ_CF) {
+    return OpStatus::WRONG_TYPE;
   }
 
+  CuckooFilter* cf = pv.GetCF();
+  if (nx && cf->Exists(item))
+    return false;
+
+  if (!cf->Add(item))
+    return OpStatus::OUT_OF_RANGE;
+  return true;
+}
+
+OpResult<bool> OpCfDel(const OpArgs& op_args, string_view key, string_view item) {
+  auto op_res = op_args.GetDbSlice().FindMutable(op_args.db_cntx, key, OBJ_CF);
+  if (!op_res)
+    return op_res.status();
+
+  return op_res->it->second.GetCF()->Delete(item);
+}
+
+// Returns the counts of `items`, or whether they exist if `exists` is set.
+OpResult<vector<unsigned>> OpCfQuery(const OpArgs& op_args, string_view key, CmdArgList items,
+                                     bool exists) {
+  auto op_res = op_args.GetDbSlice().FindReadOnly(op_args.db_cntx, key, OBJ_CF);
+  if (!op_res)
+    return op_res.status();
+
+  const CuckooFilter* cf = (*op_res)->second.GetCF();
+  vector<unsigned> result(items.size());
+  for (size_t i = 0; i < items.size(); ++i) {
+    string_view item = ToSV(items[i]);
+    result[i] = exists ? cf->Exists(item) : cf->Count(item);
+  }
   return result;
 }
 
+void CfAddGeneric(CmdArgList args, Transaction* tx, SinkReplyBuilder* builder, bool nx) {
+  string_view key = ArgS(args, 0);
+  string_view item = ArgS(args, 1);
+
+  const auto cb = [&](Transaction* t, EngineShard* shard) {
+    return OpCfAdd(t->GetOpArgs(shard), key, item, nx);
+  };
+
+  OpResult res = tx->ScheduleSingleHopT(std::move(cb));
+  if (res)
+    return builder->SendLong(*res);
+  if (res.status() == OpStatus::OUT_OF_RANGE)
+    return builder->SendError("filter is full");
+  return builder->SendError(res.status());
+}
+
+// Replies with an array if `multi` is set and with a single integer otherwise.
+// Non-existing keys are treated as empty filters.
+void CfQueryGeneric(CmdArgList args, Transaction* tx, SinkReplyBuilder* builder, bool exists,
+                    bool multi) {
+  string_view key = ArgS(args, 0);
+  args.remove_prefix(1);
+
+  const auto cb = [&](Transaction* t, EngineShard* shard) {
+    return OpCfQuery(t->GetOpArgs(shard), key, args, exists);
+  };
+
+  OpResult res = tx->ScheduleSingleHopT(std::move(cb));
+  if (!res && res.status() == OpStatus::WRONG_TYPE)
+    return builder->SendError(res.status());
+
+  if (!multi)
+    return builder->SendLong(res ? res->front() : 0);
+
+  RedisReplyBuilder* rb = static_cast<RedisReplyBuilder*>(builder);
+  rb->StartArray(args.size());
+  for (size_t i = 0; i < args.size(); ++i) {
+    rb->SendLong(res ? res->at(i) : 0);
+  }
+}
+
 }  // namespace
 
 void BloomFamily::Reserve(CmdArgList args, Transaction* tx, SinkReplyBuilder* builder) {
@@ -98,6 +210,14 @@ void BloomFamily::Reserve(CmdArgList args, Transaction* tx, SinkReplyBuilder* bu
 
   tie(params.error, params.init_capacity) = parser.Next<double, uint32_t>();
 
+  // Other options, like EXPANSION or NONSCALING, are accepted and ignored.
+  while (parser.HasNext()) {
+    if (parser.Check("BLOCKED"))
+      params.blocked = true;
+    else
+      parser.Skip(1);
+  }
+
   if (parser.Error())
     return builder->SendError(kSyntaxErr);
 
@@ -187,6 +307,73 @@ void BloomFamily::MExists(CmdArgList args, Transaction* tx, SinkReplyBuilder* bu
   }
 }
 
+void BloomFamily::CfReserve(CmdArgList args, Transaction* tx, SinkReplyBuilder* builder) {
+  CmdArgParser parser(args);
+  string_view key = parser.Next();
+  CfParams params{parser.Next<uint64_t>()};
+
+  while (parser.HasNext()) {
+    if (parser.Check("MAXITERATIONS")) {
+      params.max_iterations = parser.Next<uint32_t>();
+    } else if (parser.Check("EXPANSION")) {
+      params.expansion = parser.Next<uint32_t>();
+    } else {
+      return builder->SendError(kSyntaxErr);
+    }
+  }
+
+  if (auto err = parser.Error(); err)
+    return builder->SendError(err->MakeReply());
+
+  if (!params.ok())
+    return builder->SendError("capacity, max iterations or expansion is out of range",
+                              kSyntaxErrType);
+
+  const auto cb = [&](Transaction* t, EngineShard* shard) {
+    return OpCfReserve(params, t->GetOpArgs(shard), key);
+  };
+
+  OpStatus res = tx->ScheduleSingleHop(std::move(cb));
+  if (res == OpStatus::KEY_EXISTS) {
+    return builder->SendError("item exists");
+  }
+  return builder->SendError(res);
+}
+
+void BloomFamily::CfAdd(CmdArgList args, Transaction* tx, SinkReplyBuilder* builder) {
+  CfAddGeneric(args, tx, builder, false);
+}
+
+void BloomFamily::CfAddNx(CmdArgList args, Transaction* tx, SinkReplyBuilder* builder) {
+  CfAddGeneric(args, tx, builder, true);
+}
+
+void BloomFamily::CfDel(CmdArgList args, Transaction* tx, SinkReplyBuilder* builder) {
+  string_view key = ArgS(args, 0);
+  string_view item = ArgS(args, 1);
+
+  const auto cb = [&](Transaction* t, EngineShard* shard) {
+    return OpCfDel(t->GetOpArgs(shard), key, item);
+  };
+
+  OpResult res = tx->ScheduleSingleHopT(std::move(cb));
+  if (res)
+    return builder->SendLong(*res);
+  return builder->SendError(res.status());
+}
+
+void BloomFamily::CfExists(CmdArgList args, Transaction* tx, SinkReplyBuilder* builder) {
+  CfQueryGeneric(args, tx, builder, true, false);
+}
+
+void BloomFamily::CfMExists(CmdArgList args, Transaction* tx, SinkReplyBuilder* builder) {
+  CfQueryGeneric(args, tx, builder, true, true);
+}
+
+void BloomFamily::CfCount(CmdArgList args, Transaction* tx, SinkReplyBuilder* builder) {
+  CfQueryGeneric(args, tx, builder, false, false);
+}
+
 using CI = CommandId;
 
 #define HFUNC(x) SetHandler(&BloomFamily::x)
@@ -199,7 +386,16 @@ void BloomFamily::Register(CommandRegistry* registry) {
             << CI{"BF.ADD", CO::WRITE | CO::DENYOOM | CO::FAST, 3, 1, 1, acl::BLOOM}.HFUNC(Add)
             << CI{"BF.MADD", CO::WRITE | CO::DENYOOM | CO::FAST, -3, 1, 1, acl::BLOOM}.HFUNC(MAdd)
             << CI{"BF.EXISTS", CO::READONLY | CO::FAST, 3, 1, 1, acl::BLOOM}.HFUNC(Exists)
-            << CI{"BF.MEXISTS", CO::READONLY | CO::FAST, -3, 1, 1, acl::BLOOM}.HFUNC(MExists);
+            << CI{"BF.MEXISTS", CO::READONLY | CO::FAST, -3, 1, 1, acl::BLOOM}.HFUNC(MExists)
+            << CI{"CF.RESERVE", CO::WRITE | CO::DENYOOM | CO::FAST, -3, 1, 1, acl::BLOOM}.HFUNC(
+                   CfReserve)
+            << CI{"CF.ADD", CO::WRITE | CO::DENYOOM | CO::FAST, 3, 1, 1, acl::BLOOM}.HFUNC(CfAdd)
+            << CI{"CF.ADDNX", CO::WRITE | CO::DENYOOM | CO::FAST, 3, 1, 1, acl::BLOOM}.HFUNC(
+                   CfAddNx)
+            << CI{"CF.DEL", CO::WRITE | CO::FAST, 3, 1, 1, acl::BLOOM}.HFUNC(CfDel)
+            << CI{"CF.EXISTS", CO::READONLY | CO::FAST, 3, 1, 1, acl::BLOOM}.HFUNC(CfExists)
+            << CI{"CF.MEXISTS", CO::READONLY | CO::FAST, -3, 1, 1, acl::BLOOM}.HFUNC(CfMExists)
+            << CI{"CF.COUNT", CO::READONLY | CO::FAST, 3, 1, 1, acl::BLOOM}.HFUNC(CfCount);
 };
 
 }  // namespace dfly
@@ -27,6 +27,14 @@ class BloomFamily {
   static void MAdd(CmdArgList args, Transaction* tx, SinkReplyBuilder* builder);
   static void Exists(CmdArgList args, Transaction* tx, SinkReplyBuilder* builder);
   static void MExists(CmdArgList args, Transaction* tx, SinkReplyBuilder* builder);
+
+  static void CfReserve(CmdArgList args, Transaction* tx, SinkReplyBuilder* builder);
+  static void CfAdd(CmdArgList args, Transaction* tx, SinkReplyBuilder* builder);
+  static void CfAddNx(CmdArgList args, Transaction* tx, SinkReplyBuilder* builder);
+  static void CfDel(CmdArgList args, Transaction* tx, SinkReplyBuilder* builder);
+  static void CfExists(CmdArgList args, Transaction* tx, SinkReplyBuilder* builder);
+  static void CfMExists(CmdArgList args, Transaction* tx, SinkReplyBuilder* builder);
+  static void CfCount(CmdArgList args, Transaction* tx, SinkReplyBuilder* builder);
 };
 
 }  // namespace dfly
@@ -4,6 +4,8 @@
 
 #include "server/bloom_family.h"
 
+#include <absl/strings/str_cat.h>
+
 #include "facade/facade_test.h"
 #include "server/test_utils.h"
 
@@ -51,4 +53,79 @@ TEST_F(BloomFamilyTest, Multiple) {
   EXPECT_THAT(resp, RespArray(ElementsAre(IntArg(1), IntArg(1), IntArg(1))));
 }
 
+TEST_F(BloomFamilyTest, Blocked) {
+  EXPECT_EQ(Run({"bf.reserve", "b1", "0.01", "1000", "BLOCKED"}), "OK");
+  EXPECT_EQ(Run({"bf.reserve", "b2", "0.01", "1000", "EXPANSION", "2", "BLOCKED"}), "OK");
+  EXPECT_EQ(Run({"bf.reserve", "b3", "0.01", "1000", "NONSCALING"}), "OK");
+
+  std::vector<std::string> cmd = {"bf.madd", "b1"};
+  for (unsigned i = 0; i < 100; ++i) {
+    cmd.push_back(absl::StrCat("item", i));
+  }
+  auto resp = Run(absl::MakeSpan(cmd));
+  ASSERT_THAT(resp, ArrLen(100));
+  for (const auto& val : resp.GetVec()) {
+    EXPECT_THAT(val, IntArg(1));
+  }
+
+  cmd[0] = "bf.mexists";
+  resp = Run(absl::MakeSpan(cmd));
+  ASSERT_THAT(resp, ArrLen(100));
+  for (const auto& val : resp.GetVec()) {
+    EXPECT_THAT(val, IntArg(1));
+  }
+  EXPECT_THAT(Run({"bf.add", "b1", "item0"}), IntArg(0));
+  EXPECT_THAT(Run({"bf.exists", "b1", "foo"}), IntArg(0));
+}
+
+TEST_F(BloomFamilyTest, Cuckoo) {
+  EXPECT_EQ(Run({"cf.reserve", "c1", "100", "MAXITERATIONS", "10", "EXPANSION", "2"}), "OK");
+  EXPECT_EQ(Run({"type", "c1"}), "MBbloomCF");
+  EXPECT_THAT(Run({"cf.reserve", "c1", "100"}), ErrArg("item exists"));
+  EXPECT_THAT(Run({"cf.reserve", "c2", "0"}), ErrArg("out of range"));
+  EXPECT_THAT(Run({"cf.reserve", "c2", "100", "BUCKETS"}), ErrArg("syntax error"));
+
+  EXPECT_THAT(Run({"cf.add", "c1", "a"}), IntArg(1));
+  EXPECT_THAT(Run({"cf.add", "c1", "a"}), IntArg(1));
+  EXPECT_THAT(Run({"cf.addnx", "c1", "a"}), IntArg(0));
+  EXPECT_THAT(Run({"cf.addnx", "c1", "b"}), IntArg(1));
+  EXPECT_THAT(Run({"cf.count", "c1", "a"}), IntArg(2));
+
+  EXPECT_THAT(Run({"cf.del", "c1", "a"}), IntArg(1));
+  EXPECT_THAT(Run({"cf.exists", "c1", "a"}), IntArg(1));
+  EXPECT_THAT(Run({"cf.del", "c1", "a"}), IntArg(1));
+  EXPECT_THAT(Run({"cf.del", "c1", "a"}), IntArg(0));
+  auto resp = Run({"cf.mexists", "c1", "a", "b", "c"});
+  EXPECT_THAT(resp, RespArray(ElementsAre(IntArg(0), IntArg(1), IntArg(0))));
+
+  // Non existing keys behave as empty filters, except for deletions.
+  EXPECT_THAT(Run({"cf.exists", "c3", "a"}), IntArg(0));
+  EXPECT_THAT(Run({"cf.count", "c3", "a"}), IntArg(0));
+  EXPECT_THAT(Run({"cf.del", "c3", "a"}), ErrArg("no such key"));
+  EXPECT_THAT(Run({"cf.addnx", "c3", "a"}), IntArg(1));
+  EXPECT_EQ(Run({"type", "c3"}), "MBbloomCF");
+
+  Run({"set", "str", "foo"});
+  EXPECT_THAT(Run({"cf.add", "str", "a"}), ErrArg("WRONGTYPE"));
+  EXPECT_THAT(Run({"cf.exists", "str", "a"}), ErrArg("WRONGTYPE"));
+  EXPECT_THAT(Run({"bf.add", "c1", "a"}), ErrArg("WRONGTYPE"));
+}
+
+TEST_F(BloomFamilyTest, CuckooFull) {
+  // A single bucket can hold 4 copies of the same item.
+  Run({"cf.reserve", "c1", "4", "EXPANSION", "0"});
+  for (unsigned i = 0; i < 4; ++i) {
+    EXPECT_THAT(Run({"cf.add", "c1", "a"}), IntArg(1));
+  }
+  EXPECT_THAT(Run({"cf.add", "c1", "a"}), ErrArg("filter is full"));
+  EXPECT_THAT(Run({"cf.count", "c1", "a"}), IntArg(4));
+
+  // With expansion enabled, a new table is added instead.
+  Run({"cf.reserve", "c2", "4", "EXPANSION", "1"});
+  for (unsigned i = 0; i < 10; ++i) {
+    EXPECT_THAT(Run({"cf.add", "c2", "a"}), IntArg(1));
+  }
+  EXPECT_THAT(Run({"cf.count", "c2", "a"}), IntArg(10));
+}
+
 }  // namespace dfly
@@ -329,7 +329,7 @@ string_view LpGetView(uint8_t* lp_it, uint8_t int_buf[]) {
 OpResult<string> RunCbOnFirstNonEmptyBlocking(Transaction* trans, int req_obj_type,
                                               BlockingResultCb func, unsigned limit_ms,
                                               bool* block_flag, bool* pause_flag,
-                                              std::string* info) {
+                                              std::string* info, BlockingHandOff* handoff) {
   string result_key;
 
   // Fast path. If we have only a single shard, we can run opportunistically with a single hop.
@@ -393,7 +393,8 @@ OpResult<string> RunCbOnFirstNonEmptyBlocking(Transaction* trans, int req_obj_ty
     return ns->GetDbSlice(owner->shard_id()).FindReadOnly(context, key, req_obj_type).ok();
   };
 
-  auto status = trans->WaitOnWatch(limit_tp, std::move(wcb), key_checker, block_flag, pause_flag);
+  auto status =
+      trans->WaitOnWatch(limit_tp, std::move(wcb), key_checker, block_flag, pause_flag, handoff);
 
   if (status != OpStatus::OK)
     return status;
@@ -90,10 +90,13 @@ using BlockingResultCb =
 // Block until a any key of the transaction becomes non-empty and executes the callback.
 // If multiple keys are non-empty when this function is called, the callback is executed
 // immediately with the first key listed in the tx arguments.
+// If handoff is set, the transaction accepts values handed off by pushers while blocked; the
+// callback must consume handoff->value when it is present instead of reading the key.
 OpResult<std::string> RunCbOnFirstNonEmptyBlocking(Transaction* trans, int req_obj_type,
                                                    BlockingResultCb cb, unsigned limit_ms,
                                                    bool* block_flag, bool* pause_flag,
-                                                   std::string* info = nullptr);
+                                                   std::string* info = nullptr,
+                                                   BlockingHandOff* handoff = nullptr);
 
 };  // namespace container_utils
 
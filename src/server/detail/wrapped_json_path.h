@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include <memory>
 #include <string_view>
 #include <utility>
 #include <variant>
@@ -165,6 +166,13 @@ class WrappedJsonPath {
   static constexpr std::string_view kV2PathRootElement = "$";
 
   WrappedJsonPath(json::Path json_path, StringOrView path, JsonPathType path_type)
+      : WrappedJsonPath(std::make_shared<const json::Path>(std::move(json_path)), std::move(path),
+                        path_type) {
+  }
+
+  // Shares an already parsed path, e.g. one taken from the path cache.
+  WrappedJsonPath(std::shared_ptr<const json::Path> json_path, StringOrView path,
+                  JsonPathType path_type)
       : parsed_path_(std::move(json_path)), path_(std::move(path)), path_type_(path_type) {
   }
 
@@ -201,17 +209,7 @@ class WrappedJsonPath {
                                                         JsonPathMutateCallback<T> cb,
                                                         CallbackResultOptions options) const {
     JsonCallbackResult<std::optional<T>> mutate_result{InitializePathType(options)};
-
-    auto mutate_callback = [&cb, &mutate_result](std::optional<std::string_view> path,
-                                                 JsonType* val) -> bool {
-      auto res = cb(path, val);
-      if (res.value.has_value()) {
-        mutate_result.AddValue(std::move(res.value).value());
-      } else if (!mutate_result.IsV1()) {
-        mutate_result.AddValue(std::nullopt);
-      }
-      return res.should_be_deleted;
-    };
+    auto mutate_callback = MakeMutateCallback(cb, &mutate_result);
 
     if (HoldsJsonPath()) {
       const auto& json_path = AsJsonPath();
@@ -248,6 +246,28 @@ class WrappedJsonPath {
     return mutate_result;
   }
 
+  // Same as above for flat json. The mutated json is written into `fbb`, unless the mutation
+  // was applied to the buffer of `json_entry` in place, see json::MutatePath.
+  template <typename T>
+  OpResult<JsonCallbackResult<std::optional<T>>> Mutate(FlatJson json_entry,
+                                                        flexbuffers::Builder* fbb,
+                                                        JsonPathMutateCallback<T> cb,
+                                                        CallbackResultOptions options) const {
+    if (!HoldsJsonPath()) {
+      JsonType json = json::FromFlat(json_entry);
+      auto res = Mutate(&json, cb, options);
+      if (res) {
+        json::FromJsonType(json, fbb);
+        fbb->Finish();
+      }
+      return res;
+    }
+
+    JsonCallbackResult<std::optional<T>> mutate_result{InitializePathType(options)};
+    json::MutatePath(AsJsonPath(), MakeMutateCallback(cb, &mutate_result), json_entry, fbb);
+    return mutate_result;
+  }
+
   bool IsLegacyModePath() const {
     return path_type_ == JsonPathType::kLegacy;
   }
@@ -258,11 +278,11 @@ class WrappedJsonPath {
   }
 
   bool HoldsJsonPath() const {
-    return std::holds_alternative<json::Path>(parsed_path_);
+    return std::holds_alternative<std::shared_ptr<const json::Path>>(parsed_path_);
   }
 
   const json::Path& AsJsonPath() const {
-    return std::get<json::Path>(parsed_path_);
+    return *std::get<std::shared_ptr<const json::Path>>(parsed_path_);
   }
 
   const JsonExpression& AsJsonExpression() const {
@@ -270,6 +290,21 @@ class WrappedJsonPath {
   }
 
  private:
+  // Adapts `cb` to json::MutateCallback, collecting its values into `mutate_result`.
+  template <typename T>
+  static auto MakeMutateCallback(JsonPathMutateCallback<T> cb,
+                                 JsonCallbackResult<std::optional<T>>* mutate_result) {
+    return [cb, mutate_result](std::optional<std::string_view> path, JsonType* val) -> bool {
+      auto res = cb(path, val);
+      if (res.value.has_value()) {
+        mutate_result->AddValue(std::move(res.value).value());
+      } else if (!mutate_result->IsV1()) {
+        mutate_result->AddValue(std::nullopt);
+      }
+      return res.should_be_deleted;
+    };
+  }
+
   CallbackResultOptions InitializePathType(CallbackResultOptions options) const {
     if (!options.path_type) {
       options.path_type = path_type_;
@@ -278,7 +313,7 @@ class WrappedJsonPath {
   }
 
  private:
-  std::variant<json::Path, JsonExpression> parsed_path_;
+  std::variant<std::shared_ptr<const json::Path>, JsonExpression> parsed_path_;
   StringOrView path_;
   JsonPathType path_type_ = kDefaultJsonPathType;
 };
@@ -88,6 +88,10 @@ void CmdSerializer::SerializeEntry(string_view key, const PrimeValue& pk, const
       case OBJ_STREAM:
       case OBJ_JSON:
       case OBJ_SBF:
+      case OBJ_CMS:
+      case OBJ_TOPK:
+      case OBJ_CF:
+      case OBJ_TDIGEST:
       default:
         // These types are unsupported wrt splitting huge values to multiple commands, so we send
         // them as a RESTORE command.
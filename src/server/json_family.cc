@@ -22,6 +22,7 @@
 #include "core/json/json_object.h"
 #include "core/json/path.h"
 #include "core/mi_memory_resource.h"
+#include "core/string_lru_cache.h"
 #include "facade/cmd_arg_parser.h"
 #include "facade/op_status.h"
 #include "server/acl/acl_commands_def.h"
@@ -32,6 +33,7 @@
 #include "server/error.h"
 #include "server/journal/journal.h"
 #include "server/search/doc_index.h"
+#include "server/server_state.h"
 #include "server/string_family.h"
 #include "server/tiered_storage.h"
 #include "server/transaction.h"
@@ -39,6 +41,8 @@
 ABSL_FLAG(bool, jsonpathv2, true,
           "If true uses Dragonfly jsonpath implementation, "
           "otherwise uses legacy jsoncons implementation.");
+ABSL_FLAG(uint32_t, json_path_cache_size, 256,
+          "Maximal number of parsed json paths cached per thread. 0 disables the cache.");
 
 namespace dfly {
 
@@ -62,6 +66,11 @@ class JsonMemTracker {
   }
 
   void SetJsonSize(PrimeValue& pv, bool is_op_set) {
+    // The size of flat json is the length of its buffer.
+    if (JsonEnconding() == kEncodingJsonFlat) {
+      return;
+    }
+
     const size_t current = static_cast<MiMemoryResource*>(CompactObj::memory_resource())->used();
     int64_t diff = static_cast<int64_t>(current) - static_cast<int64_t>(start_size_);
     // If the diff is 0 it means the object use the same memory as before. No action needed.
@@ -83,8 +92,46 @@ class JsonMemTracker {
   size_t start_size_{0};
 };
 
+// Counts the net number of bytes allocated through it. Used to measure json values.
+class CountingMemoryResource : public PMR_NS::memory_resource {
+ public:
+  size_t used() const {
+    return used_;
+  }
+
+ private:
+  void* do_allocate(size_t bytes, size_t alignment) final {
+    used_ += bytes;
+    return upstream_->allocate(bytes, alignment);
+  }
+
+  void do_deallocate(void* ptr, size_t bytes, size_t alignment) final {
+    used_ -= bytes;
+    upstream_->deallocate(ptr, bytes, alignment);
+  }
+
+  bool do_is_equal(const PMR_NS::memory_resource& other) const noexcept final {
+    return this == &other;
+  }
+
+  PMR_NS::memory_resource* upstream_ = PMR_NS::get_default_resource();
+  size_t used_ = 0;
+};
+
+// Returns the number of bytes occupied by a json value: its node and everything it allocates.
+size_t JsonMemoryUsage(const JsonType& val) {
+  CountingMemoryResource mr;
+  JsonType copy(val, JsonType::allocator_type{&mr});
+  return sizeof(JsonType) + mr.used();
+}
+
 template <typename T> using ParseResult = io::Result<T, std::string>;
 
+// Per-thread cache of parsed json paths, keyed by the path string. Clients tend to query
+// the same few paths over and over, so this saves parsing them for every command.
+thread_local StringLruCache<std::shared_ptr<const json::Path>> tl_json_path_cache{
+    &FLAGS_json_path_cache_size};
+
 ParseResult<JsonExpression> ParseJsonPathAsExpression(std::string_view path) {
   std::error_code ec;
   JsonExpression res = MakeJsonPathExpr(path, ec);
@@ -95,12 +142,28 @@ ParseResult<JsonExpression> ParseJsonPathAsExpression(std::string_view path) {
 
 ParseResult<WrappedJsonPath> ParseJsonPath(StringOrView path, JsonPathType path_type) {
   if (absl::GetFlag(FLAGS_jsonpathv2)) {
-    auto path_result = json::ParsePath(path.view());
-    if (!path_result) {
-      VLOG(1) << "Invalid Json path: " << path << ' ' << path_result.error() << std::endl;
-      return nonstd::make_unexpected(kSyntaxErr);
+    const bool use_cache = tl_json_path_cache.capacity() > 0;
+    std::shared_ptr<const json::Path> parsed;
+    if (use_cache) {
+      auto& stats = ServerState::tlocal()->stats;
+      parsed = tl_json_path_cache.Get(path.view(), &stats.json_path_cache_hits,
+                                      &stats.json_path_cache_misses);
+    }
+
+    if (!parsed) {
+      auto path_result = json::ParsePath(path.view());
+      if (!path_result) {
+        VLOG(1) << "Invalid Json path: " << path << ' ' << path_result.error() << std::endl;
+        return nonstd::make_unexpected(kSyntaxErr);
+      }
+      parsed = std::make_shared<const json::Path>(std::move(path_result).value());
+
+      // Aggregation functions accumulate their state inside the path, so they can not be shared.
+      bool has_function = !parsed->empty() && parsed->front().type() == json::SegmentType::FUNCTION;
+      if (use_cache && !has_function)
+        tl_json_path_cache.Put(std::string(path.view()), parsed);
     }
-    return WrappedJsonPath{std::move(path_result).value(), std::move(path), path_type};
+    return WrappedJsonPath{std::move(parsed), std::move(path), path_type};
   }
 
   auto expr_result = ParseJsonPathAsExpression(path.view());
@@ -319,7 +382,32 @@ bool JsonAreEquals(const JsonType& lhs, const JsonType& rhs) {
   }
 }
 
-OpResult<DbSlice::AddOrFindResult> SetJson(const OpArgs& op_args, string_view key, JsonType value) {
+// JSON value parsed on the coordinator thread, before the shard hop, so that large payloads
+// do not block the shard's transaction queue. `value` is allocated with the default memory
+// resource and must be copied into the shard's memory resource before it is stored.
+struct ParsedJson {
+  JsonType value;
+
+  // Flexbuffer encoding of `value`. Prebuilt only when the value replaces a whole key and
+  // the flat encoding is used.
+  std::vector<uint8_t> flat;
+};
+
+// Share keys and the key vectors of objects with the same fields, so that arrays of similar
+// objects store each field name once. String values are not shared, since they may be
+// patched in place.
+constexpr auto kFlatJsonBuilderFlags = static_cast<flexbuffers::BuilderFlag>(
+    flexbuffers::BUILDER_FLAG_SHARE_KEYS | flexbuffers::BUILDER_FLAG_SHARE_KEY_VECTORS);
+
+std::vector<uint8_t> ToFlatJson(const JsonType& value) {
+  flexbuffers::Builder fbb(256, kFlatJsonBuilderFlags);
+  json::FromJsonType(value, &fbb);
+  fbb.Finish();
+  return fbb.GetBuffer();
+}
+
+OpResult<DbSlice::AddOrFindResult> SetJson(const OpArgs& op_args, string_view key,
+                                           const ParsedJson& parsed) {
   auto& db_slice = op_args.GetDbSlice();
 
   auto op_res = db_slice.AddOrFind(op_args.db_cntx, key);
@@ -330,13 +418,15 @@ OpResult<DbSlice::AddOrFindResult> SetJson(const OpArgs& op_args, string_view ke
   op_args.shard->search_indices()->RemoveDoc(key, op_args.db_cntx, res.it->second);
 
   if (JsonEnconding() == kEncodingJsonFlat) {
-    flexbuffers::Builder fbb;
-    json::FromJsonType(value, &fbb);
-    fbb.Finish();
-    const auto& buf = fbb.GetBuffer();
-    res.it->second.SetJson(buf.data(), buf.size());
+    if (parsed.flat.empty()) {
+      std::vector<uint8_t> buf = ToFlatJson(parsed.value);
+      res.it->second.SetJson(buf.data(), buf.size());
+    } else {
+      res.it->second.SetJson(parsed.flat.data(), parsed.flat.size());
+    }
   } else {
-    res.it->second.SetJson(std::move(value));
+    res.it->second.SetJson(
+        JsonType(parsed.value, JsonType::allocator_type{CompactObj::memory_resource()}));
   }
   op_args.shard->search_indices()->AddDoc(key, op_args.db_cntx, res.it->second);
   return std::move(res);
@@ -388,9 +478,20 @@ std::optional<JsonType> JsonFromString(std::string_view input) {
   return dfly::JsonFromString(input, PMR_NS::get_default_resource());
 }
 
-// Use this method on the shard thread
-std::optional<JsonType> ShardJsonFromString(std::string_view input) {
-  return dfly::JsonFromString(input, CompactObj::memory_resource());
+// Use this method on the coordinator thread. Set `replaces_key` when the value is going to
+// replace a whole key, so that its flat encoding is built here as well.
+std::optional<ParsedJson> ParseJson(std::string_view input, bool replaces_key) {
+  std::optional<JsonType> value = JsonFromString(input);
+  if (!value) {
+    VLOG(1) << "got invalid JSON string '" << input << "' cannot be saved";
+    return std::nullopt;
+  }
+
+  ParsedJson res{std::move(*value), {}};
+  if (replaces_key && JsonEnconding() == kEncodingJsonFlat) {
+    res.flat = ToFlatJson(res.value);
+  }
+  return res;
 }
 
 OpResult<JsonType*> GetJson(const OpArgs& op_args, string_view key) {
@@ -610,6 +711,53 @@ struct MutateOperationOptions {
   CallbackResultOptions cb_result_options = CallbackResultOptions::DefaultMutateOptions();
 };
 
+template <typename T>
+OpResult<JsonCallbackResult<optional<T>>> MutateJsonCons(const WrappedJsonPath& json_path,
+                                                         JsonPathMutateCallback<T> cb,
+                                                         const MutateOperationOptions& options,
+                                                         PrimeValue* pv) {
+  JsonType* json_val = pv->GetJson();
+  DCHECK(json_val) << "should have a valid JSON object, the type for it is '" << pv->ObjType()
+                   << "'";
+
+  auto mutate_res = json_path.Mutate(json_val, cb, options.cb_result_options);
+
+  // Make sure that we don't have other internal issue with the operation
+  if (mutate_res && options.verify_op) {
+    options.verify_op(*json_val);
+  }
+  return mutate_res;
+}
+
+// Scalars addressed by a direct path are patched in the stored buffer, e.g. by JSON.NUMINCRBY or
+// JSON.TOGGLE. Otherwise the mutated json is encoded again and replaces the buffer.
+template <typename T>
+OpResult<JsonCallbackResult<optional<T>>> MutateFlatJson(const WrappedJsonPath& json_path,
+                                                         JsonPathMutateCallback<T> cb,
+                                                         const MutateOperationOptions& options,
+                                                         PrimeValue* pv) {
+  auto [buf, len] = pv->GetJsonFlat();
+  DCHECK(buf) << "should have a valid JSON object, the type for it is '" << pv->ObjType() << "'";
+
+  flexbuffers::Builder fbb(256, kFlatJsonBuilderFlags);
+  auto mutate_res =
+      json_path.Mutate(flexbuffers::GetRoot(buf, len), &fbb, cb, options.cb_result_options);
+  if (fbb.GetSize() > 0) {
+    pv->SetJson(fbb.GetBuffer().data(), fbb.GetSize());
+  }
+
+  // The verify op may change the json, e.g. JSON.SET adds a missing path, so it is encoded again.
+  if (mutate_res && options.verify_op) {
+    std::tie(buf, len) = pv->GetJsonFlat();
+    JsonType json_val = json::FromFlat(flexbuffers::GetRoot(buf, len));
+    options.verify_op(json_val);
+
+    std::vector<uint8_t> flat = ToFlatJson(json_val);
+    pv->SetJson(flat.data(), flat.size());
+  }
+  return mutate_res;
+}
+
 template <typename T>
 OpResult<JsonCallbackResult<optional<T>>> JsonMutateOperation(const OpArgs& op_args,
                                                               std::string_view key,
@@ -623,18 +771,11 @@ OpResult<JsonCallbackResult<optional<T>>> JsonMutateOperation(const OpArgs& op_a
 
   PrimeValue& pv = it_res->it->second;
 
-  JsonType* json_val = pv.GetJson();
-  DCHECK(json_val) << "should have a valid JSON object for key '" << key << "' the type for it is '"
-                   << pv.ObjType() << "'";
-
   op_args.shard->search_indices()->RemoveDoc(key, op_args.db_cntx, pv);
 
-  auto mutate_res = json_path.Mutate(json_val, cb, options.cb_result_options);
-
-  // Make sure that we don't have other internal issue with the operation
-  if (mutate_res && options.verify_op) {
-    options.verify_op(*json_val);
-  }
+  auto mutate_res = JsonEnconding() == kEncodingJsonFlat
+                        ? MutateFlatJson(json_path, cb, options, &pv)
+                        : MutateJsonCons(json_path, cb, options, &pv);
 
   // we need to manually run this before the PostUpdater run
   mem_tracker.SetJsonSize(pv, false);
@@ -684,12 +825,41 @@ OpResult<std::string> OpJsonGet(const OpArgs& op_args, string_view key,
     options.after_key_chars(params.space.value());
   }
 
-  auto cb = [](std::string_view, const JsonType& val) { return val; };
-
   const bool legacy_mode_is_enabled = LegacyModeIsEnabled(paths);
   CallbackResultOptions cb_options = CallbackResultOptions::DefaultEvaluateOptions();
   cb_options.path_type = legacy_mode_is_enabled ? JsonPathType::kLegacy : JsonPathType::kV2;
 
+  // Without formatting options the matches of a single path are serialized straight into the
+  // reply string, instead of copying them into an intermediate json document first.
+  if (paths.size() == 1 && !params.indent && !params.new_line && !params.space) {
+    std::string res;
+    bool matched = false;
+    auto serialize_cb = [&](std::string_view, const JsonType& val) {
+      if (legacy_mode_is_enabled) {
+        res.clear();  // legacy paths reply with the last match only
+      } else {
+        res.push_back(matched ? ',' : '[');
+      }
+      matched = true;
+      val.dump(res, options, jsoncons::indenting::indent);
+      return Nothing{};
+    };
+    paths[0].second.Evaluate<Nothing>(&json_entry, serialize_cb, cb_options);
+
+    if (legacy_mode_is_enabled) {
+      if (!matched)
+        return OpStatus::INVALID_JSON_PATH;
+      return res;
+    }
+
+    if (!matched)
+      res.push_back('[');
+    res.push_back(']');
+    return res;
+  }
+
+  auto cb = [](std::string_view, const JsonType& val) { return val; };
+
   auto eval_wrapped = [&](const WrappedJsonPath& json_path) -> std::optional<JsonType> {
     auto eval_result = json_path.Evaluate<JsonType>(&json_entry, cb, cb_options);
 
@@ -722,10 +892,9 @@ OpResult<std::string> OpJsonGet(const OpArgs& op_args, string_view key,
     }
   }
 
-  jsoncons::json_printable jp(out, options, jsoncons::indenting::indent);
-  std::stringstream ss;
-  jp.dump(ss);
-  return ss.str();
+  std::string res;
+  out.dump(res, options, jsoncons::indenting::indent);
+  return res;
 }
 
 auto OpType(const OpArgs& op_args, string_view key, const WrappedJsonPath& json_path) {
@@ -1270,6 +1439,14 @@ auto OpFields(const OpArgs& op_args, string_view key, const WrappedJsonPath& jso
   return JsonEvaluateOperation<std::optional<std::size_t>>(op_args, key, json_path, std::move(cb));
 }
 
+// Returns numeric vector that represents the memory usage of JSON value at each path.
+auto OpMemory(const OpArgs& op_args, string_view key, const WrappedJsonPath& json_path) {
+  auto cb = [](const string_view&, const JsonType& val) -> std::optional<std::size_t> {
+    return JsonMemoryUsage(val);
+  };
+  return JsonEvaluateOperation<std::optional<std::size_t>>(op_args, key, json_path, std::move(cb));
+}
+
 // Returns json vector that represents the result of the json query.
 auto OpResp(const OpArgs& op_args, string_view key, const WrappedJsonPath& json_path) {
   auto cb = [](const string_view&, const JsonType& val) { return val; };
@@ -1278,13 +1455,8 @@ auto OpResp(const OpArgs& op_args, string_view key, const WrappedJsonPath& json_
 
 // Returns boolean that represents the result of the operation.
 OpResult<bool> OpSet(const OpArgs& op_args, string_view key, string_view path,
-                     const WrappedJsonPath& json_path, std::string_view json_str,
+                     const WrappedJsonPath& json_path, const ParsedJson& parsed,
                      bool is_nx_condition, bool is_xx_condition) {
-  std::optional<JsonType> parsed_json = ShardJsonFromString(json_str);
-  if (!parsed_json) {
-    VLOG(1) << "got invalid JSON string '" << json_str << "' cannot be saved";
-    return OpStatus::SYNTAX_ERR;
-  }
 
   // The whole key should be replaced.
   // NOTE: unlike in Redis, we are overriding the value when the path is "$"
@@ -1303,14 +1475,10 @@ OpResult<bool> OpSet(const OpArgs& op_args, string_view key, string_view path,
       }
     }
 
+    // SetJson copies the parsed value into the shard's memory resource, so the tracker
+    // accounts exactly for the memory of the new value.
     JsonMemTracker mem_tracker;
-    // We need to deep copy parsed_json.value() and not use move! The reason is that otherwise
-    // it's really difficult to properly track memory deltas because even if we move below,
-    // the deallocation of parsed_json won't happen in the scope of SetJson but in the scope
-    // of this function. Because of this, the memory tracking will be off. Another solution here,
-    // is to use absl::Cleanup and dispatch another Find() but that's too complicated because then
-    // you need to take into account the order of destructors.
-    OpResult<DbSlice::AddOrFindResult> st = SetJson(op_args, key, parsed_json.value());
+    OpResult<DbSlice::AddOrFindResult> st = SetJson(op_args, key, parsed);
     if (st.status() != OpStatus::OK) {
       return st.status();
     }
@@ -1325,7 +1493,9 @@ OpResult<bool> OpSet(const OpArgs& op_args, string_view key, string_view path,
   // then the assign here is called N times, where N == array.size().
   bool path_exists = false;
   bool operation_result = false;
-  const JsonType& new_json = parsed_json.value();
+  // Assigning a value of another storage kind may take over its allocator, so the parsed value
+  // is copied into the shard's memory resource once, both for assignment and insertion.
+  const JsonType new_json(parsed.value, JsonType::allocator_type{CompactObj::memory_resource()});
   auto cb = [&](std::optional<std::string_view>, JsonType* val) -> MutateCallbackResult<> {
     path_exists = true;
     if (!is_nx_condition) {
@@ -1362,9 +1532,8 @@ OpResult<bool> OpSet(const OpArgs& op_args, string_view key, string_view path,
     return OpStatus::OK;
   };
 
-  // JsonMutateOperation uses it's own JsonMemTracker. It will work, because updates to already
-  // existing json keys use copy assign, so we don't really need to account for the memory
-  // allocated by ShardJsonFromString above since it's not being moved here at all.
+  // JsonMutateOperation uses it's own JsonMemTracker. It will work, because new_json lives
+  // across the whole operation, so the tracker accounts only for its copies in the document.
   auto res = JsonMutateOperation<Nothing>(op_args, key, json_path, std::move(cb),
                                           MutateOperationOptions{std::move(inserter)});
   RETURN_ON_BAD_STATUS(res);
@@ -1378,7 +1547,11 @@ OpResult<bool> OpSet(const OpArgs& op_args, string_view key, string_view path,
   if (!res_json_path) {
     return OpStatus::SYNTAX_ERR;  // TODO(Return initial error)
   }
-  return OpSet(op_args, key, path, res_json_path.value(), json_str, is_nx_condition,
+  std::optional<ParsedJson> parsed = ParseJson(json_str, res_json_path->RefersToRootElement());
+  if (!parsed) {
+    return OpStatus::SYNTAX_ERR;
+  }
+  return OpSet(op_args, key, path, res_json_path.value(), *parsed, is_nx_condition,
                is_xx_condition);
 }
 
@@ -1419,12 +1592,11 @@ OpStatus OpMSet(const OpArgs& op_args, const ShardArgs& args) {
 // Note that currently OpMerge works only with jsoncons and json::Path support has not been
 // implemented yet.
 OpStatus OpMerge(const OpArgs& op_args, string_view key, string_view path,
-                 const WrappedJsonPath& json_path, std::string_view json_str) {
-  std::optional<JsonType> parsed_json = ShardJsonFromString(json_str);
-  if (!parsed_json) {
-    VLOG(1) << "got invalid JSON string '" << json_str << "' cannot be saved";
-    return OpStatus::SYNTAX_ERR;
-  }
+                 const WrappedJsonPath& json_path, const ParsedJson& parsed) {
+  // apply_merge_patch copies patch values into the document and the copies may inherit the
+  // allocator of the patch, so it is built in the shard's memory resource to keep them on the
+  // shard heap. Copying the parsed value is still much cheaper than parsing it here.
+  const JsonType patch(parsed.value, JsonType::allocator_type{CompactObj::memory_resource()});
 
   auto cb = [&](std::optional<std::string_view> cur_path, JsonType* val) -> MutateCallbackResult<> {
     string_view strpath = cur_path ? *cur_path : string_view{};
@@ -1432,10 +1604,10 @@ OpStatus OpMerge(const OpArgs& op_args, string_view key, string_view path,
     DVLOG(2) << "Handling " << strpath << " " << val->to_string();
     // https://datatracker.ietf.org/doc/html/rfc7386#section-2
     try {
-      mergepatch::apply_merge_patch(*val, *parsed_json);
+      mergepatch::apply_merge_patch(*val, patch);
     } catch (const std::exception& e) {
       LOG_EVERY_T(ERROR, 1) << "Exception in OpMerge: " << e.what() << " with obj: " << *val
-                            << " and patch: " << *parsed_json << ", path: " << strpath;
+                            << " and patch: " << patch << ", path: " << strpath;
     }
 
     return {};
@@ -1447,7 +1619,7 @@ OpStatus OpMerge(const OpArgs& op_args, string_view key, string_view path,
     return res.status();
 
   if (json_path.RefersToRootElement()) {
-    return OpSet(op_args, key, path, json_path, json_str, false, false).status();
+    return OpSet(op_args, key, path, json_path, parsed, false, false).status();
   }
   return OpStatus::SYNTAX_ERR;
 }
@@ -1466,8 +1638,13 @@ void JsonFamily::Set(CmdArgList args, Transaction* tx, SinkReplyBuilder* builder
   if (parser.Error() || parser.HasNext())  // also clear the parser error dcheck
     return builder->SendError(kSyntaxErr);
 
+  // Parse before scheduling, so that the shard callback only installs the value.
+  std::optional<ParsedJson> parsed = ParseJson(json_str, json_path.RefersToRootElement());
+  if (!parsed)
+    return builder->SendError(kSyntaxErr);
+
   auto cb = [&](Transaction* t, EngineShard* shard) {
-    return OpSet(t->GetOpArgs(shard), key, path, json_path, json_str, is_nx_condition,
+    return OpSet(t->GetOpArgs(shard), key, path, json_path, *parsed, is_nx_condition,
                  is_xx_condition);
   };
 
@@ -1518,8 +1695,12 @@ void JsonFamily::Merge(CmdArgList args, Transaction* tx, SinkReplyBuilder* build
 
   WrappedJsonPath json_path = GET_OR_SEND_UNEXPECTED(ParseJsonPath(path));
 
+  std::optional<ParsedJson> parsed = ParseJson(value, false);
+  if (!parsed)
+    return builder->SendError(kSyntaxErr);
+
   auto cb = [&](Transaction* t, EngineShard* shard) {
-    return OpMerge(t->GetOpArgs(shard), key, path, json_path, value);
+    return OpMerge(t->GetOpArgs(shard), key, path, json_path, *parsed);
   };
 
   OpStatus status = tx->ScheduleSingleHop(std::move(cb));
@@ -1548,21 +1729,24 @@ void JsonFamily::Debug(CmdArgList args, Transaction* tx, SinkReplyBuilder* build
   CmdArgParser parser{args};
   string_view command = parser.Next();
 
-  // The 'MEMORY' sub-command is not supported yet, calling to operation function should be added
-  // here.
   if (absl::EqualsIgnoreCase(command, "help")) {
     auto* rb = static_cast<RedisReplyBuilder*>(builder);
-    rb->StartArray(2);
+    rb->StartArray(3);
     rb->SendBulkString(
         "JSON.DEBUG FIELDS <key> <path> - report number of fields in the JSON element.");
+    rb->SendBulkString(
+        "JSON.DEBUG MEMORY <key> <path> - report memory usage in bytes of the JSON element.");
     rb->SendBulkString("JSON.DEBUG HELP - print help message.");
     return;
-  } else if (!absl::EqualsIgnoreCase(command, "fields")) {
+  }
+
+  const bool is_memory = absl::EqualsIgnoreCase(command, "memory");
+  if (!is_memory && !absl::EqualsIgnoreCase(command, "fields")) {
     builder->SendError(facade::UnknownSubCmd(command, "JSON.DEBUG"), facade::kSyntaxErrType);
     return;
   }
 
-  // JSON.DEBUG FIELDS
+  // JSON.DEBUG FIELDS|MEMORY
 
   string_view key = parser.Next();
   string_view path = parser.NextOrDefault();
@@ -1570,6 +1754,8 @@ void JsonFamily::Debug(CmdArgList args, Transaction* tx, SinkReplyBuilder* build
   WrappedJsonPath json_path = GET_OR_SEND_UNEXPECTED(ParseJsonPath(path));
 
   auto cb = [&](Transaction* t, EngineShard* shard) {
+    if (is_memory)
+      return OpMemory(t->GetOpArgs(shard), key, json_path);
     return OpFields(t->GetOpArgs(shard), key, json_path);
   };
 
@@ -8,6 +8,7 @@
 
 #include <jsoncons/json.hpp>
 
+#include "base/flags.h"
 #include "base/gtest.h"
 #include "base/logging.h"
 #include "facade/facade_test.h"
@@ -18,12 +19,27 @@ using namespace testing;
 using namespace std;
 using namespace util;
 
+ABSL_DECLARE_FLAG(bool, experimental_flat_json);
+
 namespace dfly {
 
 class JsonFamilyTest : public BaseFamilyTest {
  protected:
 };
 
+class FlatJsonFamilyTest : public JsonFamilyTest {
+ protected:
+  void SetUp() override {
+    absl::SetFlag(&FLAGS_experimental_flat_json, true);
+    JsonFamilyTest::SetUp();
+  }
+
+  void TearDown() override {
+    JsonFamilyTest::TearDown();
+    absl::SetFlag(&FLAGS_experimental_flat_json, false);
+  }
+};
+
 MATCHER_P(ElementsAreArraysMatcher, matchers, "") {
   const auto& vec = arg.GetVec();
   const size_t expected_size = std::tuple_size<decltype(matchers)>::value;
@@ -248,6 +264,23 @@ TEST_F(JsonFamilyTest, SetGetFromPhonebook) {
       R"([st{stt"number":s"212 555-1234",stt"type":s"home"st},st{stt"number":s"646 555-4567",stt"type":s"office"st}s])");
 }
 
+TEST_F(JsonFamilyTest, GetMatchesSerialization) {
+  auto resp = Run({"JSON.SET", "json", "$", R"({"a":{"x":[1,{"y":"z"}]},"b":{"x":null}})"});
+  ASSERT_THAT(resp, "OK");
+
+  resp = Run({"JSON.GET", "json", "$..x"});
+  EXPECT_EQ(resp, R"([[1,{"y":"z"}],null])");
+
+  resp = Run({"JSON.GET", "json", "$.a.x[1]"});
+  EXPECT_EQ(resp, R"([{"y":"z"}])");
+
+  resp = Run({"JSON.GET", "json", ".a.x"});
+  EXPECT_EQ(resp, R"([1,{"y":"z"}])");
+
+  resp = Run({"JSON.GET", "json", "..x"});
+  EXPECT_EQ(resp, "null");
+}
+
 TEST_F(JsonFamilyTest, GetBrackets) {
   string json = R"(
     {"a":"first", "b":{"a":"second"}}
@@ -2602,6 +2635,35 @@ TEST_F(JsonFamilyTest, DebugFields) {
   EXPECT_THAT(resp, IntArg(1));
 }
 
+TEST_F(JsonFamilyTest, DebugMemory) {
+  string long_str(100, 'x');
+  string json = R"({"a":")" + long_str + R"(", "b":[1, 2, 3]})";
+
+  auto resp = Run({"JSON.SET", "json1", "$", json});
+  ASSERT_THAT(resp, "OK");
+
+  resp = Run({"JSON.DEBUG", "MEMORY", "json1", "$.a"});
+  ASSERT_EQ(RespExpr::INT64, resp.type);
+  const int64_t str_usage = *resp.GetInt();
+  EXPECT_GT(str_usage, 100);
+
+  resp = Run({"JSON.DEBUG", "memory", "json1", "$.*"});
+  ASSERT_THAT(resp, ArrLen(2));
+  EXPECT_EQ(str_usage, *resp.GetVec()[0].GetInt());
+  const int64_t arr_usage = *resp.GetVec()[1].GetInt();
+  EXPECT_GT(arr_usage, 0);
+
+  resp = Run({"JSON.DEBUG", "MEMORY", "json1"});
+  ASSERT_EQ(RespExpr::INT64, resp.type);
+  EXPECT_GT(*resp.GetInt(), str_usage + arr_usage);
+
+  resp = Run({"JSON.DEBUG", "MEMORY", "json1", "$.c"});
+  EXPECT_THAT(resp, ArrLen(0));
+
+  resp = Run({"JSON.DEBUG", "HELP"});
+  EXPECT_THAT(resp, ArrLen(3));
+}
+
 TEST_F(JsonFamilyTest, DebugFieldsLegacy) {
   string json = R"(
     [1, 2.3, "foo", true, null, {}, [], {"a":1, "b":2}, [1,2,3]]
@@ -2735,6 +2797,50 @@ TEST_F(JsonFamilyTest, Set) {
   EXPECT_EQ(resp, R"({"a":2,"b":8,"c":[1,2,3]})");
 }
 
+TEST_F(JsonFamilyTest, SetInvalidJson) {
+  auto resp = Run({"JSON.SET", "json", "$", R"({"a": [1, 2)"});
+  EXPECT_THAT(resp, ErrArg("syntax error"));
+  EXPECT_THAT(Run({"EXISTS", "json"}), IntArg(0));
+
+  resp = Run({"JSON.SET", "json", "$", R"({"a": {"b": [1, 2]}})"});
+  EXPECT_THAT(resp, "OK");
+
+  resp = Run({"JSON.SET", "json", "$.a.c", "{invalid"});
+  EXPECT_THAT(resp, ErrArg("syntax error"));
+
+  resp = Run({"JSON.MERGE", "json", "$", R"({"a": )"});
+  EXPECT_THAT(resp, ErrArg("syntax error"));
+
+  resp = Run({"JSON.SET", "json", "$.a.c", R"({"d": "e"})"});
+  EXPECT_THAT(resp, "OK");
+
+  resp = Run({"JSON.MERGE", "json", "$", R"({"a": {"b": null, "f": 1}})"});
+  EXPECT_THAT(resp, "OK");
+
+  resp = Run({"JSON.GET", "json"});
+  EXPECT_EQ(resp, R"({"a":{"c":{"d":"e"},"f":1}})");
+}
+
+TEST_F(JsonFamilyTest, PathCache) {
+  auto resp = Run({"JSON.SET", "json", "$", R"({"a": {"b": [1, 2, 3]}, "c": 4})"});
+  EXPECT_THAT(resp, "OK");
+
+  const uint64_t hits = GetMetrics().coordinator_stats.json_path_cache_hits;
+  for (unsigned i = 0; i < 3; ++i) {
+    resp = Run({"JSON.GET", "json", "$.a.b[1]"});
+    EXPECT_EQ(resp, "[2]");
+  }
+  EXPECT_EQ(GetMetrics().coordinator_stats.json_path_cache_hits, hits + 2);
+
+  resp = Run({"JSON.SET", "json", "$.a.b[1]", "5"});
+  EXPECT_THAT(resp, "OK");
+  resp = Run({"JSON.DEL", "json", "$.c"});
+  EXPECT_THAT(resp, IntArg(1));
+
+  resp = Run({"JSON.GET", "json"});
+  EXPECT_EQ(resp, R"({"a":{"b":[1,5,3]}})");
+}
+
 TEST_F(JsonFamilyTest, SetLegacy) {
   string json = R"(
     {"a":{"a":1, "b":2, "c":3}}
@@ -3000,4 +3106,60 @@ TEST_F(JsonFamilyTest, MergeLegacy) {
   EXPECT_EQ(resp, R"({"y":{"doubled":true},"z":{"answers":["xxx","yyy"],"doubled":false}})");
 }
 
+TEST_F(FlatJsonFamilyTest, NumIncrByToggle) {
+  auto resp = Run({"JSON.SET", "json", ".", R"({"a":1,"b":true,"c":{"d":2.5},"e":[1,2]})"});
+  ASSERT_THAT(resp, "OK");
+
+  // Values that fit into the stored scalars are patched in place.
+  resp = Run({"JSON.NUMINCRBY", "json", "$.a", "1"});
+  EXPECT_EQ(resp, "[2]");
+  resp = Run({"JSON.NUMINCRBY", "json", "$.c.d", "1"});
+  EXPECT_EQ(resp, "[3.5]");
+  resp = Run({"JSON.NUMMULTBY", "json", "$.e[1]", "3"});
+  EXPECT_EQ(resp, "[6]");
+  resp = Run({"JSON.TOGGLE", "json", "$.b"});
+  EXPECT_THAT(resp, IntArg(0));
+
+  // Wider values and type changes rebuild the buffer.
+  resp = Run({"JSON.NUMINCRBY", "json", "$.a", "100000"});
+  EXPECT_EQ(resp, "[100002]");
+  resp = Run({"JSON.NUMINCRBY", "json", "$.a", "1"});
+  EXPECT_EQ(resp, "[100003]");
+  resp = Run({"JSON.NUMINCRBY", "json", "$.e[0]", "0.5"});
+  EXPECT_EQ(resp, "[1.5]");
+
+  // Other paths mutate the decoded json.
+  resp = Run({"JSON.NUMINCRBY", "json", "$..d", "1"});
+  EXPECT_EQ(resp, "[4.5]");
+  resp = Run({"JSON.TOGGLE", "json", "$.*"});
+  EXPECT_THAT(resp.GetVec(), ElementsAre(ArgType(RespExpr::NIL), IntArg(1), ArgType(RespExpr::NIL),
+                                         ArgType(RespExpr::NIL)));
+  resp = Run({"JSON.NUMINCRBY", "json", ".a", "1"});
+  EXPECT_EQ(resp, "100004");
+  resp = Run({"JSON.NUMINCRBY", "json", ".e[1]", "1"});
+  EXPECT_EQ(resp, "7");
+}
+
+TEST_F(FlatJsonFamilyTest, SetPath) {
+  auto resp = Run({"JSON.SET", "json", ".", R"({"a":1,"b":{"c":2}})"});
+  ASSERT_THAT(resp, "OK");
+
+  // Existing paths are replaced and missing ones are added.
+  resp = Run({"JSON.SET", "json", "$.a", "10"});
+  EXPECT_EQ(resp, "OK");
+  resp = Run({"JSON.SET", "json", "$.newfield", "5"});
+  EXPECT_EQ(resp, "OK");
+  resp = Run({"JSON.SET", "json", "$.b.d", "7"});
+  EXPECT_EQ(resp, "OK");
+  resp = Run({"JSON.SET", "json", "$.xx", "1", "XX"});
+  EXPECT_THAT(resp, ArgType(RespExpr::NIL));
+
+  resp = Run({"JSON.NUMINCRBY", "json", "$.a", "1"});
+  EXPECT_EQ(resp, "[11]");
+  resp = Run({"JSON.NUMINCRBY", "json", "$.newfield", "1"});
+  EXPECT_EQ(resp, "[6]");
+  resp = Run({"JSON.NUMINCRBY", "json", "$.b.*", "1"});
+  EXPECT_EQ(resp, "[3,8]");
+}
+
 }  // namespace dfly
@@ -151,38 +151,48 @@ class BPopPusher {
 };
 
 // Called as a callback from MKBlocking after we've determined which key to pop.
-std::string OpBPop(Transaction* t, EngineShard* shard, std::string_view key, ListDir dir) {
+// If a pusher handed a value off to us, it was never stored in the list and we take it as is.
+std::string OpBPop(Transaction* t, EngineShard* shard, std::string_view key, ListDir dir,
+                   BlockingHandOff* handoff) {
   DVLOG(2) << "popping from " << key << " " << t->DebugId();
 
-  auto& db_slice = t->GetDbSlice(shard->shard_id());
-  auto it_res = db_slice.FindMutable(t->GetDbContext(), key, OBJ_LIST);
+  OpArgs op_args = t->GetOpArgs(shard);
+  std::string value;
 
-  CHECK(it_res) << t->DebugId() << " " << key;  // must exist and must be ok.
+  if (handoff && handoff->value) {
+    value = std::move(*handoff->value);
+    handoff->value.reset();
+  } else {
+    auto& db_slice = t->GetDbSlice(shard->shard_id());
+    auto it_res = db_slice.FindMutable(t->GetDbContext(), key, OBJ_LIST);
 
-  auto it = it_res->it;
-  std::string value;
-  size_t len;
+    CHECK(it_res) << t->DebugId() << " " << key;  // must exist and must be ok.
 
-  if (it->second.Encoding() == OBJ_ENCODING_QUICKLIST) {
-    quicklist* ql = GetQL(it->second);
+    auto it = it_res->it;
+    size_t len;
 
-    value = ListPop(dir, ql);
-    len = quicklistCount(ql);
-  } else {
-    QList* ql = GetQLV2(it->second);
-    QList::Where where = ToWhere(dir);
-    value = ql->Pop(where);
-    len = ql->Size();
-  }
+    if (it->second.Encoding() == OBJ_ENCODING_QUICKLIST) {
+      quicklist* ql = GetQL(it->second);
 
-  it_res->post_updater.Run();
+      value = ListPop(dir, ql);
+      len = quicklistCount(ql);
+    } else {
+      QList* ql = GetQLV2(it->second);
+      QList::Where where = ToWhere(dir);
+      value = ql->Pop(where);
+      len = ql->Size();
+    }
 
-  OpArgs op_args = t->GetOpArgs(shard);
-  if (len == 0) {
-    DVLOG(1) << "deleting key " << key << " " << t->DebugId();
-    CHECK(op_args.GetDbSlice().Del(op_args.db_cntx, it));
+    it_res->post_updater.Run();
+
+    if (len == 0) {
+      DVLOG(1) << "deleting key " << key << " " << t->DebugId();
+      CHECK(op_args.GetDbSlice().Del(op_args.db_cntx, it));
+    }
   }
 
+  // Journaled in both cases: replicas apply the push as a whole and then this pop. No other
+  // transaction runs on the shard in between since awakened transactions have priority.
   if (op_args.shard->journal()) {
     string command = dir == ListDir::LEFT ? "LPOP" : "RPOP";
     RecordJournal(op_args, command, ArgSlice{key}, 1);
@@ -317,6 +327,12 @@ OpResult<string> Peek(const OpArgs& op_args, string_view key, ListDir dir, bool
   return it.Get().to_string();
 }
 
+// Hand-offs wake the waiter from inside the push callback, so the pusher must conclude in this
+// hop: otherwise the awakened transaction could be polled while the pusher is still running.
+bool CanHandOff(const OpArgs& op_args) {
+  return !op_args.tx->IsMulti() && op_args.tx->GetUniqueShardCnt() == 1;
+}
+
 OpResult<uint32_t> OpPush(const OpArgs& op_args, std::string_view key, ListDir dir,
                           bool skip_notexist, facade::ArgRange vals, bool journal_rewrite) {
   EngineShard* es = op_args.shard;
@@ -339,6 +355,32 @@ OpResult<uint32_t> OpPush(const OpArgs& op_args, std::string_view key, ListDir d
   quicklist* ql = nullptr;
   QList* ql_v2 = nullptr;
 
+  // Values at the front and at the back of vals that are not stored in the list.
+  size_t skip_front = 0, skip_back = 0;
+  if (res.is_new && CanHandOff(op_args)) {
+    auto* bc = op_args.db_cntx.ns->GetBlockingController(es->shard_id());
+    BlockingHandOff* handoff = bc ? bc->AwakeForHandOff(op_args.db_cntx.db_index, key) : nullptr;
+
+    if (handoff) {
+      // The waiter would pop the last pushed value if it pops from the side we push to, and the
+      // first one otherwise. Hand it that value and store only the rest.
+      if (handoff->pop_front == (dir == ListDir::LEFT)) {
+        skip_back = 1;
+        handoff->value = string{vals[vals.Size() - 1]};
+      } else {
+        skip_front = 1;
+        handoff->value = string{vals[0]};
+      }
+
+      if (vals.Size() == 1) {
+        res.post_updater.Run();
+        CHECK(op_args.GetDbSlice().Del(op_args.db_cntx, res.it));
+        return 1;
+      }
+    }
+  }
+  size_t num_stored = vals.Size() - skip_front - skip_back;
+
   if (res.is_new) {
     if (absl::GetFlag(FLAGS_list_experimental_v2)) {
       ql_v2 = CompactObj::AllocateMR<QList>(GetFlag(FLAGS_list_max_listpack_size),
@@ -363,18 +405,24 @@ OpResult<uint32_t> OpPush(const OpArgs& op_args, std::string_view key, ListDir d
   if (ql) {
     // Left push is LIST_HEAD.
     int pos = (dir == ListDir::LEFT) ? QUICKLIST_HEAD : QUICKLIST_TAIL;
-    for (string_view v : vals) {
-      auto vsds = WrapSds(v);
+    for (size_t i = skip_front; i < skip_front + num_stored; ++i) {
+      auto vsds = WrapSds(vals[i]);
       quicklistPush(ql, vsds, sdslen(vsds), pos);
     }
     len = quicklistCount(ql);
   } else {
-    QList::Where where = ToWhere(dir);
-    for (string_view v : vals) {
-      ql_v2->Push(v, where);
+    if (const auto* slice = std::get_if<ArgSlice>(&vals.span)) {
+      ql_v2->PushBatch(slice->subspan(skip_front, num_stored), ToWhere(dir));
+    } else {
+      vector<string_view> batch;
+      batch.reserve(num_stored);
+      for (size_t i = skip_front; i < skip_front + num_stored; ++i)
+        batch.push_back(vals[i]);
+      ql_v2->PushBatch(batch, ToWhere(dir));
     }
     len = ql_v2->Size();
   }
+  len += skip_front + skip_back;  // handed off values count as pushed
 
   if (res.is_new) {
     auto blocking_controller = op_args.db_cntx.ns->GetBlockingController(es->shard_id());
@@ -423,13 +471,7 @@ OpResult<StringVec> OpPop(const OpArgs& op_args, string_view key, ListDir dir, u
       res.reserve(count);
     }
 
-    QList::Where where = ToWhere(dir);
-    for (unsigned i = 0; i < count; ++i) {
-      string val = ql->Pop(where);
-      if (return_results) {
-        res.push_back(std::move(val));
-      }
-    }
+    ql->PopBatch(count, ToWhere(dir), return_results ? &res : nullptr);
   } else {
     quicklist* ql = GetQL(it->second);
     prev_len = quicklistCount(ql);
@@ -1141,12 +1183,15 @@ void BPopGeneric(ListDir dir, CmdArgList args, Transaction* tx, SinkReplyBuilder
   VLOG(1) << "BPop timeout(" << timeout << ")";
 
   std::string popped_value;
-  auto cb = [dir, &popped_value](Transaction* t, EngineShard* shard, std::string_view key) {
-    popped_value = OpBPop(t, shard, key, dir);
+  BlockingHandOff handoff{dir == ListDir::LEFT};
+  auto cb = [dir, &popped_value, &handoff](Transaction* t, EngineShard* shard,
+                                          std::string_view key) {
+    popped_value = OpBPop(t, shard, key, dir, &handoff);
   };
 
   OpResult<string> popped_key = container_utils::RunCbOnFirstNonEmptyBlocking(
-      tx, OBJ_LIST, std::move(cb), unsigned(timeout * 1000), &cntx->blocked, &cntx->paused);
+      tx, OBJ_LIST, std::move(cb), unsigned(timeout * 1000), &cntx->blocked, &cntx->paused,
+      nullptr, &handoff);
 
   auto* rb = static_cast<RedisReplyBuilder*>(builder);
   if (popped_key) {
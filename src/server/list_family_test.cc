@@ -271,6 +271,51 @@ TEST_F(ListFamilyTest, WrongTypeDoesNotWake) {
   EXPECT_THAT(blpop_resp.GetVec(), ElementsAre(kKey1, "B"));
 }
 
+TEST_F(ListFamilyTest, BPopHandOff) {
+  RespExpr pop_resp;
+
+  // A single pushed value goes straight to the waiter and the key is never left behind.
+  auto pop_fb = pp_->at(0)->LaunchFiber(Launch::dispatch, [&] {
+    pop_resp = Run({"brpop", kKey1, "0"});
+  });
+
+  WaitUntilLocked(0, kKey1);
+
+  pp_->at(1)->Await([&] { EXPECT_EQ(1, CheckedInt({"lpush", kKey1, "A"})); });
+  pop_fb.Join();
+
+  EXPECT_THAT(pop_resp.GetVec(), ElementsAre(kKey1, "A"));
+  EXPECT_THAT(Run({"exists", kKey1}), IntArg(0));
+
+  // With several values, the waiter gets the one it would have popped and the rest are kept.
+  pop_fb = pp_->at(0)->LaunchFiber(Launch::dispatch, [&] {
+    pop_resp = Run({"blpop", kKey1, "0"});
+  });
+
+  WaitUntilLocked(0, kKey1);
+
+  pp_->at(1)->Await([&] { EXPECT_EQ(3, CheckedInt({"rpush", kKey1, "a", "b", "c"})); });
+  pop_fb.Join();
+
+  EXPECT_THAT(pop_resp.GetVec(), ElementsAre(kKey1, "a"));
+  EXPECT_THAT(Run({"lrange", kKey1, "0", "-1"}).GetVec(), ElementsAre("b", "c"));
+
+  ASSERT_THAT(Run({"del", kKey1}), IntArg(1));
+  pop_fb = pp_->at(0)->LaunchFiber(Launch::dispatch, [&] {
+    pop_resp = Run({"blpop", kKey1, "0"});
+  });
+
+  WaitUntilLocked(0, kKey1);
+
+  pp_->at(1)->Await([&] { EXPECT_EQ(3, CheckedInt({"lpush", kKey1, "a", "b", "c"})); });
+  pop_fb.Join();
+
+  EXPECT_THAT(pop_resp.GetVec(), ElementsAre(kKey1, "c"));
+  EXPECT_THAT(Run({"lrange", kKey1, "0", "-1"}).GetVec(), ElementsAre("b", "a"));
+  EXPECT_FALSE(HasAwakened());
+  EXPECT_EQ(0, NumWatched());
+}
+
 TEST_F(ListFamilyTest, BPopSameKeyTwice) {
   RespExpr blpop_resp;
 
@@ -54,6 +54,7 @@ extern "C" {
 #include "server/search/search_family.h"
 #include "server/server_state.h"
 #include "server/set_family.h"
+#include "server/sketch_family.h"
 #include "server/stream_family.h"
 #include "server/string_family.h"
 #include "server/transaction.h"
@@ -2680,6 +2681,7 @@ void Service::RegisterCommands() {
   HllFamily::Register(&registry_);
   SearchFamily::Register(&registry_);
   BloomFamily::Register(&registry_);
+  SketchFamily::Register(&registry_);
   server_family_.Register(&registry_);
   cluster_family_.Register(&registry_);
 
@@ -31,11 +31,15 @@ extern "C" {
 #include "base/flags.h"
 #include "base/logging.h"
 #include "core/bloom.h"
+#include "core/count_min_sketch.h"
+#include "core/cuckoo_filter.h"
 #include "core/json/json_object.h"
 #include "core/qlist.h"
 #include "core/sorted_map.h"
 #include "core/string_map.h"
 #include "core/string_set.h"
+#include "core/t_digest.h"
+#include "core/top_k.h"
 #include "server/cluster/cluster_defs.h"
 #include "server/cluster/cluster_family.h"
 #include "server/container_utils.h"
@@ -233,7 +237,8 @@ string ModuleTypeName(uint64_t module_id) {
 bool RdbTypeAllowedEmpty(int type) {
   return type == RDB_TYPE_STRING || type == RDB_TYPE_JSON || type == RDB_TYPE_SBF ||
          type == RDB_TYPE_STREAM_LISTPACKS || type == RDB_TYPE_SET_WITH_EXPIRY ||
-         type == RDB_TYPE_HASH_WITH_EXPIRY;
+         type == RDB_TYPE_HASH_WITH_EXPIRY || type == RDB_TYPE_CMS || type == RDB_TYPE_TOPK ||
+         type == RDB_TYPE_CF || type == RDB_TYPE_TDIGEST;
 }
 
 }  // namespace
@@ -398,6 +403,10 @@ class RdbLoaderBase::OpaqueObjLoader {
   void operator()(const LzfString& lzfstr);
   void operator()(const unique_ptr<LoadTrace>& ptr);
   void operator()(const RdbSBF& src);
+  void operator()(const RdbCMS& src);
+  void operator()(const RdbTopK& src);
+  void operator()(const RdbCF& src);
+  void operator()(const RdbTDigest& src);
 
   std::error_code ec() const {
     return ec_;
@@ -486,13 +495,50 @@ void RdbLoaderBase::OpaqueObjLoader::operator()(const unique_ptr<LoadTrace>& ptr
 void RdbLoaderBase::OpaqueObjLoader::operator()(const RdbSBF& src) {
   SBF* sbf =
       CompactObj::AllocateMR<SBF>(src.grow_factor, src.fp_prob, src.max_capacity, src.prev_size,
-                                  src.current_size, CompactObj::memory_resource());
+                                  src.current_size, CompactObj::memory_resource(), src.blocked);
   for (unsigned i = 0; i < src.filters.size(); ++i) {
     sbf->AddFilter(src.filters[i].blob, src.filters[i].hash_cnt);
   }
   pv_->SetSBF(sbf);
 }
 
+void RdbLoaderBase::OpaqueObjLoader::operator()(const RdbCMS& src) {
+  CMS* cms = CompactObj::AllocateMR<CMS>(src.width, src.depth, CompactObj::memory_resource());
+  cms->Load(src.counters, src.count);
+  pv_->SetCMS(cms);
+}
+
+void RdbLoaderBase::OpaqueObjLoader::operator()(const RdbTopK& src) {
+  TopK* topk = CompactObj::AllocateMR<TopK>(src.k, src.width, src.depth, src.decay,
+                                            CompactObj::memory_resource());
+  topk->Load(src.buckets, src.rng_state);
+  for (const auto& [item, count] : src.heap) {
+    topk->LoadHeapEntry(item, count);
+  }
+  pv_->SetTopK(topk);
+}
+
+void RdbLoaderBase::OpaqueObjLoader::operator()(const RdbCF& src) {
+  CuckooFilter* cf =
+      CompactObj::AllocateMR<CuckooFilter>(src.capacity, src.max_iterations, src.expansion,
+                                           src.num_items, src.num_deletes,
+                                           CompactObj::memory_resource());
+  for (const string& table : src.tables) {
+    cf->AddTable(table);
+  }
+  pv_->SetCF(cf);
+}
+
+void RdbLoaderBase::OpaqueObjLoader::operator()(const RdbTDigest& src) {
+  TDigest* td = CompactObj::AllocateMR<TDigest>(src.compression, CompactObj::memory_resource());
+  if (!td->Load(src.centroids, src.num_merged, src.min, src.max)) {
+    CompactObj::DeleteMR<TDigest>(td);
+    ec_ = RdbError(errc::rdb_file_corrupted);
+    return;
+  }
+  pv_->SetTDigest(td);
+}
+
 void RdbLoaderBase::OpaqueObjLoader::CreateSet(const LoadTrace* ltrace) {
   size_t len = ltrace->arr.size();
 
@@ -982,6 +1028,7 @@ void RdbLoaderBase::OpaqueObjLoader::CreateStream(const LoadTrace* ltrace) {
         streamFreeNACK(nack);
         return;
       }
+      streamPelIndexAdd(cgroup, pel.rawid.data(), nack);
     }
 
     for (const auto& cons : cg.cons_arr) {
@@ -1526,6 +1573,18 @@ error_code RdbLoaderBase::ReadObj(int rdbtype, OpaqueObj* dest) {
     case RDB_TYPE_SBF:
       iores = ReadSBF();
       break;
+    case RDB_TYPE_CMS:
+      iores = ReadCMS();
+      break;
+    case RDB_TYPE_TOPK:
+      iores = ReadTopK();
+      break;
+    case RDB_TYPE_CF:
+      iores = ReadCF();
+      break;
+    case RDB_TYPE_TDIGEST:
+      iores = ReadTDigest();
+      break;
     default:
       LOG(ERROR) << "Unsupported rdb type " << rdbtype;
 
@@ -2095,8 +2154,9 @@ auto RdbLoaderBase::ReadSBF() -> io::Result<OpaqueObj> {
   RdbSBF res;
   uint64_t options;
   SET_OR_UNEXPECT(LoadLen(nullptr), options);
-  if (options != 0)
+  if ((options & ~RDB_SBF_OPT_BLOCKED) != 0)
     return Unexpected(errc::rdb_file_corrupted);
+  res.blocked = options & RDB_SBF_OPT_BLOCKED;
   SET_OR_UNEXPECT(FetchBinaryDouble(), res.grow_factor);
   SET_OR_UNEXPECT(FetchBinaryDouble(), res.fp_prob);
   if (res.fp_prob <= 0 || res.fp_prob > 0.5) {
@@ -2119,11 +2179,118 @@ auto RdbLoaderBase::ReadSBF() -> io::Result<OpaqueObj> {
     if (!is_power2(bit_len)) {  // must be power of two
       return Unexpected(errc::rdb_file_corrupted);
     }
+    if (res.blocked && filter_data.size() < Bloom::kBlockBytes) {
+      return Unexpected(errc::rdb_file_corrupted);
+    }
     res.filters.emplace_back(hash_cnt, std::move(filter_data));
   }
   return OpaqueObj{std::move(res), RDB_TYPE_SBF};
 }
 
+auto RdbLoaderBase::ReadCMS() -> io::Result<OpaqueObj> {
+  RdbCMS res;
+  uint64_t options;
+  SET_OR_UNEXPECT(LoadLen(nullptr), options);
+  if (options != 0)
+    return Unexpected(errc::rdb_file_corrupted);
+
+  SET_OR_UNEXPECT(LoadLen(nullptr), res.width);
+  SET_OR_UNEXPECT(LoadLen(nullptr), res.depth);
+  SET_OR_UNEXPECT(LoadLen(nullptr), res.count);
+  SET_OR_UNEXPECT(FetchGenericString(), res.counters);
+  if (res.width == 0 || res.depth == 0 ||
+      res.counters.size() != uint64_t(res.width) * res.depth * sizeof(uint32_t)) {
+    return Unexpected(errc::rdb_file_corrupted);
+  }
+
+  return OpaqueObj{std::move(res), RDB_TYPE_CMS};
+}
+
+auto RdbLoaderBase::ReadTopK() -> io::Result<OpaqueObj> {
+  RdbTopK res;
+  uint64_t options;
+  SET_OR_UNEXPECT(LoadLen(nullptr), options);
+  if (options != 0)
+    return Unexpected(errc::rdb_file_corrupted);
+
+  SET_OR_UNEXPECT(LoadLen(nullptr), res.k);
+  SET_OR_UNEXPECT(LoadLen(nullptr), res.width);
+  SET_OR_UNEXPECT(LoadLen(nullptr), res.depth);
+  SET_OR_UNEXPECT(FetchBinaryDouble(), res.decay);
+  SET_OR_UNEXPECT(LoadLen(nullptr), res.rng_state);
+  SET_OR_UNEXPECT(FetchGenericString(), res.buckets);
+  if (res.k == 0 || res.width == 0 || res.depth == 0 || !(res.decay > 0 && res.decay <= 1) ||
+      res.buckets.size() != uint64_t(res.width) * res.depth * sizeof(TopK::Bucket)) {
+    return Unexpected(errc::rdb_file_corrupted);
+  }
+
+  uint64_t heap_size;
+  SET_OR_UNEXPECT(LoadLen(nullptr), heap_size);
+  if (heap_size > res.k)
+    return Unexpected(errc::rdb_file_corrupted);
+
+  res.heap.resize(heap_size);
+  for (auto& [item, count] : res.heap) {
+    SET_OR_UNEXPECT(FetchGenericString(), item);
+    SET_OR_UNEXPECT(LoadLen(nullptr), count);
+  }
+
+  return OpaqueObj{std::move(res), RDB_TYPE_TOPK};
+}
+
+auto RdbLoaderBase::ReadCF() -> io::Result<OpaqueObj> {
+  RdbCF res;
+  uint64_t options;
+  SET_OR_UNEXPECT(LoadLen(nullptr), options);
+  if (options != 0)
+    return Unexpected(errc::rdb_file_corrupted);
+
+  SET_OR_UNEXPECT(LoadLen(nullptr), res.capacity);
+  SET_OR_UNEXPECT(LoadLen(nullptr), res.max_iterations);
+  SET_OR_UNEXPECT(LoadLen(nullptr), res.expansion);
+  SET_OR_UNEXPECT(LoadLen(nullptr), res.num_items);
+  SET_OR_UNEXPECT(LoadLen(nullptr), res.num_deletes);
+
+  uint64_t num_tables;
+  SET_OR_UNEXPECT(LoadLen(nullptr), num_tables);
+  if (num_tables == 0)
+    return Unexpected(errc::rdb_file_corrupted);
+
+  auto is_power2 = [](size_t n) { return (n & (n - 1)) == 0; };
+  for (uint64_t i = 0; i < num_tables; ++i) {
+    string table;
+    SET_OR_UNEXPECT(FetchGenericString(), table);
+    if (table.empty() || table.size() % (CuckooTable::kBucketSize * sizeof(uint16_t)) != 0 ||
+        !is_power2(table.size())) {
+      return Unexpected(errc::rdb_file_corrupted);
+    }
+    res.tables.push_back(std::move(table));
+  }
+
+  return OpaqueObj{std::move(res), RDB_TYPE_CF};
+}
+
+auto RdbLoaderBase::ReadTDigest() -> io::Result<OpaqueObj> {
+  RdbTDigest res;
+  uint64_t options;
+  SET_OR_UNEXPECT(LoadLen(nullptr), options);
+  if (options != 0)
+    return Unexpected(errc::rdb_file_corrupted);
+
+  SET_OR_UNEXPECT(LoadLen(nullptr), res.compression);
+  SET_OR_UNEXPECT(FetchBinaryDouble(), res.min);
+  SET_OR_UNEXPECT(FetchBinaryDouble(), res.max);
+  SET_OR_UNEXPECT(LoadLen(nullptr), res.num_merged);
+  SET_OR_UNEXPECT(FetchGenericString(), res.centroids);
+  if (res.compression == 0 || res.compression > TDigest::kMaxCompression ||
+      res.centroids.size() % sizeof(TDigest::Centroid) != 0 ||
+      res.num_merged > res.centroids.size() / sizeof(TDigest::Centroid)) {
+    return Unexpected(errc::rdb_file_corrupted);
+  }
+
+  return OpaqueObj{std::move(res), RDB_TYPE_TDIGEST};
+}
+
 template <typename T> io::Result<T> RdbLoaderBase::FetchInt() {
   auto ec = EnsureRead(sizeof(T));
   if (ec)
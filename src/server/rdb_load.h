@@ -44,6 +44,7 @@ class RdbLoaderBase {
     double grow_factor, fp_prob;
     size_t prev_size, current_size;
     size_t max_capacity;
+    bool blocked;
 
     struct Filter {
       unsigned hash_cnt;
@@ -54,8 +55,37 @@ class RdbLoaderBase {
     std::vector<Filter> filters;
   };
 
+  struct RdbCMS {
+    uint32_t width, depth;
+    uint64_t count;
+    std::string counters;
+  };
+
+  struct RdbTopK {
+    uint32_t k, width, depth;
+    double decay;
+    uint64_t rng_state;
+    std::string buckets;
+    std::vector<std::pair<std::string, uint32_t>> heap;
+  };
+
+  struct RdbCF {
+    uint64_t capacity;
+    uint32_t max_iterations, expansion;
+    uint64_t num_items, num_deletes;
+    std::vector<std::string> tables;
+  };
+
+  struct RdbTDigest {
+    uint32_t compression;
+    double min, max;
+    uint64_t num_merged;
+    std::string centroids;
+  };
+
   using RdbVariant =
-      std::variant<long long, base::PODArray<char>, LzfString, std::unique_ptr<LoadTrace>, RdbSBF>;
+      std::variant<long long, base::PODArray<char>, LzfString, std::unique_ptr<LoadTrace>, RdbSBF,
+                   RdbCMS, RdbTopK, RdbCF, RdbTDigest>;
 
   struct OpaqueObj {
     RdbVariant obj;
@@ -178,6 +208,10 @@ class RdbLoaderBase {
   ::io::Result<OpaqueObj> ReadRedisJson();
   ::io::Result<OpaqueObj> ReadJson();
   ::io::Result<OpaqueObj> ReadSBF();
+  ::io::Result<OpaqueObj> ReadCMS();
+  ::io::Result<OpaqueObj> ReadTopK();
+  ::io::Result<OpaqueObj> ReadCF();
+  ::io::Result<OpaqueObj> ReadTDigest();
 
   std::error_code SkipModuleData();
   std::error_code HandleCompressedBlob(int op_type);
@@ -28,12 +28,16 @@ extern "C" {
 #include "base/flags.h"
 #include "base/logging.h"
 #include "core/bloom.h"
+#include "core/count_min_sketch.h"
+#include "core/cuckoo_filter.h"
 #include "core/json/json_object.h"
 #include "core/qlist.h"
 #include "core/size_tracking_channel.h"
 #include "core/sorted_map.h"
 #include "core/string_map.h"
 #include "core/string_set.h"
+#include "core/t_digest.h"
+#include "core/top_k.h"
 #include "server/engine_shard_set.h"
 #include "server/error.h"
 #include "server/main_service.h"
@@ -209,6 +213,14 @@ uint8_t RdbObjectType(const PrimeValue& pv) {
                              // 2024.
     case OBJ_SBF:
       return RDB_TYPE_SBF;
+    case OBJ_CMS:
+      return RDB_TYPE_CMS;
+    case OBJ_TOPK:
+      return RDB_TYPE_TOPK;
+    case OBJ_CF:
+      return RDB_TYPE_CF;
+    case OBJ_TDIGEST:
+      return RDB_TYPE_TDIGEST;
   }
   LOG(FATAL) << "Unknown encoding " << compact_enc << " for type " << type;
   return 0; /* avoid warning */
@@ -429,6 +441,22 @@ error_code RdbSerializer::SaveObject(const PrimeValue& pv) {
     return SaveSBFObject(pv);
   }
 
+  if (obj_type == OBJ_CMS) {
+    return SaveCMSObject(pv);
+  }
+
+  if (obj_type == OBJ_TOPK) {
+    return SaveTopKObject(pv);
+  }
+
+  if (obj_type == OBJ_CF) {
+    return SaveCFObject(pv);
+  }
+
+  if (obj_type == OBJ_TDIGEST) {
+    return SaveTDigestObject(pv);
+  }
+
   LOG(ERROR) << "Not implemented " << obj_type;
   return make_error_code(errc::function_not_supported);
 }
@@ -695,7 +723,7 @@ std::error_code RdbSerializer::SaveSBFObject(const PrimeValue& pv) {
   SBF* sbf = pv.GetSBF();
 
   // options to allow format mutations in the future.
-  RETURN_ON_ERR(SaveLen(0));  // options - reserved
+  RETURN_ON_ERR(SaveLen(sbf->blocked() ? RDB_SBF_OPT_BLOCKED : 0));
   RETURN_ON_ERR(SaveBinaryDouble(sbf->grow_factor()));
   RETURN_ON_ERR(SaveBinaryDouble(sbf->fp_probability()));
   RETURN_ON_ERR(SaveLen(sbf->prev_size()));
@@ -718,6 +746,79 @@ std::error_code RdbSerializer::SaveSBFObject(const PrimeValue& pv) {
   return {};
 }
 
+std::error_code RdbSerializer::SaveCMSObject(const PrimeValue& pv) {
+  CMS* cms = pv.GetCMS();
+
+  RETURN_ON_ERR(SaveLen(0));  // options - reserved
+  RETURN_ON_ERR(SaveLen(cms->width()));
+  RETURN_ON_ERR(SaveLen(cms->depth()));
+  RETURN_ON_ERR(SaveLen(cms->count()));
+  RETURN_ON_ERR(SaveString(cms->data()));
+  FlushIfNeeded(FlushState::kFlushEndEntry);
+
+  return {};
+}
+
+std::error_code RdbSerializer::SaveTopKObject(const PrimeValue& pv) {
+  TopK* topk = pv.GetTopK();
+
+  RETURN_ON_ERR(SaveLen(0));  // options - reserved
+  RETURN_ON_ERR(SaveLen(topk->k()));
+  RETURN_ON_ERR(SaveLen(topk->width()));
+  RETURN_ON_ERR(SaveLen(topk->depth()));
+  RETURN_ON_ERR(SaveBinaryDouble(topk->decay()));
+  RETURN_ON_ERR(SaveLen(topk->rng_state()));
+  RETURN_ON_ERR(SaveString(topk->buckets()));
+  FlushIfNeeded(FlushState::kFlushMidEntry);
+
+  RETURN_ON_ERR(SaveLen(topk->heap().size()));
+  for (const auto& entry : topk->heap()) {
+    RETURN_ON_ERR(SaveString(entry.item));
+    RETURN_ON_ERR(SaveLen(entry.count));
+  }
+  FlushIfNeeded(FlushState::kFlushEndEntry);
+
+  return {};
+}
+
+std::error_code RdbSerializer::SaveCFObject(const PrimeValue& pv) {
+  CuckooFilter* cf = pv.GetCF();
+
+  RETURN_ON_ERR(SaveLen(0));  // options - reserved
+  RETURN_ON_ERR(SaveLen(cf->capacity()));
+  RETURN_ON_ERR(SaveLen(cf->max_iterations()));
+  RETURN_ON_ERR(SaveLen(cf->expansion()));
+  RETURN_ON_ERR(SaveLen(cf->num_items()));
+  RETURN_ON_ERR(SaveLen(cf->num_deletes()));
+  RETURN_ON_ERR(SaveLen(cf->num_tables()));
+
+  for (unsigned i = 0; i < cf->num_tables(); ++i) {
+    RETURN_ON_ERR(SaveString(cf->data(i)));
+    FlushState flush_state = FlushState::kFlushMidEntry;
+    if ((i + 1) == cf->num_tables())
+      flush_state = FlushState::kFlushEndEntry;
+
+    FlushIfNeeded(flush_state);
+  }
+
+  return {};
+}
+
+std::error_code RdbSerializer::SaveTDigestObject(const PrimeValue& pv) {
+  TDigest* td = pv.GetTDigest();
+
+  // Unmerged centroids are saved as is, so that the loaded digest is identical.
+  RETURN_ON_ERR(SaveLen(0));  // options - reserved
+  RETURN_ON_ERR(SaveLen(td->compression()));
+  RETURN_ON_ERR(SaveBinaryDouble(td->min()));
+  RETURN_ON_ERR(SaveBinaryDouble(td->max()));
+  RETURN_ON_ERR(SaveLen(td->num_merged()));
+  RETURN_ON_ERR(SaveString(td->data()));
+  FlushIfNeeded(FlushState::kFlushEndEntry);
+
+  return {};
+}
+
 /* Save a long long value as either an encoded string or a string. */
 error_code RdbSerializer::SaveLongLongAsString(int64_t value) {
   uint8_t buf[32];
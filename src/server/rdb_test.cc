@@ -16,9 +16,11 @@ extern "C" {
 #include "base/flags.h"
 #include "base/gtest.h"
 #include "base/logging.h"
+#include "core/t_digest.h"
 #include "facade/facade_test.h"  // needed to find operator== for RespExpr.
 #include "io/file.h"
 #include "server/engine_shard_set.h"
+#include "server/rdb_extensions.h"
 #include "server/rdb_load.h"
 #include "server/rdb_save.h"
 #include "server/test_utils.h"
@@ -523,6 +525,117 @@ TEST_F(RdbTest, SBF) {
   Run({"debug", "reload"});
   EXPECT_EQ(Run({"type", "k"}), "MBbloom--");
   EXPECT_THAT(Run({"BF.EXISTS", "k", "1"}), IntArg(1));
+
+  Run({"BF.RESERVE", "blocked", "0.01", "100", "BLOCKED"});
+  for (unsigned i = 0; i < 500; ++i) {
+    Run({"BF.ADD", "blocked", StrCat(i)});
+  }
+  Run({"debug", "reload"});
+  EXPECT_EQ(Run({"type", "blocked"}), "MBbloom--");
+  for (unsigned i = 0; i < 500; ++i) {
+    ASSERT_THAT(Run({"BF.EXISTS", "blocked", StrCat(i)}), IntArg(1));
+  }
+  EXPECT_THAT(Run({"BF.ADD", "blocked", "1"}), IntArg(0));
+}
+
+TEST_F(RdbTest, CuckooFilter) {
+  Run({"CF.RESERVE", "cf", "4", "EXPANSION", "2"});
+  for (unsigned i = 0; i < 20; ++i) {
+    Run({"CF.ADD", "cf", StrCat("item", i)});
+  }
+  Run({"CF.ADD", "cf", "item0"});
+  Run({"CF.DEL", "cf", "item1"});
+
+  Run({"debug", "reload"});
+
+  EXPECT_EQ(Run({"type", "cf"}), "MBbloomCF");
+  EXPECT_THAT(Run({"CF.COUNT", "cf", "item0"}), IntArg(2));
+  EXPECT_THAT(Run({"CF.EXISTS", "cf", "item19"}), IntArg(1));
+  EXPECT_THAT(Run({"CF.DEL", "cf", "item19"}), IntArg(1));
+}
+
+TEST_F(RdbTest, Sketches) {
+  Run({"CMS.INITBYDIM", "cms", "100", "4"});
+  Run({"CMS.INCRBY", "cms", "a", "5", "b", "2"});
+  Run({"TOPK.RESERVE", "topk", "2"});
+  Run({"TOPK.INCRBY", "topk", "a", "5", "b", "2", "c", "1"});
+
+  Run({"debug", "reload"});
+
+  EXPECT_EQ(Run({"type", "cms"}), "CMSk-TYPE");
+  EXPECT_THAT(Run({"CMS.QUERY", "cms", "a", "b"}).GetVec(), ElementsAre(IntArg(5), IntArg(2)));
+  EXPECT_EQ(Run({"type", "topk"}), "TopK-TYPE");
+  EXPECT_THAT(Run({"TOPK.LIST", "topk", "WITHCOUNT"}).GetVec(),
+              ElementsAre("a", IntArg(5), "b", IntArg(2)));
+}
+
+TEST_F(RdbTest, TDigest) {
+  Run({"TDIGEST.CREATE", "td", "COMPRESSION", "50"});
+  for (unsigned i = 0; i < 150; ++i) {
+    Run({"TDIGEST.ADD", "td", StrCat(i), StrCat(i + 150), StrCat(i + 300)});
+  }
+  auto quantiles = [this] {
+    vector<string> res;
+    for (const auto& val : Run({"TDIGEST.QUANTILE", "td", "0.01", "0.5", "0.99"}).GetVec())
+      res.push_back(val.GetString());
+    return res;
+  };
+  vector<string> before = quantiles();
+
+  Run({"debug", "reload"});
+
+  // Both merged and buffered centroids are restored as is.
+  EXPECT_EQ(Run({"type", "td"}), "TDIS-TYPE");
+  EXPECT_EQ(quantiles(), before);
+  EXPECT_THAT(Run({"TDIGEST.INFO", "td"}).GetVec()[9], IntArg(450));
+}
+
+// Returns a DUMP payload of a digest with compression 1 and `len` centroids of weight 1.
+static string TDigestDump(size_t len, size_t num_merged, double min, double max) {
+  vector<TDigest::Centroid> cs;
+  for (size_t i = 0; i < len; ++i)
+    cs.push_back({double(i), 1});
+  size_t size = len * sizeof(TDigest::Centroid);
+  CHECK_LT(size, 1u << 14);
+
+  string res{char(RDB_TYPE_TDIGEST), 0 /* options */, 1 /* compression */};
+  res.append(reinterpret_cast<const char*>(&min), sizeof(min));
+  res.append(reinterpret_cast<const char*>(&max), sizeof(max));
+  res.push_back(char(num_merged));
+  res.push_back(char((RDB_14BITLEN << 6) | (size >> 8)));
+  res.push_back(char(size & 0xff));
+  res.append(reinterpret_cast<const char*>(cs.data()), size);
+  res.push_back(char(RDB_SER_VERSION & 0xff));
+  res.push_back(char(RDB_SER_VERSION >> 8));
+  uint64_t crc = crc64(0, to_byte(res.data()), res.size());
+  res.append(reinterpret_cast<const char*>(&crc), sizeof(crc));
+  return res;
+}
+
+TEST_F(RdbTest, TDigestRestore) {
+  // A digest that has been filled many times over keeps space for new values after a restore.
+  Run({"TDIGEST.CREATE", "td", "COMPRESSION", "1"});
+  for (unsigned i = 0; i < 100; ++i) {
+    Run({"TDIGEST.ADD", "td", StrCat(i)});
+  }
+  auto dump = Run({"dump", "td"});
+  EXPECT_EQ(Run({"restore", "copy", "0", ToSV(dump.GetBuf())}), "OK");
+  EXPECT_EQ(Run({"TDIGEST.ADD", "copy", "100"}), "OK");
+  EXPECT_THAT(Run({"TDIGEST.INFO", "copy"}).GetVec()[9], IntArg(101));
+
+  // Compression 1 gives the capacity of 10 centroids, less than 6 of them merged.
+  EXPECT_EQ(Run({"restore", "crafted", "0", TDigestDump(9, 5, 0, 8)}), "OK");
+  EXPECT_EQ(Run({"TDIGEST.ADD", "crafted", "9"}), "OK");
+  EXPECT_THAT(Run({"TDIGEST.INFO", "crafted"}).GetVec()[9], IntArg(10));
+
+  // A full digest, too many merged centroids and invalid bounds are rejected.
+  EXPECT_THAT(Run({"restore", "bad", "0", TDigestDump(10, 10, 0, 9)}), ErrArg("Bad data format"));
+  EXPECT_THAT(Run({"restore", "bad", "0", TDigestDump(10, 0, 0, 9)}), ErrArg("Bad data format"));
+  EXPECT_THAT(Run({"restore", "bad", "0", TDigestDump(9, 6, 0, 8)}), ErrArg("Bad data format"));
+  EXPECT_THAT(Run({"restore", "bad", "0", TDigestDump(5, 5, 4, 0)}), ErrArg("Bad data format"));
+  double inf = numeric_limits<double>::infinity();
+  EXPECT_THAT(Run({"restore", "bad", "0", TDigestDump(5, 5, 0, inf)}), ErrArg("Bad data format"));
+  EXPECT_EQ(Run({"exists", "bad"}), "0");
 }
 
 TEST_F(RdbTest, DflyLoadAppend) {
@@ -4,6 +4,8 @@
 
 #include "server/search/aggregator.h"
 
+#include <absl/strings/str_cat.h>
+
 #include "base/logging.h"
 
 namespace dfly::aggregate {
@@ -103,6 +105,61 @@ PipelineStep MakeGroupStep(absl::Span<const std::string_view> fields,
   return GroupStep{std::vector<std::string>(fields.begin(), fields.end()), std::move(reducers)};
 }
 
+std::optional<PartialGroupSteps> MakePartialGroupSteps(absl::Span<const std::string_view> fields,
+                                                       absl::Span<const ReducerFunc> funcs,
+                                                       std::vector<Reducer> reducers) {
+  DCHECK_EQ(funcs.size(), reducers.size());
+  std::vector<Reducer> partial, merge;
+  std::vector<std::string> averages;  // AVG is computed from partial sums and counts
+
+  auto sum_field = [](std::string_view field) { return absl::StrCat("__avg_sum_", field); };
+  auto count_field = [](std::string_view field) { return absl::StrCat("__avg_count_", field); };
+
+  for (size_t i = 0; i < reducers.size(); i++) {
+    Reducer& reducer = reducers[i];
+    const std::string& result = reducer.result_field;
+    switch (funcs[i]) {
+      case ReducerFunc::COUNT:
+        merge.push_back({result, result, FindReducerFunc(ReducerFunc::SUM)});
+        break;
+      case ReducerFunc::SUM:
+      case ReducerFunc::MAX:
+      case ReducerFunc::MIN:
+        merge.push_back({result, result, reducer.func});
+        break;
+      case ReducerFunc::AVG:
+        partial.push_back({reducer.source_field, sum_field(result),
+                           FindReducerFunc(ReducerFunc::SUM)});
+        partial.push_back({"", count_field(result), FindReducerFunc(ReducerFunc::COUNT)});
+        merge.push_back({sum_field(result), sum_field(result), FindReducerFunc(ReducerFunc::SUM)});
+        merge.push_back(
+            {count_field(result), count_field(result), FindReducerFunc(ReducerFunc::SUM)});
+        averages.push_back(result);
+        continue;
+      case ReducerFunc::COUNT_DISTINCT:
+        return std::nullopt;
+    }
+    partial.push_back(std::move(reducer));
+  }
+
+  std::vector<std::string> group_fields(fields.begin(), fields.end());
+  PipelineStep merge_step = [group = GroupStep{group_fields, std::move(merge)},
+                             averages = std::move(averages), sum_field,
+                             count_field](std::vector<DocValues> values) mutable -> PipelineResult {
+    auto result = group(std::move(values));
+    for (DocValues& doc : *result) {
+      for (const auto& field : averages) {
+        auto sum = doc.extract(sum_field(field)), count = doc.extract(count_field(field));
+        doc[field] = std::get<double>(sum.mapped()) / std::get<double>(count.mapped());
+      }
+    }
+    return result;
+  };
+
+  return PartialGroupSteps{GroupStep{std::move(group_fields), std::move(partial)},
+                           std::move(merge_step)};
+}
+
 PipelineStep MakeSortStep(std::string_view field, bool descending) {
   return [field = std::string(field), descending](std::vector<DocValues> values) -> PipelineResult {
     std::sort(values.begin(), values.end(), [field](const DocValues& l, const DocValues& r) {
@@ -7,6 +7,7 @@
 #include <absl/container/flat_hash_map.h>
 #include <absl/types/span.h>
 
+#include <optional>
 #include <string>
 #include <variant>
 
@@ -75,6 +76,18 @@ Reducer::Func FindReducerFunc(ReducerFunc name);
 PipelineStep MakeGroupStep(absl::Span<const std::string_view> fields,
                            std::vector<Reducer> reducers);
 
+// GROUPBY split into a step that computes partial groups on every shard and a step that merges
+// the partial groups of all shards into final results.
+struct PartialGroupSteps {
+  PipelineStep shard, merge;
+};
+
+// Split `GROUPBY [fields...]` with REDUCE step, funcs are the functions of the reducers.
+// Returns nullopt if some reducer can't be computed from partial results, like COUNT_DISTINCT.
+std::optional<PartialGroupSteps> MakePartialGroupSteps(absl::Span<const std::string_view> fields,
+                                                       absl::Span<const ReducerFunc> funcs,
+                                                       std::vector<Reducer> reducers);
+
 // Make `SORTBY field [DESC]` step
 PipelineStep MakeSortStep(std::string_view field, bool descending = false);
 
@@ -104,4 +104,58 @@ TEST(AggregatorTest, GroupWithReduce) {
   EXPECT_EQ(result->at(1).at("distinct-null"), Value{(double)1});
 }
 
+TEST(AggregatorTest, PartialGroupBy) {
+  std::vector<DocValues> values[2];
+  for (size_t i = 0; i < 10; i++) {
+    values[i % 3 == 0].push_back(DocValues{
+        {"i", double(i)},
+        {"tag", i % 2 == 0 ? "even" : "odd"},
+    });
+  }
+
+  std::string_view fields[] = {"tag"};
+  ReducerFunc funcs[] = {ReducerFunc::COUNT, ReducerFunc::SUM, ReducerFunc::AVG, ReducerFunc::MIN};
+  std::vector<Reducer> reducers = {
+      Reducer{"", "count", FindReducerFunc(ReducerFunc::COUNT)},
+      Reducer{"i", "sum-i", FindReducerFunc(ReducerFunc::SUM)},
+      Reducer{"i", "avg-i", FindReducerFunc(ReducerFunc::AVG)},
+      Reducer{"i", "min-i", FindReducerFunc(ReducerFunc::MIN)}};
+
+  auto steps = MakePartialGroupSteps(fields, funcs, reducers);
+  ASSERT_TRUE(steps);
+
+  // Compute partial groups separately and merge them
+  std::vector<DocValues> partial;
+  for (auto& shard_values : values) {
+    auto result = steps->shard(std::move(shard_values));
+    ASSERT_TRUE(result);
+    partial.insert(partial.end(), result->begin(), result->end());
+  }
+
+  auto result = steps->merge(std::move(partial));
+  ASSERT_TRUE(result);
+  EXPECT_EQ(result->size(), 2);
+
+  // Reorder even first
+  if (result->at(0).at("tag") == Value("odd"))
+    std::swap(result->at(0), result->at(1));
+
+  EXPECT_EQ(result->at(0).size(), 5u);
+  EXPECT_EQ(result->at(0).at("count"), Value{(double)5});
+  EXPECT_EQ(result->at(0).at("sum-i"), Value{(double)2 + 4 + 6 + 8});
+  EXPECT_EQ(result->at(0).at("avg-i"), Value{(double)4});
+  EXPECT_EQ(result->at(0).at("min-i"), Value{(double)0});
+
+  EXPECT_EQ(result->at(1).at("count"), Value{(double)5});
+  EXPECT_EQ(result->at(1).at("sum-i"), Value{(double)1 + 3 + 5 + 7 + 9});
+  EXPECT_EQ(result->at(1).at("avg-i"), Value{(double)5});
+  EXPECT_EQ(result->at(1).at("min-i"), Value{(double)1});
+
+  // COUNT_DISTINCT can't be computed from partial results
+  ReducerFunc distinct_funcs[] = {ReducerFunc::COUNT_DISTINCT};
+  std::vector<Reducer> distinct = {
+      Reducer{"i", "distinct-i", FindReducerFunc(ReducerFunc::COUNT_DISTINCT)}};
+  EXPECT_FALSE(MakePartialGroupSteps(fields, distinct_funcs, distinct));
+}
+
 }  // namespace dfly::aggregate
@@ -4,6 +4,7 @@
 
 #include "server/search/doc_index.h"
 
+#include <absl/flags/flag.h>
 #include <absl/strings/str_join.h>
 
 #include <memory>
@@ -16,6 +17,9 @@
 #include "server/search/doc_accessors.h"
 #include "server/server_state.h"
 
+ABSL_FLAG(uint32_t, search_index_build_batch, 10000,
+          "Number of keys traversed by a search index build before yielding to other tasks");
+
 namespace dfly {
 
 using namespace std;
@@ -24,14 +28,20 @@ using nonstd::make_unexpected;
 
 namespace {
 
+// Traverse matching documents starting from cursor until at least `limit` keys were visited.
+// Returns the cursor to continue from and adds the number of visited keys to `visited`.
 template <typename F>
-void TraverseAllMatching(const DocIndex& index, const OpArgs& op_args, F&& f) {
+PrimeTable::Cursor TraverseMatching(const DocIndex& index, const OpArgs& op_args,
+                                    PrimeTable::Cursor cursor, size_t limit, size_t* visited,
+                                    F&& f) {
   auto& db_slice = op_args.GetDbSlice();
   DCHECK(db_slice.IsDbValid(op_args.db_cntx.db_index));
   auto [prime_table, _] = db_slice.GetTables(op_args.db_cntx.db_index);
 
+  size_t count = 0;
   string scratch;
   auto cb = [&](PrimeTable::iterator it) {
+    count++;
     const PrimeValue& pv = it->second;
     if (pv.ObjType() != index.GetObjCode())
       return;
@@ -40,14 +50,15 @@ void TraverseAllMatching(const DocIndex& index, const OpArgs& op_args, F&& f) {
     if (key.rfind(index.prefix, 0) != 0)
       return;
 
-    auto accessor = GetAccessor(op_args.db_cntx, pv);
-    f(key, *accessor);
+    f(key, pv);
   };
 
-  PrimeTable::Cursor cursor;
   do {
     cursor = prime_table->Traverse(cursor, cb);
-  } while (cursor);
+  } while (cursor && count < limit);
+
+  *visited += count;
+  return cursor;
 }
 
 }  // namespace
@@ -75,6 +86,8 @@ string_view SearchFieldTypeToString(search::SchemaField::FieldType type) {
       return "NUMERIC";
     case search::SchemaField::VECTOR:
       return "VECTOR";
+    case search::SchemaField::GEO:
+      return "GEO";
   }
   ABSL_UNREACHABLE();
   return "";
@@ -113,8 +126,12 @@ string DocIndexInfo::BuildRestoreCommand() const {
         [](monostate) {},
         [out = &out](const search::SchemaField::VectorParams& params) {
           auto sim = params.sim == search::VectorSimilarity::L2 ? "L2" : "COSINE";
-          absl::StrAppend(out, " ", params.use_hnsw ? "HNSW" : "FLAT", " 6 ", "DIM ", params.dim,
-                          " DISTANCE_METRIC ", sim, " INITIAL_CAP ", params.capacity);
+          bool quantized = params.quantization == search::VectorQuantization::INT8;
+          absl::StrAppend(out, " ", params.use_hnsw ? "HNSW" : "FLAT", quantized ? " 8 " : " 6 ",
+                          "DIM ", params.dim, " DISTANCE_METRIC ", sim, " INITIAL_CAP ",
+                          params.capacity);
+          if (quantized)
+            absl::StrAppend(out, " QUANTIZATION INT8");
         },
         [out = &out](const search::SchemaField::TagParams& params) {
           absl::StrAppend(out, " ", "SEPARATOR", " ", string{params.separator});
@@ -166,6 +183,10 @@ string_view ShardDocIndex::DocKeyIndex::Get(DocId id) const {
   return keys_[id];
 }
 
+bool ShardDocIndex::DocKeyIndex::Contains(string_view key) const {
+  return ids_.contains(key);
+}
+
 size_t ShardDocIndex::DocKeyIndex::Size() const {
   return ids_.size();
 }
@@ -182,20 +203,66 @@ ShardDocIndex::ShardDocIndex(shared_ptr<const DocIndex> index)
     : base_{std::move(index)}, key_index_{} {
 }
 
+ShardDocIndex::~ShardDocIndex() {
+  CancelBuild();
+}
+
 void ShardDocIndex::Rebuild(const OpArgs& op_args, PMR_NS::memory_resource* mr) {
+  CancelBuild();
+
   key_index_ = DocKeyIndex{};
   indices_.emplace(base_->schema, base_->options, mr);
 
-  auto cb = [this](string_view key, const BaseAccessor& doc) {
+  build_cursor_ = PrimeTable::Cursor{};
+  build_scanned_ = 0;
+  build_total_ = op_args.GetDbSlice().DbSize(op_args.db_cntx.db_index);
+
+  // Small keyspaces are indexed right away, so the index is complete once FT.CREATE returns
+  if (IndexBatch(op_args)) {
+    VLOG(1) << "Indexed " << key_index_.Size() << " docs on " << base_->prefix;
+    return;
+  }
+
+  building_ = true;
+  OpArgs build_args{op_args.shard, nullptr, op_args.db_cntx};
+  build_fb_ = util::fb2::Fiber("ft_index_build", [this, build_args]() mutable {
+    do {
+      util::ThisFiber::Yield();
+      build_args.db_cntx.time_now_ms = GetCurrentTimeMs();
+    } while (!cancel_build_ && !IndexBatch(build_args));
+
+    building_ = false;
+    VLOG(1) << "Indexed " << key_index_.Size() << " docs on " << base_->prefix
+            << (cancel_build_ ? " (cancelled)" : "");
+  });
+}
+
+bool ShardDocIndex::IndexBatch(const OpArgs& op_args) {
+  if (!op_args.GetDbSlice().IsDbValid(op_args.db_cntx.db_index))
+    return true;
+
+  auto cb = [&](string_view key, const PrimeValue& pv) {
+    // Documents written since the build started are already indexed by AddDoc. The same key can
+    // also be visited twice if the table grew between batches.
+    if (key_index_.Contains(key))
+      return;
+
+    auto accessor = GetAccessor(op_args.db_cntx, pv);
     DocId id = key_index_.Add(key);
-    if (!indices_->Add(id, doc)) {
+    if (!indices_->Add(id, *accessor)) {
       key_index_.Remove(key);
     }
   };
 
-  TraverseAllMatching(*base_, op_args, cb);
+  size_t limit = max(absl::GetFlag(FLAGS_search_index_build_batch), 1u);
+  build_cursor_ = TraverseMatching(*base_, op_args, build_cursor_, limit, &build_scanned_, cb);
+  return !build_cursor_;
+}
 
-  VLOG(1) << "Indexed " << key_index_.Size() << " docs on " << base_->prefix;
+void ShardDocIndex::CancelBuild() {
+  cancel_build_ = true;
+  build_fb_.JoinIfNeeded();
+  cancel_build_ = false;
 }
 
 void ShardDocIndex::AddDoc(string_view key, const DbContext& db_cntx, const PrimeValue& pv) {
@@ -235,8 +302,30 @@ SearchFieldsList ToSV(const search::Schema& schema, const std::optional<SearchFi
   return sv_fields;
 }
 
+SearchDocData ShardDocIndex::SerializeDoc(const DbContext& db_cntx, const PrimeValue& pv,
+                                          const SearchParams& params,
+                                          const SearchFieldsList& fields_to_load) const {
+  auto accessor = GetAccessor(db_cntx, pv);
+
+  if (!params.ShouldReturnAllFields()) {
+    /* Load only specific fields */
+    return accessor->Serialize(base_->schema, fields_to_load);
+  }
+
+  /*
+  In this case we need to load the whole document or loaded fields.
+  For JSON indexes it would be {"$", <the whole document as string>}
+  */
+  SearchDocData doc_data = accessor->SerializeDocument(base_->schema);
+
+  SearchDocData loaded_fields = accessor->Serialize(base_->schema, fields_to_load);
+  doc_data.insert(std::make_move_iterator(loaded_fields.begin()),
+                  std::make_move_iterator(loaded_fields.end()));
+  return doc_data;
+}
+
 SearchResult ShardDocIndex::Search(const OpArgs& op_args, const SearchParams& params,
-                                   search::SearchAlgorithm* search_algo) const {
+                                   search::SearchAlgorithm* search_algo, bool load_values) const {
   auto& db_slice = op_args.GetDbSlice();
   auto search_results = search_algo->Search(&*indices_, params.limit_offset + params.limit_total);
 
@@ -259,23 +348,9 @@ SearchResult ShardDocIndex::Search(const OpArgs& op_args, const SearchParams& pa
       continue;
     }
 
-    auto accessor = GetAccessor(op_args.db_cntx, (*it)->second);
-
     SearchDocData doc_data;
-    if (params.ShouldReturnAllFields()) {
-      /*
-      In this case we need to load the whole document or loaded fields.
-      For JSON indexes it would be {"$", <the whole document as string>}
-      */
-      doc_data = accessor->SerializeDocument(base_->schema);
-
-      SearchDocData loaded_fields = accessor->Serialize(base_->schema, fields_to_load);
-      doc_data.insert(std::make_move_iterator(loaded_fields.begin()),
-                      std::make_move_iterator(loaded_fields.end()));
-    } else {
-      /* Load only specific fields */
-      doc_data = accessor->Serialize(base_->schema, fields_to_load);
-    }
+    if (load_values)
+      doc_data = SerializeDoc(op_args.db_cntx, (*it)->second, params, fields_to_load);
 
     auto score = search_results.scores.empty() ? monostate{} : std::move(search_results.scores[i]);
     out.push_back(SerializedSearchDoc{string{key}, std::move(doc_data), std::move(score)});
@@ -285,6 +360,19 @@ SearchResult ShardDocIndex::Search(const OpArgs& op_args, const SearchParams& pa
                       std::move(search_results.profile)};
 }
 
+void ShardDocIndex::LoadValues(const OpArgs& op_args, const SearchParams& params,
+                               absl::Span<SerializedSearchDoc* const> docs) const {
+  auto& db_slice = op_args.GetDbSlice();
+  SearchFieldsList fields_to_load = ToSV(
+      base_->schema, params.ShouldReturnAllFields() ? params.load_fields : params.return_fields);
+
+  for (SerializedSearchDoc* doc : docs) {
+    auto it = db_slice.FindReadOnly(op_args.db_cntx, doc->key, base_->GetObjCode());
+    if (it && IsValid(*it))
+      doc->values = SerializeDoc(op_args.db_cntx, (*it)->second, params, fields_to_load);
+  }
+}
+
 using SortIndiciesFieldsList =
     std::vector<std::pair<string_view /*identifier*/, string_view /*alias*/>>;
 
@@ -356,15 +444,19 @@ vector<SearchDocData> ShardDocIndex::SearchForAggregator(
     if (!it || !IsValid(*it))  // Item must have expired
       continue;
 
-    auto accessor = GetAccessor(op_args.db_cntx, (*it)->second);
-
     SearchDocData extracted_sort_indicies;
     extracted_sort_indicies.reserve(sort_indicies.size());
     for (const auto& [fident, fname] : sort_indicies) {
       extracted_sort_indicies[fname] = indices_->GetSortIndexValue(doc, fident);
     }
 
-    SearchDocData loaded = accessor->Serialize(base_->schema, fields_to_load);
+    // Sortable fields are served from sort indices, the document itself is parsed only if other
+    // fields have to be loaded
+    SearchDocData loaded;
+    if (!fields_to_load.empty()) {
+      auto accessor = GetAccessor(op_args.db_cntx, (*it)->second);
+      loaded = accessor->Serialize(base_->schema, fields_to_load);
+    }
 
     out.emplace_back(make_move_iterator(extracted_sort_indicies.begin()),
                      make_move_iterator(extracted_sort_indicies.end()));
@@ -375,7 +467,11 @@ vector<SearchDocData> ShardDocIndex::SearchForAggregator(
 }
 
 DocIndexInfo ShardDocIndex::GetInfo() const {
-  return {*base_, key_index_.Size()};
+  DocIndexInfo info{*base_, key_index_.Size()};
+  info.indexing = building_;
+  if (building_ && build_total_ > 0)
+    info.percent_indexed = min(1.0, double(build_scanned_) / build_total_);
+  return info;
 }
 
 io::Result<StringVec, ErrorReply> ShardDocIndex::GetTagVals(string_view field) const {
@@ -5,6 +5,7 @@
 #pragma once
 
 #include <absl/container/flat_hash_map.h>
+#include <absl/types/span.h>
 
 #include <memory>
 #include <optional>
@@ -152,6 +153,9 @@ struct SearchParams {
   std::optional<search::SortOption> sort_option;
   search::QueryParams query_params;
 
+  bool score_results = false;  // SCORER BM25: rank text matches by relevance
+  bool with_scores = false;    // WITHSCORES: reply with document scores
+
   bool ShouldReturnAllFields() const {
     return !return_fields.has_value();
   }
@@ -169,6 +173,7 @@ struct AggregateParams {
 
   std::optional<SearchFieldsList> load_fields;
   std::vector<aggregate::PipelineStep> steps;
+  std::vector<aggregate::PipelineStep> shard_steps;  // executed on every shard before merging
 };
 
 // Stores basic info about a document index.
@@ -191,6 +196,9 @@ struct DocIndexInfo {
   DocIndex base_index;
   size_t num_docs = 0;
 
+  bool indexing = false;          // background build is still in progress
+  double percent_indexed = 1.0;  // share of the keyspace traversed by the build
+
   // Build original ft.create command that can be used to re-create this index
   std::string BuildRestoreCommand() const;
 };
@@ -208,6 +216,7 @@ class ShardDocIndex {
     std::optional<DocId> Remove(std::string_view key);
 
     std::string_view Get(DocId id) const;
+    bool Contains(std::string_view key) const;
     size_t Size() const;
 
    private:
@@ -220,10 +229,17 @@ class ShardDocIndex {
  public:
   // Index must be rebuilt at least once after intialization
   ShardDocIndex(std::shared_ptr<const DocIndex> index);
+  ~ShardDocIndex();
 
-  // Perform search on all indexed documents and return results.
+  // Perform search on all indexed documents and return results. If load_values is false, only
+  // keys and scores of the matched documents are returned, see LoadValues.
   SearchResult Search(const OpArgs& op_args, const SearchParams& params,
-                      search::SearchAlgorithm* search_algo) const;
+                      search::SearchAlgorithm* search_algo, bool load_values = true) const;
+
+  // Load values of documents returned by Search without values. Documents that expired since
+  // are left without values.
+  void LoadValues(const OpArgs& op_args, const SearchParams& params,
+                  absl::Span<SerializedSearchDoc* const> docs) const;
 
   // Perform search and load requested values - note params might be interpreted differently.
   std::vector<SearchDocData> SearchForAggregator(const OpArgs& op_args,
@@ -238,16 +254,40 @@ class ShardDocIndex {
 
   DocIndexInfo GetInfo() const;
 
+  // Returns true while documents are still being indexed in the background.
+  bool IsBuilding() const {
+    return building_;
+  }
+
   io::Result<StringVec, facade::ErrorReply> GetTagVals(std::string_view field) const;
 
  private:
-  // Clears internal data. Traverses all matching documents and assigns ids.
+  // Clears internal data and starts indexing all matching documents. The first batch is indexed
+  // synchronously, the rest of the keyspace is traversed by a background fiber that yields between
+  // batches. Documents written in the meantime are indexed by AddDoc/RemoveDoc as usual.
   void Rebuild(const OpArgs& op_args, PMR_NS::memory_resource* mr);
 
+  // Index the next batch of matching documents. Returns true if the traversal is complete.
+  bool IndexBatch(const OpArgs& op_args);
+
+  // Stop the background build if it's running.
+  void CancelBuild();
+
+  // Serialize document values requested by params.
+  SearchDocData SerializeDoc(const DbContext& db_cntx, const PrimeValue& pv,
+                             const SearchParams& params,
+                             const SearchFieldsList& fields_to_load) const;
+
  private:
   std::shared_ptr<const DocIndex> base_;
   std::optional<search::FieldIndices> indices_;
   DocKeyIndex key_index_;
+
+  // Background build state
+  PrimeTable::Cursor build_cursor_;
+  size_t build_scanned_ = 0, build_total_ = 0;  // keys traversed / keys in db at build start
+  bool building_ = false, cancel_build_ = false;
+  util::fb2::Fiber build_fb_;
 };
 
 // Stores shard doc indices by name on a specific shard.
@@ -5,8 +5,10 @@
 #include "server/search/search_family.h"
 
 #include <absl/container/flat_hash_map.h>
+#include <absl/flags/flag.h>
 #include <absl/strings/ascii.h>
 #include <absl/strings/match.h>
+#include <absl/strings/str_cat.h>
 #include <absl/strings/str_format.h>
 
 #include <atomic>
@@ -16,6 +18,7 @@
 #include "base/logging.h"
 #include "core/search/search.h"
 #include "core/search/vector_utils.h"
+#include "core/string_lru_cache.h"
 #include "facade/cmd_arg_parser.h"
 #include "facade/error.h"
 #include "facade/reply_builder.h"
@@ -26,9 +29,13 @@
 #include "server/engine_shard_set.h"
 #include "server/search/aggregator.h"
 #include "server/search/doc_index.h"
+#include "server/server_state.h"
 #include "server/transaction.h"
 #include "src/core/overloaded.h"
 
+ABSL_FLAG(uint32_t, search_query_cache_size, 256,
+          "Maximal number of parsed search queries cached per thread. 0 disables the cache.");
+
 namespace dfly {
 
 using namespace std;
@@ -38,6 +45,81 @@ namespace {
 
 static const set<string_view> kIgnoredOptions = {"WEIGHT", "SEPARATOR"};
 
+// Queries with big params, like KNN vectors, are rarely repeated and would only evict other entries
+constexpr size_t kMaxCachedParamsSize = 256;
+
+// Per-thread cache of parsed queries. Params are bound while parsing, so the key consists of
+// the index name, the normalized query text and the param values. Hot queries are repeated with
+// the same few params, so this saves parsing them for every command.
+thread_local StringLruCache<shared_ptr<const search::AstNode>> tl_query_cache{
+    &FLAGS_search_query_cache_size};
+
+// Append query with all whitespace runs outside of quotes and escapes collapsed to a single space
+void AppendNormalizedQuery(string_view query, string* out) {
+  char quote = 0;
+  bool escaped = false, space = false;
+  for (char c : absl::StripAsciiWhitespace(query)) {
+    if (escaped) {
+      escaped = false;
+    } else if (c == '\\') {
+      escaped = true;
+    } else if (quote != 0) {
+      quote = c == quote ? 0 : quote;
+    } else if (absl::ascii_isspace(c)) {
+      space = true;
+      continue;
+    } else if (c == '"' || c == '\'') {
+      quote = c;
+    }
+
+    if (space)
+      out->push_back(' ');
+    space = false;
+    out->push_back(c);
+  }
+}
+
+// Returns nullopt if the query should not be cached
+optional<string> QueryCacheKey(string_view index_name, string_view query,
+                               const search::QueryParams& params) {
+  vector<pair<string_view, string_view>> sorted_params(params.begin(), params.end());
+  sort(sorted_params.begin(), sorted_params.end());
+
+  size_t params_size = 0;
+  for (const auto& [name, value] : sorted_params)
+    params_size += name.size() + value.size();
+  if (params_size > kMaxCachedParamsSize)
+    return nullopt;
+
+  string key{index_name};
+  key.push_back('\0');
+  AppendNormalizedQuery(query, &key);
+  for (const auto& [name, value] : sorted_params)
+    absl::StrAppend(&key, string_view{"\0", 1}, name, "=", value);
+  return key;
+}
+
+// Parse query or take it from the cache, returns nullptr if the query is not valid
+shared_ptr<const search::AstNode> ParseQuery(string_view index_name, string_view query,
+                                             const search::QueryParams& params) {
+  optional<string> key;
+  if (tl_query_cache.capacity() > 0)
+    key = QueryCacheKey(index_name, query, params);
+
+  if (key) {
+    auto& stats = ServerState::tlocal()->stats;
+    if (auto cached = tl_query_cache.Get(*key, &stats.search_query_cache_hits,
+                                         &stats.search_query_cache_misses);
+        cached)
+      return cached;
+  }
+
+  auto parsed = search::SearchAlgorithm::Parse(query, &params);
+  if (parsed && key)
+    tl_query_cache.Put(std::move(*key), parsed);
+  return parsed;
+}
+
 bool IsValidJsonPath(string_view path) {
   error_code ec;
   MakeJsonPathExpr(path, ec);
@@ -58,6 +140,9 @@ search::SchemaField::VectorParams ParseVectorParams(CmdArgParser* parser) {
     } else if (parser->Check("INITIAL_CAP", &params.capacity)) {
     } else if (parser->Check("M", &params.hnsw_m)) {
     } else if (parser->Check("EF_CONSTRUCTION", &params.hnsw_ef_construction)) {
+    } else if (parser->Check("QUANTIZATION")) {
+      params.quantization = parser->MapNext("NONE", search::VectorQuantization::NONE, "INT8",
+                                            search::VectorQuantization::INT8);
     } else if (parser->Check("EF_RUNTIME")) {
       parser->Next<size_t>();
       LOG(WARNING) << "EF_RUNTIME not supported";
@@ -124,7 +209,8 @@ optional<search::Schema> ParseSchemaOrReply(DocIndex::DataType type, CmdArgParse
     // Determine type
     using search::SchemaField;
     auto type = parser.MapNext("TAG", SchemaField::TAG, "TEXT", SchemaField::TEXT, "NUMERIC",
-                               SchemaField::NUMERIC, "VECTOR", SchemaField::VECTOR);
+                               SchemaField::NUMERIC, "VECTOR", SchemaField::VECTOR, "GEO",
+                               SchemaField::GEO);
     if (auto err = parser.Error(); err) {
       builder->SendError(err->MakeReply());
       return nullopt;
@@ -152,6 +238,13 @@ optional<search::Schema> ParseSchemaOrReply(DocIndex::DataType type, CmdArgParse
         builder->SendError("Knn vector dimension cannot be zero", kSyntaxErrType);
         return nullopt;
       }
+
+      if (vector_params.use_hnsw &&
+          vector_params.quantization != search::VectorQuantization::NONE) {
+        builder->SendError("QUANTIZATION is supported only for FLAT vector indices",
+                           kSyntaxErrType);
+        return nullopt;
+      }
       params = vector_params;
     }
 
@@ -292,6 +385,11 @@ optional<SearchParams> ParseSearchParamsOrReply(CmdArgParser* parser, SinkReplyB
     } else if (parser->Check("SORTBY")) {
       params.sort_option =
           search::SortOption{parser->Next<std::string>(), bool(parser->Check("DESC"))};
+    } else if (parser->Check("SCORER")) {
+      parser->ExpectTag("BM25");
+      params.score_results = true;
+    } else if (parser->Check("WITHSCORES")) {
+      params.with_scores = true;
     } else {
       // Unsupported parameters are ignored for now
       parser->Skip(1);
@@ -317,6 +415,11 @@ optional<AggregateParams> ParseAggregatorParamsOrReply(CmdArgParser parser,
     ParseLoadFields(&parser, &params.load_fields);
   }
 
+  // Steps are pushed down to shards while shard results can still be merged by the coordinator.
+  // SORTBY is pushed down only together with a following LIMIT, making it a per shard top-k.
+  bool push_down = true;
+  optional<aggregate::PipelineStep> pending_sort;
+
   while (parser.HasNext()) {
     // GROUPBY nargs property [property ...]
     if (parser.Check("GROUPBY")) {
@@ -337,6 +440,7 @@ optional<AggregateParams> ParseAggregatorParamsOrReply(CmdArgParser parser,
       }
 
       vector<aggregate::Reducer> reducers;
+      vector<aggregate::ReducerFunc> reducer_funcs;
       while (parser.Check("REDUCE")) {
         using RF = aggregate::ReducerFunc;
         auto func_name =
@@ -361,9 +465,21 @@ optional<AggregateParams> ParseAggregatorParamsOrReply(CmdArgParser parser,
 
         reducers.push_back(
             aggregate::Reducer{std::move(source_field), std::move(result_field), std::move(func)});
+        reducer_funcs.push_back(*func_name);
       }
 
-      params.steps.push_back(aggregate::MakeGroupStep(fields, std::move(reducers)));
+      // The leading GROUPBY is computed partially on every shard if its reducers allow it
+      optional<aggregate::PartialGroupSteps> partial;
+      if (params.steps.empty())
+        partial = aggregate::MakePartialGroupSteps(fields, reducer_funcs, reducers);
+
+      if (partial) {
+        params.shard_steps.push_back(std::move(partial->shard));
+        params.steps.push_back(std::move(partial->merge));
+      } else {
+        params.steps.push_back(aggregate::MakeGroupStep(fields, std::move(reducers)));
+      }
+      push_down = false;
       continue;
     }
 
@@ -374,6 +490,8 @@ optional<AggregateParams> ParseAggregatorParamsOrReply(CmdArgParser parser,
       bool desc = bool(parser.Check("DESC"));
 
       params.steps.push_back(aggregate::MakeSortStep(field, desc));
+      if (push_down)
+        pending_sort = aggregate::MakeSortStep(field, desc);
       continue;
     }
 
@@ -381,6 +499,15 @@ optional<AggregateParams> ParseAggregatorParamsOrReply(CmdArgParser parser,
     if (parser.Check("LIMIT")) {
       auto [offset, num] = parser.Next<size_t, size_t>();
       params.steps.push_back(aggregate::MakeLimitStep(offset, num));
+
+      // Every shard returns only its first offset + num results, the coordinator limits again
+      if (push_down) {
+        if (pending_sort)
+          params.shard_steps.push_back(std::move(*pending_sort));
+        size_t shard_limit = num > SIZE_MAX - offset ? SIZE_MAX : offset + num;
+        params.shard_steps.push_back(aggregate::MakeLimitStep(0, shard_limit));
+      }
+      push_down = false;
       continue;
     }
 
@@ -415,11 +542,22 @@ auto SortableValueSender(RedisReplyBuilder* rb) {
   };
 }
 
-void SendSerializedDoc(const SerializedSearchDoc& doc, SinkReplyBuilder* builder) {
+// Send numeric scores (relevance or KNN distance), 0 for documents ordered by other means.
+void SendScore(const search::ResultScore& score, RedisReplyBuilder* rb) {
+  Overloaded sender{[rb](float value) { rb->SendDouble(value); },
+                    [rb](double value) { rb->SendDouble(value); },
+                    [rb](const auto&) { rb->SendLong(0); }};
+  visit(sender, score);
+}
+
+void SendSerializedDoc(const SerializedSearchDoc& doc, bool with_score,
+                       SinkReplyBuilder* builder) {
   auto* rb = static_cast<RedisReplyBuilder*>(builder);
   auto sortable_value_sender = SortableValueSender(rb);
 
   rb->SendBulkString(doc.key);
+  if (with_score)
+    SendScore(doc.score, rb);
   rb->StartCollection(doc.values.size(), RedisReplyBuilder::MAP);
   for (const auto& [k, v] : doc.values) {
     rb->SendBulkString(k);
@@ -461,13 +599,15 @@ void ReplyWithResults(const SearchParams& params, absl::Span<SearchResult> resul
       if (ids_only)
         rb->SendBulkString(serialized_doc.key);
       else
-        SendSerializedDoc(serialized_doc, builder);
+        SendSerializedDoc(serialized_doc, false, builder);
     }
   }
 }
 
-void ReplySorted(search::AggregationInfo agg, const SearchParams& params,
-                 absl::Span<SearchResult> results, SinkReplyBuilder* builder) {
+// Select the documents of the reply page from all shard results, ordered by their scores.
+// Returns the total number of matches to report.
+size_t SelectSorted(const search::AggregationInfo& agg, const SearchParams& params,
+                    absl::Span<SearchResult> results, vector<SerializedSearchDoc*>* page) {
   size_t total = 0;
   vector<SerializedSearchDoc*> docs;
   for (auto& shard_results : results) {
@@ -489,8 +629,16 @@ void ReplySorted(search::AggregationInfo agg, const SearchParams& params,
 
   size_t start_idx = min(params.limit_offset, docs.size());
   size_t result_count = min(docs.size() - start_idx, params.limit_total);
+  page->assign(docs.begin() + start_idx, docs.begin() + start_idx + result_count);
+
+  return min(total, agg_limit);
+}
+
+void ReplySorted(search::AggregationInfo agg, const SearchParams& params, size_t total,
+                 absl::Span<SerializedSearchDoc* const> page, SinkReplyBuilder* builder) {
   bool ids_only = params.IdsOnly();
-  size_t reply_size = ids_only ? (result_count + 1) : (result_count * 2 + 1);
+  size_t entry_size = (ids_only ? 1 : 2) + (params.with_scores ? 1 : 0);
+  size_t reply_size = page.size() * entry_size + 1;
 
   // Clear score alias if it's excluded from return values
   if (!params.ShouldReturnField(agg.alias))
@@ -499,17 +647,19 @@ void ReplySorted(search::AggregationInfo agg, const SearchParams& params,
   facade::SinkReplyBuilder::ReplyAggregator agg_reply{builder};
   auto* rb = static_cast<RedisReplyBuilder*>(builder);
   rb->StartArray(reply_size);
-  rb->SendLong(min(total, agg_limit));
-  for (auto* doc : absl::MakeSpan(docs).subspan(start_idx, result_count)) {
+  rb->SendLong(total);
+  for (auto* doc : page) {
     if (ids_only) {
       rb->SendBulkString(doc->key);
+      if (params.with_scores)
+        SendScore(doc->score, rb);
       continue;
     }
 
     if (!agg.alias.empty() && holds_alternative<float>(doc->score))
       doc->values[agg.alias] = absl::StrCat(get<float>(doc->score));
 
-    SendSerializedDoc(*doc, builder);
+    SendSerializedDoc(*doc, params.with_scores, builder);
   }
 }
 
@@ -687,14 +837,19 @@ void SearchFamily::FtInfo(CmdArgList args, Transaction* tx, SinkReplyBuilder* bu
          infos.back().base_index.schema.fields.size());
 
   size_t total_num_docs = 0;
-  for (const auto& info : infos)
+  bool indexing = false;
+  double percent_indexed = 0;
+  for (const auto& info : infos) {
     total_num_docs += info.num_docs;
+    indexing |= info.indexing;
+    percent_indexed += info.percent_indexed / infos.size();
+  }
 
   const auto& info = infos.front();
   const auto& schema = info.base_index.schema;
 
   auto* rb = static_cast<RedisReplyBuilder*>(builder);
-  rb->StartCollection(4, RedisReplyBuilder::MAP);
+  rb->StartCollection(6, RedisReplyBuilder::MAP);
 
   rb->SendSimpleString("index_name");
   rb->SendSimpleString(idx_name);
@@ -729,6 +884,12 @@ void SearchFamily::FtInfo(CmdArgList args, Transaction* tx, SinkReplyBuilder* bu
 
   rb->SendSimpleString("num_docs");
   rb->SendLong(total_num_docs);
+
+  rb->SendSimpleString("indexing");
+  rb->SendLong(indexing);
+
+  rb->SendSimpleString("percent_indexed");
+  rb->SendDouble(indexing ? percent_indexed : 1.0);
 }
 
 void SearchFamily::FtList(CmdArgList args, Transaction* tx, SinkReplyBuilder* builder) {
@@ -754,35 +915,75 @@ void SearchFamily::FtSearch(CmdArgList args, Transaction* tx, SinkReplyBuilder*
   if (!params.has_value())
     return;
 
+  auto query = ParseQuery(index_name, query_str, params->query_params);
+  if (!query)
+    return builder->SendError("Query syntax error");
+
   search::SearchAlgorithm search_algo;
   search::SortOption* sort_opt = params->sort_option.has_value() ? &*params->sort_option : nullptr;
-  if (!search_algo.Init(query_str, &params->query_params, sort_opt))
-    return builder->SendError("Query syntax error");
+  search_algo.Init(std::move(query), sort_opt);
+
+  if (params->score_results || params->with_scores)
+    search_algo.EnableScoring();
+
+  auto agg = search_algo.HasAggregation();
+
+  // Sorted results (KNN or SORTBY) are merged on the coordinator and every shard returns up to
+  // limit candidates. To avoid serializing documents that don't make it into the reply, shards
+  // first return only keys and scores, and values are loaded in a second hop for the selected page.
+  bool two_phase = agg && !params->IdsOnly() && shard_set->size() > 1;
 
   // Because our coordinator thread may not have a shard, we can't check ahead if the index exists.
   atomic<bool> index_not_found{false};
   vector<SearchResult> docs(shard_set->size());
 
-  tx->ScheduleSingleHop([&](Transaction* t, EngineShard* es) {
+  auto search_cb = [&](Transaction* t, EngineShard* es) {
     if (auto* index = es->search_indices()->GetIndex(index_name); index)
-      docs[es->shard_id()] = index->Search(t->GetOpArgs(es), *params, &search_algo);
+      docs[es->shard_id()] = index->Search(t->GetOpArgs(es), *params, &search_algo, !two_phase);
     else
       index_not_found.store(true, memory_order_relaxed);
     return OpStatus::OK;
-  });
+  };
+  tx->Execute(search_cb, !two_phase);
 
-  if (index_not_found.load())
-    return builder->SendError(string{index_name} + ": no such index");
+  optional<ErrorReply> error;
+  if (index_not_found.load()) {
+    error = ErrorReply{string{index_name} + ": no such index"};
+  } else {
+    for (auto& res : docs) {
+      if (res.error) {
+        error = std::move(res.error);
+        break;
+      }
+    }
+  }
+
+  if (error) {
+    if (two_phase)
+      tx->Conclude();
+    return builder->SendError(*error);
+  }
+
+  if (!agg)
+    return ReplyWithResults(*params, absl::MakeSpan(docs), builder);
+
+  vector<SerializedSearchDoc*> page;
+  size_t total = SelectSorted(*agg, *params, absl::MakeSpan(docs), &page);
 
-  for (const auto& res : docs) {
-    if (res.error)
-      return builder->SendError(*res.error);
+  if (two_phase) {
+    vector<vector<SerializedSearchDoc*>> shard_pages(shard_set->size());
+    for (auto* doc : page)
+      shard_pages[Shard(doc->key, shard_set->size())].push_back(doc);
+
+    auto load_cb = [&](Transaction* t, EngineShard* es) {
+      if (auto* index = es->search_indices()->GetIndex(index_name); index)
+        index->LoadValues(t->GetOpArgs(es), *params, shard_pages[es->shard_id()]);
+      return OpStatus::OK;
+    };
+    tx->Execute(load_cb, true);
   }
 
-  if (auto agg = search_algo.HasAggregation(); agg)
-    ReplySorted(*agg, *params, absl::MakeSpan(docs), builder);
-  else
-    ReplyWithResults(*params, absl::MakeSpan(docs), builder);
+  ReplySorted(*agg, *params, total, page, builder);
 }
 
 void SearchFamily::FtProfile(CmdArgList args, Transaction* tx, SinkReplyBuilder* builder) {
@@ -803,11 +1004,16 @@ void SearchFamily::FtProfile(CmdArgList args, Transaction* tx, SinkReplyBuilder*
   if (!params.has_value())
     return;
 
+  auto query = ParseQuery(index_name, query_str, params->query_params);
+  if (!query)
+    return builder->SendError("query syntax error");
+
   search::SearchAlgorithm search_algo;
   search::SortOption* sort_opt = params->sort_option.has_value() ? &*params->sort_option : nullptr;
-  if (!search_algo.Init(query_str, &params->query_params, sort_opt))
-    return builder->SendError("query syntax error");
+  search_algo.Init(std::move(query), sort_opt);
 
+  if (params->score_results || params->with_scores)
+    search_algo.EnableScoring();
   search_algo.EnableProfiling();
 
   absl::Time start = absl::Now();
@@ -860,7 +1066,9 @@ void SearchFamily::FtProfile(CmdArgList args, Transaction* tx, SinkReplyBuilder*
   if (!result_is_empty) {
     auto agg = search_algo.HasAggregation();
     if (agg) {
-      ReplySorted(*agg, *params, absl::MakeSpan(search_results), builder);
+      vector<SerializedSearchDoc*> page;
+      size_t total = SelectSorted(*agg, *params, absl::MakeSpan(search_results), &page);
+      ReplySorted(*agg, *params, total, page, builder);
     } else {
       ReplyWithResults(*params, absl::MakeSpan(search_results), builder);
     }
@@ -958,26 +1166,29 @@ void SearchFamily::FtAggregate(CmdArgList args, Transaction* tx, SinkReplyBuilde
   if (!params)
     return;
 
-  search::SearchAlgorithm search_algo;
-  if (!search_algo.Init(params->query, &params->params, nullptr))
+  auto query = ParseQuery(params->index, params->query, params->params);
+  if (!query)
     return builder->SendError("Query syntax error");
 
-  using ResultContainer = decltype(declval<ShardDocIndex>().SearchForAggregator(
-      declval<OpArgs>(), params.value(), &search_algo));
+  search::SearchAlgorithm search_algo;
+  search_algo.Init(std::move(query));
 
-  vector<ResultContainer> query_results(shard_set->size());
+  // Shards run the pushed down steps on their matches, so only partial results are merged here
+  vector<aggregate::PipelineResult> query_results(shard_set->size());
   tx->ScheduleSingleHop([&](Transaction* t, EngineShard* es) {
     if (auto* index = es->search_indices()->GetIndex(params->index); index) {
-      query_results[es->shard_id()] =
-          index->SearchForAggregator(t->GetOpArgs(es), params.value(), &search_algo);
+      auto docs = index->SearchForAggregator(t->GetOpArgs(es), params.value(), &search_algo);
+      query_results[es->shard_id()] = aggregate::Process(std::move(docs), params->shard_steps);
     }
     return OpStatus::OK;
   });
 
   vector<aggregate::DocValues> values;
   for (auto& sub_results : query_results) {
-    values.insert(values.end(), make_move_iterator(sub_results.begin()),
-                  make_move_iterator(sub_results.end()));
+    if (!sub_results.has_value())
+      return builder->SendError(sub_results.error());
+    values.insert(values.end(), make_move_iterator(sub_results->begin()),
+                  make_move_iterator(sub_results->end()));
   }
 
   auto agg_results = aggregate::Process(std::move(values), params->steps);
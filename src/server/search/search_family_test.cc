@@ -4,12 +4,17 @@
 
 #include "server/search/search_family.h"
 
+#include <absl/flags/flag.h>
+#include <absl/strings/numbers.h>
+
 #include "base/gtest.h"
 #include "base/logging.h"
 #include "facade/facade_test.h"
 #include "server/command_registry.h"
 #include "server/test_utils.h"
 
+ABSL_DECLARE_FLAG(uint32_t, search_index_build_batch);
+
 using namespace testing;
 using namespace std;
 using namespace util;
@@ -272,7 +277,40 @@ TEST_F(SearchFamilyTest, InfoIndex) {
   EXPECT_THAT(info,
               IsArray(_, _, _, IsArray("key_type", "HASH", "prefix", "doc-"), "attributes",
                       IsArray(IsArray("identifier", "name", "attribute", "name", "type", "TEXT")),
-                      "num_docs", IntArg(15)));
+                      "num_docs", IntArg(15), "indexing", IntArg(0), "percent_indexed", "1"));
+}
+
+TEST_F(SearchFamilyTest, BackgroundIndexBuild) {
+  absl::FlagSaver fs;
+  absl::SetFlag(&FLAGS_search_index_build_batch, 5u);
+
+  for (size_t i = 0; i < 300; i++)
+    Run({"hset", absl::StrCat("doc-", i), "name", "some", "num", absl::StrCat(i)});
+
+  EXPECT_EQ(Run({"ft.create", "idx", "ON", "HASH", "PREFIX", "1", "doc-", "SCHEMA", "name", "TEXT",
+                 "num", "NUMERIC"}),
+            "OK");
+
+  // Modify the keyspace while the index is being built
+  for (size_t i = 0; i < 20; i++)
+    Run({"del", absl::StrCat("doc-", i)});
+  for (size_t i = 300; i < 320; i++)
+    Run({"hset", absl::StrCat("doc-", i), "name", "some", "num", absl::StrCat(i)});
+  Run({"hset", "doc-50", "name", "other"});
+
+  for (size_t i = 0; i < 1000; i++) {
+    auto info = Run({"ft.info", "idx"});
+    if (info.GetVec()[9].GetInt() == 0)
+      break;
+    ThisFiber::SleepFor(1ms);
+  }
+
+  EXPECT_THAT(Run({"ft.info", "idx"}), IsArray(_, _, _, _, _, _, "num_docs", IntArg(300),
+                                                "indexing", IntArg(0), "percent_indexed", "1"));
+  EXPECT_THAT(Run({"ft.search", "idx", "some", "LIMIT", "0", "0"}), IntArg(299));
+  EXPECT_THAT(Run({"ft.search", "idx", "@num:[0 19]", "LIMIT", "0", "0"}), IntArg(0));
+  EXPECT_THAT(Run({"ft.search", "idx", "@num:[300 400]", "LIMIT", "0", "0"}), IntArg(20));
+  EXPECT_THAT(Run({"ft.search", "idx", "other"}), AreDocIds("doc-50"));
 }
 
 TEST_F(SearchFamilyTest, Stats) {
@@ -807,6 +845,95 @@ TEST_F(SearchFamilyTest, BasicSort) {
                 AreRange(10, 10 - i, 10 - i - 3, "d2:"));
 }
 
+TEST_F(SearchFamilyTest, GeoSearch) {
+  Run({"ft.create", "i1", "prefix", "1", "s:", "schema", "loc", "geo", "tags", "tag"});
+
+  Run({"hset", "s:1", "loc", "-122.4194,37.7749", "tags", "open"});
+  Run({"hset", "s:2", "loc", "-122.2711,37.8044", "tags", "open"});
+  Run({"hset", "s:3", "loc", "-122.4313,37.7739", "tags", "closed"});
+  Run({"hset", "s:4", "loc", "-118.2437,34.0522", "tags", "open"});
+
+  EXPECT_THAT(Run({"ft.search", "i1", "@loc:[-122.42 37.77 5 km]"}), AreDocIds("s:1", "s:3"));
+  EXPECT_THAT(Run({"ft.search", "i1", "@loc:[-122.42 37.77 50 km] @tags:{open}"}),
+              AreDocIds("s:1", "s:2"));
+  EXPECT_THAT(Run({"ft.search", "i1", "@loc:[-122.42 37.77 40 10 km]"}),
+              AreDocIds("s:1", "s:2", "s:3"));
+
+  // Nearest first, distances across shards are merged on the coordinator
+  auto resp = Run({"ft.search", "i1", "@loc:[-122.42 37.77 1000 mi]", "SORTBY", "loc", "LIMIT",
+                   "0", "3", "NOCONTENT"});
+  EXPECT_THAT(resp, IsArray(IntArg(4), "s:1", "s:3", "s:2"));
+
+  EXPECT_THAT(Run({"ft.search", "i1", "@loc:[-122.42 37.77 5 parsec]"}),
+              ErrArg("Query syntax error"));
+}
+
+TEST_F(SearchFamilyTest, QueryCache) {
+  Run({"ft.create", "i1", "schema", "title", "text", "price", "numeric"});
+  Run({"hset", "d:1", "title", "red apple", "price", "10"});
+  Run({"hset", "d:2", "title", "green apple", "price", "20"});
+
+  const uint64_t hits = GetMetrics().coordinator_stats.search_query_cache_hits;
+  EXPECT_THAT(Run({"ft.search", "i1", "apple @price:[0 15]"}), AreDocIds("d:1"));
+  EXPECT_THAT(Run({"ft.search", "i1", "  apple   @price:[0 15] "}), AreDocIds("d:1"));
+  EXPECT_EQ(GetMetrics().coordinator_stats.search_query_cache_hits, hits + 1);
+
+  // Params are bound while parsing, so every value gets its own entry
+  for (string_view max_price : {"15", "25", "15"}) {
+    auto resp = Run({"ft.search", "i1", "apple @price:[0 $max]", "PARAMS", "2", "max", max_price});
+    EXPECT_THAT(resp, max_price == "15" ? AreDocIds("d:1") : AreDocIds("d:1", "d:2"));
+  }
+  EXPECT_EQ(GetMetrics().coordinator_stats.search_query_cache_hits, hits + 2);
+
+  // Whitespace inside quotes is preserved, so these are different queries
+  EXPECT_THAT(Run({"ft.search", "i1", "'red  apple'"}), kNoResults);
+  EXPECT_THAT(Run({"ft.search", "i1", "'red apple'"}), kNoResults);
+  EXPECT_EQ(GetMetrics().coordinator_stats.search_query_cache_hits, hits + 2);
+}
+
+TEST_F(SearchFamilyTest, KnnValuesAcrossShards) {
+  Run({"ft.create", "i1", "schema", "pos", "vector", "flat", "4", "dim", "1", "distance_metric",
+       "l2", "title", "text"});
+
+  for (size_t i = 0; i < 20; i++) {
+    float pos = i;
+    Run({"hset", absl::StrCat("d:", i), "title", absl::StrCat("title", i), "pos",
+         string_view{reinterpret_cast<const char*>(&pos), sizeof(float)}});
+  }
+
+  // Values are loaded only for the global top documents, which come from different shards
+  float target = 7.2;
+  auto resp = Run({"ft.search", "i1", "* => [KNN 3 @pos $vec]", "RETURN", "1", "title", "PARAMS",
+                   "2", "vec", string_view{reinterpret_cast<const char*>(&target), sizeof(float)}});
+  EXPECT_THAT(resp, RespArray(ElementsAre(IntArg(3), "d:7", IsMap("title", "title7"), "d:8",
+                                          IsMap("title", "title8"), "d:6",
+                                          IsMap("title", "title6"))));
+}
+
+TEST_F(SearchFamilyTest, ScorerBM25) {
+  Run({"ft.create", "i1", "schema", "title", "text"});
+  Run({"hset", "d:1", "title", "dragonfly and many other words about some other things"});
+  Run({"hset", "d:2", "title", "dragonfly dragonfly"});
+  Run({"hset", "d:3", "title", "something else"});
+
+  auto resp = Run({"ft.search", "i1", "dragonfly", "SCORER", "BM25", "NOCONTENT"});
+  EXPECT_THAT(resp, RespArray(ElementsAre(IntArg(2), "d:2", "d:1")));
+
+  resp = Run({"ft.search", "i1", "dragonfly", "WITHSCORES", "RETURN", "1", "title"});
+  ASSERT_THAT(resp, ArrLen(7));
+  const auto& results = resp.GetVec();
+  EXPECT_EQ(results[1], "d:2");
+  EXPECT_EQ(results[4], "d:1");
+
+  double first = 0, second = 0;
+  ASSERT_TRUE(absl::SimpleAtod(results[2].GetString(), &first));
+  ASSERT_TRUE(absl::SimpleAtod(results[5].GetString(), &second));
+  EXPECT_GT(first, second);
+  EXPECT_THAT(results[6], IsMap("title", "dragonfly and many other words about some other things"));
+
+  EXPECT_THAT(Run({"ft.search", "i1", "dragonfly", "SCORER", "TFIDF"}), ErrArg("syntax error"));
+}
+
 TEST_F(SearchFamilyTest, FtProfile) {
   Run({"ft.create", "i1", "schema", "name", "text"});
 
@@ -1033,6 +1160,35 @@ TEST_F(SearchFamilyTest, AggregateGroupByReduceSort) {
                                          "distinct_vals", "51", "max_val", "100", "min_val", "0")));
 }
 
+TEST_F(SearchFamilyTest, AggregatePartialResults) {
+  for (size_t i = 0; i < 100; i++) {
+    Run({"hset", absl::StrCat("k", i), "even", (i % 2 == 0) ? "true" : "false", "value",
+         absl::StrCat(i)});
+  }
+  Run({"ft.create", "i1", "schema", "even", "tag", "sortable", "value", "numeric", "sortable"});
+
+  // Groups are reduced on every shard and merged afterwards
+  // clang-format off
+  auto resp = Run({"ft.aggregate", "i1", "*",
+                  "GROUPBY", "1", "@even",
+                      "REDUCE", "count", "0", "as", "count",
+                      "REDUCE", "sum", "1", "value", "as", "sum_val",
+                      "REDUCE", "avg", "1", "value", "as", "avg_val",
+                      "REDUCE", "max", "1", "value", "as", "max_val"});
+  // clang-format on
+  EXPECT_THAT(resp, IsUnordArrayWithSize(IsMap("even", "false", "count", "50", "sum_val", "2500",
+                                               "avg_val", "50", "max_val", "99"),
+                                         IsMap("even", "true", "count", "50", "sum_val", "2450",
+                                               "avg_val", "49", "max_val", "98")));
+
+  // Every shard returns only its top results
+  resp = Run({"ft.aggregate", "i1", "*", "LOAD", "1", "@value", "SORTBY", "1", "value", "DESC",
+              "LIMIT", "1", "3"});
+  EXPECT_THAT(resp, IsArray(IntArg(3), IsMap("value", "98", "even", "true"),
+                            IsMap("value", "97", "even", "false"),
+                            IsMap("value", "96", "even", "true")));
+}
+
 TEST_F(SearchFamilyTest, AggregateLoadGroupBy) {
   for (size_t i = 0; i < 101; i++) {  // 51 even, 50 odd
     Run({"hset", absl::StrCat("k", i), "even", (i % 2 == 0) ? "true" : "false", "value",
@@ -1073,6 +1229,14 @@ TEST_F(SearchFamilyTest, Vector) {
   auto resp = Run({"ft.create", "ann", "ON", "HASH", "SCHEMA", "vector", "VECTOR", "HNSW", "8",
                    "TYPE", "FLOAT32", "DIM", "100", "distance_metric", "cosine", "M", "64"});
   EXPECT_EQ(resp, "OK");
+
+  resp = Run({"ft.create", "ann-q", "ON", "HASH", "SCHEMA", "vector", "VECTOR", "HNSW", "8",
+              "TYPE", "FLOAT32", "DIM", "100", "distance_metric", "cosine", "QUANTIZATION", "INT8"});
+  EXPECT_THAT(resp, ErrArg("QUANTIZATION is supported only for FLAT vector indices"));
+
+  resp = Run({"ft.create", "flat-q", "ON", "HASH", "SCHEMA", "vector", "VECTOR", "FLAT", "8",
+              "TYPE", "FLOAT32", "DIM", "100", "distance_metric", "cosine", "QUANTIZATION", "INT8"});
+  EXPECT_EQ(resp, "OK");
 }
 
 TEST_F(SearchFamilyTest, EscapedSymbols) {
@@ -2371,6 +2371,12 @@ void ServerFamily::Info(CmdArgList args, const CommandContext& cmd_cntx) {
 
     // Total number of events of when a connection was blocked on grabbing interpreter.
     append("lua_blocked_total", m.lua_stats.blocked_cnt);
+
+    append("json_path_cache_hits", m.coordinator_stats.json_path_cache_hits);
+    append("json_path_cache_misses", m.coordinator_stats.json_path_cache_misses);
+
+    append("search_query_cache_hits", m.coordinator_stats.search_query_cache_hits);
+    append("search_query_cache_misses", m.coordinator_stats.search_query_cache_misses);
   }
 
   if (should_enter("TIERED", true)) {
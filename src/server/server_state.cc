@@ -27,7 +27,7 @@ ServerState::Stats::Stats(unsigned num_shards) : tx_width_freq_arr(num_shards) {
 }
 
 ServerState::Stats& ServerState::Stats::Add(const ServerState::Stats& other) {
-  static_assert(sizeof(Stats) == 17 * 8, "Stats size mismatch");
+  static_assert(sizeof(Stats) == 21 * 8, "Stats size mismatch");
 
 #define ADD(x) this->x += (other.x)
 
@@ -50,6 +50,10 @@ ServerState::Stats& ServerState::Stats::Add(const ServerState::Stats& other) {
   ADD(rdb_save_usec);
   ADD(rdb_save_count);
   ADD(oom_error_cmd_cnt);
+  ADD(json_path_cache_hits);
+  ADD(json_path_cache_misses);
+  ADD(search_query_cache_hits);
+  ADD(search_query_cache_misses);
 
   if (this->tx_width_freq_arr.size() > 0) {
     DCHECK_EQ(this->tx_width_freq_arr.size(), other.tx_width_freq_arr.size());
@@ -125,6 +125,12 @@ class ServerState {  // public struct - to allow initialization.
     // Number of times we rejected command dispatch due to OOM condition.
     uint64_t oom_error_cmd_cnt = 0;
 
+    uint64_t json_path_cache_hits = 0;
+    uint64_t json_path_cache_misses = 0;
+
+    uint64_t search_query_cache_hits = 0;
+    uint64_t search_query_cache_misses = 0;
+
     std::valarray<uint64_t> tx_width_freq_arr;
   };
 
@@ -0,0 +1,832 @@
+// Copyright 2024, DragonflyDB authors.  All rights reserved.
+// See LICENSE for licensing terms.
+//
+
+#include "server/sketch_family.h"
+
+#include <absl/strings/numbers.h>
+
+#include <cmath>
+
+#include "core/count_min_sketch.h"
+#include "core/t_digest.h"
+#include "core/top_k.h"
+#include "facade/cmd_arg_parser.h"
+#include "facade/error.h"
+#include "server/command_registry.h"
+#include "server/conn_context.h"
+#include "server/engine_shard_set.h"
+#include "server/transaction.h"
+
+namespace dfly {
+
+using namespace facade;
+using namespace std;
+
+namespace {
+
+// Limits the number of counters (or buckets) of a single sketch.
+constexpr uint64_t kMaxSketchCells = 1ULL << 26;
+constexpr uint32_t kMaxTopK = 1U << 16;
+
+constexpr uint32_t kDefaultTopKWidth = 8;
+constexpr uint32_t kDefaultTopKDepth = 7;
+constexpr double kDefaultTopKDecay = 0.9;
+
+constexpr uint32_t kDefaultTDigestCompression = 100;
+
+constexpr char kKeyExistsErr[] = "key already exists";
+constexpr char kDimsErr[] = "width and depth must be positive and not too large";
+constexpr char kDimsMismatchErr[] = "width and depth of all sketches must be equal";
+constexpr char kCompressionErr[] = "compression is out of range";
+
+using ItemIncrs = pair<vector<string_view>, vector<uint32_t>>;
+
+bool DimsOk(uint32_t width, uint32_t depth) {
+  return width > 0 && depth > 0 && uint64_t(width) * depth <= kMaxSketchCells;
+}
+
+// Parses <item> <incr> [<item> <incr> ...] sequence.
+optional<ErrorReply> ParseItemIncrs(CmdArgParser* parser, ItemIncrs* res) {
+  while (parser->HasNext()) {
+    auto [item, incr] = parser->Next<string_view, uint32_t>();
+    res->first.push_back(item);
+    res->second.push_back(incr);
+  }
+  if (auto err = parser->Error(); err)
+    return err->MakeReply();
+  return nullopt;
+}
+
+// Parses all `args` as finite numbers.
+bool ParseValues(CmdArgList args, vector<double>* res) {
+  res->resize(args.size());
+  for (size_t i = 0; i < args.size(); ++i) {
+    if (!absl::SimpleAtod(args[i], &(*res)[i]) || !isfinite((*res)[i]))
+      return false;
+  }
+  return true;
+}
+
+bool CompressionOk(uint32_t compression) {
+  return compression > 0 && compression <= TDigest::kMaxCompression;
+}
+
+template <typename T> void SendCounts(const OpResult<vector<T>>& res, SinkReplyBuilder* builder) {
+  if (!res)
+    return builder->SendError(res.status());
+
+  RedisReplyBuilder* rb = static_cast<RedisReplyBuilder*>(builder);
+  rb->StartArray(res->size());
+  for (T val : *res) {
+    rb->SendLong(val);
+  }
+}
+
+OpStatus OpCmsCreate(const OpArgs& op_args, string_view key, uint32_t width, uint32_t depth) {
+  auto& db_slice = op_args.GetDbSlice();
+  OpResult op_res = db_slice.AddOrFind(op_args.db_cntx, key);
+  if (!op_res)
+    return op_res.status();
+  if (!op_res->is_new)
+    return OpStatus::KEY_EXISTS;
+
+  op_res->it->second.SetCMS(
+      CompactObj::AllocateMR<CMS>(width, depth, CompactObj::memory_resource()));
+  return OpStatus::OK;
+}
+
+OpResult<vector<uint32_t>> OpCmsIncrBy(const OpArgs& op_args, string_view key,
+                                       const ItemIncrs& incrs) {
+  auto op_res = op_args.GetDbSlice().FindMutable(op_args.db_cntx, key, OBJ_CMS);
+  if (!op_res)
+    return op_res.status();
+
+  vector<uint32_t> res(incrs.first.size());
+  op_res->it->second.GetCMS()->IncrBy(incrs.first, incrs.second, res.data());
+  return res;
+}
+
+OpResult<vector<uint32_t>> OpCmsQuery(const OpArgs& op_args, string_view key, CmdArgList items) {
+  auto op_res = op_args.GetDbSlice().FindReadOnly(op_args.db_cntx, key, OBJ_CMS);
+  if (!op_res)
+    return op_res.status();
+
+  vector<uint32_t> res(items.size());
+  (*op_res)->second.GetCMS()->Query(items, res.data());
+  return res;
+}
+
+struct CmsSource {
+  string counters;
+  uint64_t count;
+  uint32_t width, depth;
+};
+
+OpStatus OpCmsMerge(const OpArgs& op_args, string_view key, const vector<CmsSource>& sources,
+                    const vector<int64_t>& weights) {
+  auto op_res = op_args.GetDbSlice().FindMutable(op_args.db_cntx, key, OBJ_CMS);
+  if (!op_res)
+    return op_res.status();
+
+  CMS* cms = op_res->it->second.GetCMS();
+  vector<CMS::MergeSource> merge_sources(sources.size());
+  for (size_t i = 0; i < sources.size(); ++i) {
+    if (sources[i].width != cms->width() || sources[i].depth != cms->depth())
+      return OpStatus::INVALID_VALUE;
+    merge_sources[i] = {sources[i].counters, sources[i].count, weights[i]};
+  }
+
+  cms->Merge(merge_sources);
+  return OpStatus::OK;
+}
+
+OpStatus OpTopKCreate(const OpArgs& op_args, string_view key, uint32_t k, uint32_t width,
+                      uint32_t depth, double decay) {
+  auto& db_slice = op_args.GetDbSlice();
+  OpResult op_res = db_slice.AddOrFind(op_args.db_cntx, key);
+  if (!op_res)
+    return op_res.status();
+  if (!op_res->is_new)
+    return OpStatus::KEY_EXISTS;
+
+  op_res->it->second.SetTopK(
+      CompactObj::AllocateMR<TopK>(k, width, depth, decay, CompactObj::memory_resource()));
+  return OpStatus::OK;
+}
+
+// Returns the items expelled from the top-k list.
+OpResult<vector<optional<string>>> OpTopKIncrBy(const OpArgs& op_args, string_view key,
+                                                const ItemIncrs& incrs) {
+  auto op_res = op_args.GetDbSlice().FindMutable(op_args.db_cntx, key, OBJ_TOPK);
+  if (!op_res)
+    return op_res.status();
+
+  TopK* topk = op_res->it->second.GetTopK();
+  vector<optional<string>> res(incrs.first.size());
+  for (size_t i = 0; i < res.size(); ++i) {
+    res[i] = topk->IncrBy(incrs.first[i], incrs.second[i]);
+  }
+  return res;
+}
+
+template <typename F> auto OpTopKRead(const OpArgs& op_args, string_view key, F&& f) {
+  using Res = decltype(f(declval<const TopK&>()));
+
+  auto op_res = op_args.GetDbSlice().FindReadOnly(op_args.db_cntx, key, OBJ_TOPK);
+  if (!op_res)
+    return OpResult<Res>{op_res.status()};
+  return OpResult<Res>{f(*(*op_res)->second.GetTopK())};
+}
+
+OpStatus OpTDigestCreate(const OpArgs& op_args, string_view key, uint32_t compression) {
+  auto& db_slice = op_args.GetDbSlice();
+  OpResult op_res = db_slice.AddOrFind(op_args.db_cntx, key);
+  if (!op_res)
+    return op_res.status();
+  if (!op_res->is_new)
+    return OpStatus::KEY_EXISTS;
+
+  op_res->it->second.SetTDigest(
+      CompactObj::AllocateMR<TDigest>(compression, CompactObj::memory_resource()));
+  return OpStatus::OK;
+}
+
+OpStatus OpTDigestAdd(const OpArgs& op_args, string_view key, const vector<double>& values) {
+  auto op_res = op_args.GetDbSlice().FindMutable(op_args.db_cntx, key, OBJ_TDIGEST);
+  if (!op_res)
+    return op_res.status();
+
+  op_res->it->second.GetTDigest()->Add(values);
+  return OpStatus::OK;
+}
+
+template <typename F> auto OpTDigestRead(const OpArgs& op_args, string_view key, F&& f) {
+  using Res = decltype(f(declval<const TDigest&>()));
+
+  auto op_res = op_args.GetDbSlice().FindReadOnly(op_args.db_cntx, key, OBJ_TDIGEST);
+  if (!op_res)
+    return OpResult<Res>{op_res.status()};
+  return OpResult<Res>{f(*(*op_res)->second.GetTDigest())};
+}
+
+struct TDigestSource {
+  vector<TDigest::Centroid> centroids;
+  double min, max;
+  uint32_t compression;
+};
+
+// Replaces the destination with a digest built from `sources` and, unless `override_dest` is set,
+// the previous destination. compression 0 keeps the compression of the destination if it
+// is kept, otherwise the largest compression of the sources is used.
+OpStatus OpTDigestMerge(const OpArgs& op_args, string_view key,
+                        const vector<TDigestSource>& sources, uint32_t compression,
+                        bool override_dest) {
+  auto& db_slice = op_args.GetDbSlice();
+  OpResult op_res = db_slice.AddOrFind(op_args.db_cntx, key);
+  if (!op_res)
+    return op_res.status();
+  PrimeValue& pv = op_res->it->second;
+
+  const TDigest* prev = nullptr;
+  if (!op_res->is_new) {
+    if (pv.ObjType() != OBJ_TDIGEST)
+      return OpStatus::WRONG_TYPE;
+    if (!override_dest)
+      prev = pv.GetTDigest();
+  }
+
+  if (compression == 0) {
+    if (prev) {
+      compression = prev->compression();
+    } else {
+      for (const auto& src : sources)
+        compression = max(compression, src.compression);
+    }
+  }
+
+  TDigest* td = CompactObj::AllocateMR<TDigest>(compression, CompactObj::memory_resource());
+  if (prev)
+    td->Merge(prev->centroids(), prev->min(), prev->max());
+  for (const auto& src : sources)
+    td->Merge(src.centroids, src.min, src.max);
+
+  pv.SetTDigest(td);  // frees the previous digest
+  return OpStatus::OK;
+}
+
+void SendDoubles(const OpResult<vector<double>>& res, SinkReplyBuilder* builder) {
+  if (!res)
+    return builder->SendError(res.status());
+
+  RedisReplyBuilder* rb = static_cast<RedisReplyBuilder*>(builder);
+  rb->StartArray(res->size());
+  for (double val : *res) {
+    rb->SendDouble(val);
+  }
+}
+
+void TopKIncrByGeneric(string_view key, const ItemIncrs& incrs, Transaction* tx,
+                       SinkReplyBuilder* builder) {
+  const auto cb = [&](Transaction* t, EngineShard* shard) {
+    return OpTopKIncrBy(t->GetOpArgs(shard), key, incrs);
+  };
+
+  auto res = tx->ScheduleSingleHopT(std::move(cb));
+  if (!res)
+    return builder->SendError(res.status());
+
+  RedisReplyBuilder* rb = static_cast<RedisReplyBuilder*>(builder);
+  rb->StartArray(res->size());
+  for (const auto& expelled : *res) {
+    if (expelled)
+      rb->SendBulkString(*expelled);
+    else
+      rb->SendNull();
+  }
+}
+
+}  // namespace
+
+void SketchFamily::CmsInitByDim(CmdArgList args, Transaction* tx, SinkReplyBuilder* builder) {
+  CmdArgParser parser(args);
+  string_view key = parser.Next();
+  uint32_t width, depth;
+  tie(width, depth) = parser.Next<uint32_t, uint32_t>();
+
+  if (!parser.Finalize())
+    return builder->SendError(parser.Error()->MakeReply());
+
+  if (!DimsOk(width, depth))
+    return builder->SendError(kDimsErr, kSyntaxErrType);
+
+  const auto cb = [&](Transaction* t, EngineShard* shard) {
+    return OpCmsCreate(t->GetOpArgs(shard), key, width, depth);
+  };
+
+  OpStatus res = tx->ScheduleSingleHop(std::move(cb));
+  if (res == OpStatus::KEY_EXISTS)
+    return builder->SendError(kKeyExistsErr);
+  return builder->SendError(res);
+}
+
+void SketchFamily::CmsInitByProb(CmdArgList args, Transaction* tx, SinkReplyBuilder* builder) {
+  CmdArgParser parser(args);
+  string_view key = parser.Next();
+  double error, prob;
+  tie(error, prob) = parser.Next<double, double>();
+
+  if (!parser.Finalize())
+    return builder->SendError(parser.Error()->MakeReply());
+
+  if (!(error > 0 && error < 1) || !(prob > 0 && prob < 1))
+    return builder->SendError("error and probability must be in (0, 1) range", kSyntaxErrType);
+
+  uint32_t width, depth;
+  tie(width, depth) = CMS::DimsFromError(error, prob);
+  if (!DimsOk(width, depth))
+    return builder->SendError(kDimsErr, kSyntaxErrType);
+
+  const auto cb = [&](Transaction* t, EngineShard* shard) {
+    return OpCmsCreate(t->GetOpArgs(shard), key, width, depth);
+  };
+
+  OpStatus res = tx->ScheduleSingleHop(std::move(cb));
+  if (res == OpStatus::KEY_EXISTS)
+    return builder->SendError(kKeyExistsErr);
+  return builder->SendError(res);
+}
+
+void SketchFamily::CmsIncrBy(CmdArgList args, Transaction* tx, SinkReplyBuilder* builder) {
+  CmdArgParser parser(args);
+  string_view key = parser.Next();
+
+  ItemIncrs incrs;
+  if (auto err = ParseItemIncrs(&parser, &incrs); err)
+    return builder->SendError(*err);
+
+  const auto cb = [&](Transaction* t, EngineShard* shard) {
+    return OpCmsIncrBy(t->GetOpArgs(shard), key, incrs);
+  };
+
+  SendCounts(tx->ScheduleSingleHopT(std::move(cb)), builder);
+}
+
+void SketchFamily::CmsQuery(CmdArgList args, Transaction* tx, SinkReplyBuilder* builder) {
+  string_view key = ArgS(args, 0);
+  args.remove_prefix(1);
+
+  const auto cb = [&](Transaction* t, EngineShard* shard) {
+    return OpCmsQuery(t->GetOpArgs(shard), key, args);
+  };
+
+  SendCounts(tx->ScheduleSingleHopT(std::move(cb)), builder);
+}
+
+// CMS.MERGE <dest> <numkeys> <src> [<src> ...] [WEIGHTS <weight> [<weight> ...]]
+// The first hop copies the source sketches, the second one merges them into the destination.
+void SketchFamily::CmsMerge(CmdArgList args, Transaction* tx, SinkReplyBuilder* builder) {
+  CmdArgParser parser(args);
+  string_view dest = parser.Next();
+  uint32_t num_keys = parser.Next<uint32_t>();
+  parser.Skip(num_keys);
+
+  vector<int64_t> weights(num_keys, 1);
+  if (parser.Check("WEIGHTS")) {
+    for (int64_t& weight : weights)
+      weight = parser.Next<int64_t>();
+  }
+
+  if (!parser.Finalize())
+    return builder->SendError(parser.Error()->MakeReply());
+
+  vector<OpResult<CmsSource>> sources(num_keys, OpStatus::KEY_NOTFOUND);
+  auto read_cb = [&](Transaction* t, EngineShard* shard) {
+    ShardArgs keys = t->GetShardArgs(shard->shard_id());
+    auto& db_slice = t->GetDbSlice(shard->shard_id());
+    for (auto it = keys.begin(); it != keys.end(); ++it) {
+      if (it.index() < 2)  // destination
+        continue;
+
+      auto op_res = db_slice.FindReadOnly(t->GetDbContext(), *it, OBJ_CMS);
+      if (!op_res) {
+        sources[it.index() - 2] = op_res.status();
+        continue;
+      }
+
+      const CMS* cms = (*op_res)->second.GetCMS();
+      sources[it.index() - 2] = CmsSource{string{cms->data()}, cms->count(), cms->width(),
+                                          cms->depth()};
+    }
+    return OpStatus::OK;
+  };
+  tx->Execute(std::move(read_cb), false);
+
+  vector<CmsSource> merge_sources;
+  merge_sources.reserve(num_keys);
+  for (auto& src : sources) {
+    if (!src) {
+      tx->Conclude();
+      return builder->SendError(src.status());
+    }
+    merge_sources.push_back(std::move(*src));
+  }
+
+  OpStatus status = OpStatus::OK;
+  auto merge_cb = [&, dest_shard = Shard(dest, shard_set->size())](Transaction* t,
+                                                                   EngineShard* shard) {
+    if (shard->shard_id() == dest_shard)
+      status = OpCmsMerge(t->GetOpArgs(shard), dest, merge_sources, weights);
+    return OpStatus::OK;
+  };
+  tx->Execute(std::move(merge_cb), true);
+
+  if (status == OpStatus::INVALID_VALUE)
+    return builder->SendError(kDimsMismatchErr);
+  return builder->SendError(status);
+}
+
+void SketchFamily::CmsInfo(CmdArgList args, Transaction* tx, SinkReplyBuilder* builder) {
+  string_view key = ArgS(args, 0);
+
+  struct Info {
+    uint32_t width, depth;
+    uint64_t count;
+  };
+
+  const auto cb = [&](Transaction* t, EngineShard* shard) -> OpResult<Info> {
+    auto op_res = t->GetDbSlice(shard->shard_id()).FindReadOnly(t->GetDbContext(), key, OBJ_CMS);
+    if (!op_res)
+      return op_res.status();
+    const CMS* cms = (*op_res)->second.GetCMS();
+    return Info{cms->width(), cms->depth(), cms->count()};
+  };
+
+  OpResult<Info> res = tx->ScheduleSingleHopT(std::move(cb));
+  if (!res)
+    return builder->SendError(res.status());
+
+  RedisReplyBuilder* rb = static_cast<RedisReplyBuilder*>(builder);
+  rb->StartCollection(3, RedisReplyBuilder::MAP);
+  rb->SendSimpleString("width");
+  rb->SendLong(res->width);
+  rb->SendSimpleString("depth");
+  rb->SendLong(res->depth);
+  rb->SendSimpleString("count");
+  rb->SendLong(res->count);
+}
+
+void SketchFamily::TopKReserve(CmdArgList args, Transaction* tx, SinkReplyBuilder* builder) {
+  CmdArgParser parser(args);
+  string_view key = parser.Next();
+  uint32_t k = parser.Next<uint32_t>();
+
+  uint32_t width = kDefaultTopKWidth, depth = kDefaultTopKDepth;
+  double decay = kDefaultTopKDecay;
+  if (parser.HasNext())
+    tie(width, depth, decay) = parser.Next<uint32_t, uint32_t, double>();
+
+  if (!parser.Finalize())
+    return builder->SendError(parser.Error()->MakeReply());
+
+  if (k == 0 || k > kMaxTopK)
+    return builder->SendError("topk is out of range", kSyntaxErrType);
+  if (!DimsOk(width, depth))
+    return builder->SendError(kDimsErr, kSyntaxErrType);
+  if (!(decay > 0 && decay <= 1))
+    return builder->SendError("decay must be in (0, 1] range", kSyntaxErrType);
+
+  const auto cb = [&](Transaction* t, EngineShard* shard) {
+    return OpTopKCreate(t->GetOpArgs(shard), key, k, width, depth, decay);
+  };
+
+  OpStatus res = tx->ScheduleSingleHop(std::move(cb));
+  if (res == OpStatus::KEY_EXISTS)
+    return builder->SendError(kKeyExistsErr);
+  return builder->SendError(res);
+}
+
+void SketchFamily::TopKAdd(CmdArgList args, Transaction* tx, SinkReplyBuilder* builder) {
+  string_view key = ArgS(args, 0);
+  args.remove_prefix(1);
+
+  ItemIncrs incrs{vector<string_view>(args.begin(), args.end()), vector<uint32_t>(args.size(), 1)};
+  TopKIncrByGeneric(key, incrs, tx, builder);
+}
+
+void SketchFamily::TopKIncrBy(CmdArgList args, Transaction* tx, SinkReplyBuilder* builder) {
+  CmdArgParser parser(args);
+  string_view key = parser.Next();
+
+  ItemIncrs incrs;
+  if (auto err = ParseItemIncrs(&parser, &incrs); err)
+    return builder->SendError(*err);
+
+  if (find(incrs.second.begin(), incrs.second.end(), 0) != incrs.second.end())
+    return builder->SendError("increment must be positive", kSyntaxErrType);
+
+  TopKIncrByGeneric(key, incrs, tx, builder);
+}
+
+void SketchFamily::TopKQuery(CmdArgList args, Transaction* tx, SinkReplyBuilder* builder) {
+  string_view key = ArgS(args, 0);
+  args.remove_prefix(1);
+
+  const auto cb = [&](Transaction* t, EngineShard* shard) {
+    return OpTopKRead(t->GetOpArgs(shard), key, [&](const TopK& topk) {
+      vector<bool> res(args.size());
+      for (size_t i = 0; i < args.size(); ++i)
+        res[i] = topk.Query(args[i]);
+      return res;
+    });
+  };
+
+  SendCounts(tx->ScheduleSingleHopT(std::move(cb)), builder);
+}
+
+void SketchFamily::TopKCount(CmdArgList args, Transaction* tx, SinkReplyBuilder* builder) {
+  string_view key = ArgS(args, 0);
+  args.remove_prefix(1);
+
+  const auto cb = [&](Transaction* t, EngineShard* shard) {
+    return OpTopKRead(t->GetOpArgs(shard), key, [&](const TopK& topk) {
+      vector<uint32_t> res(args.size());
+      for (size_t i = 0; i < args.size(); ++i)
+        res[i] = topk.Count(args[i]);
+      return res;
+    });
+  };
+
+  SendCounts(tx->ScheduleSingleHopT(std::move(cb)), builder);
+}
+
+void SketchFamily::TopKList(CmdArgList args, Transaction* tx, SinkReplyBuilder* builder) {
+  CmdArgParser parser(args);
+  string_view key = parser.Next();
+  bool with_count = parser.Check("WITHCOUNT");
+
+  if (!parser.Finalize())
+    return builder->SendError(parser.Error()->MakeReply());
+
+  const auto cb = [&](Transaction* t, EngineShard* shard) {
+    return OpTopKRead(t->GetOpArgs(shard), key, [](const TopK& topk) {
+      vector<pair<string, uint32_t>> res;
+      for (const auto& [item, count] : topk.List())
+        res.emplace_back(item, count);
+      return res;
+    });
+  };
+
+  auto res = tx->ScheduleSingleHopT(std::move(cb));
+  if (!res)
+    return builder->SendError(res.status());
+
+  RedisReplyBuilder* rb = static_cast<RedisReplyBuilder*>(builder);
+  rb->StartArray(res->size() * (with_count ? 2 : 1));
+  for (const auto& [item, count] : *res) {
+    rb->SendBulkString(item);
+    if (with_count)
+      rb->SendLong(count);
+  }
+}
+
+void SketchFamily::TopKInfo(CmdArgList args, Transaction* tx, SinkReplyBuilder* builder) {
+  string_view key = ArgS(args, 0);
+
+  struct Info {
+    uint32_t k, width, depth;
+    double decay;
+  };
+
+  const auto cb = [&](Transaction* t, EngineShard* shard) {
+    return OpTopKRead(t->GetOpArgs(shard), key, [](const TopK& topk) {
+      return Info{topk.k(), topk.width(), topk.depth(), topk.decay()};
+    });
+  };
+
+  auto res = tx->ScheduleSingleHopT(std::move(cb));
+  if (!res)
+    return builder->SendError(res.status());
+
+  RedisReplyBuilder* rb = static_cast<RedisReplyBuilder*>(builder);
+  rb->StartCollection(4, RedisReplyBuilder::MAP);
+  rb->SendSimpleString("k");
+  rb->SendLong(res->k);
+  rb->SendSimpleString("width");
+  rb->SendLong(res->width);
+  rb->SendSimpleString("depth");
+  rb->SendLong(res->depth);
+  rb->SendSimpleString("decay");
+  rb->SendDouble(res->decay);
+}
+
+void SketchFamily::TDigestCreate(CmdArgList args, Transaction* tx, SinkReplyBuilder* builder) {
+  CmdArgParser parser(args);
+  string_view key = parser.Next();
+  uint32_t compression = kDefaultTDigestCompression;
+  if (parser.Check("COMPRESSION"))
+    compression = parser.Next<uint32_t>();
+
+  if (!parser.Finalize())
+    return builder->SendError(parser.Error()->MakeReply());
+
+  if (!CompressionOk(compression))
+    return builder->SendError(kCompressionErr, kSyntaxErrType);
+
+  const auto cb = [&](Transaction* t, EngineShard* shard) {
+    return OpTDigestCreate(t->GetOpArgs(shard), key, compression);
+  };
+
+  OpStatus res = tx->ScheduleSingleHop(std::move(cb));
+  if (res == OpStatus::KEY_EXISTS)
+    return builder->SendError(kKeyExistsErr);
+  return builder->SendError(res);
+}
+
+// All the values are parsed upfront and added in one batch, which only merges the buffered
+// values once the buffer of the digest fills up.
+void SketchFamily::TDigestAdd(CmdArgList args, Transaction* tx, SinkReplyBuilder* builder) {
+  string_view key = ArgS(args, 0);
+
+  vector<double> values;
+  if (!ParseValues(args.subspan(1), &values))
+    return builder->SendError(kInvalidFloatErr);
+
+  const auto cb = [&](Transaction* t, EngineShard* shard) {
+    return OpTDigestAdd(t->GetOpArgs(shard), key, values);
+  };
+
+  return builder->SendError(tx->ScheduleSingleHop(std::move(cb)));
+}
+
+void SketchFamily::TDigestQuantile(CmdArgList args, Transaction* tx, SinkReplyBuilder* builder) {
+  string_view key = ArgS(args, 0);
+
+  vector<double> qs;
+  if (!ParseValues(args.subspan(1), &qs))
+    return builder->SendError(kInvalidFloatErr);
+  for (double q : qs) {
+    if (q < 0 || q > 1)
+      return builder->SendError("quantile should be in [0,1]", kSyntaxErrType);
+  }
+
+  const auto cb = [&](Transaction* t, EngineShard* shard) {
+    return OpTDigestRead(t->GetOpArgs(shard), key, [&](const TDigest& td) {
+      vector<double> res(qs.size());
+      td.Quantile(qs, res.data());
+      return res;
+    });
+  };
+
+  SendDoubles(tx->ScheduleSingleHopT(std::move(cb)), builder);
+}
+
+void SketchFamily::TDigestCDF(CmdArgList args, Transaction* tx, SinkReplyBuilder* builder) {
+  string_view key = ArgS(args, 0);
+
+  vector<double> values;
+  if (!ParseValues(args.subspan(1), &values))
+    return builder->SendError(kInvalidFloatErr);
+
+  const auto cb = [&](Transaction* t, EngineShard* shard) {
+    return OpTDigestRead(t->GetOpArgs(shard), key, [&](const TDigest& td) {
+      vector<double> res(values.size());
+      td.CDF(values, res.data());
+      return res;
+    });
+  };
+
+  SendDoubles(tx->ScheduleSingleHopT(std::move(cb)), builder);
+}
+
+// TDIGEST.MERGE <dest> <numkeys> <src> [<src> ...] [COMPRESSION <compression>] [OVERRIDE]
+// The first hop copies the centroids of the sources, the second one merges them into the
+// destination, which is created if needed.
+void SketchFamily::TDigestMerge(CmdArgList args, Transaction* tx, SinkReplyBuilder* builder) {
+  CmdArgParser parser(args);
+  string_view dest = parser.Next();
+  uint32_t num_keys = parser.Next<uint32_t>();
+  parser.Skip(num_keys);
+
+  optional<uint32_t> compression;
+  bool override_dest = false;
+  while (parser.HasNext()) {
+    if (parser.Check("COMPRESSION")) {
+      compression = parser.Next<uint32_t>();
+    } else if (parser.Check("OVERRIDE")) {
+      override_dest = true;
+    } else {
+      return builder->SendError(kSyntaxErr);
+    }
+  }
+
+  if (!parser.Finalize())
+    return builder->SendError(parser.Error()->MakeReply());
+
+  // Without sources a new destination would have no compression to inherit.
+  if (num_keys == 0)
+    return builder->SendError(OpStatus::AT_LEAST_ONE_KEY);
+
+  if (compression && !CompressionOk(*compression))
+    return builder->SendError(kCompressionErr, kSyntaxErrType);
+
+  vector<OpResult<TDigestSource>> sources(num_keys, OpStatus::KEY_NOTFOUND);
+  auto read_cb = [&](Transaction* t, EngineShard* shard) {
+    ShardArgs keys = t->GetShardArgs(shard->shard_id());
+    auto& db_slice = t->GetDbSlice(shard->shard_id());
+    for (auto it = keys.begin(); it != keys.end(); ++it) {
+      if (it.index() < 2)  // destination
+        continue;
+
+      auto op_res = db_slice.FindReadOnly(t->GetDbContext(), *it, OBJ_TDIGEST);
+      if (!op_res) {
+        sources[it.index() - 2] = op_res.status();
+        continue;
+      }
+
+      const TDigest* td = (*op_res)->second.GetTDigest();
+      auto centroids = td->centroids();
+      sources[it.index() - 2] =
+          TDigestSource{vector<TDigest::Centroid>(centroids.begin(), centroids.end()), td->min(),
+                        td->max(), td->compression()};
+    }
+    return OpStatus::OK;
+  };
+  tx->Execute(std::move(read_cb), false);
+
+  vector<TDigestSource> merge_sources;
+  merge_sources.reserve(num_keys);
+  for (auto& src : sources) {
+    if (!src) {
+      tx->Conclude();
+      return builder->SendError(src.status());
+    }
+    merge_sources.push_back(std::move(*src));
+  }
+
+  OpStatus status = OpStatus::OK;
+  auto merge_cb = [&, dest_shard = Shard(dest, shard_set->size())](Transaction* t,
+                                                                   EngineShard* shard) {
+    if (shard->shard_id() == dest_shard)
+      status = OpTDigestMerge(t->GetOpArgs(shard), dest, merge_sources, compression.value_or(0),
+                              override_dest);
+    return OpStatus::OK;
+  };
+  tx->Execute(std::move(merge_cb), true);
+
+  return builder->SendError(status);
+}
+
+void SketchFamily::TDigestInfo(CmdArgList args, Transaction* tx, SinkReplyBuilder* builder) {
+  string_view key = ArgS(args, 0);
+
+  struct Info {
+    uint32_t compression;
+    size_t capacity, merged, unmerged;
+    double count;
+    size_t malloc_used;
+  };
+
+  const auto cb = [&](Transaction* t, EngineShard* shard) {
+    return OpTDigestRead(t->GetOpArgs(shard), key, [](const TDigest& td) {
+      return Info{td.compression(), td.capacity(), td.num_merged(), td.num_unmerged(),
+                  td.count(), td.MallocUsed()};
+    });
+  };
+
+  auto res = tx->ScheduleSingleHopT(std::move(cb));
+  if (!res)
+    return builder->SendError(res.status());
+
+  RedisReplyBuilder* rb = static_cast<RedisReplyBuilder*>(builder);
+  rb->StartCollection(6, RedisReplyBuilder::MAP);
+  rb->SendSimpleString("Compression");
+  rb->SendLong(res->compression);
+  rb->SendSimpleString("Capacity");
+  rb->SendLong(res->capacity);
+  rb->SendSimpleString("Merged nodes");
+  rb->SendLong(res->merged);
+  rb->SendSimpleString("Unmerged nodes");
+  rb->SendLong(res->unmerged);
+  rb->SendSimpleString("Observations");
+  rb->SendLong(int64_t(res->count));
+  rb->SendSimpleString("Memory usage");
+  rb->SendLong(res->malloc_used);
+}
+
+using CI = CommandId;
+
+#define HFUNC(x) SetHandler(&SketchFamily::x)
+
+void SketchFamily::Register(CommandRegistry* registry) {
+  registry->StartFamily();
+
+  constexpr uint32_t kWriteMask = CO::WRITE | CO::DENYOOM | CO::FAST;
+  constexpr uint32_t kReadMask = CO::READONLY | CO::FAST;
+
+  *registry
+      << CI{"CMS.INITBYDIM", kWriteMask, 4, 1, 1, acl::BLOOM}.HFUNC(CmsInitByDim)
+      << CI{"CMS.INITBYPROB", kWriteMask, 4, 1, 1, acl::BLOOM}.HFUNC(CmsInitByProb)
+      << CI{"CMS.INCRBY", kWriteMask, -4, 1, 1, acl::BLOOM}.HFUNC(CmsIncrBy)
+      << CI{"CMS.QUERY", kReadMask, -3, 1, 1, acl::BLOOM}.HFUNC(CmsQuery)
+      << CI{"CMS.MERGE", CO::WRITE | CO::DENYOOM | CO::VARIADIC_KEYS, -4, 3, 3, acl::BLOOM}.HFUNC(
+             CmsMerge)
+      << CI{"CMS.INFO", kReadMask, 2, 1, 1, acl::BLOOM}.HFUNC(CmsInfo)
+      << CI{"TOPK.RESERVE", kWriteMask, -3, 1, 1, acl::BLOOM}.HFUNC(TopKReserve)
+      << CI{"TOPK.ADD", kWriteMask, -3, 1, 1, acl::BLOOM}.HFUNC(TopKAdd)
+      << CI{"TOPK.INCRBY", kWriteMask, -4, 1, 1, acl::BLOOM}.HFUNC(TopKIncrBy)
+      << CI{"TOPK.QUERY", kReadMask, -3, 1, 1, acl::BLOOM}.HFUNC(TopKQuery)
+      << CI{"TOPK.COUNT", kReadMask, -3, 1, 1, acl::BLOOM}.HFUNC(TopKCount)
+      << CI{"TOPK.LIST", kReadMask, -2, 1, 1, acl::BLOOM}.HFUNC(TopKList)
+      << CI{"TOPK.INFO", kReadMask, 2, 1, 1, acl::BLOOM}.HFUNC(TopKInfo)
+      << CI{"TDIGEST.CREATE", kWriteMask, -2, 1, 1, acl::BLOOM}.HFUNC(TDigestCreate)
+      << CI{"TDIGEST.ADD", kWriteMask, -3, 1, 1, acl::BLOOM}.HFUNC(TDigestAdd)
+      << CI{"TDIGEST.QUANTILE", kReadMask, -3, 1, 1, acl::BLOOM}.HFUNC(TDigestQuantile)
+      << CI{"TDIGEST.CDF", kReadMask, -3, 1, 1, acl::BLOOM}.HFUNC(TDigestCDF)
+      << CI{"TDIGEST.MERGE", CO::WRITE | CO::DENYOOM | CO::VARIADIC_KEYS, -4, 3, 3,
+            acl::BLOOM}
+             .HFUNC(TDigestMerge)
+      << CI{"TDIGEST.INFO", kReadMask, 2, 1, 1, acl::BLOOM}.HFUNC(TDigestInfo);
+};
+
+}  // namespace dfly
@@ -0,0 +1,49 @@
+// Copyright 2024, DragonflyDB authors.  All rights reserved.
+// See LICENSE for licensing terms.
+//
+
+#pragma once
+
+#include "server/common.h"
+
+namespace facade {
+class SinkReplyBuilder;
+}  // namespace facade
+
+namespace dfly {
+
+class CommandRegistry;
+
+// Probabilistic sketches: Count-Min sketch (CMS.*) and Top-K (TOPK.*) for frequency estimation,
+// t-digest (TDIGEST.*) for quantile estimation.
+class SketchFamily {
+ public:
+  static void Register(CommandRegistry* registry);
+
+ private:
+  using SinkReplyBuilder = facade::SinkReplyBuilder;
+
+  static void CmsInitByDim(CmdArgList args, Transaction* tx, SinkReplyBuilder* builder);
+  static void CmsInitByProb(CmdArgList args, Transaction* tx, SinkReplyBuilder* builder);
+  static void CmsIncrBy(CmdArgList args, Transaction* tx, SinkReplyBuilder* builder);
+  static void CmsQuery(CmdArgList args, Transaction* tx, SinkReplyBuilder* builder);
+  static void CmsMerge(CmdArgList args, Transaction* tx, SinkReplyBuilder* builder);
+  static void CmsInfo(CmdArgList args, Transaction* tx, SinkReplyBuilder* builder);
+
+  static void TopKReserve(CmdArgList args, Transaction* tx, SinkReplyBuilder* builder);
+  static void TopKAdd(CmdArgList args, Transaction* tx, SinkReplyBuilder* builder);
+  static void TopKIncrBy(CmdArgList args, Transaction* tx, SinkReplyBuilder* builder);
+  static void TopKQuery(CmdArgList args, Transaction* tx, SinkReplyBuilder* builder);
+  static void TopKCount(CmdArgList args, Transaction* tx, SinkReplyBuilder* builder);
+  static void TopKList(CmdArgList args, Transaction* tx, SinkReplyBuilder* builder);
+  static void TopKInfo(CmdArgList args, Transaction* tx, SinkReplyBuilder* builder);
+
+  static void TDigestCreate(CmdArgList args, Transaction* tx, SinkReplyBuilder* builder);
+  static void TDigestAdd(CmdArgList args, Transaction* tx, SinkReplyBuilder* builder);
+  static void TDigestQuantile(CmdArgList args, Transaction* tx, SinkReplyBuilder* builder);
+  static void TDigestCDF(CmdArgList args, Transaction* tx, SinkReplyBuilder* builder);
+  static void TDigestMerge(CmdArgList args, Transaction* tx, SinkReplyBuilder* builder);
+  static void TDigestInfo(CmdArgList args, Transaction* tx, SinkReplyBuilder* builder);
+};
+
+}  // namespace dfly
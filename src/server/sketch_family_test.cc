@@ -0,0 +1,171 @@
+// Copyright 2024, DragonflyDB authors.  All rights reserved.
+// See LICENSE for licensing terms.
+//
+
+#include "server/sketch_family.h"
+
+#include "facade/facade_test.h"
+#include "server/test_utils.h"
+
+namespace dfly {
+
+using testing::ElementsAre;
+
+class SketchFamilyTest : public BaseFamilyTest {
+ protected:
+};
+
+TEST_F(SketchFamilyTest, CMS) {
+  EXPECT_EQ(Run({"cms.initbydim", "c1", "100", "4"}), "OK");
+  EXPECT_EQ(Run({"type", "c1"}), "CMSk-TYPE");
+  EXPECT_THAT(Run({"cms.initbydim", "c1", "100", "4"}), ErrArg("key already exists"));
+  EXPECT_THAT(Run({"cms.initbydim", "c2", "0", "4"}), ErrArg("must be positive"));
+  EXPECT_EQ(Run({"cms.initbyprob", "c2", "0.001", "0.01"}), "OK");
+  EXPECT_THAT(Run({"cms.initbyprob", "c3", "1.5", "0.01"}), ErrArg("(0, 1) range"));
+
+  auto resp = Run({"cms.incrby", "c1", "a", "5", "b", "3", "a", "2"});
+  EXPECT_THAT(resp, RespArray(ElementsAre(IntArg(5), IntArg(3), IntArg(7))));
+  EXPECT_THAT(Run({"cms.incrby", "c1", "a", "1", "b"}), ErrArg("syntax error"));
+  EXPECT_THAT(Run({"cms.incrby", "c1", "a", "x"}), ErrArg("not an integer"));
+  EXPECT_THAT(Run({"cms.incrby", "nokey", "a", "1"}), ErrArg("no such key"));
+
+  resp = Run({"cms.query", "c1", "a", "b", "c"});
+  EXPECT_THAT(resp, RespArray(ElementsAre(IntArg(7), IntArg(3), IntArg(0))));
+  EXPECT_THAT(Run({"cms.query", "nokey", "a"}), ErrArg("no such key"));
+
+  resp = Run({"cms.info", "c1"});
+  EXPECT_THAT(resp, RespArray(ElementsAre("width", IntArg(100), "depth", IntArg(4), "count",
+                                          IntArg(10))));
+
+  Run({"set", "str", "foo"});
+  EXPECT_THAT(Run({"cms.incrby", "str", "a", "1"}), ErrArg("WRONGTYPE"));
+}
+
+TEST_F(SketchFamilyTest, CMSMerge) {
+  Run({"cms.initbydim", "src1", "100", "4"});
+  Run({"cms.initbydim", "src2", "100", "4"});
+  Run({"cms.initbydim", "dest", "100", "4"});
+  Run({"cms.initbydim", "small", "10", "4"});
+  Run({"cms.incrby", "src1", "a", "5", "b", "1"});
+  Run({"cms.incrby", "src2", "a", "2"});
+
+  EXPECT_EQ(Run({"cms.merge", "dest", "2", "src1", "src2"}), "OK");
+  auto resp = Run({"cms.query", "dest", "a", "b"});
+  EXPECT_THAT(resp, RespArray(ElementsAre(IntArg(7), IntArg(1))));
+
+  EXPECT_EQ(Run({"cms.merge", "dest", "2", "src1", "src2", "WEIGHTS", "3", "-1"}), "OK");
+  resp = Run({"cms.query", "dest", "a", "b"});
+  EXPECT_THAT(resp, RespArray(ElementsAre(IntArg(13), IntArg(3))));
+
+  // The destination may also be one of the sources.
+  EXPECT_EQ(Run({"cms.merge", "dest", "2", "dest", "src2"}), "OK");
+  EXPECT_THAT(Run({"cms.query", "dest", "a"}), IntArg(15));
+
+  EXPECT_THAT(Run({"cms.merge", "dest", "1", "small"}), ErrArg("must be equal"));
+  EXPECT_THAT(Run({"cms.merge", "small", "1", "src1"}), ErrArg("must be equal"));
+  EXPECT_THAT(Run({"cms.merge", "dest", "2", "src1", "nokey"}), ErrArg("no such key"));
+  EXPECT_THAT(Run({"cms.merge", "nokey", "1", "src1"}), ErrArg("no such key"));
+  EXPECT_THAT(Run({"cms.merge", "dest", "2", "src1", "src2", "WEIGHTS", "1"}),
+              ErrArg("syntax error"));
+  EXPECT_THAT(Run({"cms.query", "dest", "a"}), IntArg(15));
+}
+
+TEST_F(SketchFamilyTest, TopK) {
+  EXPECT_EQ(Run({"topk.reserve", "t1", "2"}), "OK");
+  EXPECT_EQ(Run({"type", "t1"}), "TopK-TYPE");
+  EXPECT_THAT(Run({"topk.reserve", "t1", "2"}), ErrArg("key already exists"));
+  EXPECT_THAT(Run({"topk.reserve", "t2", "0"}), ErrArg("out of range"));
+  EXPECT_THAT(Run({"topk.reserve", "t2", "2", "8", "7", "1.5"}), ErrArg("decay"));
+  EXPECT_THAT(Run({"topk.reserve", "t2", "2", "8"}), ErrArg("syntax error"));
+  EXPECT_EQ(Run({"topk.reserve", "t2", "2", "50", "5", "0.95"}), "OK");
+
+  auto resp = Run({"topk.add", "t1", "a", "b", "a"});
+  EXPECT_THAT(resp, RespArray(ElementsAre(ArgType(RespExpr::NIL), ArgType(RespExpr::NIL),
+                                          ArgType(RespExpr::NIL))));
+  resp = Run({"topk.incrby", "t1", "c", "100", "b", "1"});
+  EXPECT_THAT(resp, RespArray(ElementsAre("b", ArgType(RespExpr::NIL))));
+  EXPECT_THAT(Run({"topk.incrby", "t1", "c", "0"}), ErrArg("must be positive"));
+
+  resp = Run({"topk.query", "t1", "a", "b", "c"});
+  EXPECT_THAT(resp, RespArray(ElementsAre(IntArg(1), IntArg(0), IntArg(1))));
+  resp = Run({"topk.count", "t1", "b", "c", "d"});
+  EXPECT_THAT(resp, RespArray(ElementsAre(IntArg(2), IntArg(100), IntArg(0))));
+
+  resp = Run({"topk.list", "t1"});
+  EXPECT_THAT(resp, RespArray(ElementsAre("c", "a")));
+  resp = Run({"topk.list", "t1", "withcount"});
+  EXPECT_THAT(resp, RespArray(ElementsAre("c", IntArg(100), "a", IntArg(2))));
+
+  resp = Run({"topk.info", "t2"});
+  EXPECT_THAT(resp, RespArray(ElementsAre("k", IntArg(2), "width", IntArg(50), "depth", IntArg(5),
+                                          "decay", "0.95")));
+
+  EXPECT_THAT(Run({"topk.add", "nokey", "a"}), ErrArg("no such key"));
+  Run({"set", "str", "foo"});
+  EXPECT_THAT(Run({"topk.list", "str"}), ErrArg("WRONGTYPE"));
+}
+
+TEST_F(SketchFamilyTest, TDigest) {
+  EXPECT_EQ(Run({"tdigest.create", "t1"}), "OK");
+  EXPECT_EQ(Run({"type", "t1"}), "TDIS-TYPE");
+  EXPECT_THAT(Run({"tdigest.create", "t1"}), ErrArg("key already exists"));
+  EXPECT_THAT(Run({"tdigest.create", "t2", "compression", "0"}), ErrArg("out of range"));
+  EXPECT_THAT(Run({"tdigest.create", "t2", "foo"}), ErrArg("syntax error"));
+  EXPECT_EQ(Run({"tdigest.create", "t2", "compression", "50"}), "OK");
+
+  EXPECT_EQ(Run({"tdigest.quantile", "t1", "0.5"}), "nan");
+  EXPECT_EQ(Run({"tdigest.add", "t1", "5", "1", "4", "2", "3"}), "OK");
+  EXPECT_EQ(Run({"tdigest.add", "t1", "6", "8", "7", "10", "9"}), "OK");
+  EXPECT_THAT(Run({"tdigest.add", "t1", "1", "x"}), ErrArg("not a valid float"));
+  EXPECT_THAT(Run({"tdigest.add", "t1", "inf"}), ErrArg("not a valid float"));
+  EXPECT_THAT(Run({"tdigest.add", "nokey", "1"}), ErrArg("no such key"));
+
+  auto resp = Run({"tdigest.quantile", "t1", "0", "0.5", "1"});
+  EXPECT_THAT(resp, RespArray(ElementsAre("1", "5.5", "10")));
+  EXPECT_THAT(Run({"tdigest.quantile", "t1", "1.5"}), ErrArg("[0,1]"));
+
+  resp = Run({"tdigest.cdf", "t1", "0", "5.5", "11"});
+  EXPECT_THAT(resp, RespArray(ElementsAre("0", "0.5", "1")));
+  EXPECT_THAT(Run({"tdigest.cdf", "nokey", "1"}), ErrArg("no such key"));
+
+  resp = Run({"tdigest.info", "t1"});
+  ASSERT_THAT(resp, ArrLen(12));
+  EXPECT_THAT(resp.GetVec()[1], IntArg(100));
+  EXPECT_THAT(resp.GetVec()[7], IntArg(10));
+  EXPECT_THAT(resp.GetVec()[9], IntArg(10));
+
+  Run({"set", "str", "foo"});
+  EXPECT_THAT(Run({"tdigest.add", "str", "1"}), ErrArg("WRONGTYPE"));
+}
+
+TEST_F(SketchFamilyTest, TDigestMerge) {
+  Run({"tdigest.create", "src1"});
+  Run({"tdigest.create", "src2", "compression", "200"});
+  Run({"tdigest.add", "src1", "1", "2", "3"});
+  Run({"tdigest.add", "src2", "4", "5", "6"});
+
+  // The destination is created with the largest compression of the sources.
+  EXPECT_EQ(Run({"tdigest.merge", "dest", "2", "src1", "src2"}), "OK");
+  EXPECT_THAT(Run({"tdigest.info", "dest"}).GetVec()[1], IntArg(200));
+  EXPECT_THAT(Run({"tdigest.quantile", "dest", "0", "0.5", "1"}),
+              RespArray(ElementsAre("1", "3.5", "6")));
+
+  // An existing destination is merged as well, unless OVERRIDE is given.
+  EXPECT_EQ(Run({"tdigest.merge", "dest", "1", "src1", "compression", "50"}), "OK");
+  EXPECT_THAT(Run({"tdigest.info", "dest"}).GetVec()[1], IntArg(50));
+  EXPECT_THAT(Run({"tdigest.info", "dest"}).GetVec()[9], IntArg(9));
+  EXPECT_EQ(Run({"tdigest.merge", "dest", "2", "dest", "src2", "override"}), "OK");
+  EXPECT_THAT(Run({"tdigest.info", "dest"}).GetVec()[9], IntArg(12));
+
+  EXPECT_THAT(Run({"tdigest.merge", "dest", "2", "src1", "nokey"}), ErrArg("no such key"));
+  EXPECT_THAT(Run({"tdigest.merge", "dest", "1", "src1", "compression", "0"}),
+              ErrArg("out of range"));
+  EXPECT_THAT(Run({"tdigest.merge", "dest", "1", "src1", "foo"}), ErrArg("syntax error"));
+  EXPECT_THAT(Run({"tdigest.merge", "new", "0", "override"}), ErrArg("at least 1 input key"));
+  EXPECT_EQ(Run({"exists", "new"}), "0");
+  Run({"set", "str", "foo"});
+  EXPECT_THAT(Run({"tdigest.merge", "str", "1", "src1"}), ErrArg("WRONGTYPE"));
+  EXPECT_THAT(Run({"tdigest.info", "dest"}).GetVec()[9], IntArg(12));
+}
+
+}  // namespace dfly
@@ -4,6 +4,7 @@
 
 #include "server/stream_family.h"
 
+#include <absl/container/inlined_vector.h>
 #include <absl/strings/str_cat.h>
 
 extern "C" {
@@ -31,7 +32,35 @@ namespace {
 
 struct Record {
   streamID id;
-  vector<pair<string, string>> kv_arr;
+
+  // Field-value pairs are stored back to back in a single buffer, with the end offset of each
+  // field and value in kv_ends. Range scans decode many records and a string per field and
+  // value would cost up to two allocations per pair.
+  string kv_buf;
+  vector<uint32_t> kv_ends;
+
+  size_t NumPairs() const {
+    return kv_ends.size() / 2;
+  }
+
+  string_view Field(size_t i) const {
+    return Element(i * 2);
+  }
+
+  string_view Value(size_t i) const {
+    return Element(i * 2 + 1);
+  }
+
+  void Append(const unsigned char* data, int64_t len) {
+    kv_buf.append(reinterpret_cast<const char*>(data), len);
+    kv_ends.push_back(kv_buf.size());
+  }
+
+ private:
+  string_view Element(size_t i) const {
+    uint32_t start = i ? kv_ends[i - 1] : 0;
+    return string_view{kv_buf}.substr(start, kv_ends[i] - start);
+  }
 };
 
 using RecordVec = vector<Record>;
@@ -532,16 +561,23 @@ int StreamAppendItem(stream* s, CmdArgList fields, streamID* added_id, streamID*
    * in reverse order: we can just start from the end of the listpack, read
    * the entry, and jump back N times to seek the "flags" field to read
    * the stream full entry. */
-  lp = lpAppendInteger(lp, flags);
-  lp = lpAppendInteger(lp, id.ms - master_id.ms);
-  lp = lpAppendInteger(lp, id.seq - master_id.seq);
+  // The whole entry is encoded with a single append, so the listpack is grown and its
+  // terminator moved once per XADD rather than once per element.
+  absl::InlinedVector<listpackEntry, 16> entry;
+  auto add_int = [&entry](long long val) { entry.push_back(listpackEntry{nullptr, 0, val}); };
+  auto add_str = [&entry](MutableSlice sl) {
+    entry.push_back(listpackEntry{const_cast<uint8_t*>(SafePtr(sl)), uint32_t(sl.size()), 0});
+  };
+
+  add_int(flags);
+  add_int(id.ms - master_id.ms);
+  add_int(id.seq - master_id.seq);
   if (!(flags & STREAM_ITEM_FLAG_SAMEFIELDS))
-    lp = lpAppendInteger(lp, numfields);
+    add_int(numfields);
   for (int64_t i = 0; i < numfields; i++) {
-    MutableSlice field = fields[i * 2], value = fields[i * 2 + 1];
     if (!(flags & STREAM_ITEM_FLAG_SAMEFIELDS))
-      lp = lpAppend(lp, SafePtr(field), field.size());
-    lp = lpAppend(lp, SafePtr(value), value.size());
+      add_str(fields[i * 2]);
+    add_str(fields[i * 2 + 1]);
   }
   /* Compute and store the lp-count field. */
   int64_t lp_count = numfields;
@@ -551,7 +587,8 @@ int StreamAppendItem(stream* s, CmdArgList fields, streamID* added_id, streamID*
      * the values, and an additional num-fields field. */
     lp_count += numfields + 1;
   }
-  lp = lpAppendInteger(lp, lp_count);
+  add_int(lp_count);
+  lp = lpBatchAppend(lp, entry.data(), entry.size());
 
   /* Insert back into the tree in order to update the listpack pointer. */
   if (ri.data != lp)
@@ -678,6 +715,23 @@ OpResult<streamID> OpAdd(const OpArgs& op_args, const AddTrimOpts& opts, CmdArgL
   return result_id;
 }
 
+// Decodes the field-value pairs of the entry the iterator is positioned at.
+Record ReadRecord(streamIterator* si, streamID id, int64_t numfields) {
+  Record rec;
+  rec.id = id;
+  rec.kv_ends.reserve(numfields * 2);
+
+  while (numfields--) {
+    unsigned char *key, *value;
+    int64_t key_len, value_len;
+    streamIteratorGetField(si, &key, &value, &key_len, &value_len);
+    rec.Append(key, key_len);
+    rec.Append(value, value_len);
+  }
+
+  return rec;
+}
+
 OpResult<RecordVec> OpRange(const OpArgs& op_args, string_view key, const RangeOpts& opts) {
   auto& db_slice = op_args.GetDbSlice();
   auto res_it = db_slice.FindReadOnly(op_args.db_cntx, key, OBJ_STREAM);
@@ -698,9 +752,6 @@ OpResult<RecordVec> OpRange(const OpArgs& op_args, string_view key, const RangeO
 
   streamIteratorStart(&si, s, &sstart, &send, opts.is_rev);
   while (streamIteratorGetID(&si, &id, &numfields)) {
-    Record rec;
-    rec.id = id;
-    rec.kv_arr.reserve(numfields);
     if (opts.group && streamCompareID(&id, &opts.group->last_id) > 0) {
       if (opts.group->entries_read != SCG_INVALID_ENTRIES_READ &&
           !streamRangeHasTombstones(s, &id, NULL)) {
@@ -715,18 +766,7 @@ OpResult<RecordVec> OpRange(const OpArgs& op_args, string_view key, const RangeO
       opts.group->last_id = id;
     }
 
-    /* Emit the field-value pairs. */
-    while (numfields--) {
-      unsigned char *key, *value;
-      int64_t key_len, value_len;
-      streamIteratorGetField(&si, &key, &value, &key_len, &value_len);
-      string skey(reinterpret_cast<char*>(key), key_len);
-      string sval(reinterpret_cast<char*>(value), value_len);
-
-      rec.kv_arr.emplace_back(std::move(skey), std::move(sval));
-    }
-
-    result.push_back(std::move(rec));
+    result.push_back(ReadRecord(&si, id, numfields));
 
     if (opts.group && !opts.noack) {
       unsigned char buf[sizeof(streamID)];
@@ -737,6 +777,8 @@ OpResult<RecordVec> OpRange(const OpArgs& op_args, string_view key, const RangeO
        * if we find that there is already an entry for this ID. */
       streamNACK* nack = StreamCreateNACK(opts.consumer);
       int group_inserted = raxTryInsert(opts.group->pel, buf, sizeof(buf), nack, nullptr);
+      if (group_inserted)
+        streamPelIndexAdd(opts.group, buf, nack);
 
       int consumer_inserted = raxTryInsert(opts.consumer->pel, buf, sizeof(buf), nack, nullptr);
 
@@ -752,7 +794,7 @@ OpResult<RecordVec> OpRange(const OpArgs& op_args, string_view key, const RangeO
 
         /* Update the consumer and NACK metadata. */
         nack->consumer = opts.consumer;
-        nack->delivery_time = GetCurrentTimeMs();
+        streamNACKSetDeliveryTime(opts.group, buf, nack, GetCurrentTimeMs());
         nack->delivery_count = 1;
         /* Add the entry in the new consumer local PEL. */
         raxInsert(opts.consumer->pel, buf, sizeof(buf), nack, NULL);
@@ -800,10 +842,10 @@ OpResult<RecordVec> OpRangeFromConsumerPEL(const OpArgs& op_args, string_view ke
     ropts.end.val = id;
     auto op_result = OpRange(op_args, key, ropts);
     if (!op_result || !op_result.value().size()) {
-      result.push_back(Record{id, vector<pair<string, string>>()});
+      result.push_back(Record{id});
     } else {
       streamNACK* nack = static_cast<streamNACK*>(ri.data);
-      nack->delivery_time = GetCurrentTimeMs();
+      streamNACKSetDeliveryTime(opts.group, ri.key, nack, GetCurrentTimeMs());
       nack->delivery_count++;
       result.push_back(std::move(op_result.value()[0]));
     }
@@ -915,20 +957,7 @@ vector<Record> GetStreamRecords(stream* s, streamID start, streamID end, bool re
 
   streamIteratorStart(&si, s, &start, &end, reverse);
   while (streamIteratorGetID(&si, &id, &numfields)) {
-    Record rec;
-    rec.id = id;
-    rec.kv_arr.reserve(numfields);
-
-    while (numfields--) {
-      unsigned char *key, *value;
-      int64_t key_len, value_len;
-      streamIteratorGetField(&si, &key, &value, &key_len, &value_len);
-      string skey(reinterpret_cast<char*>(key), key_len);
-      string sval(reinterpret_cast<char*>(value), value_len);
-
-      rec.kv_arr.emplace_back(std::move(skey), std::move(sval));
-    }
-    records.push_back(std::move(rec));
+    records.push_back(ReadRecord(&si, id, numfields));
     arraylen++;
     if (count && count == arraylen)
       break;
@@ -1206,21 +1235,7 @@ void AppendClaimResultItem(ClaimInfo& result, stream* s, streamID id) {
   streamID cid;
   streamIteratorStart(&it, s, &id, &id, 0);
   while (streamIteratorGetID(&it, &cid, &numfields)) {
-    Record rec;
-    rec.id = cid;
-    rec.kv_arr.reserve(numfields);
-
-    /* Emit the field-value pairs. */
-    while (numfields--) {
-      unsigned char *key, *value;
-      int64_t key_len, value_len;
-      streamIteratorGetField(&it, &key, &value, &key_len, &value_len);
-      string skey(reinterpret_cast<char*>(key), key_len);
-      string sval(reinterpret_cast<char*>(value), value_len);
-
-      rec.kv_arr.emplace_back(std::move(skey), std::move(sval));
-    }
-    result.records.push_back(std::move(rec));
+    result.records.push_back(ReadRecord(&it, cid, numfields));
   }
   streamIteratorStop(&it);
 }
@@ -1254,6 +1269,7 @@ OpResult<ClaimInfo> OpClaim(const OpArgs& op_args, string_view key, const ClaimO
       if (nack != raxNotFound) {
         /* Release the NACK */
         raxRemove(cgr_res->cg->pel, buf.begin(), sizeof(buf), nullptr);
+        streamPelIndexRemove(cgr_res->cg, buf.begin(), nack);
         raxRemove(nack->consumer->pel, buf.begin(), sizeof(buf), nullptr);
         LOG_IF(DFATAL, nack->consumer->pel->numnodes == 0) << "Invalid rax state";
         streamFreeNACK(nack);
@@ -1267,6 +1283,7 @@ OpResult<ClaimInfo> OpClaim(const OpArgs& op_args, string_view key, const ClaimO
       /* Create the NACK. */
       nack = streamCreateNACK(nullptr);
       raxInsert(cgr_res->cg->pel, buf.begin(), sizeof(buf), nack, nullptr);
+      streamPelIndexAdd(cgr_res->cg, buf.begin(), nack);
     }
 
     // We found the nack, continue.
@@ -1298,7 +1315,7 @@ OpResult<ClaimInfo> OpClaim(const OpArgs& op_args, string_view key, const ClaimO
         }
       }
       // Set the delivery time for the entry.
-      nack->delivery_time = opts.delivery_time;
+      streamNACKSetDeliveryTime(cgr_res->cg, buf.begin(), nack, opts.delivery_time);
       /* Set the delivery attempts counter if given, otherwise
        * autoincrement unless JUSTID option provided */
       if (opts.retry >= 0) {
@@ -1514,6 +1531,7 @@ OpResult<uint32_t> OpAck(const OpArgs& op_args, string_view key, string_view gna
     streamNACK* nack = (streamNACK*)raxFind(res->cg->pel, buf, sizeof(buf));
     if (nack != raxNotFound) {
       raxRemove(res->cg->pel, buf, sizeof(buf), nullptr);
+      streamPelIndexRemove(res->cg, buf, nack);
       raxRemove(nack->consumer->pel, buf, sizeof(buf), nullptr);
       streamFreeNACK(nack);
       acknowledged++;
@@ -1523,6 +1541,59 @@ OpResult<uint32_t> OpAck(const OpArgs& op_args, string_view key, string_view gna
   return acknowledged;
 }
 
+// Collects the pending entries of the group that have been idle since at most `cutoff`, with IDs
+// in [start, end] and owned by `consumer` if it is set, sorted by ID. Uses the delivery time
+// index, so it costs the number of idle entries rather than the size of the PEL. Returns false
+// if more than `limit` idle entries exist: they are dense enough then for a scan in ID order to
+// find the requested ones quickly.
+bool CollectIdlePending(streamCG* cg, mstime_t cutoff, streamID start, streamID end,
+                        const streamConsumer* consumer, size_t limit,
+                        vector<pair<streamID, streamNACK*>>* dest) {
+  raxIterator ri;
+  raxStart(&ri, cg->pel_by_time);
+  raxSeek(&ri, "^", nullptr, 0);
+
+  size_t scanned = 0;
+  bool complete = true;
+  while (raxNext(&ri)) {
+    DCHECK_EQ(ri.key_len, STREAM_PEL_TIME_KEY_LEN);
+    streamNACK* nack = static_cast<streamNACK*>(ri.data);
+    if (nack->delivery_time > cutoff)
+      break;
+
+    if (++scanned > limit) {
+      complete = false;
+      break;
+    }
+
+    streamID id;
+    streamDecodeID(ri.key + sizeof(uint64_t), &id);
+    if (streamCompareID(&id, &start) < 0 || streamCompareID(&id, &end) > 0)
+      continue;
+    if (consumer && nack->consumer != consumer)
+      continue;
+
+    dest->emplace_back(id, nack);
+  }
+  raxStop(&ri);
+
+  if (!complete) {
+    dest->clear();
+    return false;
+  }
+
+  sort(dest->begin(), dest->end(), [](const auto& a, const auto& b) {
+    return a.first.ms != b.first.ms ? a.first.ms < b.first.ms : a.first.seq < b.first.seq;
+  });
+  return true;
+}
+
+// XPENDING with IDLE reads up to max(count * 10, kMinIdleIndexScan) idle entries from the delivery
+// time index before it falls back to scanning the PEL in ID order. The count is bounded, so that
+// the product does not overflow.
+constexpr size_t kMinIdleIndexScan = 1024;
+constexpr int64_t kMaxIdleScanCount = INT64_MAX / 10;
+
 OpResult<ClaimInfo> OpAutoClaim(const OpArgs& op_args, string_view key, const ClaimOpts& opts) {
   auto cgr_res = FindGroup(op_args, key, opts.group, false);
   RETURN_ON_BAD_STATUS(cgr_res);
@@ -1541,8 +1612,10 @@ OpResult<ClaimInfo> OpAutoClaim(const OpArgs& op_args, string_view key, const Cl
   // https://redis.io/commands/xautoclaim/
   // The maximum number of pending entries that the command scans is the product of
   // multiplying <count>'s value by 10 (hard-coded).
-  int64_t attempts = opts.count * 10;
+  int64_t attempts = int64_t(opts.count) * 10;
 
+  // The delivery time index is not used here even with min-idle-time, since the scan must also
+  // report and release the deleted entries that are not idle yet.
   unsigned char start_key[sizeof(streamID)];
   streamID start_id = opts.start;
   streamEncodeID(start_key, &start_id);
@@ -1563,6 +1636,7 @@ OpResult<ClaimInfo> OpAutoClaim(const OpArgs& op_args, string_view key, const Cl
 
     if (!streamEntryExists(stream, &id)) {
       raxRemove(group->pel, ri.key, ri.key_len, nullptr);
+      streamPelIndexRemove(group, ri.key, nack);
       raxRemove(nack->consumer->pel, ri.key, ri.key_len, nullptr);
       streamFreeNACK(nack);
       result.deleted_ids.push_back(id);
@@ -1590,7 +1664,7 @@ OpResult<ClaimInfo> OpAutoClaim(const OpArgs& op_args, string_view key, const Cl
       }
     }
 
-    nack->delivery_time = now;
+    streamNACKSetDeliveryTime(group, ri.key, nack, now);
     if (!result.justid) {
       nack->delivery_count++;
     }
@@ -1680,12 +1754,36 @@ PendingReducedResult GetPendingReducedResult(streamCG* cg) {
   return result;
 }
 
+PendingExtendedResult MakePendingItem(streamID id, const streamNACK* nack, mstime_t now) {
+  /* Milliseconds elapsed since last delivery. */
+  mstime_t elapsed = now - nack->delivery_time;
+  if (elapsed < 0) {
+    elapsed = 0;
+  }
+
+  return {.start = id,
+          .consumer_name = nack->consumer->name,
+          .delivery_count = nack->delivery_count,
+          .elapsed = elapsed};
+}
+
 PendingExtendedResultList GetPendingExtendedResult(streamCG* cg, streamConsumer* consumer,
                                                    const PendingOpts& opts) {
   PendingExtendedResultList result;
   rax* pel = consumer ? consumer->pel : cg->pel;
   streamID sstart = opts.start.val, send = opts.end.val;
   auto now = GetCurrentTimeMs();
+
+  vector<pair<streamID, streamNACK*>> idle;
+  size_t idle_limit = max<size_t>(min(opts.count, kMaxIdleScanCount) * 10, kMinIdleIndexScan);
+  if (opts.min_idle_time > 0 && CollectIdlePending(cg, now - opts.min_idle_time, sstart, send,
+                                                   consumer, idle_limit, &idle)) {
+    size_t len = min<size_t>(idle.size(), opts.count);
+    result.reserve(len);
+    for (size_t i = 0; i < len; ++i)
+      result.push_back(MakePendingItem(idle[i].first, idle[i].second, now));
+    return result;
+  }
   unsigned char start_key[sizeof(streamID)];
   unsigned char end_key[sizeof(streamID)];
   raxIterator ri;
@@ -1714,18 +1812,7 @@ PendingExtendedResultList GetPendingExtendedResult(streamCG* cg, streamConsumer*
     /* Entry ID. */
     streamID id;
     streamDecodeID(ri.key, &id);
-
-    /* Milliseconds elapsed since last delivery. */
-    mstime_t elapsed = now - nack->delivery_time;
-    if (elapsed < 0) {
-      elapsed = 0;
-    }
-
-    PendingExtendedResult item = {.start = id,
-                                  .consumer_name = nack->consumer->name,
-                                  .delivery_count = nack->delivery_count,
-                                  .elapsed = elapsed};
-    result.push_back(item);
+    result.push_back(MakePendingItem(id, nack, now));
   }
   raxStop(&ri);
   return result;
@@ -2004,10 +2091,10 @@ struct StreamReplies {
   void SendRecord(const Record& record) const {
     rb->StartArray(2);
     rb->SendBulkString(StreamIdRepr(record.id));
-    rb->StartArray(record.kv_arr.size() * 2);
-    for (const auto& k_v : record.kv_arr) {
-      rb->SendBulkString(k_v.first);
-      rb->SendBulkString(k_v.second);
+    rb->StartArray(record.NumPairs() * 2);
+    for (size_t i = 0; i < record.NumPairs(); ++i) {
+      rb->SendBulkString(record.Field(i));
+      rb->SendBulkString(record.Value(i));
     }
   }
 
@@ -2908,14 +2995,14 @@ void StreamFamily::XInfo(CmdArgList args, const CommandContext& cmd_cntx) {
           rb->SendLong(sinfo->groups);
 
           rb->SendBulkString("first-entry");
-          if (sinfo->first_entry.kv_arr.size() != 0) {
+          if (sinfo->first_entry.NumPairs() != 0) {
             StreamReplies{rb}.SendRecord(sinfo->first_entry);
           } else {
             rb->SendNullArray();
           }
 
           rb->SendBulkString("last-entry");
-          if (sinfo->last_entry.kv_arr.size() != 0) {
+          if (sinfo->last_entry.NumPairs() != 0) {
             StreamReplies{rb}.SendRecord(sinfo->last_entry);
           } else {
             rb->SendNullArray();
@@ -110,6 +110,26 @@ TEST_F(StreamFamilyTest, Range) {
   EXPECT_THAT(sub1, ElementsAre("1-0", ArrLen(2)));
 }
 
+TEST_F(StreamFamilyTest, RangeFieldEncodings) {
+  // Same fields as the master entry, different fields, empty and integer-like values.
+  Run({"xadd", "key", "1-1", "f1", "v1", "f2", "12"});
+  Run({"xadd", "key", "1-2", "f1", "", "f2", "-5"});
+  Run({"xadd", "key", "1-3", "g", "long value, not inlined"});
+
+  auto resp = Run({"xrange", "key", "-", "+"});
+  ASSERT_THAT(resp, ArrLen(3));
+  auto sub_arr = resp.GetVec();
+  EXPECT_THAT(sub_arr[0].GetVec(),
+              ElementsAre("1-1", RespArray(ElementsAre("f1", "v1", "f2", "12"))));
+  EXPECT_THAT(sub_arr[1].GetVec(),
+              ElementsAre("1-2", RespArray(ElementsAre("f1", "", "f2", "-5"))));
+  EXPECT_THAT(sub_arr[2].GetVec(),
+              ElementsAre("1-3", RespArray(ElementsAre("g", "long value, not inlined"))));
+
+  resp = Run({"xrevrange", "key", "+", "-", "COUNT", "1"});
+  EXPECT_THAT(resp.GetVec(), ElementsAre("1-3", RespArray(ElementsAre("g", _))));
+}
+
 TEST_F(StreamFamilyTest, GroupCreate) {
   auto resp = Run({"xadd", "key", "1-*", "f1", "v1"});
   EXPECT_EQ(resp, "1-0");
@@ -699,6 +719,53 @@ TEST_F(StreamFamilyTest, XPending) {
   EXPECT_THAT(resp, ArrLen(0));
 }
 
+TEST_F(StreamFamilyTest, XPendingIdleIndex) {
+  for (string_view id : {"1-0", "1-1", "1-2", "1-3", "1-4"})
+    Run({"xadd", "foo", id, "k", "v"});
+  Run({"xgroup", "create", "foo", "group", "0"});
+
+  TEST_current_time_ms = 1000;
+  Run({"xreadgroup", "group", "group", "alice", "count", "2", "streams", "foo", ">"});
+  TEST_current_time_ms = 2000;
+  Run({"xreadgroup", "group", "group", "bob", "streams", "foo", ">"});
+  TEST_current_time_ms = 5000;
+
+  auto resp = Run({"xpending", "foo", "group", "IDLE", "3500", "-", "+", "10"});
+  EXPECT_THAT(resp,
+              RespArray(ElementsAre(RespArray(ElementsAre("1-0", "alice", IntArg(4000), _)),
+                                    RespArray(ElementsAre("1-1", "alice", IntArg(4000), _)))));
+
+  resp = Run({"xpending", "foo", "group", "IDLE", "2500", "1-1", "1-3", "2"});
+  EXPECT_THAT(resp, RespArray(ElementsAre(RespArray(ElementsAre("1-1", "alice", _, _)),
+                                          RespArray(ElementsAre("1-2", "bob", _, _)))));
+
+  resp = Run({"xpending", "foo", "group", "IDLE", "2500", "-", "+", "10", "bob"});
+  EXPECT_THAT(resp, ArrLen(3));
+
+  // Acknowledged and claimed entries leave or move in the delivery time order.
+  Run({"xack", "foo", "group", "1-1"});
+  resp = Run({"xautoclaim", "foo", "group", "carol", "3500", "0-0", "justid"});
+  EXPECT_THAT(resp, RespArray(ElementsAre("0-0", RespArray(ElementsAre("1-0")),
+                                          RespArray(ElementsAre()))));
+
+  resp = Run({"xpending", "foo", "group", "IDLE", "2500", "-", "+", "10"});
+  EXPECT_THAT(resp, RespArray(ElementsAre(RespArray(ElementsAre("1-2", "bob", _, _)),
+                                          RespArray(ElementsAre("1-3", "bob", _, _)),
+                                          RespArray(ElementsAre("1-4", "bob", _, _)))));
+
+  resp = Run({"xautoclaim", "foo", "group", "carol", "2500", "0-0", "count", "2", "justid"});
+  EXPECT_THAT(resp, RespArray(ElementsAre("1-4", RespArray(ElementsAre("1-2", "1-3")),
+                                          RespArray(ElementsAre()))));
+
+  // Deleted entries are released when they are reached.
+  Run({"xdel", "foo", "1-4"});
+  resp = Run({"xautoclaim", "foo", "group", "carol", "2500", "1-4"});
+  EXPECT_THAT(resp, RespArray(ElementsAre("0-0", RespArray(ElementsAre()),
+                                          RespArray(ElementsAre("1-4")))));
+  resp = Run({"xpending", "foo", "group", "-", "+", "10", "bob"});
+  EXPECT_THAT(resp, ArrLen(0));
+}
+
 TEST_F(StreamFamilyTest, XPendingInvalidArgs) {
   Run({"xadd", "foo", "1-0", "k1", "v1"});
   Run({"xadd", "foo", "1-1", "k2", "v2"});
@@ -946,6 +1013,36 @@ TEST_F(StreamFamilyTest, XAutoClaim) {
                                   RespArray(ElementsAre("1-2", "1-4")))));
 }
 
+TEST_F(StreamFamilyTest, XAutoClaimMinIdleDeleted) {
+  Run({"xadd", "foo", "1-0", "k1", "v1"});
+  Run({"xadd", "foo", "1-1", "k2", "v2"});
+  Run({"xadd", "foo", "1-2", "k3", "v3"});
+  Run({"xgroup", "create", "foo", "group", "0"});
+  Run({"xreadgroup", "group", "group", "alice", "streams", "foo", ">"});
+
+  AdvanceTime(1000);
+  Run({"xadd", "foo", "1-3", "k4", "v4"});
+  Run({"xreadgroup", "group", "group", "alice", "streams", "foo", ">"});
+  Run({"xdel", "foo", "1-1", "1-3"});
+
+  // Deleted entries are released even if they are not idle yet, as in Redis.
+  auto resp = Run({"xautoclaim", "foo", "group", "bob", "500", "0-0", "justid"});
+  EXPECT_THAT(resp, RespArray(ElementsAre("0-0", RespArray(ElementsAre("1-0", "1-2")),
+                                          RespArray(ElementsAre("1-1", "1-3")))));
+
+  resp = Run({"xpending", "foo", "group"});
+  EXPECT_THAT(resp, RespArray(ElementsAre(IntArg(2), "1-0", "1-2", _)));
+
+  // The claimed entries are not idle anymore.
+  resp = Run({"xpending", "foo", "group", "IDLE", "500", "-", "+", "10"});
+  EXPECT_THAT(resp, ArrLen(0));
+  AdvanceTime(1000);
+  resp = Run({"xpending", "foo", "group", "IDLE", "500", "-", "+", "9223372036854775807"});
+  EXPECT_THAT(resp, ArrLen(2));
+  resp = Run({"xautoclaim", "foo", "group", "bob", "500", "0-0", "count", "2147483647", "justid"});
+  EXPECT_THAT(resp, RespArray(ElementsAre("0-0", RespArray(ElementsAre("1-0", "1-2")), ArrLen(0))));
+}
+
 TEST_F(StreamFamilyTest, XInfoStream) {
   Run({"del", "mystream"});
   Run({"xgroup", "create", "mystream", "mygroup", "$", "MKSTREAM"});
@@ -1249,7 +1249,8 @@ ShardArgs Transaction::GetShardArgs(ShardId sid) const {
 }
 
 OpStatus Transaction::WaitOnWatch(const time_point& tp, WaitKeysProvider wkeys_provider,
-                                  KeyReadyChecker krc, bool* block_flag, bool* pause_flag) {
+                                  KeyReadyChecker krc, bool* block_flag, bool* pause_flag,
+                                  BlockingHandOff* handoff) {
   if (blocking_barrier_.IsClaimed()) {  // Might have been cancelled ahead by a dropping connection
     Conclude();
     return OpStatus::CANCELLED;
@@ -1260,7 +1261,7 @@ OpStatus Transaction::WaitOnWatch(const time_point& tp, WaitKeysProvider wkeys_p
   // Register keys on active shards blocking controllers and mark shard state as suspended.
   auto cb = [&](Transaction* t, EngineShard* shard) {
     auto keys = wkeys_provider(t, shard);
-    return t->WatchInShard(&t->GetNamespace(), keys, shard, krc);
+    return t->WatchInShard(&t->GetNamespace(), keys, shard, krc, handoff);
   };
   Execute(std::move(cb), true);
 
@@ -1300,14 +1301,14 @@ OpStatus Transaction::WaitOnWatch(const time_point& tp, WaitKeysProvider wkeys_p
 }
 
 OpStatus Transaction::WatchInShard(Namespace* ns, BlockingController::Keys keys, EngineShard* shard,
-                                   KeyReadyChecker krc) {
+                                   KeyReadyChecker krc, BlockingHandOff* handoff) {
   auto& sd = shard_data_[SidToId(shard->shard_id())];
 
   CHECK_EQ(0, sd.local_mask & SUSPENDED_Q);
   sd.local_mask |= SUSPENDED_Q;
   sd.local_mask &= ~OUT_OF_ORDER;
 
-  ns->GetOrAddBlockingController(shard)->AddWatched(keys, std::move(krc), this);
+  ns->GetOrAddBlockingController(shard)->AddWatched(keys, std::move(krc), this, handoff);
   DVLOG(2) << "WatchInShard " << DebugId();
 
   return OpStatus::OK;
@@ -1552,6 +1553,7 @@ OpResult<KeyIndex> DetermineKeys(const CommandId* cid, CmdArgList args) {
     // ZUNION/INTER <num_keys> <key1> [<key2> ...]
     // EVAL <script> <num_keys>
     // XREAD ... STREAMS ...
+    // CMS.MERGE <dest> <num_keys> <key1> [<key2> ...]
     if (args.size() < 2)
       return OpStatus::SYNTAX_ERR;
 
@@ -1572,8 +1574,8 @@ OpResult<KeyIndex> DetermineKeys(const CommandId* cid, CmdArgList args) {
       return OpStatus::SYNTAX_ERR;
     }
 
-    if (absl::EndsWith(name, "STORE"))
-      bonus = 0;  // Z<xxx>STORE <key> commands
+    if (absl::EndsWith(name, "STORE") || absl::EndsWith(name, ".MERGE"))
+      bonus = 0;  // Z<xxx>STORE <key> and <type>.MERGE <key> commands
 
     unsigned num_keys_index;
     if (absl::StartsWith(name, "EVAL"))
@@ -217,8 +217,10 @@ class Transaction {
   // or b) tp is reached. If tp is time_point::max() then waits indefinitely.
   // Expects that the transaction had been scheduled before, and uses Execute(.., true) to register.
   // Returns false if timeout occurred, true if was notified by one of the keys.
+  // If handoff is set, pushers may deliver a value into it directly when waking the transaction.
   facade::OpStatus WaitOnWatch(const time_point& tp, WaitKeysProvider cb, KeyReadyChecker krc,
-                               bool* block_flag, bool* pause_flag);
+                               bool* block_flag, bool* pause_flag,
+                               BlockingHandOff* handoff = nullptr);
 
   // Returns true if transaction is awaked, false if it's timed-out and can be removed from the
   // blocking queue.
@@ -532,7 +534,7 @@ class Transaction {
 
   // Adds itself to watched queue in the shard. Must run in that shard thread.
   OpStatus WatchInShard(Namespace* ns, std::variant<ShardArgs, ArgSlice> keys, EngineShard* shard,
-                        KeyReadyChecker krc);
+                        KeyReadyChecker krc, BlockingHandOff* handoff);
 
   // Expire blocking transaction, unlock keys and unregister it from the blocking controller
   void ExpireBlocking(WaitKeysProvider wcb);
@@ -7,6 +7,7 @@
 #include <absl/types/span.h>
 
 #include <optional>
+#include <string>
 
 #include "base/iterator.h"
 #include "src/facade/facade_types.h"
@@ -122,6 +123,13 @@ class LockTag {
 using KeyReadyChecker =
     std::function<bool(EngineShard*, const DbContext& context, Transaction* tx, std::string_view)>;
 
+// Slot through which a push can deliver a value straight to a suspended blocking pop instead of
+// storing it in the watched key first. Owned by the blocked command for the whole wait.
+struct BlockingHandOff {
+  bool pop_front = true;             // which end of the container the waiter pops from
+  std::optional<std::string> value;  // set by the pusher when it hands a value off
+};
+
 // References arguments in another array.
 using IndexSlice = std::pair<uint32_t, uint32_t>;  // [begin, end)
 